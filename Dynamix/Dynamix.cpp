@@ -5,9 +5,16 @@
 #include <string>
 #include <iostream>
 #include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <filesystem>
 #include <AstNode.h>
 #include <Interpreter.h>
 #include <Parser.h>
+#include <Jit.h>
+#include <CppTranslator.h>
+#include <SlabAllocator.h>
+#include <ModuleCache.h>
 
 using namespace Dynamix;
 using namespace std;
@@ -19,7 +26,7 @@ void ShowErrors(Parser const& p, bool repl = false) {
 		if (repl)
 			println("{}", e.Description());
 		else
-			println("({},{}): {}", e.Location().Line, e.Location().Col, e.Description());
+			println("{}({},{}): {}", e.Location().FileName(), e.Location().Line, e.Location().Col, e.Description());
 	}
 }
 
@@ -88,10 +95,56 @@ int RunRepl(Parser& p, Interpreter& intr) {
 	return 0;
 }
 
+OptimizerPasses DisabledPass(const char* option) {
+	static const pair<const char*, OptimizerPasses> options[] = {
+		{ "-Ono-fold", OptimizerPasses::ConstantFolding },
+		{ "-Ono-propagate", OptimizerPasses::ConstantPropagation },
+		{ "-Ono-branches", OptimizerPasses::DeadBranches },
+		{ "-Ono-unreachable", OptimizerPasses::UnreachableCode },
+	};
+	for (auto& [name, pass] : options)
+		if (_stricmp(option, name) == 0)
+			return pass;
+	return OptimizerPasses::None;
+}
+
+int CompileProgram(vector<CppTranslator::Source> const& sources, string output) {
+	if (output.empty())
+		output = filesystem::path(sources[0].FileName).replace_extension(".cpp").string();
+
+	CppTranslator translator;
+	auto code = translator.Translate(sources);
+	ofstream out(output, ios::binary);
+	if (!out || !out.write(code.data(), code.size())) {
+		println("Cannot write {}", output);
+		return 1;
+	}
+	println("{}: {} functions translated, {} interpreted", output, translator.Translated().size(), translator.Interpreted().size());
+	for (auto& name : translator.Interpreted())
+		println("\tinterpreted: {}", name);
+	println("Build with the DynamixCore headers and library, e.g. g++ -std=c++20 -O2 -I DynamixCore {} <DynamixCore library>", output);
+	return 0;
+}
+
 void Usage() {
 	println("Dynamix v0.1");
 	println("Usage:\tdynamix run <file> [file]...[-- params] (parse files and run Main function)");
 	println("\tdynamix load [file]...                  (parse files and run REPL)");
+	println("\tdynamix compile <file>... [-o out.cpp]  (translate the program to C++ to build a native executable)");
+	println("Options:\t-vm                             (execute with the bytecode VM)");
+	println("\t-jit                                    (execute with the bytecode VM, compiling hot functions to machine code)");
+	println("\t-tiered                                 (start on the tree-walker, compiling hot functions in the background)");
+	println("\t-perfmap                                (with -jit, write /tmp/perf-<pid>.map for perf)");
+	println("\t-depth:<calls>                          (fail calls nested deeper than this, default {})", Interpreter::DefaultMaxCallDepth);
+	println("\t-gc:<objects>                           (collect reference cycles after this many objects are created; 0 never)");
+	println("\t-gcstats                                (print what the cycle collector freed and how long it paused)");
+	println("\t-nursery                                (bump-allocate objects in chunks that are reused whole once empty)");
+	println("\t-confined                               (count object references without atomics; scripts run on one thread)");
+	println("\t-stack:<MB>                             (run scripts on a dedicated stack of this size)");
+	println("\t-cache[:<dir>]                          (keep parsed files as .dxc modules next to them, or in dir, and load those)");
+	println("\t-O0                                     (parse files that follow without optimizing them)");
+	println("\t-Ono-fold, -Ono-propagate, -Ono-branches, -Ono-unreachable");
+	println("\t                                        (turn off one optimizer pass for files that follow)");
 }
 
 int main(int argc, const char* argv[], const char* envp[]) {
@@ -103,7 +156,8 @@ int main(int argc, const char* argv[], const char* envp[]) {
 	enum Command {
 		Invalid,
 		Run,
-		Load
+		Load,
+		Compile
 	};
 
 	auto cmd = Command::Invalid;
@@ -112,6 +166,8 @@ int main(int argc, const char* argv[], const char* envp[]) {
 		cmd = Command::Run;
 	else if (_stricmp(argv[1], "load") == 0)
 		cmd = Command::Load;
+	else if (_stricmp(argv[1], "compile") == 0)
+		cmd = Command::Compile;
 	else {
 		println("Unknown command: {}", argv[1]);
 		Usage();
@@ -120,17 +176,103 @@ int main(int argc, const char* argv[], const char* envp[]) {
 
 	Tokenizer t;
 	Parser p(t);
+	p.SetOptimizations(OptimizerPasses::All);
 	Runtime rt;
 	Interpreter intr(rt);
 
 	vector<unique_ptr<Statements>> program;
 	bool error = false;
 	int params = 0;
+	bool perfMap = false;
+	bool gcStats = false;
+	vector<CppTranslator::Source> sources;
+	string output;
+	unique_ptr<ModuleCache> cache;
 	for (int i = 2; i < argc; i++) {
 		if (_stricmp(argv[i], "--") == 0) {
 			params = i + 1;
 			break;
 		}
+		if (_stricmp(argv[i], "-vm") == 0) {
+			intr.SetEngine(ExecutionEngine::Bytecode);
+			continue;
+		}
+		if (_stricmp(argv[i], "-jit") == 0) {
+			intr.SetEngine(ExecutionEngine::Jit);
+			if (!intr.GetJit())
+				println("JIT not supported on this platform, running the bytecode VM");
+			continue;
+		}
+		if (_stricmp(argv[i], "-tiered") == 0) {
+			intr.SetEngine(ExecutionEngine::Tiered);
+			continue;
+		}
+		if (_stricmp(argv[i], "-perfmap") == 0) {
+			perfMap = true;
+			continue;
+		}
+		if (_strnicmp(argv[i], "-depth:", 7) == 0) {
+			intr.SetMaxCallDepth(atoi(argv[i] + 7));
+			continue;
+		}
+		if (_strnicmp(argv[i], "-gc:", 4) == 0) {
+			rt.GetCollector().SetThreshold(atoi(argv[i] + 4));
+			continue;
+		}
+		if (_stricmp(argv[i], "-gcstats") == 0) {
+			gcStats = true;
+			continue;
+		}
+		if (_stricmp(argv[i], "-nursery") == 0) {
+			rt.SetHeapMode(HeapMode::Nursery);
+			continue;
+		}
+		if (_stricmp(argv[i], "-confined") == 0) {
+			rt.SetThreadingMode(ThreadingMode::Confined);
+			continue;
+		}
+		if (_strnicmp(argv[i], "-stack:", 7) == 0) {
+			intr.SetStackSize(size_t(atoi(argv[i] + 7)) << 20);
+			continue;
+		}
+		if (_strnicmp(argv[i], "-cache", 6) == 0 && (argv[i][6] == 0 || argv[i][6] == ':')) {
+			cache = make_unique<ModuleCache>(argv[i][6] ? argv[i] + 7 : "");
+			p.SetModuleCache(cache.get());
+			continue;
+		}
+		if (_stricmp(argv[i], "-O0") == 0) {
+			p.SetOptimizations(OptimizerPasses::None);
+			continue;
+		}
+		if (auto pass = DisabledPass(argv[i]); pass != OptimizerPasses::None) {
+			p.SetOptimizations(p.Optimizations() & (OptimizerPasses::All ^ pass));
+			continue;
+		}
+		if (cmd == Command::Compile) {
+			if (_stricmp(argv[i], "-o") == 0 && i + 1 < argc) {
+				output = argv[++i];
+				continue;
+			}
+			//
+			// the generated program parses the same text the same way to find the nodes it refers to
+			//
+			ifstream in(argv[i], ios::binary);
+			if (!in) {
+				println("Cannot open {}", argv[i]);
+				error = true;
+				continue;
+			}
+			string text{ istreambuf_iterator<char>(in), istreambuf_iterator<char>() };
+			auto code = p.Parse(text);
+			if (!code) {
+				ShowErrors(p);
+				error = true;
+				continue;
+			}
+			sources.push_back({ argv[i], move(text), p.Optimizations(), code.get() });
+			program.push_back(move(code));
+			continue;
+		}
 		auto code = p.ParseFile(argv[i]);
 		if (!code) {
 			ShowErrors(p);
@@ -144,6 +286,17 @@ int main(int argc, const char* argv[], const char* envp[]) {
 	if (error)
 		return 0;
 
+	if (cmd == Command::Compile) {
+		if (sources.empty()) {
+			Usage();
+			return 1;
+		}
+		return CompileProgram(sources, output);
+	}
+
+	if (auto jit = intr.GetJit(); jit && perfMap)
+		jit->EnablePerfMap(true);
+
 	Value result;
 	for (auto& code : program) {
 		result = intr.Eval(code.get());
@@ -168,6 +321,26 @@ int main(int argc, const char* argv[], const char* envp[]) {
 		}
 	}
 
+	if (gcStats) {
+		auto& gc = rt.GetCollector();
+		gc.Collect();
+		auto& stats = gc.GetStats();
+		println("Cycle collections: {}, objects freed: {}, longest pause: {} us, total pause: {} us", stats.Collections, stats.Freed,
+			chrono::duration_cast<chrono::microseconds>(stats.MaxPause).count(), chrono::duration_cast<chrono::microseconds>(stats.TotalPause).count());
+		if (auto heap = rt.GetHeap()) {
+			auto& heapStats = heap->GetStats();
+			println("Nursery objects: {} ({} KB), chunks reclaimed: {}, promoted: {}, still old: {}", heapStats.Allocated, heapStats.AllocatedBytes >> 10,
+				heapStats.Reclaimed, heapStats.Promoted, heapStats.OldChunks);
+		}
+#ifndef _WIN32
+		auto slabs = SlabAllocator::GetStats();
+		size_t live = 0;
+		for (auto& c : slabs.Classes)
+			live += c.LiveBytes;
+		println("Slabs: {} ({} KB), live: {} KB", slabs.Slabs, slabs.Slabs * SlabAllocator::SlabSize >> 10, live >> 10);
+#endif
+	}
+
 	return 0;
 }
 
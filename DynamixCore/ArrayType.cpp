@@ -17,6 +17,13 @@ ArrayObject* ArrayType::CreateArray(std::vector<Value> args) {
 	return new ArrayObject(std::move(args));
 }
 
+Value ArrayType::CreateArrayValue(std::vector<Value> args) {
+	auto array = CreateArray(std::move(args));
+	Value value(array);
+	array->Release();
+	return value;
+}
+
 Value ArrayObject::InvokeGetIndexer(Value const& index) {
 	if (index.IsObject() && index.ToObject()->Type() == RangeType::Get()) {
 		// slicing
@@ -30,7 +37,7 @@ void ArrayObject::InvokeSetIndexer(Value const& index, Value const& value, Token
 	if (!index.IsInteger())
 		throw RuntimeError(RuntimeErrorType::TypeMismatch, "Array index must be an integer");
 	auto i = ValidateIndex(index.ToInteger());
-	m_Items[i].Assign(value, assign);
+	Publish(m_Items[i].Assign(value, assign));
 }
 
 void ArrayObject::Reverse() noexcept {
@@ -47,6 +54,18 @@ SliceObject* ArrayObject::Slice(Int start, Int count) {
 	return new SliceObject(this, start, count);
 }
 
+void ArrayObject::GetReferences(std::vector<RuntimeObject const*>& refs) const {
+	RuntimeObject::GetReferences(refs);
+	for (auto& item : m_Items)
+		if (item.IsObject())
+			refs.push_back(item.AsObject());
+}
+
+void ArrayObject::ReleaseReferences() noexcept {
+	RuntimeObject::ReleaseReferences();
+	m_Items.clear();
+}
+
 ArrayType::ArrayType() : StaticObjectType("Array") {
 	BEGIN_METHODS(ArrayObject)
 		METHOD(Count, 0, return inst->Count();),
@@ -85,6 +104,7 @@ void* ArrayObject::QueryService(ServiceId id) noexcept {
 }
 
 Int ArrayObject::Add(Value item) {
+	Publish(item);
 	m_Items.push_back(std::move(item));
 	return Int(m_Items.size());
 }
@@ -97,6 +117,7 @@ Int ArrayObject::RemoveAt(Int index) {
 
 Int ArrayObject::Insert(Int index, Value item) {
 	ValidateIndex(index);
+	Publish(item);
 	m_Items.insert(m_Items.begin() + index, std::move(item));
 	return Int(m_Items.size());
 }
@@ -106,6 +127,7 @@ Int ArrayObject::Append(Value list) {
 	if (obj->Type()->Name() != Type()->Name())
 		throw RuntimeError(RuntimeErrorType::TypeMismatch, "Cannot append non-array to array");
 	auto other = ObjectType::GetInstance<ArrayObject>(obj);
+	Publish(list);
 	m_Items.insert(m_Items.end(), other->m_Items.begin(), other->m_Items.end());
 	return Int(m_Items.size());
 }
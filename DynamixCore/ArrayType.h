@@ -13,6 +13,8 @@ namespace Dynamix {
 		static ArrayType* Get();
 
 		ArrayObject* CreateArray(std::vector<Value> args);
+		// an array referenced only by the returned value
+		Value CreateArrayValue(std::vector<Value> args);
 
 	private:
 		ArrayType();
@@ -66,6 +68,9 @@ namespace Dynamix {
 		void Reverse() noexcept;
 		void ForEach(AstNode const* code);
 
+		void GetReferences(std::vector<RuntimeObject const*>& refs) const override;
+		void ReleaseReferences() noexcept override;
+
 	protected:
 		Int ValidateIndex(Int index) const;
 
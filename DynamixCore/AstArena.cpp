@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <new>
+
+#include "AstArena.h"
+#include "AstNode.h"
+#include "SlabAllocator.h"
+
+using namespace Dynamix;
+using namespace std;
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+static const HANDLE s_hHeap = ::HeapCreate(HEAP_NO_SERIALIZE, 2 << 20, 0);
+
+#endif
+
+//
+// every node is preceded by the arena it lives in, null for nodes outside any arena.
+// the low bits of an arena's node say whether it is to be released, and whether it was deleted before the arena
+//
+namespace {
+	constexpr size_t HeaderSize = sizeof(uintptr_t);
+	constexpr uintptr_t Released = 1, Deleted = 2, Flags = Released | Deleted;
+
+	uintptr_t& HeaderOf(void const* p) noexcept {
+		return static_cast<uintptr_t*>(const_cast<void*>(p))[-1];
+	}
+
+	// the start of the node, where the header is, whatever base it is seen through
+	uintptr_t& HeaderOf(AstNode const* node) noexcept {
+		return HeaderOf(dynamic_cast<void const*>(node));
+	}
+
+	void* AllocateOutside(size_t size) {
+#ifdef _WIN32
+		auto block = ::HeapAlloc(s_hHeap, 0, size);
+		if (!block)
+			throw bad_alloc();
+		return block;
+#else
+		return SlabAllocator::Allocate(size);
+#endif
+	}
+
+	void FreeOutside(void* block, size_t size) noexcept {
+#ifdef _WIN32
+		::HeapFree(s_hHeap, 0, block);
+#else
+		SlabAllocator::Free(block, size);
+#endif
+	}
+}
+
+AstArena::Scope::Scope(AstArena* arena) noexcept : m_Previous(s_Current) {
+	s_Current = arena;
+}
+
+AstArena::Scope::~Scope() {
+	s_Current = m_Previous;
+}
+
+AstArena::~AstArena() {
+	for (auto node : m_Release)
+		if ((HeaderOf(node) & Deleted) == 0)
+			const_cast<AstNode*>(node)->ReleaseOutsideArena();
+	for (auto chunk : m_Chunks)
+		::operator delete(chunk);
+}
+
+pmr::memory_resource* AstArena::Resource() noexcept {
+	if (s_Current)
+		return s_Current;
+	return pmr::new_delete_resource();
+}
+
+void* AstArena::AllocateNode(size_t size) {
+	auto arena = s_Current;
+	auto block = static_cast<uintptr_t*>(arena ? arena->Bump(HeaderSize + size, NodeAlignment) : AllocateOutside(HeaderSize + size));
+	*block = reinterpret_cast<uintptr_t>(arena);
+	if (arena)
+		arena->m_Stats.Nodes++;
+	return block + 1;
+}
+
+void AstArena::FreeNode(void* p, size_t size) noexcept {
+	// nodes in an arena go with it
+	if (auto& header = HeaderOf(p); header == 0)
+		FreeOutside(&header, HeaderSize + size);
+	else
+		header |= Deleted;
+}
+
+AstArena* AstArena::Of(AstNode const* node) noexcept {
+	return reinterpret_cast<AstArena*>(HeaderOf(node) & ~Flags);
+}
+
+void AstArena::AddRelease(AstNode const* node) {
+	auto& header = HeaderOf(node);
+	if (header & Released)
+		return;
+	header |= Released;
+	m_Release.push_back(node);
+	m_Stats.Released++;
+}
+
+void AstArena::Adopt(unique_ptr<AstArena> other) {
+	m_Adopted.push_back(move(other));
+}
+
+void* AstArena::do_allocate(size_t bytes, size_t alignment) {
+	return Bump(bytes, alignment);
+}
+
+char* AstArena::Bump(size_t bytes, size_t alignment) {
+	auto align = [=](char* p) {
+		return reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + alignment - 1) & ~uintptr_t(alignment - 1));
+	};
+	auto next = align(m_Next);
+	if (m_Next == nullptr || m_End - next < ptrdiff_t(bytes)) {
+		auto chunkSize = max(ChunkSize, bytes + alignment);
+		m_Next = static_cast<char*>(::operator new(chunkSize));
+		m_End = m_Next + chunkSize;
+		m_Chunks.push_back(m_Next);
+		m_Stats.Chunks++;
+		next = align(m_Next);
+	}
+	m_Next = next + bytes;
+	m_Stats.Bytes += bytes;
+	return next;
+}
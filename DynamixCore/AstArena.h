@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+#include "NoCopyMove.h"
+
+namespace Dynamix {
+	class AstNode;
+
+	// the vectors a node owns; in a parsed tree their memory comes from its arena
+	template<typename T>
+	using AstVector = std::pmr::vector<T>;
+
+	//
+	// the memory of a parsed tree: its nodes one after another in the order they are created, and the vectors they own.
+	// the parser makes a tree's arena current while building it, and the root Statements owns it.
+	// the tree goes without running a node destructor: the few nodes holding something outside the arena
+	// (compiled code, objects in literals, functions the tiered compiler knows) are released, then the chunks are freed.
+	// nodes must not outlive the tree they were parsed into, and nodes put into it must be created while its arena is current
+	//
+	class AstArena final : public std::pmr::memory_resource, NoCopy {
+	public:
+		static constexpr size_t ChunkSize = 64 << 10;
+		// nodes need no more than pointer alignment
+		static constexpr size_t NodeAlignment = alignof(void*);
+
+		struct Stats {
+			size_t Nodes{ 0 };
+			size_t Bytes{ 0 };
+			size_t Chunks{ 0 };
+			size_t Released{ 0 };
+		};
+
+		//
+		// nodes created on this thread go to the arena while the scope lives
+		//
+		class Scope final : NoCopy {
+		public:
+			explicit Scope(AstArena* arena) noexcept;
+			~Scope();
+
+		private:
+			AstArena* m_Previous;
+		};
+
+		AstArena() = default;
+		~AstArena();
+
+		static AstArena* Current() noexcept {
+			return s_Current;
+		}
+		// where the vectors of a node created now get their memory
+		static std::pmr::memory_resource* Resource() noexcept;
+
+		// memory for a node, from the current arena if there is one
+		static void* AllocateNode(size_t size);
+		static void FreeNode(void* p, size_t size) noexcept;
+		// null for a node outside any arena
+		static AstArena* Of(AstNode const* node) noexcept;
+
+		// the node holds something outside the arena, to release when the arena goes unless the node is deleted first
+		void AddRelease(AstNode const* node);
+		// keeps the arena of nodes moved in from another tree alive along with this one
+		void Adopt(std::unique_ptr<AstArena> other);
+
+		Stats const& GetStats() const noexcept {
+			return m_Stats;
+		}
+
+	protected:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void*, size_t, size_t) noexcept override {}
+		bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {
+			return this == &other;
+		}
+
+	private:
+		char* Bump(size_t bytes, size_t alignment);
+
+		std::vector<char*> m_Chunks;
+		char* m_Next{ nullptr };
+		char* m_End{ nullptr };
+		std::vector<AstNode const*> m_Release;
+		std::vector<std::unique_ptr<AstArena>> m_Adopted;
+		Stats m_Stats;
+		inline static thread_local AstArena* s_Current;
+	};
+}
@@ -1,42 +1,34 @@
 #include "AstNode.h"
+#include "AstTables.h"
+#include "TieredCompiler.h"
 #include <format>
 
 using namespace Dynamix;
 using namespace std;
 
-static size_t g_AstNodeCount;
-static size_t g_TotalMemory;
-
-#ifdef _WIN32
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-static const HANDLE s_hHeap = ::HeapCreate(HEAP_NO_SERIALIZE, 2 << 20, 0);
-#endif
+static_assert(alignof(Value) <= AstArena::NodeAlignment && alignof(shared_ptr<CodeChunk>) <= AstArena::NodeAlignment);
 
 void* AstNode::operator new(size_t size) {
-	++g_AstNodeCount;
-	g_TotalMemory += size;
-#ifdef _WIN32
-	return ::HeapAlloc(s_hHeap, 0, size);
-#else
-	return ::operator new(size);
-#endif
+	return AstArena::AllocateNode(size);
 }
 
 void AstNode::operator delete(void* p, size_t size) {
-	--g_AstNodeCount;
-	g_TotalMemory -= size;
-#ifdef _WIN32
-	::HeapFree(s_hHeap, 0, p);
-#else
-	return ::operator delete(p);
-#endif
+	AstArena::FreeNode(p, size);
+}
+
+void AstNode::SetCompiledCode(shared_ptr<CodeChunk> code) const {
+	if (code)
+		if (auto arena = AstArena::Of(this))
+			arena->AddRelease(this);
+	m_Code = move(code);
+}
+
+void AstNode::ReleaseOutsideArena() noexcept {
+	m_Code.reset();
 }
 
 BinaryExpression::BinaryExpression(unique_ptr<Expression> left, TokenType op, unique_ptr<Expression> right)
 	: m_Left(move(left)), m_Right(move(right)), m_Operator(op) {
-	m_Left->SetParent(this);
-	m_Right->SetParent(this);
 }
 
 Value BinaryExpression::Accept(Visitor* visitor) const {
@@ -47,8 +39,8 @@ string BinaryExpression::ToString() const {
 	return format("({} {} {})", m_Left->ToString(), Token::TypeToString(m_Operator), m_Right->ToString());
 }
 
-GetMemberExpression::GetMemberExpression(unique_ptr<Expression> left, string member, TokenType op) noexcept 
-	: m_Left(move(left)), m_Member(move(member)), m_Operator(op) {
+GetMemberExpression::GetMemberExpression(unique_ptr<Expression> left, Atom member, TokenType op) noexcept 
+	: m_Left(move(left)), m_Member(member), m_Operator(op) {
 }
 
 Expression const* GetMemberExpression::Left() const noexcept {
@@ -56,7 +48,7 @@ Expression const* GetMemberExpression::Left() const noexcept {
 }
 
 std::string const& GetMemberExpression::Member() const noexcept {
-	return m_Member;
+	return m_Member.ToString();
 }
 
 Value GetMemberExpression::Accept(Visitor* visitor) const {
@@ -71,7 +63,15 @@ Expression* BinaryExpression::Right() const noexcept {
 	return m_Right.get();
 }
 
-LiteralExpression::LiteralExpression(Value value) noexcept : m_Value(move(value)) {
+LiteralExpression::LiteralExpression(Value value) : m_Value(move(value)) {
+	if (m_Value.OwnsStorage())
+		if (auto arena = AstArena::Of(this))
+			arena->AddRelease(this);
+}
+
+void LiteralExpression::ReleaseOutsideArena() noexcept {
+	m_Value.Free();
+	AstNode::ReleaseOutsideArena();
 }
 
 Value LiteralExpression::Accept(Visitor* visitor) const {
@@ -86,7 +86,7 @@ Value const& LiteralExpression::Literal() const noexcept {
 	return m_Value;
 }
 
-NameExpression::NameExpression(string name) : m_Name(move(name)) {
+NameExpression::NameExpression(Atom name) : m_Name(name) {
 }
 
 Value NameExpression::Accept(Visitor* visitor) const {
@@ -98,15 +98,14 @@ Dynamix::TokenType BinaryExpression::Operator() const noexcept {
 }
 
 string const& NameExpression::Name() const noexcept {
-	return m_Name;
+	return m_Name.ToString();
 }
 
 string NameExpression::ToString() const {
-	return m_Name;
+	return m_Name.ToString();
 }
 
 UnaryExpression::UnaryExpression(TokenType op, unique_ptr<Expression> arg) noexcept : m_Operator(op), m_Arg(move(arg)) {
-	m_Arg->SetParent(this);
 }
 
 Value UnaryExpression::Accept(Visitor* visitor) const {
@@ -125,10 +124,8 @@ Expression* UnaryExpression::Arg() const noexcept {
 	return m_Arg.get();
 }
 
-VarValStatement::VarValStatement(string name, SymbolFlags flags, unique_ptr<Expression> init) noexcept
-	: m_Name(move(name)), m_Init(move(init)), m_Flags(flags) {
-	if (m_Init)
-		m_Init->SetParent(this);
+VarValStatement::VarValStatement(Atom name, SymbolFlags flags, unique_ptr<Expression> init) noexcept
+	: m_Name(name), m_Init(move(init)), m_Flags(flags) {
 }
 
 Value VarValStatement::Accept(Visitor* visitor) const {
@@ -140,7 +137,7 @@ string VarValStatement::ToString() const {
 }
 
 string const& VarValStatement::Name() const noexcept {
-	return m_Name;
+	return m_Name.ToString();
 }
 
 Expression const* VarValStatement::Init() const noexcept {
@@ -155,9 +152,8 @@ bool VarValStatement::IsStatic() const noexcept {
 	return (m_Flags & SymbolFlags::Static) == SymbolFlags::Static;
 }
 
-AssignExpression::AssignExpression(string lhs, unique_ptr<Expression> rhs, TokenType assignType) noexcept
-	: m_Lhs(move(lhs)), m_Value(move(rhs)), m_AssignType(assignType) {
-	m_Value->SetParent(this);
+AssignExpression::AssignExpression(Atom lhs, unique_ptr<Expression> rhs, TokenType assignType) noexcept
+	: m_Lhs(lhs), m_Value(move(rhs)), m_AssignType(assignType) {
 }
 
 Value AssignExpression::Accept(Visitor* visitor) const {
@@ -180,7 +176,7 @@ Expression const* AccessArrayExpression::Index() const noexcept {
 }
 
 string const& AssignExpression::Lhs() const noexcept {
-	return m_Lhs;
+	return m_Lhs.ToString();
 }
 
 Expression const* AssignExpression::Value() const noexcept {
@@ -195,10 +191,8 @@ string AssignExpression::ToString() const {
 	return format("{} {} {}", Lhs(), Token::TypeToString(AssignType()), Value()->ToString());
 }
 
-InvokeFunctionExpression::InvokeFunctionExpression(unique_ptr<Expression> callable, vector<unique_ptr<Expression>> args) :
-	m_Callable(move(callable)), m_Arguments(move(args)) {
-	for (auto& arg : m_Arguments)
-		arg->SetParent(this);
+InvokeFunctionExpression::InvokeFunctionExpression(unique_ptr<Expression> callable, vector<unique_ptr<Expression>> args) : m_Callable(move(callable)) {
+	m_Arguments.assign(make_move_iterator(args.begin()), make_move_iterator(args.end()));
 }
 
 Expression const* InvokeFunctionExpression::Callable() const {
@@ -211,8 +205,6 @@ Value InvokeFunctionExpression::Accept(Visitor* visitor) const {
 
 WhileStatement::WhileStatement(unique_ptr<Expression> condition, unique_ptr<Statement> body) :
 	m_Condition(move(condition)), m_Body(move(body)) {
-	m_Condition->SetParent(this);
-	m_Body->SetParent(this);
 }
 
 Value WhileStatement::Accept(Visitor* visitor) const {
@@ -244,10 +236,6 @@ Statement const* WhileStatement::Body() const noexcept {
 
 IfThenElseExpression::IfThenElseExpression(unique_ptr<Expression> condition, unique_ptr<Statement> thenExpr, unique_ptr<Statement> elseExpr) :
 	m_Condition(move(condition)), m_Then(move(thenExpr)), m_Else(move(elseExpr)) {
-	m_Condition->SetParent(this);
-	m_Then->SetParent(this);
-	if (m_Else)
-		m_Else->SetParent(this);
 }
 
 Value IfThenElseExpression::Accept(Visitor* visitor) const {
@@ -273,33 +261,46 @@ Statement const* IfThenElseExpression::Else() const noexcept {
 	return m_Else.get();
 }
 
-FunctionDeclaration::FunctionDeclaration(string name, bool method, bool isStatic) : m_Name(move(name)), m_Method(method), m_Static(isStatic) {
+FunctionEssentials::~FunctionEssentials() {
+	Forget();
+}
+
+void FunctionEssentials::Forget() noexcept {
+	if (m_Body)
+		TieredCompiler::Forget(m_Body.get());
+}
+
+FunctionDeclaration::FunctionDeclaration(string const& name, bool method, bool isStatic) : m_Name(name), m_Method(method), m_Static(isStatic) {
+	if (auto arena = AstArena::Of(this))
+		arena->AddRelease(this);
 }
 
 Value FunctionDeclaration::Accept(Visitor* visitor) const {
 	return visitor->VisitFunctionDeclaration(this);
 }
 
+void FunctionDeclaration::ReleaseOutsideArena() noexcept {
+	Forget();
+	AstNode::ReleaseOutsideArena();
+}
+
 string const& FunctionDeclaration::Name() const noexcept {
-	return m_Name;
+	return m_Name.ToString();
 }
 
 void FunctionDeclaration::SetBody(std::unique_ptr<Expression> body) noexcept {
 	m_Body = move(body);
-	m_Body->SetParent(this);
 }
 
 std::string FunctionDeclaration::ToString() const {
 	std::string params;
 	for (auto& param : Parameters())
-		(params += param.Name) += ", ";
+		(params += param.Name.ToString()) += ", ";
 	auto decl = format("fn {} ({})\n ", Name(), params.substr(0, params.length() - 2));
 	return decl + Body()->ToString();
 }
 
 ReturnStatement::ReturnStatement(unique_ptr<Expression> expr) : m_Expr(move(expr)) {
-	if (m_Expr)
-		m_Expr->SetParent(this);
 }
 
 Value ReturnStatement::Accept(Visitor* visitor) const {
@@ -360,18 +361,27 @@ Statement const* ForStatement::Body() const noexcept {
 }
 
 AnonymousFunctionExpression::AnonymousFunctionExpression(vector<Parameter> params, unique_ptr<Expression> body) {
-	m_Parameters = move(params);
+	SetParameters(move(params));
 	m_Body = move(body);
+	if (auto arena = AstArena::Of(this))
+		arena->AddRelease(this);
 }
 
 Value AnonymousFunctionExpression::Accept(Visitor* visitor) const {
 	return visitor->VisitAnonymousFunction(this);
 }
 
-EnumDeclaration::EnumDeclaration(std::string name, std::unordered_map<std::string, long long> values) : m_Name(move(name)), m_Values(move(values)) {
+void AnonymousFunctionExpression::ReleaseOutsideArena() noexcept {
+	Forget();
+	AstNode::ReleaseOutsideArena();
 }
 
-unordered_map<std::string, long long> const& EnumDeclaration::Values() const noexcept {
+EnumDeclaration::EnumDeclaration(std::string const& name, std::unordered_map<std::string, long long> const& values) : m_Name(name) {
+	for (auto& [value, number] : values)
+		m_Values.emplace(Atom(value), number);
+}
+
+pmr::unordered_map<Atom, long long> const& EnumDeclaration::Values() const noexcept {
 	return m_Values;
 }
 
@@ -380,10 +390,10 @@ Value EnumDeclaration::Accept(Visitor* visitor) const {
 }
 
 string const& EnumDeclaration::Name() const noexcept {
-	return m_Name;
+	return m_Name.ToString();
 }
 
-vector<unique_ptr<Expression>> const& Dynamix::InvokeFunctionExpression::Arguments() const {
+AstVector<unique_ptr<Expression>> const& Dynamix::InvokeFunctionExpression::Arguments() const {
 	return m_Arguments;
 }
 
@@ -400,27 +410,63 @@ Value Statements::Accept(Visitor* visitor) const {
 	return visitor->VisitStatements(this);
 }
 
+Statements::Statements() noexcept = default;
+
+Statements::~Statements() noexcept {
+	// the nodes of a parsed tree go with its arena, without running their destructors
+	if (m_Arena)
+		for (auto& stmt : m_Stmts)
+			if (stmt && AstArena::Of(stmt.get()))
+				stmt.release();
+}
+
+unique_ptr<Statements> Statements::NewTree() {
+	AstArena::Scope outside(nullptr);
+	auto root = make_unique<Statements>();
+	root->SetArena(make_unique<AstArena>());
+	return root;
+}
+
+void Statements::SetArena(unique_ptr<AstArena> arena) noexcept {
+	m_Arena = move(arena);
+}
+
+void Statements::SetTables(unique_ptr<AstTables> tables) noexcept {
+	m_Tables = move(tables);
+}
+
 void Statements::Add(unique_ptr<Statement> stmt) {
-	stmt->SetParent(this);
 	m_Stmts.push_back(move(stmt));
 }
 
 Statement const* Statements::Append(std::unique_ptr<Statements> stmts) {
+	if (stmts->m_Arena) {
+		if (m_Arena)
+			m_Arena->Adopt(move(stmts->m_Arena));
+		else
+			m_Arena = move(stmts->m_Arena);
+	}
+	if (stmts->m_Tables) {
+		if (m_Tables)
+			m_Tables->Adopt(move(stmts->m_Tables));
+		else
+			m_Tables = move(stmts->m_Tables);
+	}
 	auto count = m_Stmts.size();
 	m_Stmts.resize(m_Stmts.size() + stmts->Count());
 	std::move(stmts->m_Stmts.begin(), stmts->m_Stmts.end(), m_Stmts.begin() + count);
-	return m_Stmts.data()->get() + count;
+	return count < m_Stmts.size() ? m_Stmts[count].get() : nullptr;
 }
 
 Statement const* Statements::GetAt(int i) const {
 	return i < 0 || i >= m_Stmts.size() ? nullptr : m_Stmts[i].get();
 }
 
-vector<unique_ptr<Statement>> const& Statements::Get() const {
+AstVector<unique_ptr<Statement>> const& Statements::Get() const {
 	return m_Stmts;
 }
 
-vector<unique_ptr<Statement>>& Statements::Get() {
+AstVector<unique_ptr<Statement>>& Statements::Get() {
 	return m_Stmts;
 }
 
@@ -447,12 +493,11 @@ Value ArrayExpression::Accept(Visitor* visitor) const {
 	return visitor->VisitArrayExpression(this);
 }
 
-vector<unique_ptr<Expression>> const& ArrayExpression::Items() const {
+AstVector<unique_ptr<Expression>> const& ArrayExpression::Items() const {
 	return m_Items;
 }
 
 ExpressionStatement::ExpressionStatement(std::unique_ptr<Expression> expr, bool sc) : m_Expr(move(expr)), m_Semicolon(sc) {
-	m_Expr->SetParent(this);
 }
 
 Value ExpressionStatement::Accept(Visitor* visitor) const {
@@ -468,15 +513,15 @@ string ExpressionStatement::ToString() const {
 	return Expr()->ToString();
 }
 
-ClassDeclaration::ClassDeclaration(std::string name, ClassDeclaration const* parent) noexcept : m_Name(move(name)), m_Parent(parent) {
+ClassDeclaration::ClassDeclaration(std::string const& name, ClassDeclaration const* parent) : m_Name(name), m_Parent(parent) {
 }
 
 Value ClassDeclaration::Accept(Visitor* visitor) const {
 	return visitor->VisitClassDeclaration(this);
 }
 
-void ClassDeclaration::AddInterface(std::string name) {
-	m_Interfaces.push_back(move(name));
+void ClassDeclaration::AddInterface(std::string const& name) {
+	m_Interfaces.emplace_back(name);
 }
 
 AssignArrayIndexExpression::AssignArrayIndexExpression(unique_ptr<Expression> arrayAccess, unique_ptr<Expression> rhs, TokenType assignType) noexcept 
@@ -499,10 +544,8 @@ Value AssignFieldExpression::Accept(Visitor* visitor) const {
 	return visitor->VisitAssignField(this);
 }
 
-ForEachStatement::ForEachStatement(string name, unique_ptr<Expression> collection, unique_ptr<Statement> body) noexcept 
-	: m_Name(move(name)), m_Collection(move(collection)), m_Body(move(body)) {
-	m_Body->SetParent(this);
-	m_Collection->SetParent(this);
+ForEachStatement::ForEachStatement(Atom name, unique_ptr<Expression> collection, unique_ptr<Statement> body) noexcept 
+	: m_Name(name), m_Collection(move(collection)), m_Body(move(body)) {
 }
 
 Value ForEachStatement::Accept(Visitor* visitor) const {
@@ -5,12 +5,20 @@
 #include <vector>
 #include <unordered_map>
 
+#include "AstArena.h"
 #include "Value.h"
 #include "Visitor.h"
 #include "Token.h"
 #include "SymbolTable.h"
+#include "InlineCache.h"
+#include "Quickening.h"
 
 namespace Dynamix {
+	struct CodeChunk;
+	class AstTables;
+	class Optimizer;
+	class FunctionEssentials;
+
 	enum class AstNodeType : uint16_t {
 		None = 0,
 
@@ -56,7 +64,7 @@ namespace Dynamix {
 
 	struct AttributeValue {
 		std::string Name;
-		Value Value;
+		Dynamix::Value Value;
 		AttributeFlags Flags;
 	};
 
@@ -94,30 +102,19 @@ namespace Dynamix {
 			return m_Location;
 		}
 
-		SymbolTable* Symbols() noexcept {
-			return &m_Symbols;
+		std::shared_ptr<CodeChunk> const& CompiledCode() const noexcept {
+			return m_Code;
 		}
 
-		SymbolTable const* Symbols() const {
-			return &m_Symbols;
-		}
+		void SetCompiledCode(std::shared_ptr<CodeChunk> code) const;
 
-		void SetParent(AstNode* parent) noexcept {
-			m_Symbols.SetParent(parent->Symbols());
-		}
-
-		void SetParentSymbols(SymbolTable* symbols) noexcept {
-			m_Symbols.SetParent(symbols);
-		}
-
-		std::vector<Attribute>& Attributes() noexcept {
-			return m_Attributes;
-		}
+		// lets go of what the node holds outside its arena; the arena calls it instead of the destructor
+		virtual void ReleaseOutsideArena() noexcept;
 
 	private:
-		SymbolTable m_Symbols;
+		// symbol tables and attributes are kept by the tree's AstTables, for the few nodes that have them
 		CodeLocation m_Location;
-		std::vector<Attribute> m_Attributes;
+		mutable std::shared_ptr<CodeChunk> m_Code;
 	};
 
 	enum class ParameterFlags : uint8_t {
@@ -131,54 +128,112 @@ namespace Dynamix {
 	public:
 	};
 
+	//
+	// a node that opens a runtime scope; the Resolver sets the number of variable slots it needs
+	//
+	class ScopeSlots {
+	public:
+		int SlotCount() const noexcept {
+			return m_SlotCount;
+		}
+		void SetSlotCount(int count) const noexcept {
+			m_SlotCount = count;
+		}
+
+	private:
+		mutable int m_SlotCount{ 0 };
+	};
+
+	//
+	// a loop whose iterations tiered execution counts toward compiling the function running it
+	//
+	class LoopCounter {
+	public:
+		int Iterations() const noexcept {
+			return m_Iterations;
+		}
+		int CountIteration() const noexcept {
+			return ++m_Iterations;
+		}
+
+	private:
+		mutable int m_Iterations{ 0 };
+	};
+
+	//
+	// a node that declares or refers to a variable the Resolver may bind to a slot
+	//
+	class VariableSlot {
+	public:
+		SlotRef Slot() const noexcept {
+			return m_Slot;
+		}
+		void SetSlot(SlotRef slot) const noexcept {
+			m_Slot = slot;
+		}
+
+	private:
+		mutable SlotRef m_Slot;
+	};
+
 	struct Parameter {
-		std::string Name;
+		Atom Name;
 		std::unique_ptr<Expression> DefaultValue;
 		ParameterFlags Flags{ ParameterFlags::In };
 	};
 
 	class GetMemberExpression : public Expression {
+		friend class Optimizer;
 	public:
-		GetMemberExpression(std::unique_ptr<Expression> left, std::string member, TokenType op) noexcept;
+		GetMemberExpression(std::unique_ptr<Expression> left, Atom member, TokenType op) noexcept;
 		Value Accept(Visitor* visitor) const override;
 
 		Expression const* Left() const noexcept;
 		std::string const& Member() const noexcept;
+		Atom MemberAtom() const noexcept {
+			return m_Member;
+		}
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::GetMember;
 		}
 		TokenType const& Operator() const noexcept {
 			return m_Operator;
 		}
+		InlineCache& Cache() const noexcept {
+			return m_Cache;
+		}
 
 	private:
 		std::unique_ptr<Expression> m_Left;
-		std::string m_Member;
+		Atom m_Member;
 		TokenType m_Operator;
+		mutable InlineCache m_Cache;
 	};
 
 	class MatchCaseExpression {
+		friend class Optimizer;
 	public:
 		explicit MatchCaseExpression(std::unique_ptr<Statements> action) noexcept : m_Action(std::move(action)) {}
 		void AddCase(std::unique_ptr<Expression> expr) noexcept {
 			m_Cases.push_back(std::move(expr));
 		}
-		void SetCases(std::vector<std::unique_ptr<Expression>> cases) noexcept {
-			m_Cases = std::move(cases);
+		void SetCases(std::vector<std::unique_ptr<Expression>> cases) {
+			m_Cases.assign(std::make_move_iterator(cases.begin()), std::make_move_iterator(cases.end()));
 		}
 		Statements const* Action() const noexcept {
 			return m_Action.get();
 		}
-		std::vector<std::unique_ptr<Expression>> const& Cases() const noexcept {
+		AstVector<std::unique_ptr<Expression>> const& Cases() const noexcept {
 			return m_Cases;
 		}
 
 	private:
 		std::unique_ptr<Statements> m_Action;
-		std::vector<std::unique_ptr<Expression>> m_Cases;
+		AstVector<std::unique_ptr<Expression>> m_Cases{ AstArena::Resource() };
 	};
 
 	class MatchExpression : public Expression {
+		friend class Optimizer;
 	public:
 		explicit MatchExpression(std::unique_ptr<Expression> expr) noexcept : m_Expr(std::move(expr)) {}
 		AstNodeType NodeType() const noexcept override {
@@ -190,7 +245,7 @@ namespace Dynamix {
 			m_MatchCases.push_back(std::move(expr));
 		}
 
-		std::vector<MatchCaseExpression> const& MatchCases() const noexcept {
+		AstVector<MatchCaseExpression> const& MatchCases() const noexcept {
 			return m_MatchCases;
 		}
 		Expression const* ToMatch() const noexcept {
@@ -205,11 +260,12 @@ namespace Dynamix {
 
 	private:
 		std::unique_ptr<Expression> m_Expr;
-		std::vector<MatchCaseExpression> m_MatchCases;
+		AstVector<MatchCaseExpression> m_MatchCases{ AstArena::Resource() };
 		bool m_HasDefault{ false };
 	};
 
-	class AccessArrayExpression : public Expression {
+	class AccessArrayExpression : public Expression, public QuickSite {
+		friend class Optimizer;
 	public:
 		AccessArrayExpression(std::unique_ptr<Expression> left, std::unique_ptr<Expression> index) noexcept;
 		Value Accept(Visitor* visitor) const override;
@@ -230,6 +286,7 @@ namespace Dynamix {
 	};
 
 	class ArrayExpression : public Expression {
+		friend class Optimizer;
 	public:
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::Array;
@@ -238,13 +295,14 @@ namespace Dynamix {
 		void Add(std::unique_ptr<Expression> expr);
 		Value Accept(Visitor* visitor) const override;
 
-		std::vector<std::unique_ptr<Expression>> const& Items() const;
+		AstVector<std::unique_ptr<Expression>> const& Items() const;
 
 	private:
-		std::vector<std::unique_ptr<Expression>> m_Items;
+		AstVector<std::unique_ptr<Expression>> m_Items{ AstArena::Resource() };
 	};
 
 	class ExpressionStatement final : public Statement {
+		friend class Optimizer;
 	public:
 		ExpressionStatement(std::unique_ptr<Expression> expr, bool semicolon);
 		AstNodeType NodeType() const noexcept {
@@ -253,6 +311,9 @@ namespace Dynamix {
 
 		Value Accept(Visitor* visitor) const override;
 		Expression const* Expr() const;
+		bool HasSemicolon() const noexcept {
+			return m_Semicolon;
+		}
 		std::string ToString() const override;
 
 	private:
@@ -262,6 +323,8 @@ namespace Dynamix {
 
 	class Statements final : public Statement {
 	public:
+		Statements() noexcept;
+		~Statements() noexcept;
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::Statements;
 		}
@@ -269,25 +332,42 @@ namespace Dynamix {
 		Value Accept(Visitor* visitor) const override;
 		void Add(std::unique_ptr<Statement> stmt);
 		Statement const* Append(std::unique_ptr<Statements> stmts);
-		std::vector<std::unique_ptr<Statement>> const& Get() const;
-		std::vector<std::unique_ptr<Statement>>& Get();
+		AstVector<std::unique_ptr<Statement>> const& Get() const;
+		AstVector<std::unique_ptr<Statement>>& Get();
 		std::unique_ptr<Statement> RemoveAt(int index);
 		Statement const* GetAt(int i) const;
 		int Count() const noexcept {
 			return static_cast<int>(m_Stmts.size());
 		}
 		std::string ToString() const override;
-		std::vector<std::unique_ptr<Statement>> const& All() const noexcept {
+		AstVector<std::unique_ptr<Statement>> const& All() const noexcept {
 			return m_Stmts;
 		}
 
+		// the root of a tree to build in an arena of its own; the root itself is outside any arena
+		static std::unique_ptr<Statements> NewTree();
+
+		// the memory of a parsed tree and the tables for the scopes and attributes of its nodes, owned by its root
+		void SetArena(std::unique_ptr<AstArena> arena) noexcept;
+		AstArena* Arena() const noexcept {
+			return m_Arena.get();
+		}
+		void SetTables(std::unique_ptr<AstTables> tables) noexcept;
+		AstTables* Tables() const noexcept {
+			return m_Tables.get();
+		}
+
 	private:
-		std::vector<std::unique_ptr<Statement>> m_Stmts;
+		// the arena goes last, after any node outside it that holds nodes in it
+		std::unique_ptr<AstArena> m_Arena;
+		std::unique_ptr<AstTables> m_Tables;
+		AstVector<std::unique_ptr<Statement>> m_Stmts{ AstArena::Resource() };
 	};
 
-	class VarValStatement : public Statement {
+	class VarValStatement : public Statement, public VariableSlot {
+		friend class Optimizer;
 	public:
-		VarValStatement(std::string name, SymbolFlags flags, std::unique_ptr<Expression> init) noexcept;
+		VarValStatement(Atom name, SymbolFlags flags, std::unique_ptr<Expression> init) noexcept;
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::VarValStatement;
 		}
@@ -296,6 +376,9 @@ namespace Dynamix {
 		std::string ToString() const override;
 
 		std::string const& Name() const noexcept;
+		Atom NameAtom() const noexcept {
+			return m_Name;
+		}
 		Expression const* Init() const noexcept;
 		bool IsConst() const noexcept;
 		bool IsStatic() const noexcept;
@@ -304,16 +387,20 @@ namespace Dynamix {
 		}
 
 	private:
-		std::string m_Name;
+		Atom m_Name;
 		std::unique_ptr<Expression> m_Init;
 		SymbolFlags m_Flags;
 	};
 
-	class AssignExpression : public Expression {
+	class AssignExpression : public Expression, public VariableSlot, public QuickSite {
+		friend class Optimizer;
 	public:
-		AssignExpression(std::string lhs, std::unique_ptr<Expression> rhs, TokenType assignType) noexcept;
-		Value Accept(Visitor* visitor) const override;
+		AssignExpression(Atom lhs, std::unique_ptr<Expression> rhs, TokenType assignType) noexcept;
+		Dynamix::Value Accept(Visitor* visitor) const override;
 		std::string const& Lhs() const noexcept;
+		Atom LhsAtom() const noexcept {
+			return m_Lhs;
+		}
 		Expression const* Value() const noexcept;
 		TokenType AssignType() const noexcept;
 		std::string ToString() const override;
@@ -322,19 +409,20 @@ namespace Dynamix {
 		}
 
 	private:
-		std::string m_Lhs;
+		Atom m_Lhs;
 		std::unique_ptr<Expression> m_Value;
 		TokenType m_AssignType;
 	};
 
 	class AssignFieldExpression : public Expression {
+		friend class Optimizer;
 	public:
 		AssignFieldExpression(std::unique_ptr<Expression> lhs, std::unique_ptr<Expression> rhs, TokenType assignType) noexcept;
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::AssignField;
 		}
 
-		Value Accept(Visitor* visitor) const override;
+		Dynamix::Value Accept(Visitor* visitor) const override;
 		TokenType AssignType() const noexcept {
 			return m_AssignType;
 		}
@@ -352,13 +440,14 @@ namespace Dynamix {
 	};
 
 	class AssignArrayIndexExpression : public Expression {
+		friend class Optimizer;
 	public:
 		AssignArrayIndexExpression(std::unique_ptr<Expression> arrayAccess, std::unique_ptr<Expression> rhs, TokenType assignType) noexcept;
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::AssignArrayIndex;
 		}
 
-		Value Accept(Visitor* visitor) const override;
+		Dynamix::Value Accept(Visitor* visitor) const override;
 
 		AccessArrayExpression const* ArrayAccess() const noexcept {
 			return reinterpret_cast<AccessArrayExpression const*>(m_ArrayAccess.get());
@@ -376,7 +465,8 @@ namespace Dynamix {
 		TokenType m_AssignType;
 	};
 
-	class BinaryExpression : public Expression {
+	class BinaryExpression : public Expression, public QuickSite {
+		friend class Optimizer;
 	public:
 		BinaryExpression(std::unique_ptr<Expression> left, TokenType op, std::unique_ptr<Expression> right);
 		AstNodeType NodeType() const noexcept override {
@@ -395,11 +485,14 @@ namespace Dynamix {
 		TokenType m_Operator;
 	};
 
-	class NameExpression : public Expression {
+	class NameExpression : public Expression, public VariableSlot {
 	public:
-		explicit NameExpression(std::string name);
+		explicit NameExpression(Atom name);
 		Value Accept(Visitor* visitor) const override;
 		std::string const& Name() const noexcept;
+		Atom NameAtom() const noexcept {
+			return m_Name;
+		}
 		std::string const& NameSpace() const noexcept;
 		std::string ToString() const override;
 		AstNodeType NodeType() const noexcept override {
@@ -407,10 +500,11 @@ namespace Dynamix {
 		}
 
 	private:
-		std::string m_Name;
+		Atom m_Name;
 	};
 
-	class UnaryExpression : public Expression {
+	class UnaryExpression : public Expression, public QuickSite {
+		friend class Optimizer;
 	public:
 		UnaryExpression(TokenType op, std::unique_ptr<Expression> arg) noexcept;
 		AstNodeType NodeType() const noexcept override {
@@ -428,8 +522,9 @@ namespace Dynamix {
 
 	class LiteralExpression : public Expression {
 	public:
-		explicit LiteralExpression(Value value) noexcept;
+		explicit LiteralExpression(Value value);
 		Value Accept(Visitor* visitor) const override;
+		void ReleaseOutsideArena() noexcept override;
 
 		std::string ToString() const override;
 		Value const& Literal() const noexcept;
@@ -442,6 +537,7 @@ namespace Dynamix {
 	};
 
 	class RangeExpression : public Expression {
+		friend class Optimizer;
 	public:
 		RangeExpression(std::unique_ptr<Expression> start, std::unique_ptr<Expression> end, bool endInclusive = false) noexcept;
 		AstNodeType NodeType() const noexcept override {
@@ -464,18 +560,35 @@ namespace Dynamix {
 	};
 
 	class InvokeFunctionExpression : public Expression {
+		friend class Optimizer;
 	public:
 		InvokeFunctionExpression(std::unique_ptr<Expression> callable, std::vector<std::unique_ptr<Expression>> args);
 		Value Accept(Visitor* visitor) const override;
 		Expression const* Callable() const;
-		std::vector<std::unique_ptr<Expression>> const& Arguments() const;
+		AstVector<std::unique_ptr<Expression>> const& Arguments() const;
 		std::string ToString() const override;
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::InvokeFunction;
 		}
+		InlineCache& Cache() const noexcept {
+			return m_Cache;
+		}
+		// set by the Resolver on a call whose result is returned as is by the enclosing function
+		bool IsTailCall() const noexcept {
+			return m_TailCaller != nullptr;
+		}
+		// the function the call returns from
+		FunctionEssentials const* TailCaller() const noexcept {
+			return m_TailCaller;
+		}
+		void SetTailCall(FunctionEssentials const* caller) const noexcept {
+			m_TailCaller = caller;
+		}
 	private:
 		std::unique_ptr<Expression> m_Callable;
-		std::vector<std::unique_ptr<Expression>> m_Arguments;
+		AstVector<std::unique_ptr<Expression>> m_Arguments{ AstArena::Resource() };
+		mutable InlineCache m_Cache;
+		mutable FunctionEssentials const* m_TailCaller{ nullptr };
 	};
 
 	enum class UseType {
@@ -486,7 +599,7 @@ namespace Dynamix {
 
 	class UseStatement : public Statement {
 	public:
-		UseStatement(std::string name, UseType type) noexcept : m_Name(std::move(name)), m_Type(type) {}
+		UseStatement(std::string const& name, UseType type) : m_Name(name), m_Type(type) {}
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::Use;
 		}
@@ -494,20 +607,21 @@ namespace Dynamix {
 		Value Accept(Visitor* visitor) const override;
 
 		std::string const& Name() const noexcept {
-			return m_Name;
+			return m_Name.ToString();
 		}
 		UseType Type() const noexcept {
 			return m_Type;
 		}
 
 	private:
-		std::string m_Name;
+		Atom m_Name;
 		UseType m_Type;
 	};
 
-	class ForEachStatement : public Statement {
+	class ForEachStatement : public Statement, public ScopeSlots, public VariableSlot, public LoopCounter {
+		friend class Optimizer;
 	public:
-		ForEachStatement(std::string name, std::unique_ptr<Expression> collection, std::unique_ptr<Statement> body) noexcept;
+		ForEachStatement(Atom name, std::unique_ptr<Expression> collection, std::unique_ptr<Statement> body) noexcept;
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::ForEach;
 		}
@@ -515,6 +629,9 @@ namespace Dynamix {
 		Value Accept(Visitor* visitor) const override;
 
 		std::string const& Name() const noexcept {
+			return m_Name.ToString();
+		}
+		Atom NameAtom() const noexcept {
 			return m_Name;
 		}
 		Statement const* Body() const noexcept {
@@ -525,12 +642,13 @@ namespace Dynamix {
 		}
 
 	private:
-		std::string m_Name;
+		Atom m_Name;
 		std::unique_ptr<Expression> m_Collection;
 		std::unique_ptr<Statement> m_Body;
 	};
 
-	class ForStatement : public Statement {
+	class ForStatement : public Statement, public ScopeSlots, public LoopCounter {
+		friend class Optimizer;
 	public:
 		ForStatement() = default;
 		ForStatement(std::unique_ptr<Statement> init, std::unique_ptr<Expression> whileExpr, 
@@ -542,22 +660,15 @@ namespace Dynamix {
 		Value Accept(Visitor* visitor) const override;
 		void SetBody(std::unique_ptr<Statement> body) noexcept {
 			m_Body = move(body);
-			m_Body->SetParent(this);
 		}
 		void SetInit(std::unique_ptr<Statement> init) noexcept {
 			m_Init = move(init);
-			if (m_Init)
-				m_Init->SetParent(this);
 		}
 		void SetWhile(std::unique_ptr<Expression> expr) noexcept {
 			m_While = move(expr);
-			if(m_While)
-				m_While->SetParent(this);
 		}
 		void SetInc(std::unique_ptr<Expression> expr) noexcept {
 			m_Inc = move(expr);
-			if(m_Inc)
-				m_Inc->SetParent(this);
 		}
 		Statement const* Init() const noexcept;
 		Expression const* While() const noexcept;
@@ -570,8 +681,11 @@ namespace Dynamix {
 		std::unique_ptr<Statement> m_Body;
 	};
 
-	class FunctionEssentials {
+	class FunctionEssentials : public ScopeSlots {
+		friend class Optimizer;
 	public:
+		~FunctionEssentials();
+
 		void SetBody(std::unique_ptr<Expression> body) noexcept {
 			m_Body = std::move(body);
 		}
@@ -579,23 +693,43 @@ namespace Dynamix {
 			return m_Body.get();
 		}
 
-		void SetParameters(std::vector<Parameter> parameters) noexcept {
-			m_Parameters = std::move(parameters);
+		void SetParameters(std::vector<Parameter> parameters) {
+			m_Parameters.assign(std::make_move_iterator(parameters.begin()), std::make_move_iterator(parameters.end()));
 		}
 
-		std::vector<Parameter> const& Parameters() const noexcept {
+		AstVector<Parameter> const& Parameters() const noexcept {
 			return m_Parameters;
 		}
 
+		//
+		// set by the Resolver: the names a call keeps in its own scope, and the names
+		// it or any function declared in it finds only in the scopes of whoever called it
+		//
+		AstVector<Atom> const& FrameNames() const noexcept {
+			return m_FrameNames;
+		}
+		AstVector<Atom> const& FreeNames() const noexcept {
+			return m_FreeNames;
+		}
+		void SetNames(std::vector<Atom> const& frame, std::vector<Atom> const& free) const {
+			m_FrameNames.assign(frame.begin(), frame.end());
+			m_FreeNames.assign(free.begin(), free.end());
+		}
+
 	protected:
-		std::vector<Parameter> m_Parameters;
+		// the tiered compiler may still have the body queued or on its thread
+		void Forget() noexcept;
+
+		AstVector<Parameter> m_Parameters{ AstArena::Resource() };
 		std::unique_ptr<Expression> m_Body;
+		mutable AstVector<Atom> m_FrameNames{ AstArena::Resource() }, m_FreeNames{ AstArena::Resource() };
 	};
 
 	class FunctionDeclaration : public Statement, public FunctionEssentials {
 	public:
-		explicit FunctionDeclaration(std::string name, bool method = false, bool isStatic = false);
+		explicit FunctionDeclaration(std::string const& name, bool method = false, bool isStatic = false);
 		Value Accept(Visitor* visitor) const override;
+		void ReleaseOutsideArena() noexcept override;
 
 		std::string const& Name() const noexcept;
 		std::string ToString() const override;
@@ -611,108 +745,118 @@ namespace Dynamix {
 		void SetBody(std::unique_ptr<Expression> body) noexcept;
 
 	private:
-		std::string m_Name;
+		Atom m_Name;
 		bool m_Method, m_Static;
 	};
 
 	class InterfaceDeclaration : public Statement {
 	public:
-		explicit InterfaceDeclaration(std::string name) noexcept : m_Name(std::move(name)) {}
+		explicit InterfaceDeclaration(std::string const& name) : m_Name(name) {}
 
 		AstNodeType NodeType() const noexcept override {
 			return AstNodeType::InterfaceDeclaration;
 		}
 		Value Accept(Visitor* visitor) const override;
 
-		void SetMethods(std::vector<std::unique_ptr<FunctionDeclaration>> methods) noexcept {
-			m_Methods = std::move(methods);
+		void SetMethods(std::vector<std::unique_ptr<FunctionDeclaration>> methods) {
+			m_Methods.assign(std::make_move_iterator(methods.begin()), std::make_move_iterator(methods.end()));
 		}
-		std::vector<std::unique_ptr<FunctionDeclaration>> const& Methods() const noexcept {
+		AstVector<std::unique_ptr<FunctionDeclaration>> const& Methods() const noexcept {
 			return m_Methods;
 		}
-		void AddBaseInterface(std::string name) noexcept {
-			m_BaseNames.push_back(std::move(name));
+		void AddBaseInterface(std::string const& name) {
+			m_BaseNames.emplace_back(name);
 		}
 
 		std::string const& Name() const noexcept {
-			return m_Name;
+			return m_Name.ToString();
 		}
-		std::vector<std::string> const& BaseNames() const noexcept {
+		AstVector<Atom> const& BaseNames() const noexcept {
 			return m_BaseNames;
 		}
 
 	private:
-		std::string m_Name;
-		std::vector<std::string> m_BaseNames;
-		std::vector<std::unique_ptr<FunctionDeclaration>> m_Methods;
+		Atom m_Name;
+		AstVector<Atom> m_BaseNames{ AstArena::Resource() };
+		AstVector<std::unique_ptr<FunctionDeclaration>> m_Methods{ AstArena::Resource() };
 	};
 
 	class ClassDeclaration : public Statement {
+		friend class Optimizer;
 	public:
-		explicit ClassDeclaration(std::string name, ClassDeclaration const* parent = nullptr) noexcept;
+		explicit ClassDeclaration(std::string const& name, ClassDeclaration const* parent = nullptr);
 		AstNodeType NodeType() const noexcept override {
 			return AstNodeType::ClassDeclaration;
 		}
-		void SetBaseType(std::string name) noexcept {
-			m_BaseName = std::move(name);
+		void SetBaseType(std::string const& name) {
+			m_BaseName = Atom(name);
 		}
 
 		Value Accept(Visitor* visitor) const override;
-		void SetMethods(std::vector<std::unique_ptr<FunctionDeclaration>> methods) noexcept {
-			m_Methods = std::move(methods);
+		void SetMethods(std::vector<std::unique_ptr<FunctionDeclaration>> methods) {
+			m_Methods.assign(std::make_move_iterator(methods.begin()), std::make_move_iterator(methods.end()));
 		}
-		void SetFields(std::vector<std::unique_ptr<Statement>> fields) noexcept {
-			m_Fields = std::move(fields);
+		void SetFields(std::vector<std::unique_ptr<Statement>> fields) {
+			m_Fields.assign(std::make_move_iterator(fields.begin()), std::make_move_iterator(fields.end()));
 		}
-		void SetTypes(std::vector<std::unique_ptr<ClassDeclaration>> types) noexcept {
-			m_Types = std::move(types);
+		void SetTypes(std::vector<std::unique_ptr<ClassDeclaration>> types) {
+			m_Types.assign(std::make_move_iterator(types.begin()), std::make_move_iterator(types.end()));
 		}
 		ClassDeclaration const* Parent() const noexcept {
 			return m_Parent;
 		}
-		std::vector<std::unique_ptr<FunctionDeclaration>> const& Methods() const noexcept {
+		AstVector<std::unique_ptr<FunctionDeclaration>> const& Methods() const noexcept {
 			return m_Methods;
 		}
-		std::vector<std::unique_ptr<Statement>> const& Fields() const noexcept {
+		AstVector<std::unique_ptr<Statement>> const& Fields() const noexcept {
 			return m_Fields;
 		}
-		std::vector<std::unique_ptr<ClassDeclaration>> const& Types() const noexcept {
+		AstVector<std::unique_ptr<ClassDeclaration>> const& Types() const noexcept {
 			return m_Types;
 		}
 		std::string const& Name() const noexcept {
-			return m_Name;
+			return m_Name.ToString();
 		}
 		std::string const& BaseName() const noexcept {
-			return m_BaseName;
+			return m_BaseName.ToString();
 		}
 
-		void AddInterface(std::string name);
-		std::vector<std::string> const& Interfaces() const noexcept {
+		void AddInterface(std::string const& name);
+		AstVector<Atom> const& Interfaces() const noexcept {
 			return m_Interfaces;
 		}
 
+		// set by the Resolver: names the field initializers, and functions declared in them, find in the scope creating the object
+		AstVector<Atom> const& FreeNames() const noexcept {
+			return m_FreeNames;
+		}
+		void SetFreeNames(std::vector<Atom> const& names) const {
+			m_FreeNames.assign(names.begin(), names.end());
+		}
+
 	private:
-		std::string m_Name, m_BaseName;
-		std::vector<std::unique_ptr<FunctionDeclaration>> m_Methods;
-		std::vector<std::unique_ptr<Statement>> m_Fields;
-		std::vector<std::unique_ptr<ClassDeclaration>> m_Types;
-		std::vector<std::string> m_Interfaces;
+		Atom m_Name, m_BaseName;
+		AstVector<std::unique_ptr<FunctionDeclaration>> m_Methods{ AstArena::Resource() };
+		AstVector<std::unique_ptr<Statement>> m_Fields{ AstArena::Resource() };
+		AstVector<std::unique_ptr<ClassDeclaration>> m_Types{ AstArena::Resource() };
+		AstVector<Atom> m_Interfaces{ AstArena::Resource() };
 		ClassDeclaration const* m_Parent;
+		mutable AstVector<Atom> m_FreeNames{ AstArena::Resource() };
 	};
 
 	class EnumDeclaration : public Statement {
 	public:
-		EnumDeclaration(std::string name, std::unordered_map<std::string, long long> values);
+		EnumDeclaration(std::string const& name, std::unordered_map<std::string, long long> const& values);
 		Value Accept(Visitor* visitor) const override;
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::EnumDeclararion;
 		}
 		std::string const& Name() const noexcept;
-		std::unordered_map<std::string, long long> const& Values() const noexcept;
+		std::pmr::unordered_map<Atom, long long> const& Values() const noexcept;
 
 	private:
-		std::string m_Name;
-		std::unordered_map<std::string, long long> m_Values;
+		Atom m_Name;
+		std::pmr::unordered_map<Atom, long long> m_Values{ AstArena::Resource() };
 	};
 
 	class AnonymousFunctionExpression : public Expression, public FunctionEssentials {
@@ -722,40 +866,47 @@ namespace Dynamix {
 			return AstNodeType::AnonymousFunction;
 		}
 		Value Accept(Visitor* visitor) const override;
+		void ReleaseOutsideArena() noexcept override;
 	};
 
 	struct FieldInitializer {
-		std::string Name;
+		Atom Name;
 		std::unique_ptr<Expression> Init;
 	};
 
 	class NewObjectExpression : public Expression {
+		friend class Optimizer;
 	public:
-		NewObjectExpression(std::string className, std::vector<std::unique_ptr<Expression>> args, std::vector<FieldInitializer> inits) noexcept
-			: m_ClassName(std::move(className)), m_Arguments(std::move(args)), m_FieldInit(move(inits)) {}
+		NewObjectExpression(Atom className, std::vector<std::unique_ptr<Expression>> args, std::vector<FieldInitializer> inits) : m_ClassName(className) {
+			m_Arguments.assign(std::make_move_iterator(args.begin()), std::make_move_iterator(args.end()));
+			m_FieldInit.assign(std::make_move_iterator(inits.begin()), std::make_move_iterator(inits.end()));
+		}
 		AstNodeType NodeType() const noexcept {
 			return AstNodeType::NewObject;
 		}
 
 		Value Accept(Visitor* visitor) const override;
 		std::string const& ClassName() const {
+			return m_ClassName.ToString();
+		}
+		Atom ClassNameAtom() const noexcept {
 			return m_ClassName;
 		}
-		std::vector<std::unique_ptr<Expression>> const& Arguments() const noexcept {
+		AstVector<std::unique_ptr<Expression>> const& Arguments() const noexcept {
 			return m_Arguments;
 		}
 
-		void AddFieldInit(FieldInitializer init) noexcept {
+		void AddFieldInit(FieldInitializer init) {
 			m_FieldInit.push_back(std::move(init));
 		}
 
-		std::vector<FieldInitializer> const& FieldInitializers() const noexcept {
+		AstVector<FieldInitializer> const& FieldInitializers() const noexcept {
 			return m_FieldInit;
 		}
 	private:
-		std::string m_ClassName;
-		std::vector<std::unique_ptr<Expression>> m_Arguments;
-		std::vector<FieldInitializer> m_FieldInit;
+		Atom m_ClassName;
+		AstVector<std::unique_ptr<Expression>> m_Arguments{ AstArena::Resource() };
+		AstVector<FieldInitializer> m_FieldInit{ AstArena::Resource() };
 	};
 
 	class BreakOrContinueStatement : public Statement {
@@ -772,7 +923,8 @@ namespace Dynamix {
 		TokenType m_Type;
 	};
 
-	class WhileStatement : public Statement {
+	class WhileStatement : public Statement, public ScopeSlots, public LoopCounter {
+		friend class Optimizer;
 	public:
 		WhileStatement(std::unique_ptr<Expression> condition, std::unique_ptr<Statement> body);
 		AstNodeType NodeType() const noexcept {
@@ -790,6 +942,7 @@ namespace Dynamix {
 	};
 
 	class ReturnStatement : public Statement {
+		friend class Optimizer;
 	public:
 		explicit ReturnStatement(std::unique_ptr<Expression> expr = nullptr);
 		AstNodeType NodeType() const noexcept {
@@ -804,7 +957,8 @@ namespace Dynamix {
 		std::unique_ptr<Expression> m_Expr;
 	};
 
-	class RepeatStatement : public Statement {
+	class RepeatStatement : public Statement, public LoopCounter {
+		friend class Optimizer;
 	public:
 		RepeatStatement(std::unique_ptr<Expression> times, std::unique_ptr<Statement> body);
 		AstNodeType NodeType() const noexcept {
@@ -822,6 +976,7 @@ namespace Dynamix {
 	};
 
 	class IfThenElseExpression : public Expression {
+		friend class Optimizer;
 	public:
 		IfThenElseExpression(std::unique_ptr<Expression> condition, std::unique_ptr<Statement> thenExpr, std::unique_ptr<Statement> elseExpr = nullptr);
 		Value Accept(Visitor* visitor) const override;
@@ -833,6 +988,12 @@ namespace Dynamix {
 		Expression const* Condition() const noexcept;
 		Statement const* Then() const noexcept;
 		Statement const* Else() const noexcept;
+		std::unique_ptr<Statement> ReleaseThen() noexcept {
+			return std::move(m_Then);
+		}
+		std::unique_ptr<Statement> ReleaseElse() noexcept {
+			return std::move(m_Else);
+		}
 
 	private:
 		std::unique_ptr<Expression> m_Condition;
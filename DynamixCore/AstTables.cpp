@@ -0,0 +1,33 @@
+#include "AstTables.h"
+
+using namespace Dynamix;
+using namespace std;
+
+AstTables::Scope::Scope(AstTables* tables) noexcept : m_Previous(s_Current) {
+	s_Current = tables;
+}
+
+AstTables::Scope::~Scope() {
+	s_Current = m_Previous;
+}
+
+SymbolTable* AstTables::AddScope(AstNode const* node, SymbolTable* parent) {
+	return &m_Scopes.try_emplace(node, parent).first->second;
+}
+
+SymbolTable const* AstTables::Symbols(AstNode const* node) const noexcept {
+	if (auto it = m_Scopes.find(node); it != m_Scopes.end())
+		return &it->second;
+	for (auto& adopted : m_Adopted)
+		if (auto symbols = adopted->Symbols(node))
+			return symbols;
+	return nullptr;
+}
+
+vector<Attribute>& AstTables::Attributes(AstNode const* node) {
+	return m_Attributes[node];
+}
+
+void AstTables::Adopt(unique_ptr<AstTables> other) {
+	m_Adopted.push_back(move(other));
+}
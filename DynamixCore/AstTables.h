@@ -0,0 +1,49 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "AstNode.h"
+#include "NoCopyMove.h"
+#include "SymbolTable.h"
+
+namespace Dynamix {
+	//
+	// what only a few nodes of a parsed tree have: the symbol tables of the nodes that open a scope, and attributes.
+	// the parser makes a tree's tables current while building it, and the root Statements owns them
+	//
+	class AstTables final : NoCopy {
+	public:
+		//
+		// scopes opened on this thread go to the tables while the scope lives
+		//
+		class Scope final : NoCopy {
+		public:
+			explicit Scope(AstTables* tables) noexcept;
+			~Scope();
+
+		private:
+			AstTables* m_Previous;
+		};
+
+		static AstTables* Current() noexcept {
+			return s_Current;
+		}
+
+		// the symbol table of a scope the node opens, nested in the enclosing scope's
+		SymbolTable* AddScope(AstNode const* node, SymbolTable* parent);
+		// null if the node opens no scope
+		SymbolTable const* Symbols(AstNode const* node) const noexcept;
+		std::vector<Attribute>& Attributes(AstNode const* node);
+
+		// keeps the tables of nodes moved in from another tree along with this one's
+		void Adopt(std::unique_ptr<AstTables> other);
+
+	private:
+		std::unordered_map<AstNode const*, SymbolTable> m_Scopes;
+		std::unordered_map<AstNode const*, std::vector<Attribute>> m_Attributes;
+		std::vector<std::unique_ptr<AstTables>> m_Adopted;
+		inline static thread_local AstTables* s_Current;
+	};
+}
@@ -0,0 +1,86 @@
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+#include <cassert>
+#include <stdexcept>
+
+#include "Atom.h"
+
+using namespace Dynamix;
+using namespace std;
+
+namespace {
+	//
+	// names live in fixed-size chunks that never move, so ToString does not need the lock
+	//
+	class AtomTable {
+	public:
+		static constexpr uint32_t ChunkBits = 12;
+		static constexpr uint32_t ChunkSize = 1 << ChunkBits;
+		static constexpr uint32_t MaxChunks = 1 << 12;
+
+		AtomTable() {
+			Intern("");
+			[[maybe_unused]] auto self = Intern("this");
+			assert(self == Atom::This.Id());
+		}
+
+		uint32_t Intern(string_view name) {
+			lock_guard lock(m_Lock);
+			if (auto it = m_Ids.find(name); it != m_Ids.end())
+				return it->second;
+
+			auto id = m_Count;
+			if ((id >> ChunkBits) >= MaxChunks)
+				throw length_error("Too many distinct names");
+			auto& chunk = m_Chunks[id >> ChunkBits];
+			if (!chunk)
+				chunk = make_unique<string[]>(ChunkSize);
+			auto& stored = chunk[id & (ChunkSize - 1)];
+			stored = name;
+			m_Ids.emplace(stored, id);
+			m_Count++;
+			return id;
+		}
+
+		uint32_t Find(string_view name) noexcept {
+			lock_guard lock(m_Lock);
+			auto it = m_Ids.find(name);
+			return it == m_Ids.end() ? 0 : it->second;
+		}
+
+		string const& Name(uint32_t id) const noexcept {
+			return m_Chunks[id >> ChunkBits][id & (ChunkSize - 1)];
+		}
+
+		size_t Count() const noexcept {
+			return m_Count;
+		}
+
+	private:
+		mutex m_Lock;
+		unordered_map<string_view, uint32_t> m_Ids;
+		unique_ptr<string[]> m_Chunks[MaxChunks];
+		uint32_t m_Count{ 0 };
+	};
+
+	AtomTable& Table() {
+		static AtomTable table;
+		return table;
+	}
+}
+
+Atom::Atom(string_view name) : m_Id(Table().Intern(name)) {
+}
+
+Atom Atom::Find(string_view name) noexcept {
+	return Atom(Table().Find(name));
+}
+
+string const& Atom::ToString() const noexcept {
+	return Table().Name(m_Id);
+}
+
+size_t Atom::Count() noexcept {
+	return Table().Count();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <format>
+#include <functional>
+
+namespace Dynamix {
+	//
+	// an interned identifier: a 32-bit id into the runtime-wide atom table.
+	// atoms compare and hash as integers; the name is kept only for diagnostics.
+	// constructing from a string interns it for the life of the process, so it is explicit:
+	// names from source code are interned once by the parser, and strings that show up at run time
+	// are looked up with Find, which never adds to the table
+	//
+	class Atom {
+	public:
+		constexpr Atom() noexcept = default;
+		explicit Atom(std::string_view name);
+		explicit Atom(std::string const& name) : Atom(std::string_view(name)) {}
+		explicit Atom(const char* name) : Atom(std::string_view(name)) {}
+
+		// the atom for an existing name, or the empty atom if nothing was ever interned with it
+		static Atom Find(std::string_view name) noexcept;
+
+		// names the runtime looks up itself, interned first so they need no table access
+		static const Atom This;
+
+		uint32_t Id() const noexcept {
+			return m_Id;
+		}
+		// the empty atom is used for "no name"
+		bool IsEmpty() const noexcept {
+			return m_Id == 0;
+		}
+
+		std::string const& ToString() const noexcept;
+
+		bool operator==(Atom const&) const noexcept = default;
+		auto operator<=>(Atom const&) const noexcept = default;
+
+		static size_t Count() noexcept;
+
+	private:
+		constexpr explicit Atom(uint32_t id) noexcept : m_Id(id) {}
+
+		uint32_t m_Id{ 0 };
+	};
+
+	inline constexpr Atom Atom::This{ 1u };
+}
+
+template<>
+struct std::hash<Dynamix::Atom> {
+	size_t operator()(Dynamix::Atom atom) const noexcept {
+		return atom.Id();
+	}
+};
+
+template<>
+struct std::formatter<Dynamix::Atom> : std::formatter<std::string> {
+	auto format(Dynamix::Atom atom, std::format_context& ctx) const {
+		return std::formatter<std::string>::format(atom.ToString(), ctx);
+	}
+};
@@ -0,0 +1,32 @@
+#include <format>
+
+#include "Bytecode.h"
+
+using namespace Dynamix;
+using namespace std;
+
+const char* Dynamix::OpCodeToString(OpCode op) noexcept {
+	static const char* names[] = {
+		"Nop", "LoadConst", "LoadEmpty", "LoadTrue", "LoadFalse", "Move", "ClearRegs",
+		"LoadName", "Assign", "TestVar", "DeclareVar",
+		"Add", "Sub", "Mul", "Div", "Mod", "Equal", "NotEqual", "Less", "LessEqual", "Greater", "GreaterEqual",
+		"Binary", "Unary", "Jump", "JumpIfFalse", "JumpIfTrue", "JumpIfError",
+		"Call", "CallMember", "GetMember", "GetIndex", "SetIndex", "NewArray", "PushScope", "PopScope",
+		"RepeatInit", "RepeatNext", "IterInit", "IterNext", "IterEnd", "Return", "ReturnEmpty", "EvalNode",
+	};
+	static_assert(size(names) == (size_t)OpCode::Count_);
+
+	return (size_t)op < size(names) ? names[(size_t)op] : "(Unknown)";
+}
+
+string CodeChunk::Disassemble() const {
+	string text;
+	for (size_t i = 0; i < Code.size(); i++) {
+		auto& inst = Code[i];
+		text += format("{:4}: {:<12} {:3} {:3} {:3} ({})", i, OpCodeToString(inst.Op), inst.A, inst.B, inst.C, inst.sBx);
+		if (inst.Op == OpCode::LoadConst)
+			text += format(" ; {}", Constants[inst.Bx].ToString());
+		text += "\n";
+	}
+	return text;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <cstdint>
+
+#include "Value.h"
+
+namespace Dynamix {
+	class AstNode;
+	class JitCode;
+
+	enum class OpCode : uint8_t {
+		Nop,
+		LoadConst,		// R[A] = K[Bx]
+		LoadEmpty,		// R[A] = empty
+		LoadTrue,		// R[A] = true
+		LoadFalse,		// R[A] = false
+		Move,			// R[A] = R[B]
+		ClearRegs,		// R[A] .. R[A + B - 1] = empty
+		LoadName,		// R[A] = name (origin NameExpression)
+		Assign,			// R[A] = (name op= R[A]) (origin AssignExpression)
+		TestVar,		// if var exists locally: R[A] = DuplicateName error, pc += sBx
+		DeclareVar,		// declare var with initial value R[A]; R[A] = empty
+		Add,			// R[A] = R[B] + R[C]
+		Sub,
+		Mul,
+		Div,
+		Mod,
+		Equal,
+		NotEqual,
+		Less,
+		LessEqual,
+		Greater,
+		GreaterEqual,
+		Binary,			// R[A] = R[B] op R[C] (origin BinaryExpression)
+		Unary,			// R[A] = op R[B] (origin UnaryExpression)
+		Jump,			// pc += sBx
+		JumpIfFalse,	// if !R[A] pc += sBx
+		JumpIfTrue,		// if R[A] pc += sBx
+		JumpIfError,	// if R[A] is an error pc += sBx
+		Call,			// R[A] = R[B](R[B + 1] .. R[B + C])
+		CallMember,		// R[A] = R[B].member(R[B + 1] .. R[B + C]) (origin InvokeFunctionExpression)
+		GetMember,		// R[A] = R[A].member (origin GetMemberExpression)
+		GetIndex,		// R[A] = R[B][R[C]]
+		SetIndex,		// R[A][R[A + 1]] op= R[A + 2] (origin AssignArrayIndexExpression)
+		NewArray,		// R[A] = [R[B] .. R[B + C - 1]]
+		PushScope,		// push a scope with Bx variable slots
+		PopScope,
+		RepeatInit,		// R[A] = int(R[A])
+		RepeatNext,		// if R[A] <= 0 pc += sBx else --R[A]
+		IterInit,		// push a scope, declare the loop variable and start enumerating R[A] (origin ForEachStatement)
+		IterNext,		// loop variable = next item, or pc += sBx when done
+		IterEnd,		// drop the enumerator and pop the loop scope
+		Return,			// return R[A]
+		ReturnEmpty,
+		EvalNode,		// R[A] = tree-walk origin node; Bx - 1 is the loop handler index, if any
+		Count_,
+	};
+
+	struct Instruction {
+		OpCode Op;
+		uint8_t A;
+		union {
+			struct {
+				uint8_t B, C;
+			};
+			uint16_t Bx;
+			int16_t sBx;
+		};
+	};
+	static_assert(sizeof(Instruction) == 4);
+
+	//
+	// jump targets for break/continue statements left pending by a tree-walked node inside a compiled loop
+	//
+	struct LoopHandler {
+		int Break;
+		int Continue;
+	};
+
+	struct CodeChunk {
+		std::vector<Instruction> Code;
+		std::vector<AstNode const*> Origins;	// source node per instruction
+		std::vector<Value> Constants;
+		std::vector<LoopHandler> Handlers;
+		int RegisterCount{ 0 };
+		bool FunctionBody{ false };
+		// calls and loop iterations run so far, and the machine code the JIT built once they were enough
+		mutable int Hotness{ 0 };
+		mutable std::shared_ptr<JitCode const> Native;
+
+		std::string Disassemble() const;
+	};
+
+	const char* OpCodeToString(OpCode op) noexcept;
+}
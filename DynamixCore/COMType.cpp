@@ -79,9 +79,9 @@ Value VariantToValue(CComVariant const& v) {
 	return Value();
 }
 
-Value COMObject::Invoke(Interpreter& intr, std::string const& name, std::vector<Value>& args, InvokeFlags flags) {
+Value COMObject::Invoke(Interpreter& intr, Atom name, std::vector<Value>& args, InvokeFlags flags) {
 	DISPID id;
-	if (auto hr = GetDispId(name, &id); FAILED(hr))
+	if (auto hr = GetDispId(name.ToString(), &id); FAILED(hr))
 		return Value::HResult(hr);
 
 	std::vector<CComVariant> v;
@@ -96,9 +96,9 @@ Value COMObject::Invoke(Interpreter& intr, std::string const& name, std::vector<
 	return VariantToValue(result);
 }
 
-void COMObject::AssignField(std::string const& name, Value value, TokenType assignType) {
+void COMObject::AssignField(Atom name, Value value, TokenType assignType) {
 	DISPID id;
-	if (FAILED(GetDispId(name, &id)))
+	if (FAILED(GetDispId(name.ToString(), &id)))
 		throw RuntimeError(RuntimeErrorType::UnknownMember, std::format("Property '{}' not found on COM object", name));
 
 	auto var = ValueToVariant(value);
@@ -107,9 +107,9 @@ void COMObject::AssignField(std::string const& name, Value value, TokenType assi
 		throw RuntimeError(RuntimeErrorType::PropertyPut, std::format("Property '{}' failed to set on COM object", name));
 }
 
-Value COMObject::GetFieldValue(std::string const& name) const {
+Value COMObject::GetFieldValue(Atom name) const {
 	DISPID id;
-	if (auto hr = GetDispId(name, &id); FAILED(hr))
+	if (auto hr = GetDispId(name.ToString(), &id); FAILED(hr))
 		return Value::HResult(hr);
 
 	CComVariant result;
@@ -117,9 +117,9 @@ Value COMObject::GetFieldValue(std::string const& name) const {
 	return FAILED(hr) ? Value::HResult(hr) : VariantToValue(result);
 }
 
-bool COMObject::HasField(std::string const& name) const noexcept {
+bool COMObject::HasField(Atom name) const noexcept {
 	DISPID id;
-	return SUCCEEDED(GetDispId(name, &id));
+	return SUCCEEDED(GetDispId(name.ToString(), &id));
 }
 
 HRESULT COMObject::GetDispId(std::string const& name, DISPID* id) const {
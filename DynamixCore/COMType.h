@@ -14,6 +14,10 @@ namespace Dynamix {
 
 		static Value Create(Value const& cls);
 
+		bool HasDynamicMembers() const noexcept override {
+			return true;
+		}
+
 	private:
 		COMType();
 	};
@@ -26,11 +30,11 @@ namespace Dynamix {
 			return true;
 		}
 
-		Value Invoke(Interpreter& intr, std::string const& name, std::vector<Value>& args, InvokeFlags flags) override;
-		void AssignField(std::string const& name, Value value, TokenType assignType) override;
+		Value Invoke(Interpreter& intr, Atom name, std::vector<Value>& args, InvokeFlags flags) override;
+		void AssignField(Atom name, Value value, TokenType assignType) override;
 
-		Value GetFieldValue(std::string const& name) const override;
-		bool HasField(std::string const& name) const noexcept override;
+		Value GetFieldValue(Atom name) const override;
+		bool HasField(Atom name) const noexcept override;
 
 		IDispatch* GetDispatch() const {
 			return m_Dispatch.p;
@@ -0,0 +1,174 @@
+#include <cassert>
+#include <format>
+#include <print>
+
+#include "CompiledProgram.h"
+#include "CppTranslator.h"
+#include "AstNode.h"
+#include "Runtime.h"
+#include "RuntimeObject.h"
+#include "ObjectType.h"
+#include "ArrayType.h"
+#include "RangeType.h"
+
+using namespace Dynamix;
+using namespace std;
+
+CompiledProgram::CompiledProgram(span<CompiledSource const> sources, size_t nodeCount) : m_Parser(m_Tokenizer) {
+	vector<CppTranslator::Source> translated;
+	for (auto& source : sources) {
+		m_Parser.SetOptimizations(source.Optimizations);
+		auto code = m_Parser.Parse(string_view(source.Text, source.Length));
+		if (!code) {
+			for (auto& e : m_Parser.Errors())
+				println("{}({},{}): {}", source.FileName, e.Location().Line, e.Location().Col, e.Description());
+			exit(1);
+		}
+		translated.push_back({ source.FileName, string(source.Text, source.Length), source.Optimizations, code.get() });
+		m_Code.push_back(move(code));
+	}
+
+	CppTranslator translator;
+	translator.Translate(translated);
+	m_Nodes = translator.Nodes();
+	if (m_Nodes.size() != nodeCount) {
+		println("Program was generated by a different build of Dynamix");
+		exit(1);
+	}
+}
+
+int CompiledProgram::Run(vector<CompiledFunction> const& functions, int argc, const char* argv[], const char* envp[]) {
+	Runtime rt;
+	Interpreter intr(rt);
+	for (auto& f : functions)
+		intr.BindNative(reinterpret_cast<FunctionDeclaration const*>(m_Nodes[f.Node]), f.Code);
+
+	try {
+		for (auto& code : m_Code)
+			intr.Eval(code.get());
+		rt.AddCode(move(m_Code));
+
+		if (auto result = intr.RunMain(argc - 1, argv + 1, envp); !result.IsEmpty())
+			println("{}", result.ToString());
+	}
+	catch (RuntimeError const& err) {
+		println("Runtime error: {}", err.Message());
+		return 1;
+	}
+	return 0;
+}
+
+Value CompiledProgram::Literal(AstNode const* node) {
+	return reinterpret_cast<LiteralExpression const*>(node)->Literal();
+}
+
+Value CompiledProgram::Binary(Interpreter& intr, Value const& left, TokenType op, Value const& right) {
+	return intr.BinaryOperation(left, op, right);
+}
+
+Value CompiledProgram::Unary(Value const& arg, TokenType op) {
+	return arg.UnaryOperator(op);
+}
+
+void CompiledProgram::Assign(Value& target, TokenType type, Value const& rhs) {
+	target.Assign(rhs, type);
+}
+
+Int CompiledProgram::DivInt(Int left, Int right) {
+	if (right == 0)
+		throw RuntimeError(RuntimeErrorType::DivisionByZero, "Cannot divide by zero");
+	return left / right;
+}
+
+Real CompiledProgram::DivReal(Real left, Real right) {
+	if (right == 0)
+		throw RuntimeError(RuntimeErrorType::DivisionByZero, "Cannot divide by zero");
+	return left / right;
+}
+
+void CompiledProgram::Variable(Interpreter& intr, AstNode const* assign) {
+	auto expr = reinterpret_cast<AssignExpression const*>(assign);
+	if (!intr.FindVariable(expr->LhsAtom(), SlotRef()))
+		throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Unknown identifier: {}", expr->Lhs()), expr->Location());
+}
+
+Value CompiledProgram::AssignVariable(Interpreter& intr, AstNode const* assign, Value const& rhs) {
+	auto expr = reinterpret_cast<AssignExpression const*>(assign);
+	auto lhs = intr.FindVariable(expr->LhsAtom(), SlotRef());
+	if (!lhs)
+		throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Unknown identifier: {}", expr->Lhs()), expr->Location());
+	return lhs->VarValue.Assign(rhs, expr->AssignType());
+}
+
+Value CompiledProgram::GetMember(Interpreter& intr, Value const& target, AstNode const* member) {
+	return intr.GetMemberValue(target, reinterpret_cast<GetMemberExpression const*>(member));
+}
+
+Value CompiledProgram::InvokeMember(Interpreter& intr, Value const& target, vector<Value>& args, AstNode const* site) {
+	return intr.InvokeMember(target, args, reinterpret_cast<InvokeFunctionExpression const*>(site));
+}
+
+Value CompiledProgram::Index(Value const& value, Value const& index) {
+	if (value.IsObject() && value.AsObject()->Type() == ArrayType::Get() && index.IsInteger()) {
+		auto array = static_cast<ArrayObject const*>(value.AsObject());
+		// out of range indices take the generic path to report the error
+		if (auto i = index.AsInteger(); i >= 0 && i < array->Count())
+			return array->Items()[i];
+	}
+	return value.InvokeIndexer(index);
+}
+
+Value CompiledProgram::AssignIndex(Value array, Value const& index, Value const& value, TokenType type) {
+	return array.AssignArrayIndex(index, value, type);
+}
+
+Value CompiledProgram::AssignField(Interpreter& intr, Value const& obj, AstNode const* assign, Value const& value) {
+	auto expr = reinterpret_cast<AssignFieldExpression const*>(assign);
+	if (!obj.IsObject())
+		throw RuntimeError(RuntimeErrorType::TypeMismatch, format("Cannot assign a field of {}", obj.ToString()), expr->Location());
+	const_cast<RuntimeObject*>(obj.AsObject())->AssignField(expr->Lhs()->MemberAtom(), value, expr->AssignType());
+	return intr.GetMemberValue(obj, expr->Lhs());
+}
+
+Value CompiledProgram::NewObject(Interpreter& intr, AstNode const* expr, vector<Value> args) {
+	auto newObject = reinterpret_cast<NewObjectExpression const*>(expr);
+	auto& name = newObject->ClassName();
+	auto v = intr.CurrentScope().FindElement(newObject->ClassNameAtom());
+	if (v == nullptr)
+		throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Class '{}' not found in scope", name));
+
+	if ((v->Flags & ElementFlags::Class) != ElementFlags::Class)
+		throw RuntimeError(RuntimeErrorType::TypeMismatch, format("'{}' is not a class name in scope", name));
+
+	auto type = reinterpret_cast<ObjectType*>(v->VarValue.AsObject());
+	auto obj = type->CreateObject(intr, args);
+	assert(obj);
+	Value vobj(obj);
+	obj->Release();
+	return vobj;
+}
+
+Value CompiledProgram::Array(vector<Value> items) {
+	return ArrayType::Get()->CreateArrayValue(move(items));
+}
+
+Value CompiledProgram::Range(Value const& start, Value const& end, bool inclusive) {
+	return RangeType::Get()->CreateRange(start.ToInteger(), end.ToInteger() + (inclusive ? 1 : 0));
+}
+
+unique_ptr<IEnumerator> CompiledProgram::Enumerate(Value const& collection, AstNode const* stmt) {
+	auto location = reinterpret_cast<ForEachStatement const*>(stmt)->Collection()->Location();
+	if (!collection.IsObject())
+		throw RuntimeError(RuntimeErrorType::TypeMismatch, "Expected collection in 'foreach' statement", location);
+
+	auto enumerable = static_cast<IEnumerable*>(const_cast<RuntimeObject*>(collection.AsObject())->QueryService(ServiceId::Enumerable));
+	if (!enumerable)
+		throw RuntimeError(RuntimeErrorType::TypeMismatch, "Object does not implement the Enumerable interface", location);
+	return enumerable->GetEnumerator();
+}
+
+void CompiledProgram::CheckArity(vector<Value> const& args, size_t count, AstNode const* decl) {
+	if (args.size() != count)
+		throw RuntimeError(RuntimeErrorType::WrongNumberArguments,
+			format("Wrong numnber of arguments. Expected: {}, Provided: {}", count, args.size()), decl->Location());
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <bit>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "Interpreter.h"
+#include "Optimizer.h"
+#include "Parser.h"
+#include "Tokenizer.h"
+#include "CoreInterfaces.h"
+
+namespace Dynamix {
+	class AstNode;
+	class Statements;
+
+	//
+	// a source file embedded in a program generated by 'dynamix compile'
+	//
+	struct CompiledSource {
+		const char* FileName;
+		const char* Text;
+		size_t Length;
+		OptimizerPasses Optimizations;
+	};
+
+	//
+	// a translated function, bound in place of the declaration at Node
+	//
+	struct CompiledFunction {
+		int Node;
+		NativeFunction Code;
+	};
+
+	//
+	// startup and runtime support for generated programs.
+	// the sources are parsed again and translated again to number their nodes the same way as
+	// when the program was generated; the static helpers are the operations translated code
+	// performs through the runtime, with the interpreter's semantics
+	//
+	class CompiledProgram final : NoCopy {
+	public:
+		CompiledProgram(std::span<CompiledSource const> sources, size_t nodeCount);
+
+		AstNode const* const* Nodes() const noexcept {
+			return m_Nodes.data();
+		}
+
+		// runs Main with the program's arguments; returns the process exit code
+		int Run(std::vector<CompiledFunction> const& functions, int argc, const char* argv[], const char* envp[]);
+
+		static Value Literal(AstNode const* node);
+		static Value Binary(Interpreter& intr, Value const& left, TokenType op, Value const& right);
+		static Value Unary(Value const& arg, TokenType op);
+		static void Assign(Value& target, TokenType type, Value const& rhs);
+		static Int DivInt(Int left, Int right);
+		static Real DivReal(Real left, Real right);
+
+		// fails as an assignment to an unknown variable does
+		static void Variable(Interpreter& intr, AstNode const* assign);
+		static Value AssignVariable(Interpreter& intr, AstNode const* assign, Value const& rhs);
+
+		static Value GetMember(Interpreter& intr, Value const& target, AstNode const* member);
+		static Value InvokeMember(Interpreter& intr, Value const& target, std::vector<Value>& args, AstNode const* site);
+		static Value Index(Value const& value, Value const& index);
+		static Value AssignIndex(Value array, Value const& index, Value const& value, TokenType type);
+		static Value AssignField(Interpreter& intr, Value const& obj, AstNode const* assign, Value const& value);
+		static Value NewObject(Interpreter& intr, AstNode const* expr, std::vector<Value> args);
+		static Value Array(std::vector<Value> items);
+		static Value Range(Value const& start, Value const& end, bool inclusive);
+		static std::unique_ptr<IEnumerator> Enumerate(Value const& collection, AstNode const* stmt);
+		static void CheckArity(std::vector<Value> const& args, size_t count, AstNode const* decl);
+
+	private:
+		Tokenizer m_Tokenizer;
+		Parser m_Parser;
+		std::vector<std::unique_ptr<Statements>> m_Code;
+		std::vector<AstNode const*> m_Nodes;
+	};
+}
@@ -0,0 +1,514 @@
+#include <cassert>
+#include <algorithm>
+
+#include "Compiler.h"
+#include "AstNode.h"
+
+using namespace Dynamix;
+using namespace std;
+
+namespace {
+	// thrown when a chunk exceeds the instruction encoding limits
+	struct CompileError {
+	};
+
+	OpCode BinaryOpCode(TokenType op) noexcept {
+		switch (op) {
+			case TokenType::Plus: return OpCode::Add;
+			case TokenType::Minus: return OpCode::Sub;
+			case TokenType::Mul: return OpCode::Mul;
+			case TokenType::Div: return OpCode::Div;
+			case TokenType::Mod: return OpCode::Mod;
+			case TokenType::Equal: return OpCode::Equal;
+			case TokenType::NotEqual: return OpCode::NotEqual;
+			case TokenType::LessThan: return OpCode::Less;
+			case TokenType::LessThanOrEqual: return OpCode::LessEqual;
+			case TokenType::GreaterThan: return OpCode::Greater;
+			case TokenType::GreaterThanOrEqual: return OpCode::GreaterEqual;
+		}
+		return OpCode::Binary;
+	}
+}
+
+unique_ptr<CodeChunk> Compiler::Compile(AstNode const* root, bool functionBody) {
+	m_Chunk = make_unique<CodeChunk>();
+	m_Chunk->FunctionBody = functionBody;
+	m_Loops.clear();
+	m_NextRegister = m_HighWater = 0;
+	m_Origin = root;
+
+	try {
+		auto result = AllocRegisters();
+		CompileInto(root, result);
+		Emit(OpCode::Return, result);
+	}
+	catch (CompileError const&) {
+		//
+		// too big to encode - hand the whole tree to the tree-walker
+		//
+		m_Chunk = make_unique<CodeChunk>();
+		m_Chunk->FunctionBody = functionBody;
+		m_Chunk->RegisterCount = 1;
+		m_Loops.clear();
+		m_Origin = root;
+		EmitBx(OpCode::EvalNode, 0, 0);
+		Emit(OpCode::Return, 0);
+	}
+	return move(m_Chunk);
+}
+
+void Compiler::CompileInto(AstNode const* node, int dest) {
+	auto origin = m_Origin;
+	auto saved = m_Dest;
+	m_Dest = dest;
+	if (node) {
+		m_Origin = node;
+		node->Accept(this);
+	}
+	else {
+		Emit(OpCode::LoadEmpty, dest);
+	}
+	m_Origin = origin;
+	m_Dest = saved;
+}
+
+int Compiler::Emit(OpCode op, int a, int b, int c) {
+	assert(a >= 0 && a <= UINT8_MAX && b >= 0 && b <= UINT8_MAX && c >= 0 && c <= UINT8_MAX);
+	Instruction inst{ op, (uint8_t)a };
+	inst.B = (uint8_t)b;
+	inst.C = (uint8_t)c;
+	m_Chunk->Code.push_back(inst);
+	m_Chunk->Origins.push_back(m_Origin);
+	return Here() - 1;
+}
+
+int Compiler::EmitBx(OpCode op, int a, int bx) {
+	if (bx > UINT16_MAX)
+		throw CompileError();
+
+	Instruction inst{ op, (uint8_t)a };
+	inst.Bx = (uint16_t)bx;
+	m_Chunk->Code.push_back(inst);
+	m_Chunk->Origins.push_back(m_Origin);
+	return Here() - 1;
+}
+
+int Compiler::EmitJump(OpCode op, int a) {
+	return Emit(op, a);
+}
+
+void Compiler::PatchJump(int pc, int target) {
+	auto offset = target - (pc + 1);
+	if (offset < INT16_MIN || offset > INT16_MAX)
+		throw CompileError();
+
+	m_Chunk->Code[pc].sBx = (int16_t)offset;
+}
+
+void Compiler::PatchJump(int pc) {
+	PatchJump(pc, Here());
+}
+
+int Compiler::Here() const noexcept {
+	return (int)m_Chunk->Code.size();
+}
+
+int Compiler::AllocRegisters(int count) {
+	auto reg = m_NextRegister;
+	m_NextRegister += count;
+	if (m_NextRegister > UINT8_MAX)
+		throw CompileError();
+
+	m_HighWater = max(m_HighWater, m_NextRegister);
+	m_Chunk->RegisterCount = max(m_Chunk->RegisterCount, m_NextRegister);
+	return reg;
+}
+
+void Compiler::FreeRegisters(int top) noexcept {
+	m_NextRegister = top;
+}
+
+int Compiler::AddConstant(Value const& value) {
+	m_Chunk->Constants.push_back(value);
+	return (int)m_Chunk->Constants.size() - 1;
+}
+
+Value Compiler::Fallback(AstNode const* node) {
+	assert(node == m_Origin);
+	int handler = 0;
+	if (!m_Loops.empty()) {
+		m_Chunk->Handlers.push_back(LoopHandler{ -1, -1 });
+		handler = (int)m_Chunk->Handlers.size();
+		m_Loops.back().Handlers.push_back(handler - 1);
+	}
+	EmitBx(OpCode::EvalNode, m_Dest, handler);
+	return Value();
+}
+
+void Compiler::BeginLoop(int continueTarget) {
+	LoopContext loop;
+	loop.ContinueTarget = continueTarget;
+	m_Loops.push_back(move(loop));
+}
+
+Compiler::LoopContext Compiler::EndLoop() {
+	auto loop = move(m_Loops.back());
+	m_Loops.pop_back();
+	return loop;
+}
+
+void Compiler::PatchLoop(LoopContext const& loop, int breakTarget, int continueTarget) {
+	for (auto pc : loop.Breaks)
+		PatchJump(pc, breakTarget);
+	for (auto pc : loop.Continues)
+		PatchJump(pc, continueTarget);
+	for (auto h : loop.Handlers)
+		m_Chunk->Handlers[h] = LoopHandler{ breakTarget, continueTarget };
+}
+
+Value Compiler::VisitLiteral(LiteralExpression const* expr) {
+	auto& value = expr->Literal();
+	if (value.IsEmpty())
+		Emit(OpCode::LoadEmpty, m_Dest);
+	else if (value.IsBoolean())
+		Emit(value.ToBoolean() ? OpCode::LoadTrue : OpCode::LoadFalse, m_Dest);
+	else
+		EmitBx(OpCode::LoadConst, m_Dest, AddConstant(value));
+	return Value();
+}
+
+Value Compiler::VisitBinary(BinaryExpression const* expr) {
+	auto op = expr->Operator();
+	auto dest = m_Dest;
+	auto top = m_NextRegister;
+
+	CompileInto(expr->Left(), dest);
+	if (op == TokenType::And || op == TokenType::Or) {
+		auto shortCircuit = EmitJump(op == TokenType::And ? OpCode::JumpIfFalse : OpCode::JumpIfTrue, dest);
+		auto right = AllocRegisters();
+		CompileInto(expr->Right(), right);
+		Emit(OpCode::Binary, dest, dest, right);
+		FreeRegisters(top);
+		auto end = EmitJump(OpCode::Jump);
+		PatchJump(shortCircuit);
+		Emit(op == TokenType::And ? OpCode::LoadFalse : OpCode::LoadTrue, dest);
+		PatchJump(end);
+		return Value();
+	}
+
+	auto right = AllocRegisters();
+	CompileInto(expr->Right(), right);
+	Emit(BinaryOpCode(op), dest, dest, right);
+	FreeRegisters(top);
+	return Value();
+}
+
+Value Compiler::VisitUnary(UnaryExpression const* expr) {
+	CompileInto(expr->Arg(), m_Dest);
+	Emit(OpCode::Unary, m_Dest, m_Dest);
+	return Value();
+}
+
+Value Compiler::VisitName(NameExpression const* expr) {
+	Emit(OpCode::LoadName, m_Dest);
+	return Value();
+}
+
+Value Compiler::VisitVar(VarValStatement const* expr) {
+	auto dest = m_Dest;
+	auto duplicate = EmitJump(OpCode::TestVar, dest);
+	CompileInto(expr->Init(), dest);
+	Emit(OpCode::DeclareVar, dest);
+	PatchJump(duplicate);
+	return Value();
+}
+
+Value Compiler::VisitAssign(AssignExpression const* expr) {
+	CompileInto(expr->Value(), m_Dest);
+	Emit(OpCode::Assign, m_Dest);
+	return Value();
+}
+
+Value Compiler::VisitInvokeFunction(InvokeFunctionExpression const* expr) {
+	auto& args = expr->Arguments();
+	if (args.size() >= UINT8_MAX)
+		return Fallback(expr);
+
+	//
+	// the tree-walker leaves a call in tail position for the caller to run once this body returns,
+	// so a chain of tail calls does not nest
+	//
+	if (expr->IsTailCall() && m_Chunk->FunctionBody)
+		return Fallback(expr);
+
+	auto top = m_NextRegister;
+	auto dest = m_Dest;
+	auto base = AllocRegisters((int)args.size() + 1);
+	//
+	// obj.method(...) dispatches on the receiver through the site's inline cache
+	//
+	auto member = expr->Callable()->NodeType() == AstNodeType::GetMember;
+	if (member)
+		CompileInto(reinterpret_cast<GetMemberExpression const*>(expr->Callable())->Left(), base);
+	else
+		CompileInto(expr->Callable(), base);
+	for (size_t i = 0; i < args.size(); i++)
+		CompileInto(args[i].get(), base + 1 + (int)i);
+	Emit(member ? OpCode::CallMember : OpCode::Call, dest, base, (int)args.size());
+	FreeRegisters(top);
+	return Value();
+}
+
+Value Compiler::VisitWhile(WhileStatement const* stmt) {
+	auto dest = m_Dest;
+	auto top = m_NextRegister;
+	auto temp = AllocRegisters();
+
+	EmitBx(OpCode::PushScope, 0, stmt->SlotCount());
+	auto loop = Here();
+	CompileInto(stmt->Condition(), temp);
+	auto exit = EmitJump(OpCode::JumpIfFalse, temp);
+	BeginLoop(loop);
+	CompileInto(stmt->Body(), temp);
+	auto context = EndLoop();
+	PatchJump(EmitJump(OpCode::Jump), loop);
+	PatchJump(exit);
+	PatchLoop(context, Here(), loop);
+	Emit(OpCode::PopScope);
+	Emit(OpCode::LoadEmpty, dest);
+	FreeRegisters(top);
+	return Value();
+}
+
+Value Compiler::VisitIfThenElse(IfThenElseExpression const* expr) {
+	auto dest = m_Dest;
+	CompileInto(expr->Condition(), dest);
+	auto error = EmitJump(OpCode::JumpIfError, dest);
+	auto otherwise = EmitJump(OpCode::JumpIfFalse, dest);
+	CompileInto(expr->Then(), dest);
+	auto end = EmitJump(OpCode::Jump);
+	PatchJump(otherwise);
+	CompileInto(expr->Else(), dest);
+	PatchJump(end);
+	PatchJump(error);
+	return Value();
+}
+
+Value Compiler::VisitFunctionDeclaration(FunctionDeclaration const* decl) {
+	return Fallback(decl);
+}
+
+Value Compiler::VisitReturn(ReturnStatement const* decl) {
+	if (!m_Chunk->FunctionBody)
+		return Fallback(decl);
+
+	CompileInto(decl->ReturnValue(), m_Dest);
+	Emit(OpCode::Return, m_Dest);
+	return Value();
+}
+
+Value Compiler::VisitBreakContinue(BreakOrContinueStatement const* stmt) {
+	switch (stmt->BreakType()) {
+		case TokenType::Break:
+			if (m_Loops.empty())
+				break;
+			m_Loops.back().Breaks.push_back(EmitJump(OpCode::Jump));
+			return Value();
+
+		case TokenType::Continue:
+			if (m_Loops.empty())
+				break;
+			if (auto target = m_Loops.back().ContinueTarget; target >= 0)
+				PatchJump(EmitJump(OpCode::Jump), target);
+			else
+				m_Loops.back().Continues.push_back(EmitJump(OpCode::Jump));
+			return Value();
+
+		case TokenType::BreakOut:
+			if (!m_Chunk->FunctionBody)
+				break;
+			Emit(OpCode::ReturnEmpty);
+			return Value();
+	}
+	return Fallback(stmt);
+}
+
+Value Compiler::VisitFor(ForStatement const* stmt) {
+	auto dest = m_Dest;
+	auto top = m_NextRegister;
+	auto temp = AllocRegisters();
+
+	EmitBx(OpCode::PushScope, 0, stmt->SlotCount());
+	if (stmt->Init())
+		CompileInto(stmt->Init(), temp);
+	auto loop = Here();
+	CompileInto(stmt->While(), temp);
+	auto exit = EmitJump(OpCode::JumpIfFalse, temp);
+	BeginLoop();
+	if (stmt->Body())
+		CompileInto(stmt->Body(), temp);
+	auto context = EndLoop();
+	auto next = Here();
+	if (stmt->Inc())
+		CompileInto(stmt->Inc(), temp);
+	PatchJump(EmitJump(OpCode::Jump), loop);
+	PatchJump(exit);
+	PatchLoop(context, Here(), next);
+	Emit(OpCode::PopScope);
+	Emit(OpCode::LoadEmpty, dest);
+	FreeRegisters(top);
+	return Value();
+}
+
+Value Compiler::VisitStatements(Statements const* stmts) {
+	auto dest = m_Dest;
+	if (stmts->Get().empty()) {
+		Emit(OpCode::LoadEmpty, dest);
+		return Value();
+	}
+
+	for (auto& stmt : stmts->Get()) {
+		//
+		// release temporaries once a statement is done, so objects die as early as they do when tree-walking
+		//
+		auto top = m_NextRegister;
+		auto highWater = m_HighWater;
+		m_HighWater = top;
+		CompileInto(stmt.get(), dest);
+		if (m_HighWater > top)
+			Emit(OpCode::ClearRegs, top, m_HighWater - top);
+		m_HighWater = max(highWater, m_HighWater);
+	}
+	return Value();
+}
+
+Value Compiler::VisitAnonymousFunction(AnonymousFunctionExpression const* func) {
+	// the tree-walker records the names it looks up in its callers' scopes
+	if (!func->FreeNames().empty())
+		return Fallback(func);
+	EmitBx(OpCode::LoadConst, m_Dest, AddConstant(Value(static_cast<AstNode const*>(func))));
+	return Value();
+}
+
+Value Compiler::VisitEnumDeclaration(EnumDeclaration const* decl) {
+	return Fallback(decl);
+}
+
+Value Compiler::VisitExpressionStatement(ExpressionStatement const* expr) {
+	CompileInto(expr->Expr(), m_Dest);
+	if (expr->HasSemicolon())
+		Emit(OpCode::LoadEmpty, m_Dest);
+	return Value();
+}
+
+Value Compiler::VisitArrayExpression(ArrayExpression const* expr) {
+	auto& items = expr->Items();
+	if (items.size() > UINT8_MAX)
+		return Fallback(expr);
+
+	auto top = m_NextRegister;
+	auto dest = m_Dest;
+	auto base = AllocRegisters(max(1, (int)items.size()));
+	for (size_t i = 0; i < items.size(); i++)
+		CompileInto(items[i].get(), base + (int)i);
+	Emit(OpCode::NewArray, dest, base, (int)items.size());
+	FreeRegisters(top);
+	return Value();
+}
+
+Value Compiler::VisitRepeat(RepeatStatement const* stmt) {
+	auto dest = m_Dest;
+	auto top = m_NextRegister;
+	auto counter = AllocRegisters();
+	auto temp = AllocRegisters();
+
+	CompileInto(stmt->Times(), counter);
+	Emit(OpCode::RepeatInit, counter);
+	auto loop = Here();
+	auto exit = EmitJump(OpCode::RepeatNext, counter);
+	BeginLoop(loop);
+	CompileInto(stmt->Body(), temp);
+	auto context = EndLoop();
+	PatchJump(EmitJump(OpCode::Jump), loop);
+	PatchJump(exit);
+	PatchLoop(context, Here(), loop);
+	Emit(OpCode::LoadEmpty, dest);
+	FreeRegisters(top);
+	return Value();
+}
+
+Value Compiler::VisitGetMember(GetMemberExpression const* expr) {
+	CompileInto(expr->Left(), m_Dest);
+	Emit(OpCode::GetMember, m_Dest);
+	return Value();
+}
+
+Value Compiler::VisitAccessArray(AccessArrayExpression const* expr) {
+	auto top = m_NextRegister;
+	auto dest = m_Dest;
+	auto index = AllocRegisters();
+	CompileInto(expr->Index(), index);
+	CompileInto(expr->Left(), dest);
+	Emit(OpCode::GetIndex, dest, dest, index);
+	FreeRegisters(top);
+	return Value();
+}
+
+Value Compiler::VisitAssignArrayIndex(AssignArrayIndexExpression const* expr) {
+	auto top = m_NextRegister;
+	auto dest = m_Dest;
+	auto base = AllocRegisters(3);
+	CompileInto(expr->ArrayAccess()->Left(), base);
+	CompileInto(expr->ArrayAccess()->Index(), base + 1);
+	CompileInto(expr->Value(), base + 2);
+	Emit(OpCode::SetIndex, base);
+	Emit(OpCode::Move, dest, base);
+	FreeRegisters(top);
+	return Value();
+}
+
+Value Compiler::VisitClassDeclaration(ClassDeclaration const* decl) {
+	return Fallback(decl);
+}
+
+Value Compiler::VisitNewObjectExpression(NewObjectExpression const* expr) {
+	return Fallback(expr);
+}
+
+Value Compiler::VisitAssignField(AssignFieldExpression const* expr) {
+	return Fallback(expr);
+}
+
+Value Compiler::VisitForEach(ForEachStatement const* stmt) {
+	auto dest = m_Dest;
+	auto top = m_NextRegister;
+	auto collection = AllocRegisters();
+	auto temp = AllocRegisters();
+
+	CompileInto(stmt->Collection(), collection);
+	Emit(OpCode::IterInit, collection);
+	auto loop = Here();
+	auto exit = EmitJump(OpCode::IterNext);
+	BeginLoop(loop);
+	CompileInto(stmt->Body(), temp);
+	auto context = EndLoop();
+	PatchJump(EmitJump(OpCode::Jump), loop);
+	PatchJump(exit);
+	PatchLoop(context, Here(), loop);
+	Emit(OpCode::IterEnd);
+	Emit(OpCode::LoadEmpty, dest);
+	FreeRegisters(top);
+	return Value();
+}
+
+Value Compiler::VisitRange(RangeExpression const* expr) {
+	return Fallback(expr);
+}
+
+Value Compiler::VisitMatch(MatchExpression const* expr) {
+	return Fallback(expr);
+}
+
+Value Compiler::VisitUse(UseStatement const* use) {
+	return Fallback(use);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Visitor.h"
+#include "Bytecode.h"
+
+namespace Dynamix {
+	class AstNode;
+	class Statement;
+
+	//
+	// lowers an AST into register-based bytecode for the VirtualMachine.
+	// nodes with no bytecode form are emitted as EvalNode and run by the tree-walker.
+	//
+	class Compiler final : public Visitor {
+	public:
+		std::unique_ptr<CodeChunk> Compile(AstNode const* root, bool functionBody = false);
+
+		// Inherited via Visitor
+		Value VisitLiteral(LiteralExpression const* expr) override;
+		Value VisitBinary(BinaryExpression const* expr) override;
+		Value VisitUnary(UnaryExpression const* expr) override;
+		Value VisitName(NameExpression const* expr) override;
+		Value VisitVar(VarValStatement const* expr) override;
+		Value VisitAssign(AssignExpression const* expr) override;
+		Value VisitInvokeFunction(InvokeFunctionExpression const* expr) override;
+		Value VisitWhile(WhileStatement const* stmt) override;
+		Value VisitIfThenElse(IfThenElseExpression const* expr) override;
+		Value VisitFunctionDeclaration(FunctionDeclaration const* decl) override;
+		Value VisitReturn(ReturnStatement const* decl) override;
+		Value VisitBreakContinue(BreakOrContinueStatement const* stmt) override;
+		Value VisitFor(ForStatement const* stmt) override;
+		Value VisitStatements(Statements const* stmts) override;
+		Value VisitAnonymousFunction(AnonymousFunctionExpression const* func) override;
+		Value VisitEnumDeclaration(EnumDeclaration const* decl) override;
+		Value VisitExpressionStatement(ExpressionStatement const* expr) override;
+		Value VisitArrayExpression(ArrayExpression const* expr) override;
+		Value VisitRepeat(RepeatStatement const* stmt) override;
+		Value VisitGetMember(GetMemberExpression const* expr) override;
+		Value VisitAccessArray(AccessArrayExpression const* expr) override;
+		Value VisitAssignArrayIndex(AssignArrayIndexExpression const* expr) override;
+		Value VisitClassDeclaration(ClassDeclaration const* decl) override;
+		Value VisitNewObjectExpression(NewObjectExpression const* expr) override;
+		Value VisitAssignField(AssignFieldExpression const* expr) override;
+		Value VisitForEach(ForEachStatement const* stmt) override;
+		Value VisitRange(RangeExpression const* expr) override;
+		Value VisitMatch(MatchExpression const* expr) override;
+		Value VisitUse(UseStatement const* use) override;
+
+	private:
+		struct LoopContext {
+			std::vector<int> Breaks;
+			std::vector<int> Continues;
+			std::vector<int> Handlers;
+			int ContinueTarget{ -1 };
+		};
+
+		void CompileInto(AstNode const* node, int dest);
+		int Emit(OpCode op, int a = 0, int b = 0, int c = 0);
+		int EmitBx(OpCode op, int a, int bx);
+		int EmitJump(OpCode op, int a = 0);
+		void PatchJump(int pc, int target);
+		void PatchJump(int pc);
+		int Here() const noexcept;
+		int AllocRegisters(int count = 1);
+		void FreeRegisters(int top) noexcept;
+		int AddConstant(Value const& value);
+		Value Fallback(AstNode const* node);
+		void BeginLoop(int continueTarget = -1);
+		LoopContext EndLoop();
+		void PatchLoop(LoopContext const& loop, int breakTarget, int continueTarget);
+
+		std::unique_ptr<CodeChunk> m_Chunk;
+		std::vector<LoopContext> m_Loops;
+		AstNode const* m_Origin{ nullptr };
+		int m_Dest{ 0 };
+		int m_NextRegister{ 0 };
+		int m_HighWater{ 0 };
+	};
+}
@@ -20,7 +20,7 @@ namespace Dynamix {
 
 	class ComplexObject : public RuntimeObject {
 	public:
-		ComplexObject(Real real = 0, Real image = 0) : RuntimeObject(ComplexType::Get()), m_Num(real, image) {}
+		ComplexObject(Dynamix::Real real = 0, Dynamix::Real image = 0) : RuntimeObject(ComplexType::Get()), m_Num(real, image) {}
 		ComplexObject(std::complex<double> const& c) : ComplexObject(c.real(), c.imag()) {}
 
 		Value InvokeOperator(Interpreter& intr, TokenType op, Value const& rhs) const override;
@@ -29,11 +29,11 @@ namespace Dynamix {
 			return Image() == 0 && Real() == 0;
 		}
 
-		Real Image() const noexcept {
+		Dynamix::Real Image() const noexcept {
 			return m_Num.imag();
 		}
 
-		Real Real() const noexcept {
+		Dynamix::Real Real() const noexcept {
 			return m_Num.real();
 		}
 
@@ -0,0 +1,1375 @@
+#include <cassert>
+#include <cmath>
+#include <bit>
+#include <format>
+#include <algorithm>
+#include <utility>
+
+#include "CppTranslator.h"
+#include "AstNode.h"
+#include "Quickening.h"
+
+using namespace Dynamix;
+using namespace std;
+
+namespace {
+	//
+	// what a subtree refers to and does, for deciding how much of a function can be translated.
+	// a shallow scan stays in the scope it starts in and collects the variables declared there
+	//
+	class NodeScan final : public Visitor {
+	public:
+		explicit NodeScan(bool shallow = false) noexcept : m_Shallow(shallow) {}
+
+		void Scan(AstNode const* node) {
+			if (node)
+				node->Accept(this);
+		}
+
+		void ScanCallable(FunctionEssentials const* func, bool method) {
+			if (m_Callables == 0)
+				m_Own = 1;
+			m_Callables++;
+			for (auto& p : func->Parameters()) {
+				Declare(p.Name);
+				Scan(p.DefaultValue.get());
+			}
+			auto recordThis = exchange(m_RecordThis, !method);
+			Scan(func->Body());
+			m_RecordThis = recordThis;
+			m_Callables--;
+		}
+
+		// names read, assigned or declared
+		unordered_set<Atom> Names;
+		// names looked up through the scope chain from inside a function, method or lambda
+		unordered_set<Atom> Dynamic;
+		unordered_set<Atom> Declared;
+		// names declared by the code scanned itself rather than by functions nested in it
+		unordered_set<Atom> Own;
+		vector<VarValStatement const*> Vars;
+		// returns, breaks, declarations and tail calls outside nested functions, which only mean something in their enclosing function
+		bool Control{ false };
+		bool Assigns{ false };
+
+		Value VisitLiteral(LiteralExpression const* expr) override {
+			return Value();
+		}
+		Value VisitBinary(BinaryExpression const* expr) override {
+			Scan(expr->Left());
+			Scan(expr->Right());
+			return Value();
+		}
+		Value VisitUnary(UnaryExpression const* expr) override {
+			Scan(expr->Arg());
+			return Value();
+		}
+		Value VisitName(NameExpression const* expr) override {
+			Use(expr, expr->NameAtom());
+			return Value();
+		}
+		Value VisitVar(VarValStatement const* expr) override {
+			Scan(expr->Init());
+			Declare(expr->NameAtom());
+			Vars.push_back(expr);
+			Assigns = true;
+			Control |= m_Callables == 0;
+			return Value();
+		}
+		Value VisitAssign(AssignExpression const* expr) override {
+			Scan(expr->Value());
+			Use(expr, expr->LhsAtom());
+			Assigns = true;
+			return Value();
+		}
+		Value VisitInvokeFunction(InvokeFunctionExpression const* expr) override {
+			Scan(expr->Callable());
+			for (auto& arg : expr->Arguments())
+				Scan(arg.get());
+			if (expr->IsTailCall())
+				Control |= m_Callables == 0;
+			return Value();
+		}
+		Value VisitWhile(WhileStatement const* stmt) override {
+			if (!m_Shallow) {
+				Scan(stmt->Condition());
+				Scan(stmt->Body());
+			}
+			return Value();
+		}
+		Value VisitIfThenElse(IfThenElseExpression const* expr) override {
+			Scan(expr->Condition());
+			Scan(expr->Then());
+			Scan(expr->Else());
+			return Value();
+		}
+		Value VisitFunctionDeclaration(FunctionDeclaration const* decl) override {
+			Declare(Atom(decl->Name()));
+			Control |= m_Callables == 0;
+			if (!m_Shallow)
+				ScanCallable(decl, decl->IsMethod() && !decl->IsStatic());
+			return Value();
+		}
+		Value VisitReturn(ReturnStatement const* decl) override {
+			Scan(decl->ReturnValue());
+			Control |= m_Callables == 0;
+			return Value();
+		}
+		Value VisitBreakContinue(BreakOrContinueStatement const* stmt) override {
+			Control |= m_Callables == 0;
+			return Value();
+		}
+		Value VisitFor(ForStatement const* stmt) override {
+			if (!m_Shallow) {
+				Scan(stmt->Init());
+				Scan(stmt->While());
+				Scan(stmt->Inc());
+				Scan(stmt->Body());
+			}
+			return Value();
+		}
+		Value VisitStatements(Statements const* stmts) override {
+			for (auto& stmt : stmts->Get())
+				Scan(stmt.get());
+			return Value();
+		}
+		Value VisitAnonymousFunction(AnonymousFunctionExpression const* func) override {
+			if (!m_Shallow)
+				ScanCallable(func, false);
+			return Value();
+		}
+		Value VisitEnumDeclaration(EnumDeclaration const* decl) override {
+			Declare(Atom(decl->Name()));
+			Control |= m_Callables == 0;
+			return Value();
+		}
+		Value VisitExpressionStatement(ExpressionStatement const* expr) override {
+			Scan(expr->Expr());
+			return Value();
+		}
+		Value VisitArrayExpression(ArrayExpression const* expr) override {
+			for (auto& item : expr->Items())
+				Scan(item.get());
+			return Value();
+		}
+		Value VisitRepeat(RepeatStatement const* stmt) override {
+			Scan(stmt->Times());
+			Scan(stmt->Body());
+			return Value();
+		}
+		Value VisitGetMember(GetMemberExpression const* expr) override {
+			Scan(expr->Left());
+			return Value();
+		}
+		Value VisitAccessArray(AccessArrayExpression const* expr) override {
+			Scan(expr->Left());
+			Scan(expr->Index());
+			return Value();
+		}
+		Value VisitAssignArrayIndex(AssignArrayIndexExpression const* expr) override {
+			Scan(expr->ArrayAccess());
+			Scan(expr->Value());
+			return Value();
+		}
+		Value VisitClassDeclaration(ClassDeclaration const* decl) override {
+			Declare(Atom(decl->Name()));
+			Control |= m_Callables == 0;
+			if (m_Shallow)
+				return Value();
+			for (auto& m : decl->Methods())
+				ScanCallable(m.get(), !m->IsStatic());
+			//
+			// field initializers run when objects are created, possibly from inside a function
+			//
+			m_Callables++;
+			auto recordThis = exchange(m_RecordThis, true);
+			for (auto& f : decl->Fields())
+				Scan(f.get());
+			m_RecordThis = recordThis;
+			m_Callables--;
+			for (auto& t : decl->Types())
+				Scan(t.get());
+			return Value();
+		}
+		Value VisitNewObjectExpression(NewObjectExpression const* expr) override {
+			for (auto& arg : expr->Arguments())
+				Scan(arg.get());
+			for (auto& init : expr->FieldInitializers())
+				Scan(init.Init.get());
+			return Value();
+		}
+		Value VisitAssignField(AssignFieldExpression const* expr) override {
+			Scan(expr->Lhs());
+			Scan(expr->Value());
+			return Value();
+		}
+		Value VisitForEach(ForEachStatement const* stmt) override {
+			Scan(stmt->Collection());
+			if (!m_Shallow) {
+				Declare(stmt->NameAtom());
+				Scan(stmt->Body());
+			}
+			return Value();
+		}
+		Value VisitRange(RangeExpression const* expr) override {
+			Scan(expr->Start());
+			Scan(expr->End());
+			return Value();
+		}
+		Value VisitMatch(MatchExpression const* expr) override {
+			Scan(expr->ToMatch());
+			for (auto& mc : expr->MatchCases()) {
+				for (auto& c : mc.Cases())
+					Scan(c.get());
+				Scan(mc.Action());
+			}
+			return Value();
+		}
+		Value VisitUse(UseStatement const* use) override {
+			Control |= m_Callables == 0;
+			return Value();
+		}
+
+	private:
+		void Declare(Atom name) {
+			Names.insert(name);
+			Declared.insert(name);
+			if (m_Callables == m_Own)
+				Own.insert(name);
+		}
+
+		void Use(VariableSlot const* node, Atom name) {
+			Names.insert(name);
+			if (m_Callables > 0 && !node->Slot().IsResolved() && (m_RecordThis || name != m_This))
+				Dynamic.insert(name);
+		}
+
+		Atom m_This{ "this" };
+		int m_Callables{ 0 };
+		int m_Own{ 0 };
+		bool m_RecordThis{ true };
+		bool m_Shallow;
+	};
+
+	string TokenName(TokenType op) {
+		static const pair<TokenType, const char*> names[] = {
+			{ TokenType::Plus, "Plus" }, { TokenType::Minus, "Minus" }, { TokenType::Mul, "Mul" }, { TokenType::Div, "Div" },
+			{ TokenType::Mod, "Mod" }, { TokenType::Power, "Power" }, { TokenType::Not, "Not" }, { TokenType::And, "And" },
+			{ TokenType::Or, "Or" }, { TokenType::Equal, "Equal" }, { TokenType::NotEqual, "NotEqual" },
+			{ TokenType::LessThan, "LessThan" }, { TokenType::LessThanOrEqual, "LessThanOrEqual" },
+			{ TokenType::GreaterThan, "GreaterThan" }, { TokenType::GreaterThanOrEqual, "GreaterThanOrEqual" },
+			{ TokenType::BitwiseAnd, "BitwiseAnd" }, { TokenType::BitwiseOr, "BitwiseOr" }, { TokenType::BitwiseXor, "BitwiseXor" },
+			{ TokenType::StreamLeft, "StreamLeft" }, { TokenType::StreamRight, "StreamRight" }, { TokenType::TypeOf, "TypeOf" },
+			{ TokenType::Assign, "Assign" }, { TokenType::Assign_Add, "Assign_Add" }, { TokenType::Assign_Sub, "Assign_Sub" },
+			{ TokenType::Assign_Mul, "Assign_Mul" }, { TokenType::Assign_Div, "Assign_Div" }, { TokenType::Assign_Mod, "Assign_Mod" },
+			{ TokenType::Assign_And, "Assign_And" }, { TokenType::Assign_Or, "Assign_Or" }, { TokenType::Assign_Xor, "Assign_Xor" },
+		};
+		for (auto& [type, name] : names)
+			if (type == op)
+				return format("TokenType::{}", name);
+		return format("TokenType({})", int(op));
+	}
+
+	string Identifier(string const& name) {
+		string id;
+		for (auto ch : name)
+			id += isalnum((unsigned char)ch) || ch == '_' ? ch : '_';
+		return id;
+	}
+
+	string Quoted(string const& text) {
+		string quoted = "\"";
+		for (auto ch : text) {
+			if (ch == '"' || ch == '\\')
+				quoted += '\\';
+			quoted += ch;
+		}
+		return quoted + '"';
+	}
+
+	string IntLiteral(Int value) {
+		if (value == INT64_MIN)
+			return "(Int(-9223372036854775807) - 1)";
+		return format("Int({})", value);
+	}
+
+	string RealLiteral(Real value) {
+		if (!isfinite(value))
+			return format("std::bit_cast<Real>(uint64_t(0x{:x}))", bit_cast<uint64_t>(value));
+		auto text = format("{}", value);
+		if (text.find_first_of(".e") == string::npos)
+			text += ".0";
+		return format("Real({})", text);
+	}
+
+	bool IsNonZeroLiteral(Expression const* expr) {
+		if (expr == nullptr || expr->NodeType() != AstNodeType::Literal)
+			return false;
+		auto& value = reinterpret_cast<LiteralExpression const*>(expr)->Literal();
+		return (value.IsInteger() && value.AsInteger() != 0) || (value.IsReal() && value.AsReal() != 0);
+	}
+
+	bool IsNumeric(auto type) noexcept {
+		return type == decltype(type)::Int || type == decltype(type)::Real;
+	}
+}
+
+string CppTranslator::Translate(vector<Source> const& sources) {
+	m_Nodes.clear();
+	m_NodeIndex.clear();
+	m_Functions.clear();
+	m_Translated.clear();
+	m_Interpreted.clear();
+	ScanProgram(sources);
+
+	//
+	// a call to a function that does not translate goes through the interpreter, which can change
+	// what its caller needs; translate until the set of translated functions settles
+	//
+	m_Code.assign(m_Functions.size(), string());
+	for (bool changed = true; changed; ) {
+		changed = false;
+		for (size_t i = 0; i < m_Functions.size(); i++) {
+			auto& f = m_Functions[i];
+			if (f.Translated && !TranslateFunction(f)) {
+				f.Translated = false;
+				changed = true;
+			}
+			else if (f.Translated) {
+				m_Code[i] = move(m_Text);
+			}
+		}
+	}
+
+	string out;
+	out += "//\n// generated by 'dynamix compile'";
+	for (auto& source : sources)
+		out += format(" {}", source.FileName);
+	out += "\n// build against DynamixCore with the same build of the core, e.g.\n";
+	out += "// g++ -std=c++20 -O2 -I <DynamixCore> <this file> <DynamixCore library>\n//\n\n";
+	out += "#include <CompiledProgram.h>\n\nusing namespace Dynamix;\nusing P = CompiledProgram;\n\nnamespace {\n";
+
+	for (size_t i = 0; i < sources.size(); i++) {
+		out += format("\tunsigned char const Source{}[] = {{", i);
+		auto& text = sources[i].Text;
+		for (size_t j = 0; j < text.size(); j++)
+			out += format("{}{}{}", j % 20 == 0 ? "\n\t\t" : " ", (int)(unsigned char)text[j], ",");
+		out += "\n\t\t0\n\t};\n";
+	}
+	out += "\tCompiledSource const Sources[] = {\n";
+	for (size_t i = 0; i < sources.size(); i++)
+		out += format("\t\t{{ {}, reinterpret_cast<char const*>(Source{}), sizeof(Source{}) - 1, OptimizerPasses({}) }},\n",
+			Quoted(sources[i].FileName), i, i, (uint32_t)sources[i].Optimizations);
+	out += "\t};\n\n\tAstNode const* const* N;\n\n";
+
+	for (auto& f : m_Functions) {
+		if (!f.Translated) {
+			m_Interpreted.push_back(f.Decl->Name());
+			continue;
+		}
+		m_Translated.push_back(f.Decl->Name());
+		string params = f.Method ? ", Value self" : "";
+		for (size_t i = 0; i < f.Decl->Parameters().size(); i++)
+			params += format(", Value p{}_{}", i, Identifier(f.Decl->Parameters()[i].Name.ToString()));
+		out += format("\tValue {}(Interpreter& intr{});\n", f.Id, params);
+	}
+	out += "\n";
+	for (size_t i = 0; i < m_Functions.size(); i++)
+		if (m_Functions[i].Translated)
+			out += m_Code[i] + "\n";
+
+	string table;
+	for (auto& f : m_Functions) {
+		if (!f.Translated)
+			continue;
+		auto count = f.Decl->Parameters().size() + (f.Method ? 1 : 0);
+		string args;
+		for (size_t i = 0; i < count; i++)
+			args += format(", std::move(args[{}])", i);
+		out += format("\tValue {}_native(Interpreter& intr, std::vector<Value>& args) {{\n", f.Id);
+		out += format("\t\tP::CheckArity(args, {}, N[{}]);\n", count, Node(f.Decl));
+		out += format("\t\treturn {}(intr{});\n\t}}\n\n", f.Id, args);
+		table += format("\t\t{{ {}, {}_native }},\n", Node(f.Decl), f.Id);
+	}
+	out += format("\tstd::vector<CompiledFunction> const Functions = {{\n{}\t}};\n}}\n\n", table);
+	out += "int main(int argc, const char* argv[], const char* envp[]) {\n";
+	out += format("\tCompiledProgram program(Sources, {});\n", m_Nodes.size());
+	out += "\tN = program.Nodes();\n";
+	out += "\treturn program.Run(Functions, argc, argv, envp);\n}\n";
+	return out;
+}
+
+void CppTranslator::ScanProgram(vector<Source> const& sources) {
+	NodeScan scan;
+	auto add = [&](FunctionDeclaration const* decl, bool method) {
+		auto id = format("{}{}_{}", method ? "m" : "f", m_Functions.size(), Identifier(decl->Name()));
+		m_Functions.push_back(Function{ decl, move(id), method });
+	};
+	for (auto& source : sources) {
+		for (auto& stmt : source.Code->Get()) {
+			if (stmt->NodeType() == AstNodeType::FunctionDeclaration) {
+				auto decl = reinterpret_cast<FunctionDeclaration const*>(stmt.get());
+				m_FunctionNames[Atom(decl->Name())]++;
+				add(decl, false);
+				scan.ScanCallable(decl, false);
+				continue;
+			}
+			if (stmt->NodeType() == AstNodeType::ClassDeclaration) {
+				for (auto& m : reinterpret_cast<ClassDeclaration const*>(stmt.get())->Methods())
+					if (!m->IsStatic() && m->Name() != "new")
+						add(m.get(), true);
+			}
+			scan.Scan(stmt.get());
+		}
+	}
+	m_DynamicNames = move(scan.Dynamic);
+	m_DeclaredNames = move(scan.Declared);
+	m_ThisIsDynamic = m_DynamicNames.contains(Atom::This);
+}
+
+bool CppTranslator::TranslateFunction(Function const& f) {
+	auto decl = f.Decl;
+	auto& params = decl->Parameters();
+	for (size_t i = 0; i < params.size(); i++) {
+		if (params[i].DefaultValue)
+			return false;
+		for (size_t j = 0; j < i; j++)
+			if (params[i].Name == params[j].Name)
+				return false;
+	}
+	if (f.Method && m_ThisIsDynamic)
+		return false;
+
+	//
+	// other code sees a function's variables through dynamic scoping if it looks up any name the function declares
+	//
+	NodeScan scan;
+	scan.ScanCallable(decl, f.Method);
+	for (auto& name : scan.Own)
+		if (m_DynamicNames.contains(name))
+			return false;
+	m_LocalNames = move(scan.Own);
+	m_Function = &f;
+	m_Locals.clear();
+
+	//
+	// local types start unset and widen until a pass over the body changes none of them
+	//
+	for (;;) {
+		m_TypesChanged = false;
+		try {
+			EmitFunction(f);
+		}
+		catch (Unsupported const&) {
+			return false;
+		}
+		if (m_TypesChanged)
+			continue;
+		auto unset = false;
+		for (auto& local : m_Locals) {
+			if (local.Type == CType::Unset) {
+				local.Type = CType::Value;
+				unset = true;
+			}
+		}
+		if (!unset)
+			return true;
+	}
+}
+
+void CppTranslator::EmitFunction(Function const& f) {
+	auto decl = f.Decl;
+	m_Text.clear();
+	m_Frames.clear();
+	m_Declared.clear();
+	m_Unguarded.clear();
+	m_LocalCount = 0;
+	m_Temps = 0;
+	m_Loops = 0;
+	m_TailCall = false;
+	m_Indent = 3;
+
+	Line("Value result;");
+	EnterScope(decl);
+	for (size_t i = 0; i < decl->Parameters().size(); i++)
+		DefineLocal((int)i, decl->Parameters()[i].Name.ToString(), true);
+	DeclareLocals(decl->Body());
+	//
+	// variables declared directly in the body run their initializer once per call
+	//
+	if (auto body = dynamic_cast<Statements const*>(decl->Body()))
+		for (auto& stmt : body->Get())
+			if (stmt->NodeType() == AstNodeType::VarValStatement)
+				m_Unguarded.insert(stmt.get());
+
+	Stmt(decl->Body(), "result");
+	Line("return result;");
+	LeaveScope();
+
+	string params = f.Method ? ", Value self" : "";
+	for (size_t i = 0; i < decl->Parameters().size(); i++)
+		params += format(", Value {}", m_Locals[i].Id);
+	auto body = move(m_Text);
+	m_Text = format("\tValue {}(Interpreter& intr{}) {{\n\t\tCallFrame frame(&intr);\n", f.Id, params);
+	if (m_TailCall)
+		m_Text += "\ttail:\n";
+	m_Text += "\t\t{\n" + body + "\t\t}\n\t}\n";
+}
+
+void CppTranslator::EnterScope(ScopeSlots const* owner) {
+	Frame frame{ owner };
+	frame.Slots.assign(owner->SlotCount(), -1);
+	frame.Insert = m_Text.size();
+	frame.Indent = m_Indent;
+	m_Frames.push_back(move(frame));
+}
+
+void CppTranslator::LeaveScope() {
+	auto& frame = m_Frames.back();
+	string decls;
+	auto indent = string(frame.Indent, '\t');
+	for (auto index : frame.Locals) {
+		auto& local = m_Locals[index];
+		// parameters are declared by the function's signature
+		if (index < (int)m_Function->Decl->Parameters().size())
+			continue;
+		switch (local.Type) {
+			case CType::Int: decls += format("{}Int {}{{}};\n", indent, local.Id); break;
+			case CType::Real: decls += format("{}Real {}{{}};\n", indent, local.Id); break;
+			case CType::Bool: decls += format("{}bool {}{{}};\n", indent, local.Id); break;
+			default: decls += format("{}Value {};\n", indent, local.Id); break;
+		}
+		if (local.Flagged)
+			decls += format("{}bool d{} = false;\n", indent, index);
+	}
+	m_Text.insert(frame.Insert, decls);
+	m_Frames.pop_back();
+}
+
+int CppTranslator::DefineLocal(int slot, string const& name, bool fixed) {
+	auto& frame = m_Frames.back();
+	if (slot < 0 || slot >= (int)frame.Slots.size())
+		throw Unsupported();
+	if (auto index = frame.Slots[slot]; index >= 0) {
+		m_Locals[index].Declarations++;
+		return index;
+	}
+
+	auto index = m_LocalCount++;
+	if (index == (int)m_Locals.size())
+		m_Locals.push_back(Local{ m_Frames.size() == 1 && fixed ? format("p{}_{}", slot, Identifier(name)) : format("l{}_{}", index, Identifier(name)) });
+	auto& local = m_Locals[index];
+	local.Declarations = 1;
+	local.Fixed = fixed;
+	local.Flagged = false;
+	if (fixed)
+		local.Type = CType::Value;
+	m_Declared.resize(m_LocalCount);
+	m_Declared[index] = fixed;
+	frame.Slots[slot] = index;
+	frame.Locals.push_back(index);
+	return index;
+}
+
+void CppTranslator::DeclareLocals(AstNode const* node) {
+	NodeScan scan(true);
+	scan.Scan(node);
+	for (auto var : scan.Vars) {
+		if (!var->Slot().IsResolved() || var->Slot().Depth != 0)
+			throw Unsupported();
+		DefineLocal(var->Slot().Index, var->Name(), false);
+	}
+}
+
+int CppTranslator::FindLocal(SlotRef slot) const {
+	if (!slot.IsResolved() || slot.Depth >= (int)m_Frames.size())
+		return -1;
+	auto& frame = m_Frames[m_Frames.size() - 1 - slot.Depth];
+	return slot.Index < (int)frame.Slots.size() ? frame.Slots[slot.Index] : -1;
+}
+
+CppTranslator::Operand CppTranslator::LocalOperand(int index) {
+	auto& local = m_Locals[index];
+	return Operand{ local.Id, local.Type, false };
+}
+
+CppTranslator::Context CppTranslator::TakeContext() {
+	return exchange(m_Context, Context{ false });
+}
+
+//
+// where a statement leaves its value; one used as an expression gets a temporary
+//
+string CppTranslator::ValueTarget(Context const& ctx) {
+	if (ctx.Statement)
+		return ctx.Target;
+	auto temp = NewTemp();
+	Line(format("Value {};", temp));
+	m_Result = Operand{ temp, CType::Value, true, true };
+	return temp;
+}
+
+Value CppTranslator::Finish(Context const& ctx, Operand op) {
+	if (ctx.Statement && !ctx.Target.empty())
+		Line(format("{} = {};", ctx.Target, Boxed(op)));
+	m_Result = move(op);
+	return Value();
+}
+
+CppTranslator::Operand CppTranslator::Expr(Expression const* expr) {
+	m_Context = Context{ false };
+	expr->Accept(this);
+	return m_Result;
+}
+
+void CppTranslator::Stmt(AstNode const* node, string const& target) {
+	if (node == nullptr) {
+		if (!target.empty())
+			Line(format("{} = Value();", target));
+		return;
+	}
+	m_Context = Context{ true, target };
+	node->Accept(this);
+}
+
+//
+// a block runs its statements with the variables declared so far; those it declares are not known after it
+//
+void CppTranslator::Body(AstNode const* node) {
+	auto declared = m_Declared;
+	m_Indent++;
+	Stmt(node, "");
+	m_Indent--;
+	declared.resize(m_Declared.size());
+	m_Declared = move(declared);
+}
+
+//
+// code with no translation runs on the interpreter, as long as it does not touch the function's variables
+// or transfer control out of it
+//
+Value CppTranslator::Fallback(AstNode const* node) {
+	auto ctx = TakeContext();
+	if (!IsClosed(node))
+		throw Unsupported();
+	auto eval = format("intr.Eval({})", N(node));
+	if (ctx.Statement) {
+		Line(ctx.Target.empty() ? eval + ";" : format("{} = {};", ctx.Target, eval));
+		return Value();
+	}
+	m_Result = Temp(CType::Value, eval);
+	return Value();
+}
+
+//
+// until its declaration runs, a variable's name is looked up through the scope chain, where it can find
+// any variable of that name; functions declaring one are left to the interpreter, as is this one
+//
+void CppTranslator::LateName(Atom name) {
+	m_DynamicNames.insert(name);
+	throw Unsupported();
+}
+
+bool CppTranslator::IsClosed(AstNode const* node) const {
+	NodeScan scan;
+	scan.Scan(node);
+	if (scan.Control)
+		return false;
+	for (auto& name : scan.Names)
+		if (m_LocalNames.contains(name))
+			return false;
+	return !(m_Function->Method && scan.Names.contains(Atom::This));
+}
+
+bool CppTranslator::HasAssignment(AstNode const* node) const {
+	NodeScan scan;
+	scan.Scan(node);
+	return scan.Assigns;
+}
+
+string CppTranslator::NewTemp() {
+	return format("t{}", m_Temps++);
+}
+
+CppTranslator::Operand CppTranslator::Temp(CType type, string const& text) {
+	auto temp = NewTemp();
+	char const* name = "Value";
+	switch (type) {
+		case CType::Int: name = "Int"; break;
+		case CType::Real: name = "Real"; break;
+		case CType::Bool: name = "bool"; break;
+	}
+	Line(format("{} {} = {};", name, temp, text));
+	return Operand{ temp, type, true, type == CType::Value || type == CType::Unset };
+}
+
+CppTranslator::Operand CppTranslator::Materialize(Operand op) {
+	if (op.Stable)
+		return op;
+	return Temp(op.Type, op.Text);
+}
+
+string CppTranslator::Boxed(Operand const& op) const {
+	if (op.Type == CType::Value || op.Type == CType::Unset)
+		return op.Text;
+	return format("Value({})", op.Text);
+}
+
+string CppTranslator::Converted(Operand const& op, CType type) const {
+	if (type == op.Type || type == CType::Unset || op.Type == CType::Unset)
+		return op.Text;
+	if (type == CType::Value)
+		return Boxed(op);
+	if (type == CType::Real && op.Type == CType::Int)
+		return format("Real({})", op.Text);
+	return op.Text;
+}
+
+string CppTranslator::Condition(Expression const* cond) {
+	auto op = Expr(cond);
+	if (op.Type == CType::Bool)
+		return op.Text;
+	return format("{}.ToBoolean()", Boxed(op));
+}
+
+//
+// arguments in order; each is copied before a later one that assigns a variable
+//
+vector<CppTranslator::Operand> CppTranslator::Operands(AstVector<unique_ptr<Expression>> const& args) {
+	size_t last = 0;
+	for (size_t i = 0; i < args.size(); i++)
+		if (HasAssignment(args[i].get()))
+			last = i;
+
+	vector<Operand> ops;
+	for (size_t i = 0; i < args.size(); i++) {
+		auto op = Expr(args[i].get());
+		ops.push_back(i < last ? Materialize(move(op)) : move(op));
+	}
+	return ops;
+}
+
+void CppTranslator::CallBlock(Operand const& result, vector<Operand> const& args, string const& call) {
+	Line(format("Value {};", result.Text));
+	Line("{");
+	m_Indent++;
+	Line("Arguments arguments(&intr);");
+	Line("auto& args = arguments.Get();");
+	for (auto& arg : args)
+		Line(format("args.emplace_back({});", arg.Movable ? format("std::move({})", arg.Text) : Boxed(arg)));
+	Line(format("{} = {};", result.Text, call));
+	m_Indent--;
+	Line("}");
+}
+
+//
+// a call by name binds to a translated function if nothing else in the program declares that name
+//
+CppTranslator::Function const* CppTranslator::DirectCallee(InvokeFunctionExpression const* expr) const {
+	if (expr->Callable()->NodeType() != AstNodeType::Name)
+		return nullptr;
+	auto name = reinterpret_cast<NameExpression const*>(expr->Callable());
+	if (name->Slot().IsResolved())
+		return nullptr;
+	if (auto it = m_FunctionNames.find(name->NameAtom()); it == m_FunctionNames.end() || it->second != 1)
+		return nullptr;
+	if (m_DeclaredNames.contains(name->NameAtom()))
+		return nullptr;
+	for (auto& f : m_Functions)
+		if (!f.Method && f.Translated && f.Decl->Name() == name->Name())
+			return f.Decl->Parameters().size() == expr->Arguments().size() ? &f : nullptr;
+	return nullptr;
+}
+
+void CppTranslator::Join(Local& local, CType type) {
+	if (type == CType::Unset || local.Type == type || local.Type == CType::Value)
+		return;
+	local.Type = local.Type == CType::Unset ? type : CType::Value;
+	m_TypesChanged = true;
+}
+
+void CppTranslator::AssignLocal(int index, TokenType type, Operand const& rhs) {
+	auto& local = m_Locals[index];
+	if (type == TokenType::Assign) {
+		Join(local, rhs.Type);
+		Line(format("{} = {};", local.Id, Converted(rhs, local.Type)));
+		return;
+	}
+	auto op = CompoundOperator(type);
+	Join(local, op == TokenType::Invalid ? CType::Value : BinaryType(op, local.Type, rhs.Type, nullptr));
+	if (local.Type == CType::Value || local.Type == CType::Unset) {
+		Line(format("P::Assign({}, {}, {});", local.Id, TokenName(type), Boxed(rhs)));
+		return;
+	}
+	auto result = TypedBinary(op, LocalOperand(index), rhs, local.Type);
+	Line(format("{} = {};", local.Id, result.Text));
+}
+
+//
+// the type of a binary operation on operands of known types; Value unless the result is certain.
+// integer division throws on zero, as does division of an integer and a real;
+// real division by zero and the remainder of zero give an error value, so they are typed only by a non-zero literal
+//
+CppTranslator::CType CppTranslator::BinaryType(TokenType op, CType left, CType right, Expression const* rightExpr) const {
+	if (left == CType::Unset || right == CType::Unset)
+		return CType::Unset;
+
+	auto ints = left == CType::Int && right == CType::Int;
+	if (IsNumeric(left) && IsNumeric(right)) {
+		switch (op) {
+			case TokenType::Plus:
+			case TokenType::Minus:
+			case TokenType::Mul:
+				return ints ? CType::Int : CType::Real;
+			case TokenType::Div:
+				if (left == CType::Real && right == CType::Real)
+					return IsNonZeroLiteral(rightExpr) ? CType::Real : CType::Value;
+				return ints ? CType::Int : CType::Real;
+			case TokenType::Mod:
+				return ints && IsNonZeroLiteral(rightExpr) ? CType::Int : CType::Value;
+			case TokenType::BitwiseAnd:
+			case TokenType::BitwiseOr:
+			case TokenType::BitwiseXor:
+				return ints ? CType::Int : CType::Value;
+			case TokenType::Equal:
+			case TokenType::NotEqual:
+			case TokenType::LessThan:
+			case TokenType::LessThanOrEqual:
+			case TokenType::GreaterThan:
+			case TokenType::GreaterThanOrEqual:
+				return CType::Bool;
+		}
+	}
+	if (left == CType::Bool && right == CType::Bool) {
+		switch (op) {
+			case TokenType::Equal:
+			case TokenType::NotEqual:
+			case TokenType::LessThan:
+			case TokenType::LessThanOrEqual:
+			case TokenType::GreaterThan:
+			case TokenType::GreaterThanOrEqual:
+				return CType::Bool;
+		}
+	}
+	return CType::Value;
+}
+
+CppTranslator::Operand CppTranslator::TypedBinary(TokenType op, Operand const& left, Operand const& right, CType type) {
+	if (type == CType::Value || type == CType::Unset)
+		return Temp(type, format("P::Binary(intr, {}, {}, {})", Boxed(left), TokenName(op), Boxed(right)));
+
+	auto ints = left.Type == CType::Int && right.Type == CType::Int;
+	auto reals = left.Type == CType::Real && right.Type == CType::Real;
+	auto mixed = IsNumeric(left.Type) && IsNumeric(right.Type) && !ints;
+	auto a = mixed ? Converted(left, CType::Real) : left.Text;
+	auto b = mixed ? Converted(right, CType::Real) : right.Text;
+	string text;
+	switch (op) {
+		case TokenType::Plus: text = format("{} + {}", a, b); break;
+		case TokenType::Minus: text = format("{} - {}", a, b); break;
+		case TokenType::Mul: text = format("{} * {}", a, b); break;
+		case TokenType::Div:
+			text = ints ? format("P::DivInt({}, {})", a, b) : reals ? format("{} / {}", a, b) : format("P::DivReal({}, {})", a, b);
+			break;
+		case TokenType::Mod: text = format("{} % {}", a, b); break;
+		case TokenType::BitwiseAnd: text = format("{} & {}", a, b); break;
+		case TokenType::BitwiseOr: text = format("{} | {}", a, b); break;
+		case TokenType::BitwiseXor: text = format("{} ^ {}", a, b); break;
+		case TokenType::Equal: text = format("{} == {}", a, b); break;
+		case TokenType::NotEqual: text = format("{} != {}", a, b); break;
+		case TokenType::LessThan: text = format("{} < {}", a, b); break;
+		case TokenType::LessThanOrEqual: text = format("{} <= {}", a, b); break;
+		case TokenType::GreaterThan: text = format("{} > {}", a, b); break;
+		case TokenType::GreaterThanOrEqual: text = format("{} >= {}", a, b); break;
+		default:
+			assert(false);
+	}
+	return Temp(type, text);
+}
+
+void CppTranslator::Line(string const& text) {
+	m_Text.append(m_Indent, '\t').append(text).append(1, '\n');
+}
+
+int CppTranslator::Node(AstNode const* node) {
+	auto [it, added] = m_NodeIndex.try_emplace(node, (int)m_Nodes.size());
+	if (added)
+		m_Nodes.push_back(node);
+	return it->second;
+}
+
+string CppTranslator::N(AstNode const* node) {
+	return format("N[{}]", Node(node));
+}
+
+Value CppTranslator::VisitLiteral(LiteralExpression const* expr) {
+	auto ctx = TakeContext();
+	auto& value = expr->Literal();
+	if (value.IsInteger())
+		return Finish(ctx, Operand{ IntLiteral(value.AsInteger()), CType::Int });
+	if (value.IsReal())
+		return Finish(ctx, Operand{ RealLiteral(value.AsReal()), CType::Real });
+	if (value.IsBoolean())
+		return Finish(ctx, Operand{ value.ToBoolean() ? "true" : "false", CType::Bool });
+	return Finish(ctx, Operand{ format("P::Literal({})", N(expr)), CType::Value });
+}
+
+Value CppTranslator::VisitBinary(BinaryExpression const* expr) {
+	auto ctx = TakeContext();
+	auto op = expr->Operator();
+	auto left = Expr(expr->Left());
+
+	if (op == TokenType::And || op == TokenType::Or) {
+		//
+		// the right operand runs only if the left one does not decide the result
+		//
+		auto decided = op == TokenType::And ? "false" : "true";
+		if (left.Type == CType::Bool) {
+			auto result = Temp(CType::Bool, left.Text);
+			Line(format("if ({}{}) {{", op == TokenType::And ? "" : "!", result.Text));
+			m_Indent++;
+			Line(format("{} = {};", result.Text, Condition(expr->Right())));
+			m_Indent--;
+			Line("}");
+			return Finish(ctx, result);
+		}
+		auto boxed = Materialize(Operand{ Boxed(left), CType::Value, left.Stable && left.Type == CType::Value });
+		auto result = Temp(left.Type == CType::Unset ? CType::Unset : CType::Value, "Value()");
+		Line(format("if ({}{}.ToBoolean()) {{", op == TokenType::And ? "!" : "", boxed.Text));
+		Line(format("\t{} = {};", result.Text, decided));
+		Line("}");
+		Line("else {");
+		m_Indent++;
+		auto right = Expr(expr->Right());
+		Line(format("{} = P::Binary(intr, {}, {}, {});", result.Text, boxed.Text, TokenName(op), Boxed(right)));
+		m_Indent--;
+		Line("}");
+		return Finish(ctx, result);
+	}
+
+	if (HasAssignment(expr->Right()))
+		left = Materialize(move(left));
+	auto right = Expr(expr->Right());
+	return Finish(ctx, TypedBinary(op, left, right, BinaryType(op, left.Type, right.Type, expr->Right())));
+}
+
+Value CppTranslator::VisitUnary(UnaryExpression const* expr) {
+	auto ctx = TakeContext();
+	auto arg = Expr(expr->Arg());
+	switch (expr->Operator()) {
+		case TokenType::Minus:
+			if (IsNumeric(arg.Type) || arg.Type == CType::Unset)
+				return Finish(ctx, Temp(arg.Type, format("-{}", arg.Text)));
+			break;
+
+		case TokenType::Not:
+			if (arg.Type == CType::Bool)
+				return Finish(ctx, Temp(CType::Bool, format("!{}", arg.Text)));
+			return Finish(ctx, Temp(CType::Bool, format("!{}.ToBoolean()", Boxed(arg))));
+	}
+	return Finish(ctx, Temp(CType::Value, format("P::Unary({}, {})", Boxed(arg), TokenName(expr->Operator()))));
+}
+
+Value CppTranslator::VisitName(NameExpression const* expr) {
+	auto ctx = TakeContext();
+	auto slot = expr->Slot();
+	if (!slot.IsResolved()) {
+		if (m_Function->Method && expr->Name() == "this")
+			return Finish(ctx, Operand{ "self", CType::Value });
+		return Finish(ctx, Temp(CType::Value, format("intr.Eval({})", N(expr))));
+	}
+	auto index = FindLocal(slot);
+	if (index < 0)
+		throw Unsupported();
+	if (!m_Declared[index])
+		LateName(expr->NameAtom());
+	return Finish(ctx, LocalOperand(index));
+}
+
+Value CppTranslator::VisitVar(VarValStatement const* expr) {
+	auto ctx = TakeContext();
+	auto index = FindLocal(expr->Slot());
+	if (expr->IsStatic() || index < 0 || expr->Slot().Depth != 0)
+		throw Unsupported();
+
+	auto target = ValueTarget(ctx);
+	auto& local = m_Locals[index];
+	if (local.Fixed) {
+		// a parameter of the same name is already declared
+		if (!target.empty())
+			Line(format("{} = Value::Error(ValueErrorType::DuplicateName);", target));
+		return Value();
+	}
+
+	auto unguarded = local.Declarations == 1 && m_Unguarded.contains(expr);
+	auto flag = format("d{}", index);
+	if (!unguarded) {
+		local.Flagged = true;
+		Line(format("if (!{}) {{", flag));
+		m_Indent++;
+	}
+	auto init = expr->Init() ? Expr(expr->Init()) : Operand{ "Value()", CType::Value };
+	if (m_Locals[index].Flagged)
+		Line(format("{} = true;", flag));
+	AssignLocal(index, TokenType::Assign, init);
+	if (!unguarded) {
+		if (!target.empty())
+			Line(format("{} = Value();", target));
+		m_Indent--;
+		Line("}");
+		if (!target.empty())
+			Line(format("else {} = Value::Error(ValueErrorType::DuplicateName);", target));
+	}
+	else if (!target.empty()) {
+		Line(format("{} = Value();", target));
+	}
+	m_Declared[index] = true;
+	return Value();
+}
+
+Value CppTranslator::VisitAssign(AssignExpression const* expr) {
+	auto ctx = TakeContext();
+	auto type = expr->AssignType();
+	if (!expr->Slot().IsResolved()) {
+		// the variable is found before the value is computed, as the interpreter does
+		Line(format("P::Variable(intr, {});", N(expr)));
+		auto rhs = Expr(expr->Value());
+		return Finish(ctx, Temp(CType::Value, format("P::AssignVariable(intr, {}, {})", N(expr), Boxed(rhs))));
+	}
+
+	auto index = FindLocal(expr->Slot());
+	if (index < 0)
+		throw Unsupported();
+	if (!m_Declared[index])
+		LateName(expr->LhsAtom());
+	AssignLocal(index, type, Expr(expr->Value()));
+	return Finish(ctx, LocalOperand(index));
+}
+
+Value CppTranslator::VisitInvokeFunction(InvokeFunctionExpression const* expr) {
+	auto ctx = TakeContext();
+	auto& args = expr->Arguments();
+	auto assigns = any_of(args.begin(), args.end(), [&](auto& arg) { return HasAssignment(arg.get()); });
+
+	if (expr->Callable()->NodeType() == AstNodeType::GetMember) {
+		auto target = Expr(reinterpret_cast<GetMemberExpression const*>(expr->Callable())->Left());
+		if (assigns)
+			target = Materialize(move(target));
+		auto ops = Operands(args);
+		auto result = Operand{ NewTemp(), CType::Value, true, true };
+		CallBlock(result, ops, format("P::InvokeMember(intr, {}, args, {})", Boxed(target), N(expr)));
+		return Finish(ctx, result);
+	}
+
+	if (auto f = DirectCallee(expr)) {
+		auto ops = Operands(args);
+		string call = f->Id + "(intr";
+		for (auto& op : ops)
+			call += ", " + (op.Movable ? format("std::move({})", op.Text) : Boxed(op));
+		return Finish(ctx, Temp(CType::Value, call + ")"));
+	}
+
+	auto callee = Expr(expr->Callable());
+	if (assigns)
+		callee = Materialize(move(callee));
+	auto ops = Operands(args);
+	auto result = Operand{ NewTemp(), CType::Value, true, true };
+	CallBlock(result, ops, format("intr.CallFunction({}, args, {})", Boxed(callee), N(expr)));
+	return Finish(ctx, result);
+}
+
+Value CppTranslator::VisitWhile(WhileStatement const* stmt) {
+	auto target = ValueTarget(TakeContext());
+	Line("{");
+	m_Indent++;
+	EnterScope(stmt);
+	DeclareLocals(stmt->Condition());
+	DeclareLocals(stmt->Body());
+	Line("for (;;) {");
+	m_Indent++;
+	Line(format("if (!({}))", Condition(stmt->Condition())));
+	Line("\tbreak;");
+	m_Indent--;
+	m_Loops++;
+	Body(stmt->Body());
+	m_Loops--;
+	Line("}");
+	LeaveScope();
+	m_Indent--;
+	Line("}");
+	if (!target.empty())
+		Line(format("{} = Value();", target));
+	return Value();
+}
+
+Value CppTranslator::VisitIfThenElse(IfThenElseExpression const* expr) {
+	auto target = ValueTarget(TakeContext());
+	auto cond = Expr(expr->Condition());
+	if (cond.Type == CType::Bool) {
+		Line(format("if ({}) {{", cond.Text));
+	}
+	else if (target.empty() && !expr->Else()) {
+		auto boxed = Materialize(Operand{ Boxed(cond), CType::Value, cond.Stable && cond.Type == CType::Value });
+		Line(format("if (!{0}.IsError() && {0}.ToBoolean()) {{", boxed.Text));
+	}
+	else {
+		// an error value is the result of the whole expression
+		auto boxed = Materialize(Operand{ Boxed(cond), CType::Value, cond.Stable && cond.Type == CType::Value });
+		Line(format("if ({}.IsError()) {{", boxed.Text));
+		if (!target.empty())
+			Line(format("\t{} = {};", target, boxed.Text));
+		Line("}");
+		Line(format("else if ({}.ToBoolean()) {{", boxed.Text));
+	}
+	auto declared = m_Declared;
+	m_Indent++;
+	Stmt(expr->Then(), target);
+	m_Indent--;
+	m_Declared = declared;
+	m_Declared.resize(m_LocalCount);
+	Line("}");
+	if (expr->Else() || !target.empty()) {
+		Line("else {");
+		m_Indent++;
+		Stmt(expr->Else(), target);
+		m_Indent--;
+		m_Declared = move(declared);
+		m_Declared.resize(m_LocalCount);
+		Line("}");
+	}
+	return Value();
+}
+
+Value CppTranslator::VisitFunctionDeclaration(FunctionDeclaration const* decl) {
+	// declares into the function's scope, which translated code does not have
+	throw Unsupported();
+}
+
+Value CppTranslator::VisitReturn(ReturnStatement const* decl) {
+	TakeContext();
+	auto value = decl->ReturnValue();
+	if (value && value->NodeType() == AstNodeType::InvokeFunction) {
+		//
+		// a call of the function itself in tail position reuses the running call, as the interpreter does
+		//
+		auto call = reinterpret_cast<InvokeFunctionExpression const*>(value);
+		if (call->IsTailCall() && DirectCallee(call) == m_Function) {
+			auto ops = Operands(call->Arguments());
+			for (size_t i = 0; i < ops.size(); i++) {
+				ops[i] = Materialize(move(ops[i]));
+				ops[i].Type = ops[i].Type == CType::Unset ? CType::Value : ops[i].Type;
+			}
+			for (size_t i = 0; i < ops.size(); i++)
+				Line(format("{} = {};", m_Locals[i].Id, ops[i].Movable ? format("std::move({})", ops[i].Text) : Boxed(ops[i])));
+			Line("goto tail;");
+			m_TailCall = true;
+			return Value();
+		}
+	}
+	Line(format("return {};", value ? Boxed(Expr(value)) : "Value()"));
+	return Value();
+}
+
+Value CppTranslator::VisitBreakContinue(BreakOrContinueStatement const* stmt) {
+	TakeContext();
+	switch (stmt->BreakType()) {
+		case TokenType::Break:
+		case TokenType::Continue:
+			// outside a loop they leave the function for the caller's loop
+			if (m_Loops == 0)
+				throw Unsupported();
+			Line(stmt->BreakType() == TokenType::Break ? "break;" : "continue;");
+			break;
+
+		default:
+			Line("return Value();");
+			break;
+	}
+	return Value();
+}
+
+Value CppTranslator::VisitFor(ForStatement const* stmt) {
+	auto target = ValueTarget(TakeContext());
+	Line("{");
+	m_Indent++;
+	EnterScope(stmt);
+	DeclareLocals(stmt->Init());
+	DeclareLocals(stmt->While());
+	DeclareLocals(stmt->Inc());
+	DeclareLocals(stmt->Body());
+	// the initializer runs once each time the loop starts
+	if (stmt->Init() && stmt->Init()->NodeType() == AstNodeType::VarValStatement)
+		m_Unguarded.insert(stmt->Init());
+	Stmt(stmt->Init(), "");
+	auto first = NewTemp();
+	Line(format("for (bool {0} = true;; {0} = false) {{", first));
+	m_Indent++;
+	Line(format("if (!{}) {{", first));
+	Body(stmt->Inc());
+	Line("}");
+	Line(format("if (!({}))", stmt->While() ? Condition(stmt->While()) : "Value().ToBoolean()"));
+	Line("\tbreak;");
+	m_Indent--;
+	m_Loops++;
+	Body(stmt->Body());
+	m_Loops--;
+	Line("}");
+	LeaveScope();
+	m_Indent--;
+	Line("}");
+	if (!target.empty())
+		Line(format("{} = Value();", target));
+	return Value();
+}
+
+Value CppTranslator::VisitStatements(Statements const* stmts) {
+	auto target = ValueTarget(TakeContext());
+	auto& all = stmts->Get();
+	if (all.empty() && !target.empty())
+		Line(format("{} = Value();", target));
+
+	auto declared = m_Declared;
+	for (size_t i = 0; i < all.size(); i++)
+		Stmt(all[i].get(), i + 1 == all.size() ? target : "");
+	declared.resize(m_Declared.size());
+	m_Declared = move(declared);
+	return Value();
+}
+
+Value CppTranslator::VisitAnonymousFunction(AnonymousFunctionExpression const* func) {
+	return Fallback(func);
+}
+
+Value CppTranslator::VisitEnumDeclaration(EnumDeclaration const* decl) {
+	throw Unsupported();
+}
+
+Value CppTranslator::VisitExpressionStatement(ExpressionStatement const* expr) {
+	return expr->Expr()->Accept(this);
+}
+
+Value CppTranslator::VisitArrayExpression(ArrayExpression const* expr) {
+	auto ctx = TakeContext();
+	auto ops = Operands(expr->Items());
+	string items;
+	for (auto& op : ops)
+		items += (items.empty() ? "" : ", ") + (op.Movable ? format("std::move({})", op.Text) : Boxed(op));
+	return Finish(ctx, Temp(CType::Value, format("P::Array({{ {} }})", items)));
+}
+
+Value CppTranslator::VisitRepeat(RepeatStatement const* stmt) {
+	auto target = ValueTarget(TakeContext());
+	auto times = Expr(stmt->Times());
+	auto count = Temp(CType::Int, times.Type == CType::Int ? times.Text : format("{}.ToInteger()", Boxed(times)));
+	Line(format("for (; {0} > 0; --{0}) {{", count.Text));
+	m_Loops++;
+	Body(stmt->Body());
+	m_Loops--;
+	Line("}");
+	if (!target.empty())
+		Line(format("{} = Value();", target));
+	return Value();
+}
+
+Value CppTranslator::VisitGetMember(GetMemberExpression const* expr) {
+	auto ctx = TakeContext();
+	auto target = Expr(expr->Left());
+	return Finish(ctx, Temp(CType::Value, format("P::GetMember(intr, {}, {})", Boxed(target), N(expr))));
+}
+
+Value CppTranslator::VisitAccessArray(AccessArrayExpression const* expr) {
+	auto ctx = TakeContext();
+	// the index is computed before the value it indexes
+	auto index = Expr(expr->Index());
+	if (HasAssignment(expr->Left()))
+		index = Materialize(move(index));
+	auto value = Expr(expr->Left());
+	return Finish(ctx, Temp(CType::Value, format("P::Index({}, {})", Boxed(value), Boxed(index))));
+}
+
+Value CppTranslator::VisitAssignArrayIndex(AssignArrayIndexExpression const* expr) {
+	auto ctx = TakeContext();
+	auto access = expr->ArrayAccess();
+	auto array = Expr(access->Left());
+	if (HasAssignment(access->Index()) || HasAssignment(expr->Value()))
+		array = Materialize(move(array));
+	auto index = Expr(access->Index());
+	if (HasAssignment(expr->Value()))
+		index = Materialize(move(index));
+	auto value = Expr(expr->Value());
+	return Finish(ctx, Temp(CType::Value, format("P::AssignIndex({}, {}, {}, {})", Boxed(array), Boxed(index), Boxed(value), TokenName(expr->AssignType()))));
+}
+
+Value CppTranslator::VisitClassDeclaration(ClassDeclaration const* decl) {
+	throw Unsupported();
+}
+
+Value CppTranslator::VisitNewObjectExpression(NewObjectExpression const* expr) {
+	if (!expr->FieldInitializers().empty())
+		return Fallback(expr);
+
+	auto ctx = TakeContext();
+	auto ops = Operands(expr->Arguments());
+	string args;
+	for (auto& op : ops)
+		args += (args.empty() ? "" : ", ") + (op.Movable ? format("std::move({})", op.Text) : Boxed(op));
+	return Finish(ctx, Temp(CType::Value, format("P::NewObject(intr, {}, {{ {} }})", N(expr), args)));
+}
+
+Value CppTranslator::VisitAssignField(AssignFieldExpression const* expr) {
+	//
+	// the interpreter reads the field back through its left side; that is only the same object
+	// when evaluating the left side again has no effects
+	//
+	if (expr->Lhs()->Left()->NodeType() != AstNodeType::Name)
+		return Fallback(expr);
+
+	auto ctx = TakeContext();
+	auto obj = Expr(expr->Lhs()->Left());
+	if (HasAssignment(expr->Value()))
+		obj = Materialize(move(obj));
+	auto value = Expr(expr->Value());
+	return Finish(ctx, Temp(CType::Value, format("P::AssignField(intr, {}, {}, {})", Boxed(obj), N(expr), Boxed(value))));
+}
+
+Value CppTranslator::VisitForEach(ForEachStatement const* stmt) {
+	auto target = ValueTarget(TakeContext());
+	auto collection = Expr(stmt->Collection());
+	Line("{");
+	m_Indent++;
+	auto enumerator = NewTemp();
+	Line(format("auto {} = P::Enumerate({}, {});", enumerator, Boxed(collection), N(stmt)));
+	EnterScope(stmt);
+	auto item = DefineLocal(stmt->Slot().Index, stmt->Name(), true);
+	DeclareLocals(stmt->Body());
+	auto next = NewTemp();
+	Line(format("for (Value {0}; !({0} = {1}->GetNextValue()).IsError(); ) {{", next, enumerator));
+	Line(format("\t{} = std::move({});", m_Locals[item].Id, next));
+	m_Loops++;
+	Body(stmt->Body());
+	m_Loops--;
+	Line("}");
+	LeaveScope();
+	m_Indent--;
+	Line("}");
+	if (!target.empty())
+		Line(format("{} = Value();", target));
+	return Value();
+}
+
+Value CppTranslator::VisitRange(RangeExpression const* expr) {
+	auto ctx = TakeContext();
+	auto start = Expr(expr->Start());
+	if (HasAssignment(expr->End()))
+		start = Materialize(move(start));
+	auto end = Expr(expr->End());
+	return Finish(ctx, Temp(CType::Value, format("P::Range({}, {}, {})", Boxed(start), Boxed(end), expr->EndInclusive())));
+}
+
+Value CppTranslator::VisitMatch(MatchExpression const* expr) {
+	return Fallback(expr);
+}
+
+Value CppTranslator::VisitUse(UseStatement const* use) {
+	throw Unsupported();
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "AstArena.h"
+#include "Visitor.h"
+#include "Optimizer.h"
+#include "Atom.h"
+#include "SymbolTable.h"
+#include "Token.h"
+
+namespace Dynamix {
+	class AstNode;
+	class Expression;
+	class ScopeSlots;
+	class FunctionEssentials;
+
+	//
+	// translates a program's functions to C++ for 'dynamix compile'.
+	// top level functions and instance methods become C++ functions over Value, with locals typed
+	// Int, Real or bool where every assignment to them agrees, and calls between them made directly.
+	// the generated program embeds the sources and re-parses them at startup (see CompiledProgram);
+	// translated functions are bound in place of their bodies and everything else runs on the interpreter.
+	// a function whose locals could be seen by other code through dynamic scoping is left interpreted
+	//
+	class CppTranslator final : public Visitor {
+	public:
+		struct Source {
+			std::string FileName;
+			std::string Text;
+			OptimizerPasses Optimizations;
+			Statements const* Code;
+		};
+
+		std::string Translate(std::vector<Source> const& sources);
+
+		// nodes the generated code refers to as N[index], in the order they are numbered
+		std::vector<AstNode const*> const& Nodes() const noexcept {
+			return m_Nodes;
+		}
+		std::vector<std::string> const& Translated() const noexcept {
+			return m_Translated;
+		}
+		std::vector<std::string> const& Interpreted() const noexcept {
+			return m_Interpreted;
+		}
+
+		// Inherited via Visitor
+		Value VisitLiteral(LiteralExpression const* expr) override;
+		Value VisitBinary(BinaryExpression const* expr) override;
+		Value VisitUnary(UnaryExpression const* expr) override;
+		Value VisitName(NameExpression const* expr) override;
+		Value VisitVar(VarValStatement const* expr) override;
+		Value VisitAssign(AssignExpression const* expr) override;
+		Value VisitInvokeFunction(InvokeFunctionExpression const* expr) override;
+		Value VisitWhile(WhileStatement const* stmt) override;
+		Value VisitIfThenElse(IfThenElseExpression const* expr) override;
+		Value VisitFunctionDeclaration(FunctionDeclaration const* decl) override;
+		Value VisitReturn(ReturnStatement const* decl) override;
+		Value VisitBreakContinue(BreakOrContinueStatement const* stmt) override;
+		Value VisitFor(ForStatement const* stmt) override;
+		Value VisitStatements(Statements const* stmts) override;
+		Value VisitAnonymousFunction(AnonymousFunctionExpression const* func) override;
+		Value VisitEnumDeclaration(EnumDeclaration const* decl) override;
+		Value VisitExpressionStatement(ExpressionStatement const* expr) override;
+		Value VisitArrayExpression(ArrayExpression const* expr) override;
+		Value VisitRepeat(RepeatStatement const* stmt) override;
+		Value VisitGetMember(GetMemberExpression const* expr) override;
+		Value VisitAccessArray(AccessArrayExpression const* expr) override;
+		Value VisitAssignArrayIndex(AssignArrayIndexExpression const* expr) override;
+		Value VisitClassDeclaration(ClassDeclaration const* decl) override;
+		Value VisitNewObjectExpression(NewObjectExpression const* expr) override;
+		Value VisitAssignField(AssignFieldExpression const* expr) override;
+		Value VisitForEach(ForEachStatement const* stmt) override;
+		Value VisitRange(RangeExpression const* expr) override;
+		Value VisitMatch(MatchExpression const* expr) override;
+		Value VisitUse(UseStatement const* use) override;
+
+	private:
+		// C++ type of a local or a temporary; Unset is a local no assignment has been seen for yet
+		enum class CType : uint8_t {
+			Unset,
+			Int,
+			Real,
+			Bool,
+			Value,
+		};
+
+		struct Operand {
+			std::string Text;
+			CType Type{ CType::Value };
+			// false for a local, whose value a later assignment may change
+			bool Stable{ true };
+			// a Value temporary used once, which can be moved from
+			bool Movable{ false };
+		};
+
+		struct Local {
+			std::string Id;
+			CType Type{ CType::Unset };
+			int Declarations{ 0 };
+			// parameters and foreach variables exist from the start of their scope
+			bool Fixed{ false };
+			// whether a declared flag is kept for the variable
+			bool Flagged{ false };
+		};
+
+		struct Frame {
+			ScopeSlots const* Owner;
+			std::vector<int> Slots;
+			std::vector<int> Locals;
+			size_t Insert;
+			int Indent;
+		};
+
+		struct Function {
+			FunctionDeclaration const* Decl;
+			std::string Id;
+			bool Method;
+			bool Translated{ true };
+		};
+
+		struct Context {
+			bool Statement;
+			std::string Target;
+		};
+
+		struct Unsupported {};
+
+		void ScanProgram(std::vector<Source> const& sources);
+		bool TranslateFunction(Function const& f);
+		void EmitFunction(Function const& f);
+		void EnterScope(ScopeSlots const* owner);
+		void LeaveScope();
+		int DefineLocal(int slot, std::string const& name, bool fixed);
+		void DeclareLocals(AstNode const* node);
+		int FindLocal(SlotRef slot) const;
+		Operand LocalOperand(int index);
+
+		Context TakeContext();
+		std::string ValueTarget(Context const& ctx);
+		Value Finish(Context const& ctx, Operand op);
+		Operand Expr(Expression const* expr);
+		void Stmt(AstNode const* node, std::string const& target);
+		void Body(AstNode const* node);
+		Value Fallback(AstNode const* node);
+		[[noreturn]] void LateName(Atom name);
+		bool IsClosed(AstNode const* node) const;
+		bool HasAssignment(AstNode const* node) const;
+		Operand Temp(CType type, std::string const& text);
+		Operand Materialize(Operand op);
+		std::string NewTemp();
+		std::string Boxed(Operand const& op) const;
+		std::string Converted(Operand const& op, CType type) const;
+		std::string Condition(Expression const* cond);
+		std::vector<Operand> Operands(AstVector<std::unique_ptr<Expression>> const& args);
+		void CallBlock(Operand const& result, std::vector<Operand> const& args, std::string const& call);
+		Function const* DirectCallee(InvokeFunctionExpression const* expr) const;
+		void AssignLocal(int index, TokenType type, Operand const& rhs);
+		CType BinaryType(TokenType op, CType left, CType right, Expression const* rightExpr) const;
+		Operand TypedBinary(TokenType op, Operand const& left, Operand const& right, CType type);
+		void Join(Local& local, CType type);
+		void Line(std::string const& text);
+		int Node(AstNode const* node);
+		std::string N(AstNode const* node);
+
+		// whole program
+		std::vector<AstNode const*> m_Nodes;
+		std::unordered_map<AstNode const*, int> m_NodeIndex;
+		std::vector<Function> m_Functions;
+		std::vector<std::string> m_Code;
+		std::unordered_map<Atom, int> m_FunctionNames;
+		std::unordered_set<Atom> m_DynamicNames;
+		std::unordered_set<Atom> m_DeclaredNames;
+		std::vector<std::string> m_Translated, m_Interpreted;
+		bool m_ThisIsDynamic{ false };
+
+		// function being translated
+		Function const* m_Function{ nullptr };
+		std::vector<Local> m_Locals;
+		std::vector<bool> m_Declared;
+		std::unordered_set<Atom> m_LocalNames;
+		std::unordered_set<AstNode const*> m_Unguarded;
+		std::vector<Frame> m_Frames;
+		std::string m_Text;
+		Context m_Context;
+		Operand m_Result;
+		int m_LocalCount{ 0 };
+		int m_Indent{ 0 };
+		int m_Temps{ 0 };
+		int m_Loops{ 0 };
+		bool m_TailCall{ false };
+		bool m_TypesChanged{ false };
+	};
+}
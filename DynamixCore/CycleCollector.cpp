@@ -0,0 +1,189 @@
+#include <algorithm>
+#include <cassert>
+
+#include "CycleCollector.h"
+#include "RuntimeObject.h"
+
+using namespace Dynamix;
+using namespace std;
+
+CycleCollector::CycleCollector() noexcept : m_Previous(s_Current) {
+	s_Current = this;
+}
+
+CycleCollector::~CycleCollector() {
+	for (auto obj : m_Roots) {
+		obj->m_Root = RuntimeObject::NotBuffered;
+		obj->m_Collector = nullptr;
+	}
+
+	//
+	// runtimes need not go in the reverse order they came; unlink this one wherever it is
+	//
+	if (s_Current == this) {
+		s_Current = m_Previous;
+		return;
+	}
+	for (auto collector = s_Current; collector; collector = collector->m_Previous)
+		if (collector->m_Previous == this) {
+			collector->m_Previous = m_Previous;
+			break;
+		}
+}
+
+void CycleCollector::AddRoot(RuntimeObject const* obj) {
+	assert(obj->m_Root == RuntimeObject::NotBuffered);
+	// types are not instances of themselves; nothing references them the way cycles form
+	if (obj->IsObjectType())
+		return;
+	obj->m_Root = (int)m_Roots.size();
+	obj->m_Collector = this;
+	m_Roots.push_back(obj);
+}
+
+void CycleCollector::RemoveRoot(RuntimeObject const* obj) noexcept {
+	auto index = obj->m_Root;
+	assert(index >= 0 && obj->m_Collector == this && m_Roots[index] == obj);
+	auto last = m_Roots.back();
+	m_Roots[index] = last;
+	last->m_Root = index;
+	m_Roots.pop_back();
+	obj->m_Root = RuntimeObject::NotBuffered;
+	obj->m_Collector = nullptr;
+}
+
+size_t CycleCollector::Collect() {
+	m_Created = 0;
+	if (m_Collecting || m_Roots.empty())
+		return 0;
+
+	auto start = chrono::steady_clock::now();
+	m_Collecting = true;
+	auto roots = move(m_Roots);
+	m_Roots.clear();
+	for (auto obj : roots) {
+		obj->m_Root = RuntimeObject::NotBuffered;
+		obj->m_Collector = nullptr;
+	}
+
+	for (auto obj : roots)
+		MarkGray(obj);
+	for (auto obj : roots)
+		Scan(obj);
+	vector<RuntimeObject const*> garbage;
+	for (auto obj : roots)
+		CollectWhite(obj, garbage);
+	Free(garbage);
+	m_Collecting = false;
+
+	auto pause = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start);
+	m_Stats.Collections++;
+	m_Stats.Freed += garbage.size();
+	m_Stats.LastFreed = garbage.size();
+	m_Stats.LastPause = pause;
+	m_Stats.MaxPause = max(m_Stats.MaxPause, pause);
+	m_Stats.TotalPause += pause;
+	return garbage.size();
+}
+
+void CycleCollector::Children(RuntimeObject const* obj) {
+	m_Children.clear();
+	obj->GetReferences(m_Children);
+	erase_if(m_Children, [](auto child) { return child->IsObjectType(); });
+}
+
+//
+// takes away the references among everything reachable from the root
+//
+void CycleCollector::MarkGray(RuntimeObject const* root) {
+	if (root->m_Color == RuntimeObject::GcColor::Gray)
+		return;
+
+	root->m_Color = RuntimeObject::GcColor::Gray;
+	m_Stack.push_back(root);
+	while (!m_Stack.empty()) {
+		auto obj = m_Stack.back();
+		m_Stack.pop_back();
+		Children(obj);
+		for (auto child : m_Children) {
+			child->m_RefCount--;
+			if (child->m_Color != RuntimeObject::GcColor::Gray) {
+				child->m_Color = RuntimeObject::GcColor::Gray;
+				m_Stack.push_back(child);
+			}
+		}
+	}
+}
+
+//
+// an object still counted is referenced from outside, and so is everything it reaches;
+// the rest is garbage
+//
+void CycleCollector::Scan(RuntimeObject const* root) {
+	m_Stack.push_back(root);
+	while (!m_Stack.empty()) {
+		auto obj = m_Stack.back();
+		m_Stack.pop_back();
+		if (obj->m_Color != RuntimeObject::GcColor::Gray)
+			continue;
+
+		if (obj->m_RefCount > 0) {
+			ScanBlack(obj);
+			continue;
+		}
+		obj->m_Color = RuntimeObject::GcColor::White;
+		Children(obj);
+		m_Stack.insert(m_Stack.end(), m_Children.begin(), m_Children.end());
+	}
+}
+
+void CycleCollector::ScanBlack(RuntimeObject const* root) {
+	root->m_Color = RuntimeObject::GcColor::Black;
+	m_Black.push_back(root);
+	while (!m_Black.empty()) {
+		auto obj = m_Black.back();
+		m_Black.pop_back();
+		Children(obj);
+		for (auto child : m_Children) {
+			child->m_RefCount++;
+			if (child->m_Color != RuntimeObject::GcColor::Black) {
+				child->m_Color = RuntimeObject::GcColor::Black;
+				m_Black.push_back(child);
+			}
+		}
+	}
+}
+
+void CycleCollector::CollectWhite(RuntimeObject const* root, vector<RuntimeObject const*>& garbage) {
+	m_Stack.push_back(root);
+	while (!m_Stack.empty()) {
+		auto obj = m_Stack.back();
+		m_Stack.pop_back();
+		if (obj->m_Color != RuntimeObject::GcColor::White || obj->m_Root != RuntimeObject::NotBuffered)
+			continue;
+
+		obj->m_Color = RuntimeObject::GcColor::Black;
+		obj->m_Root = RuntimeObject::Freeing;
+		garbage.push_back(obj);
+		Children(obj);
+		m_Stack.insert(m_Stack.end(), m_Children.begin(), m_Children.end());
+	}
+}
+
+//
+// the garbage gets back the counts the trial took and is held while it drops its references,
+// so each object is deleted once, by its own release, whatever order the cycle is in
+//
+void CycleCollector::Free(vector<RuntimeObject const*> const& garbage) {
+	for (auto obj : garbage) {
+		Children(obj);
+		for (auto child : m_Children)
+			child->m_RefCount++;
+	}
+	for (auto obj : garbage)
+		obj->m_RefCount++;
+	for (auto obj : garbage)
+		const_cast<RuntimeObject*>(obj)->ReleaseReferences();
+	for (auto obj : garbage)
+		obj->Release();
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+#include "NoCopyMove.h"
+
+namespace Dynamix {
+	class RuntimeObject;
+
+	//
+	// frees reference cycles scripts can no longer reach, synchronously, after Bacon and Rajan.
+	// an object whose count drops to anything but zero may have just lost the last reference into
+	// a cycle, so it is buffered as a possible root. a collection subtracts the references the objects
+	// reachable from the roots hold on each other; objects left with no count are only kept alive
+	// by each other and are freed, everything else gets its count back.
+	// each Runtime has one, buffering the objects released on its thread; an object remembers the collector
+	// that buffered it, and leaves that one when freed, whichever runtime the thread is on by then
+	//
+	class CycleCollector final : NoCopy {
+	public:
+		struct Stats {
+			uint64_t Collections{ 0 };
+			// objects freed by all collections, and by the last one
+			uint64_t Freed{ 0 };
+			uint64_t LastFreed{ 0 };
+			std::chrono::nanoseconds LastPause{};
+			std::chrono::nanoseconds MaxPause{};
+			std::chrono::nanoseconds TotalPause{};
+		};
+
+		static constexpr int DefaultThreshold = 10000;
+
+		CycleCollector() noexcept;
+		~CycleCollector();
+
+		static CycleCollector* Current() noexcept {
+			return s_Current;
+		}
+
+		// objects created between automatic collections; 0 collects only when asked
+		void SetThreshold(int count) noexcept {
+			m_Threshold = count;
+		}
+		int Threshold() const noexcept {
+			return m_Threshold;
+		}
+
+		// returns the number of objects freed
+		size_t Collect();
+
+		Stats const& GetStats() const noexcept {
+			return m_Stats;
+		}
+		size_t RootCount() const noexcept {
+			return m_Roots.size();
+		}
+
+		void ObjectCreated() {
+			if (++m_Created >= m_Threshold && m_Threshold > 0 && !m_Collecting)
+				Collect();
+		}
+		void AddRoot(RuntimeObject const* obj);
+		void RemoveRoot(RuntimeObject const* obj) noexcept;
+
+	private:
+		void MarkGray(RuntimeObject const* root);
+		void Scan(RuntimeObject const* root);
+		void ScanBlack(RuntimeObject const* root);
+		void CollectWhite(RuntimeObject const* root, std::vector<RuntimeObject const*>& garbage);
+		void Children(RuntimeObject const* obj);
+		void Free(std::vector<RuntimeObject const*> const& garbage);
+
+		std::vector<RuntimeObject const*> m_Roots;
+		// scratch space of the traversals
+		std::vector<RuntimeObject const*> m_Stack, m_Black, m_Children;
+		int m_Threshold{ DefaultThreshold };
+		int m_Created{ 0 };
+		bool m_Collecting{ false };
+		Stats m_Stats;
+		CycleCollector* m_Previous;
+		inline static thread_local CycleCollector* s_Current;
+	};
+}
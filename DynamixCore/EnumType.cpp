@@ -41,7 +41,7 @@ Value CustomEnumType::ToString(Int value) const {
 }
 
 Value CustomEnumType::Parse(const char* name) const {
-	if (auto it = m_FieldValues.find(name); it != m_FieldValues.end())
+	if (auto it = m_FieldValues.find(Atom::Find(name)); it != m_FieldValues.end())
 		return it->second;
 	return Value::Error(ValueErrorType::UndefinedSymbol);
 }
@@ -36,7 +36,7 @@ Value Enumerable::Filter(Interpreter& intr, Value predicate) {
 			items.push_back(next);
 		}
 	}
-	return ArrayType::Get()->CreateArray(std::move(items));
+	return ArrayType::Get()->CreateArrayValue(std::move(items));
 }
 
 Value Enumerable::Any(Interpreter& intr, Value predicate) {
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Dynamix {
+	class ObjectType;
+	struct MethodInfo;
+
+	//
+	// per-site memo of member lookups keyed by the receiver's type.
+	// holds up to Size types (polymorphic), then gives up and stays megamorphic.
+	// all caches are dropped when any type is revoked, since its address may be reused.
+	//
+	class InlineCache {
+	public:
+		static constexpr int Size = 4;
+
+		struct Entry {
+			ObjectType const* Type;
+			MethodInfo const* Method;	// null if the member is not a resolvable method
+			ObjectType const* Owner;	// type whose static fields the method sees
+			bool Field;
+		};
+
+		Entry const* Find(ObjectType const* type) const noexcept {
+			if (m_Epoch != s_Epoch)
+				return nullptr;
+			for (int i = 0; i < m_Count; i++)
+				if (m_Entries[i].Type == type)
+					return &m_Entries[i];
+			return nullptr;
+		}
+
+		Entry const* Add(Entry const& entry) noexcept {
+			if (m_Epoch != s_Epoch) {
+				m_Epoch = s_Epoch;
+				m_Count = 0;
+				m_Megamorphic = false;
+			}
+			if (m_Count == Size) {
+				m_Megamorphic = true;
+				return nullptr;
+			}
+			m_Entries[m_Count] = entry;
+			return &m_Entries[m_Count++];
+		}
+
+		bool IsMegamorphic() const noexcept {
+			return m_Megamorphic && m_Epoch == s_Epoch;
+		}
+		int Count() const noexcept {
+			return m_Epoch == s_Epoch ? m_Count : 0;
+		}
+
+		static void Invalidate() noexcept {
+			s_Epoch++;
+		}
+
+	private:
+		Entry m_Entries[Size]{};
+		uint32_t m_Epoch{ 0 };
+		uint8_t m_Count{ 0 };
+		bool m_Megamorphic{ false };
+
+		static inline uint32_t s_Epoch{ 1 };
+	};
+}
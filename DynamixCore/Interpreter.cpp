@@ -14,41 +14,173 @@
 #include "SymbolTable.h"
 #include "ArrayType.h"
 #include "RangeType.h"
+#include "VirtualMachine.h"
+#include "StackGuard.h"
+#include "TieredCompiler.h"
 
 using namespace Dynamix;
 using namespace std;
 
-Interpreter::Interpreter(Runtime& rt) : m_Runtime(rt) {
-	m_Scopes.push(Scope(m_Runtime.GetGlobalScope()));    // global scope
+namespace {
+	FunctionEssentials const* FunctionOf(AstNode const* node) noexcept {
+		if (node->NodeType() == AstNodeType::FunctionDeclaration)
+			return static_cast<FunctionEssentials const*>(reinterpret_cast<FunctionDeclaration const*>(node));
+
+		assert(node->NodeType() == AstNodeType::AnonymousFunction);
+		return static_cast<FunctionEssentials const*>(reinterpret_cast<AnonymousFunctionExpression const*>(node));
+	}
+}
+
+Interpreter::Interpreter(Runtime& rt) : m_Runtime(rt), m_Scopes(m_Runtime.GetGlobalScope()) {
 
 #ifdef _WIN32
 	::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED | COINIT_DISABLE_OLE1DDE);
 #endif
+	SetEngine(rt.DefaultEngine());
+}
+
+Interpreter::~Interpreter() = default;
+
+void Interpreter::SetEngine(ExecutionEngine engine) {
+	if (engine != ExecutionEngine::TreeWalker && !m_VM)
+		m_VM = make_unique<VirtualMachine>(*this);
+	if (m_VM)
+		m_VM->EnableJit(engine == ExecutionEngine::Jit);
+	if (engine != ExecutionEngine::Tiered)
+		m_Tiers.reset();
+	else if (!m_Tiers)
+		m_Tiers = make_unique<TieredCompiler>();
+	m_Engine = engine;
+}
+
+Jit* Interpreter::GetJit() const noexcept {
+	return m_VM ? m_VM->GetJit() : nullptr;
 }
 
 Value Interpreter::Eval(AstNode const* root) {
 	if (!root)
 		return Value();
 
+	if (m_StackSize && !m_OnStack)
+		return RunOnStack([&] { return Eval(root); });
+
+	//
+	// a return or breakout in top level code has nothing to complete; drop it before running new code
+	//
+	if (m_Completion != Completion::Normal && m_Scopes.Depth() == 0)
+		m_Completion = Completion::Normal;
+
+	if ((m_Engine == ExecutionEngine::Bytecode || m_Engine == ExecutionEngine::Jit) && !m_VM->IsTreeWalking())
+		return m_VM->Execute(root);
+
 	m_CurrentNode = root;
-	try {
-		return root->Accept(this);
+	return root->Accept(this);
+}
+
+Value Interpreter::ExecuteBody(AstNode const* body) {
+	CallFrame frame(this);
+	switch (m_Engine) {
+		case ExecutionEngine::TreeWalker:
+			return Eval(body);
+		case ExecutionEngine::Tiered:
+			return ExecuteTiered(body);
+		default:
+			return m_VM->ExecuteBody(body);
 	}
-	catch (ReturnStatement const& ret) {
-		return ret.ReturnValue();
+}
+
+//
+// a body runs compiled once its code is installed; until then the tree-walker runs it and counts
+//
+Value Interpreter::ExecuteTiered(AstNode const* body) {
+	m_Tiers->Install();
+	if (body->CompiledCode()) {
+		RunningBody running(this, nullptr);
+		return m_VM->ExecuteBody(body);
 	}
+
+	m_Tiers->CountCall(body);
+	RunningBody running(this, body);
+	return Eval(body);
+}
+
+void Interpreter::CountIteration(LoopCounter const* loop) {
+	if (loop->CountIteration() == TieredCompiler::HotIterations && m_Body)
+		m_Tiers->Enqueue(m_Body);
 }
 
 void Interpreter::RunConstructor(RuntimeObject* instance, MethodInfo const* ctor, std::vector<Value> const& args) {
-	Scoper scoper(this);
+	CallFrame frame(this);
+	// constructors are not compiled; their loops count for nothing
+	RunningBody running(this, nullptr);
+	Scoper scoper(this, ctor->SlotCount);
 	Element pThis{ instance };
-	CurrentScope().AddElement("this", move(pThis));
+	CurrentScope().AddElement(Atom::This, move(pThis));
 	int i = 0;
 	for (auto& arg : args) {
 		Element varg{ arg };
-		CurrentScope().AddElement(ctor->Parameters[i++].Name, move(varg));
+		CurrentScope().DefineSlot(i, ctor->Parameters[i].Name, move(varg));
+		i++;
+	}
+	CompleteCall(Eval(ctor->Code.Node));
+}
+
+//
+// settles a return or breakout at a call boundary; break and continue keep unwinding to the caller's loop
+//
+Value Interpreter::CompleteCall(Value result) {
+	//
+	// each tail call runs here rather than nested in the call that made it, so the native stack
+	// and the scope stack stay flat however long the chain of tail calls is
+	//
+	for (;;) {
+		switch (m_Completion) {
+			case Completion::Return:
+				m_Completion = Completion::Normal;
+				return result;
+
+			case Completion::Breakout:
+				m_Completion = Completion::Normal;
+				return Value();
+
+			case Completion::TailCall:
+				m_Completion = Completion::Normal;
+				result = RunTailCall();
+				break;
+
+			default:
+				return result;
+		}
+	}
+}
+
+Value Interpreter::RunTailCall() {
+	auto decl = m_TailCall;
+	Arguments arguments(this);
+	auto& args = arguments.Get();
+	args.swap(m_TailArgs);
+
+	Scoper scoper(this, decl->SlotCount());
+	for (size_t i = 0; i < args.size(); i++)
+		CurrentScope().DefineSlot((int)i, decl->Parameters()[i].Name, Element{ move(args[i]) });
+	return ExecuteBody(decl->Body());
+}
+
+//
+// settles a break or continue at the end of a loop iteration; returns true if the loop must exit
+//
+bool Interpreter::EndIteration(Value& result) noexcept {
+	switch (m_Completion) {
+		case Completion::Continue:
+			m_Completion = Completion::Normal;
+			return false;
+
+		case Completion::Break:
+			m_Completion = Completion::Normal;
+			result = Value();
+			return true;
 	}
-	Eval(ctor->Code.Node);
+	return true;
 }
 
 Value Interpreter::VisitLiteral(LiteralExpression const* expr) {
@@ -68,18 +200,45 @@ Value Interpreter::VisitBinary(BinaryExpression const* expr) {
 			break;
 	}
 
+	auto right = Eval(expr->Right());
+	if (expr->Quick() != QuickOp::Generic) {
+		if (expr->Quick() == QuickOp::Unobserved)
+			expr->Quicken(QuickenBinary(expr->Operator(), left, right));
+		Value result;
+		if (QuickBinary(expr->Quick(), left, right, result))
+			return result;
+		expr->Deoptimize();
+	}
+	return BinaryOperation(left, expr->Operator(), right);
+}
+
+Value Interpreter::BinaryOperation(Value const& left, TokenType op, Value const& right) {
 	if (left.IsObject())
-		return left.AsObject()->InvokeOperator(*this, expr->Operator(), Eval(expr->Right()));
+		return left.AsObject()->InvokeOperator(*this, op, right);
 
-	return left.BinaryOperator(expr->Operator(), Eval(expr->Right()));
+	return left.BinaryOperator(op, right);
 }
 
 Value Interpreter::VisitUnary(UnaryExpression const* expr) {
-	return Eval(expr->Arg()).UnaryOperator(expr->Operator());
+	auto arg = Eval(expr->Arg());
+	if (expr->Quick() != QuickOp::Generic) {
+		if (expr->Quick() == QuickOp::Unobserved)
+			expr->Quicken(QuickenUnary(expr->Operator(), arg));
+		Value result;
+		if (QuickUnary(expr->Quick(), arg, result))
+			return result;
+		expr->Deoptimize();
+	}
+	return arg.UnaryOperator(expr->Operator());
 }
 
 Value Interpreter::VisitName(NameExpression const* expr) {
-	auto elements = CurrentScope().FindElements(expr->Name());
+	if (auto slot = expr->Slot(); slot.IsResolved())
+		if (auto e = CurrentScope().SlotElement(slot))
+			return e->VarValue;
+
+	auto& elements = m_Lookup;
+	CurrentScope().FindElements(expr->NameAtom(), elements);
 	if (elements.size() == 1) {
 		return elements[0]->VarValue;
 	}
@@ -88,10 +247,10 @@ Value Interpreter::VisitName(NameExpression const* expr) {
 			return Value(expr->Name().c_str());
 		throw RuntimeError(RuntimeErrorType::MultipleSymbols, format("Multiple symbols referring to: '{}'", expr->Name()), expr->Location());
 	}
-	auto e = CurrentScope().FindElementWithUse(expr->Name());
+	auto e = CurrentScope().FindElementWithUse(expr->NameAtom());
 	if (e) {
 		assert(e->VarValue.IsObjectType());
-		GetMemberExpression gme(make_unique<NameExpression>(e->VarValue.AsObject()->Type()->Name()), expr->Name(), TokenType::DoubleColon);
+		GetMemberExpression gme(make_unique<NameExpression>(e->VarValue.AsObject()->Type()->NameAtom()), expr->NameAtom(), TokenType::DoubleColon);
 		return VisitGetMember(&gme);
 	}
 	throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Unknown identifier: '{}'", expr->Name()), expr->Location());
@@ -99,35 +258,131 @@ Value Interpreter::VisitName(NameExpression const* expr) {
 }
 
 Value Interpreter::VisitVar(VarValStatement const* expr) {
-	if (CurrentScope().FindElement(expr->Name(), -1, true))
+	if (IsDeclared(expr))
 		return Value::Error(ValueErrorType::DuplicateName);
 
+	DeclareVariable(expr, expr->Init() ? Eval(expr->Init()) : Value());
+	return Value();
+}
+
+bool Interpreter::IsDeclared(VarValStatement const* decl) {
+	if (auto slot = decl->Slot(); slot.IsResolved())
+		return CurrentScope().SlotElement(slot) != nullptr;
+
+	return CurrentScope().FindElement(decl->NameAtom(), -1, true) != nullptr;
+}
+
+void Interpreter::DeclareVariable(VarValStatement const* decl, Value value) {
 	Element v;
-	if (expr->Init())
-		v.VarValue = Eval(expr->Init());
+	v.VarValue = move(value);
+	CurrentScope().DefineSlot(decl->Slot().Index, decl->NameAtom(), move(v));
+}
 
-	CurrentScope().AddElement(expr->Name(), move(v));
-	return Value();
+Element* Interpreter::FindVariable(Atom name, SlotRef slot) {
+	if (slot.IsResolved())
+		if (auto e = CurrentScope().SlotElement(slot))
+			return e;
+
+	return CurrentScope().FindElement(name);
 }
 
 Value Interpreter::VisitAssign(AssignExpression const* expr) {
-	auto lhs = CurrentScope().FindElement(expr->Lhs());
+	auto lhs = FindVariable(expr->LhsAtom(), expr->Slot());
 	if (!lhs)
 		throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Unknown identifier: {}", expr->Lhs()), expr->Location());
 
 	auto rhs = Eval(expr->Value());
-	return lhs->VarValue.Assign(rhs, expr->AssignType());
+	auto& value = lhs->VarValue;
+	if (expr->Quick() != QuickOp::Generic) {
+		if (expr->Quick() == QuickOp::Unobserved)
+			expr->Quicken(QuickenBinary(CompoundOperator(expr->AssignType()), value, rhs));
+		if (QuickBinary(expr->Quick(), value, rhs, value))
+			return value;
+		expr->Deoptimize();
+	}
+	return value.Assign(rhs, expr->AssignType());
 }
 
 Value Interpreter::VisitInvokeFunction(InvokeFunctionExpression const* expr) {
+	if (expr->Callable()->NodeType() == AstNodeType::GetMember) {
+		auto target = Eval(reinterpret_cast<GetMemberExpression const*>(expr->Callable())->Left());
+		Arguments arguments(this);
+		auto& args = arguments.Get();
+		for (auto& arg : expr->Arguments()) {
+			args.emplace_back(Eval(arg.get()));
+		}
+		return InvokeMember(target, args, expr);
+	}
+
 	auto f = Eval(expr->Callable());
 
-	std::vector<Value> args;
-	args.reserve(expr->Arguments().size() + 1);
+	Arguments arguments(this);
+	auto& args = arguments.Get();
 	for (auto& arg : expr->Arguments()) {
 		args.emplace_back(Eval(arg.get()));
 	}
 
+	if (expr->IsTailCall() && CanLeaveScope(expr->TailCaller())) {
+		if (f.IsString())
+			if (auto e = CurrentScope().FindElement(Atom::Find(f.ToString()), (int8_t)args.size()))
+				f = e->VarValue;
+		//
+		// a script function is left for the enclosing call to run once this body unwinds;
+		// native code and bound methods are called as usual
+		//
+		if (f.IsAstNode()) {
+			if (auto decl = FunctionOf(f.AsAstNode()); decl->Parameters().size() == args.size()) {
+				m_TailCall = decl;
+				m_TailArgs.swap(args);
+				m_Completion = Completion::TailCall;
+				return Value();
+			}
+		}
+	}
+	return CallFunction(move(f), args, expr);
+}
+
+//
+// scopes chain to the caller's, so a callee may read the caller's variables by name;
+// the caller's scope can go before the callee runs only if no declared function looks up any of its names
+//
+bool Interpreter::CanLeaveScope(FunctionEssentials const* caller) const noexcept {
+	for (auto name : caller->FrameNames())
+		if (m_Runtime.IsFreeName(name))
+			return false;
+	return true;
+}
+
+Value Interpreter::InvokeMember(Value const& target, std::vector<Value>& args, InvokeFunctionExpression const* site) {
+	auto member = reinterpret_cast<GetMemberExpression const*>(site->Callable());
+	if (target.IsObject()) {
+		auto obj = const_cast<RuntimeObject*>(target.AsObject());
+		auto type = obj->Type();
+		auto& cache = site->Cache();
+		auto entry = cache.Find(type);
+		if (!entry && !cache.IsMegamorphic() && !type->HasDynamicMembers()) {
+			InlineCache::Entry e{ type };
+			e.Field = type->HasField(member->MemberAtom());
+			if (!e.Field)
+				e.Method = type->ResolveMethod(member->MemberAtom(), (int8_t)args.size(), e.Owner);
+			entry = cache.Add(e);
+		}
+		auto isStatic = member->Operator() == TokenType::DoubleColon;
+		if (entry && entry->Method)
+			return entry->Owner->InvokeMethod(*this, isStatic ? nullptr : obj, entry->Method, args);
+		//
+		// uncached methods are invoked by name, without binding them to the instance first
+		//
+		if (!(entry ? entry->Field : type->HasField(member->MemberAtom())))
+			return obj->Invoke(*this, member->MemberAtom(), args, isStatic ? InvokeFlags::Static : InvokeFlags::Instance);
+	}
+	//
+	// fields holding functions and primitives take the general path
+	//
+	return CallFunction(GetMemberValue(target, member), args, site);
+}
+
+Value Interpreter::CallFunction(Value f, std::vector<Value>& args, AstNode const* site) {
 	if (f.IsNativeFunction()) {
 		return (*f.AsNativeCode())(*this, args);
 	}
@@ -137,69 +392,44 @@ Value Interpreter::VisitInvokeFunction(InvokeFunctionExpression const* expr) {
 	}
 	else if (f.IsCallable()) {
 		auto c = f.AsCallable();
-		auto isStatic = (c->Flags & SymbolFlags::Static) == SymbolFlags::Static;
-		try {
-			return const_cast<RuntimeObject*>(c->Instance.Get())->Invoke(*this, c->Name, args, isStatic ? InvokeFlags::Static : InvokeFlags::Instance);
-		}
-		catch (ReturnStatementException const& ret) {
-			return ret.ReturnValue;
-		}
-		catch (BreakoutStatementException const&) {
-			return Value();
-		}
+		auto instance = const_cast<RuntimeObject*>(c->Instance.Get());
+		ObjectType const* owner;
+		if (auto method = c->Resolve((int8_t)args.size(), owner))
+			return owner->InvokeMethod(*this, c->IsStatic() ? nullptr : instance, method, args);
+		return instance->Invoke(*this, c->Name, args, c->IsStatic() ? InvokeFlags::Static : InvokeFlags::Instance);
 	}
 	else if (f.IsString()) {
-		auto e = CurrentScope().FindElement(f.ToString(), (int8_t)expr->Arguments().size());
+		auto e = CurrentScope().FindElement(Atom::Find(f.ToString()), (int8_t)args.size());
 		if (e)
 			f = e->VarValue;
 		else
-			throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Cannot find method '{}' with {} arguments", f.ToString(), expr->Arguments().size()));
+			throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Cannot find method '{}' with {} arguments", f.ToString(), args.size()));
 		if (f.IsAstNode())
 			node = f.AsAstNode();
 	}
 	if(node) {
-		Scoper scoper(this);
-		auto node = f.AsAstNode();
-		FunctionEssentials const* decl;
-		if (node->NodeType() == AstNodeType::FunctionDeclaration) {
-			decl = static_cast<FunctionEssentials const*>(reinterpret_cast<FunctionDeclaration const*>(node));
-		}
-		else {
-			assert(node->NodeType() == AstNodeType::AnonymousFunction);
-			decl = static_cast<FunctionEssentials const*>(reinterpret_cast<AnonymousFunctionExpression const*>(node));
-		}
-		if (decl->Parameters().size() != expr->Arguments().size())
+		auto decl = FunctionOf(node);
+		if (decl->Parameters().size() != args.size())
 			throw RuntimeError(RuntimeErrorType::WrongNumberArguments,
-				format("Wrong numnber of arguments. Expected: {}, Provided: {}", decl->Parameters().size(), expr->Arguments().size()), expr->Location());
+				format("Wrong numnber of arguments. Expected: {}, Provided: {}", decl->Parameters().size(), args.size()), site->Location());
 
-		for (size_t i = 0; i < expr->Arguments().size(); i++) {
-			Element v{ Eval(expr->Arguments()[i].get()) };
-			CurrentScope().AddElement(decl->Parameters()[i].Name, move(v));
-		}
-		try {
-			return Eval(decl->Body());
-		}
-		catch (ReturnStatementException const& ret) {
-			return ret.ReturnValue;
-		}
-		catch (BreakoutStatementException const&) {
-			return Value();
+		Scoper scoper(this, decl->SlotCount());
+		for (size_t i = 0; i < args.size(); i++) {
+			Element v{ move(args[i]) };
+			CurrentScope().DefineSlot((int)i, decl->Parameters()[i].Name, move(v));
 		}
+		return CompleteCall(ExecuteBody(decl->Body()));
 	}
 	return Value();
 }
 
 Value Interpreter::VisitWhile(WhileStatement const* stmt) {
-	Scoper scoper(this);
+	Scoper scoper(this, stmt->SlotCount());
 	while (Eval(stmt->Condition()).ToBoolean()) {
-		try {
-			Eval(stmt->Body());
-		}
-		catch (BreakStatementException const&) {
-			break;
-		}
-		catch (ContinueStatementException const&) {
-		}
+		if (m_Tiers)
+			CountIteration(stmt);
+		if (auto result = Eval(stmt->Body()); m_Completion != Completion::Normal && EndIteration(result))
+			return result;
 	}
 	return Value();
 }
@@ -218,44 +448,47 @@ Value Interpreter::VisitIfThenElse(IfThenElseExpression const* expr) {
 
 Value Interpreter::VisitFunctionDeclaration(FunctionDeclaration const* decl) {
 	Element v{ decl };
+	if (auto code = BoundNative(decl))
+		v.VarValue = code;
 	v.Arity = (int8_t)decl->Parameters().size();
-	CurrentScope().AddElement(decl->Name(), v);
+	CurrentScope().AddElement(Atom(decl->Name()), v);
+	m_Runtime.AddFreeNames(decl->FreeNames());
 
 	return Value();
 }
 
 Value Interpreter::VisitReturn(ReturnStatement const* decl) {
-	auto ret = decl->ReturnValue()->Accept(this);
-	throw ReturnStatementException{ ret };
+	auto ret = Eval(decl->ReturnValue());
+	if (m_Completion != Completion::TailCall)
+		m_Completion = Completion::Return;
+	return ret;
 }
 
 Value Interpreter::VisitBreakContinue(BreakOrContinueStatement const* stmt) {
 	switch (stmt->BreakType()) {
 		case TokenType::Continue:
-			throw ContinueStatementException();
+			m_Completion = Completion::Continue;
+			break;
 		case TokenType::Break:
-			throw BreakStatementException();
+			m_Completion = Completion::Break;
+			break;
 		case TokenType::BreakOut:
-			throw BreakoutStatementException();
+			m_Completion = Completion::Breakout;
+			break;
+		default:
+			assert(false);
 	}
-	assert(false);
 	return Value();
 }
 
 Value Interpreter::VisitFor(ForStatement const* stmt) {
-	Scoper scoper(this);
+	Scoper scoper(this, stmt->SlotCount());
 	Eval(stmt->Init());
 	while (Eval(stmt->While()).ToBoolean()) {
-		if (stmt->Body()) {
-			try {
-				Eval(stmt->Body());
-			}
-			catch (BreakStatementException) {
-				break;
-			}
-			catch (ContinueStatementException) {
-			}
-		}
+		if (m_Tiers)
+			CountIteration(stmt);
+		if (auto result = Eval(stmt->Body()); m_Completion != Completion::Normal && EndIteration(result))
+			return result;
 		Eval(stmt->Inc());
 	}
 	return Value();
@@ -265,21 +498,25 @@ Value Interpreter::VisitStatements(Statements const* stmts) {
 	Value result;
 	for (auto& stmt : stmts->Get()) {
 		result = Eval(stmt.get());
+		if (m_Completion != Completion::Normal)
+			break;
 	}
 	return result;
 }
 
 Value Interpreter::VisitAnonymousFunction(AnonymousFunctionExpression const* func) {
+	m_Runtime.AddFreeNames(func->FreeNames());
 	return func;
 }
 
 Value Interpreter::VisitEnumDeclaration(EnumDeclaration const* decl) {
-	if (CurrentScope().FindElement(decl->Name(), -1, true)) {
+	Atom name(decl->Name());
+	if (CurrentScope().FindElement(name, -1, true)) {
 		throw RuntimeError(RuntimeErrorType::DuplicateDefinition, format("Type '{}' already defined in this scope", decl->Name()), decl->Location());
 	}
 	auto type = m_Runtime.BuildEnum(decl);
 	Element e{ (RuntimeObject*)type.Get(), ElementFlags::Enum };
-	CurrentScope().AddElement(decl->Name(), move(e));
+	CurrentScope().AddElement(name, move(e));
 
 	return Value();
 }
@@ -295,26 +532,22 @@ Value Interpreter::VisitArrayExpression(ArrayExpression const* expr) {
 	for (auto& item : expr->Items())
 		values.emplace_back(Eval(item.get()));
 
-	return type->CreateArray(values);
+	return type->CreateArrayValue(move(values));
 }
 
 Value Interpreter::VisitRepeat(RepeatStatement const* stmt) {
 	auto times = Eval(stmt->Times()).ToInteger();
 	for (; times > 0; --times) {
-		try {
-			Eval(stmt->Body());
-		}
-		catch (BreakStatementException const&) {
-			break;
-		}
-		catch (ContinueStatementException const&) {
-		}
+		if (m_Tiers)
+			CountIteration(stmt);
+		if (auto result = Eval(stmt->Body()); m_Completion != Completion::Normal && EndIteration(result))
+			return result;
 	}
 	return Value();
 }
 
 Scope& Interpreter::CurrentScope() {
-	return m_Scopes.top();
+	return m_Scopes.Top();
 }
 
 CodeLocation Interpreter::Location() const noexcept {
@@ -322,47 +555,37 @@ CodeLocation Interpreter::Location() const noexcept {
 }
 
 Value Interpreter::Invoke(AstNode const* node, std::vector<Value> const* args) {
-	Expression const* body;
-	FunctionEssentials const* decl = nullptr;
-
-	if (node->NodeType() == AstNodeType::FunctionDeclaration) {
-		decl = static_cast<FunctionEssentials const*>(reinterpret_cast<FunctionDeclaration const*>(node));
-	}
-	else {
-		assert(node->NodeType() == AstNodeType::AnonymousFunction);
-		decl = static_cast<FunctionEssentials const*>(reinterpret_cast<AnonymousFunctionExpression const*>(node));
-	}
-	body = decl->Body();
+	auto decl = FunctionOf(node);
+	auto body = decl->Body();
 	auto& params = decl->Parameters();
-	Scoper scoper(this);
+	Scoper scoper(this, decl->SlotCount());
 	if (args) {
 		for (size_t i = 0; i < args->size(); i++) {
 			Element v{ (*args)[i] };
-			CurrentScope().AddElement(params[i].Name, move(v));
+			CurrentScope().DefineSlot((int)i, params[i].Name, move(v));
 		}
 	}
 
-	try {
-		return Eval(body);
-	}
-	catch (ReturnStatementException const& ret) {
-		return ret.ReturnValue;
-	}
-	catch (BreakoutStatementException const&) {
-	}
-	return Value();
+	return CompleteCall(ExecuteBody(body));
 }
 
 Value Interpreter::RunMain(int argc, const char* argv[], const char* envp[]) {
+	if (m_StackSize && !m_OnStack)
+		return RunOnStack([&] { return RunMain(argc, argv, envp); });
+
 	AstNode const* main = nullptr;
-	for (auto& node : m_Runtime.Code()) {
-		if (node->NodeType() == AstNodeType::FunctionDeclaration) {
-			auto decl = reinterpret_cast<FunctionDeclaration const*>(node.get());
-			if (decl->Name() == "Main") {
-				main = decl;
-				break;
+	for (auto& code : m_Runtime.Code()) {
+		for (auto& node : code->Get()) {
+			if (node->NodeType() == AstNodeType::FunctionDeclaration) {
+				auto decl = reinterpret_cast<FunctionDeclaration const*>(node.get());
+				if (decl->Name() == "Main") {
+					main = decl;
+					break;
+				}
 			}
 		}
+		if (main)
+			break;
 	}
 	if (main) {
 		std::vector<Value> args;
@@ -370,28 +593,77 @@ Value Interpreter::RunMain(int argc, const char* argv[], const char* envp[]) {
 		items.reserve(argc);
 		for (int i = 0; i < argc; i++)
 			items.push_back(argv[i]);
-		auto sargs = ArrayType::Get()->CreateArray(move(items));
+		auto sargs = ArrayType::Get()->CreateArrayValue(move(items));
 		args.push_back(move(sargs));
+		auto decl = reinterpret_cast<FunctionDeclaration const*>(main);
+		if (auto code = BoundNative(decl); code && decl->Parameters().size() == args.size())
+			return code(*this, args);
 		return Invoke(main, &args);
 	}
 
 	return Value::Error();
 }
 
-void Interpreter::PushScope() {
-	if (m_Scopes.size() > 100)
-		throw RuntimeError(RuntimeErrorType::StackOverflow, "Call stack is too deep");
+void Interpreter::BindNative(FunctionDeclaration const* decl, NativeFunction code) {
+	m_Natives[decl] = code;
+}
+
+NativeFunction Interpreter::BoundNative(FunctionDeclaration const* decl) const noexcept {
+	if (m_Natives.empty())
+		return nullptr;
+	auto it = m_Natives.find(decl);
+	return it == m_Natives.end() ? nullptr : it->second;
+}
 
-	m_Scopes.push(Scope(&m_Scopes.top()));
+void Interpreter::PushScope(int slots) {
+	m_Scopes.Push(slots);
+}
+
+void Interpreter::EnterCall() {
+	if (m_CallDepth >= m_MaxCallDepth)
+		throw RuntimeError(RuntimeErrorType::StackOverflow, format("Call stack is too deep (more than {} calls)", m_MaxCallDepth), Location());
+	if (StackGuard::Remaining() < StackGuard::DefaultReserve)
+		throw RuntimeError(RuntimeErrorType::StackOverflow, "Call stack is too deep (native stack exhausted)", Location());
+	m_CallDepth++;
+}
+
+//
+// runs top level code on the dedicated stack, so how deep scripts recurse is up to
+// the call depth limit rather than to the stack of the thread that happens to run them
+//
+Value Interpreter::RunOnStack(std::function<Value()> const& run) {
+	Value result;
+	m_OnStack = true;
+	try {
+		StackGuard::RunOnStack(m_StackSize, [&] { result = run(); });
+	}
+	catch (...) {
+		m_OnStack = false;
+		throw;
+	}
+	m_OnStack = false;
+	return result;
 }
 
 void Interpreter::PopScope() {
-	m_Scopes.pop();
-	assert(!m_Scopes.empty());
+	m_Scopes.Pop();
+}
+
+std::vector<Value>& Interpreter::BorrowArguments() {
+	if (m_ArgumentDepth == m_ArgumentPool.size())
+		m_ArgumentPool.push_back(make_unique<vector<Value>>());
+	return *m_ArgumentPool[m_ArgumentDepth++];
+}
+
+void Interpreter::ReturnArguments() noexcept {
+	m_ArgumentPool[--m_ArgumentDepth]->clear();
 }
 
 Value Interpreter::VisitGetMember(GetMemberExpression const* expr) {
-	auto value = Eval(expr->Left());
+	return GetMemberValue(Eval(expr->Left()), expr);
+}
+
+Value Interpreter::GetMemberValue(Value const& value, GetMemberExpression const* expr) {
 	if (expr->Operator() == TokenType::QuestionDot && value.IsEmpty())
 		return Value();
 
@@ -400,20 +672,33 @@ Value Interpreter::VisitGetMember(GetMemberExpression const* expr) {
 		throw RuntimeError(RuntimeErrorType::UnknownMember, format("Unknown member '{}'", expr->Member()), expr->Location());
 
 	auto obj = value.ToObject();
-	if (type->HasField(expr->Member()))
-		return obj->GetFieldValue(expr->Member());
+	auto& cache = expr->Cache();
+	auto entry = cache.Find(type);
+	if (!entry && !cache.IsMegamorphic() && !type->HasDynamicMembers())
+		entry = cache.Add({ type, nullptr, nullptr, type->HasField(expr->MemberAtom()) });
+	if (entry ? entry->Field : type->HasField(expr->MemberAtom()))
+		return obj->GetFieldValue(expr->MemberAtom());
 
-	auto c = new Callable;
-	c->Instance = obj;
-	c->Name = expr->Member();
 	bool isStatic = expr->Operator() == TokenType::DoubleColon;
-	c->Flags = isStatic ? SymbolFlags::Static : SymbolFlags::None;
-	return c;
+	return Callable::Create(obj, expr->MemberAtom(), isStatic ? SymbolFlags::Static : SymbolFlags::None);
 }
 
 Value Interpreter::VisitAccessArray(AccessArrayExpression const* expr) {
 	auto index = Eval(expr->Index());
 	auto value = Eval(expr->Left());
+	if (expr->Quick() != QuickOp::Generic) {
+		auto array = value.IsObject() && value.AsObject()->Type() == ArrayType::Get() ? static_cast<ArrayObject const*>(value.AsObject()) : nullptr;
+		if (expr->Quick() == QuickOp::Unobserved)
+			expr->Quicken(array && index.IsInteger() ? QuickOp::IndexArrayInt : QuickOp::Generic);
+		if (expr->Quick() == QuickOp::IndexArrayInt && array && index.IsInteger()) {
+			// out of range indices take the generic path to report the error
+			if (auto i = index.AsInteger(); i >= 0 && i < array->Count())
+				return array->Items()[i];
+		}
+		else {
+			expr->Deoptimize();
+		}
+	}
 	return value.InvokeIndexer(index);
 }
 
@@ -431,7 +716,10 @@ Value Interpreter::VisitClassDeclaration(ClassDeclaration const* decl) {
 	if (decl->Parent())
 		name = decl->Parent()->Name() + "::" + name;
 
-	CurrentScope().AddElement(name, move(v));
+	CurrentScope().AddElement(Atom(name), move(v));
+	m_Runtime.AddFreeNames(decl->FreeNames());
+	for (auto& m : decl->Methods())
+		m_Runtime.AddFreeNames(m->FreeNames());
 	for (auto& t : decl->Types()) {
 		VisitClassDeclaration(t.get());
 	}
@@ -439,7 +727,7 @@ Value Interpreter::VisitClassDeclaration(ClassDeclaration const* decl) {
 }
 
 Value Interpreter::VisitNewObjectExpression(NewObjectExpression const* expr) {
-	auto v = CurrentScope().FindElement(expr->ClassName());
+	auto v = CurrentScope().FindElement(expr->ClassNameAtom());
 	if (v == nullptr)
 		throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Class '{}' not found in scope", expr->ClassName()));
 
@@ -468,7 +756,7 @@ Value Interpreter::VisitNewObjectExpression(NewObjectExpression const* expr) {
 Value Interpreter::VisitAssignField(AssignFieldExpression const* expr) {
 	auto obj = Eval(expr->Lhs()->Left());
 	assert(obj.IsObject());
-	obj.AsObject()->AssignField(expr->Lhs()->Member(), Eval(expr->Value()), expr->AssignType());
+	obj.AsObject()->AssignField(expr->Lhs()->MemberAtom(), Eval(expr->Value()), expr->AssignType());
 	return Eval(expr->Lhs());
 }
 
@@ -483,17 +771,18 @@ Value Interpreter::VisitForEach(ForEachStatement const* stmt) {
 	if (!enumerable)
 		throw RuntimeError(RuntimeErrorType::TypeMismatch, "Object does not implement the Enumerable interface", stmt->Collection()->Location());
 
-	Scoper scoper(this);
-	Element e{};
-	CurrentScope().AddElement(stmt->Name(), e);
+	Scoper scoper(this, stmt->SlotCount());
+	auto index = CurrentScope().DefineSlot(stmt->Slot().Index, stmt->NameAtom(), Element{});
+	assert(index);
 	auto enumerator = enumerable->GetEnumerator();
 	Value next;
-	auto index = CurrentScope().FindElement(stmt->Name());
-	assert(index);
 
 	while (!(next = enumerator->GetNextValue()).IsError()) {
 		index->VarValue = move(next);
-		Eval(stmt->Body());
+		if (m_Tiers)
+			CountIteration(stmt);
+		if (auto result = Eval(stmt->Body()); m_Completion != Completion::Normal && EndIteration(result))
+			return result;
 	}
 	return Value();
 }
@@ -517,9 +806,9 @@ Value Interpreter::VisitMatch(MatchExpression const* expr) {
 			if (c->NodeType() == AstNodeType::AnonymousFunction) {
 				auto af = reinterpret_cast<AnonymousFunctionExpression const*>(c.get());
 				assert(af->Parameters().size() == 1);
-				Scoper scoper(this);
-				CurrentScope().AddElement(af->Parameters()[0].Name, Element{ value });
-				if (Eval(af->Body()).ToBoolean()) {
+				Scoper scoper(this, af->SlotCount());
+				CurrentScope().DefineSlot(0, af->Parameters()[0].Name, Element{ value });
+				if (CompleteCall(Eval(af->Body())).ToBoolean()) {
 					return Eval(mc.Action());
 				}
 			}
@@ -538,13 +827,14 @@ Value Interpreter::VisitMatch(MatchExpression const* expr) {
 }
 
 Value Interpreter::VisitUse(UseStatement const* use) {
-	auto e = CurrentScope().FindElement(use->Name());
+	Atom name(use->Name());
+	auto e = CurrentScope().FindElement(name);
 	if (e == nullptr)
 		throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Unknown name '{}'", use->Name()), use->Location());
 	if ((e->Flags & ElementFlags::Class) == ElementFlags::None)
 		throw RuntimeError(RuntimeErrorType::InvalidType, format("'{}' is not a class", use->Name()), use->Location());
 
-	CurrentScope().AddUse(use->Name());
+	CurrentScope().AddUse(name);
 
 	return Value();
 }
@@ -1,7 +1,10 @@
 #pragma once
 
-#include <stack>
 #include <memory>
+#include <vector>
+#include <functional>
+#include <utility>
+#include <unordered_map>
 #include "Scope.h"
 #include "Visitor.h"
 #include "Value.h"
@@ -13,15 +16,81 @@ namespace Dynamix {
 	class SymbolTable;
 	class Runtime;
 	class AstNode;
-
+	class FunctionEssentials;
+
+
+	class VirtualMachine;
+	class Jit;
+	class TieredCompiler;
+	class LoopCounter;
+
+	//
+	// control transfer pending while Visit methods unwind to the statement that handles it
+	//
+	enum class Completion : uint8_t {
+		Normal,
+		Return,
+		Break,
+		Continue,
+		Breakout,
+		// a call in tail position left its callee and arguments for CompleteCall to run
+		TailCall,
+	};
 
 	class Interpreter final : public Visitor, NoCopy {
+		friend class VirtualMachine;
 	public:
 		Interpreter(Runtime& rt);
+		~Interpreter();
 
 		Value Eval(AstNode const* root);
+		Value ExecuteBody(AstNode const* body);
+
+		void SetEngine(ExecutionEngine engine);
+		ExecutionEngine Engine() const noexcept {
+			return m_Engine;
+		}
+		// null unless the engine is Jit and the platform supports it
+		Jit* GetJit() const noexcept;
+		// null unless the engine is Tiered
+		TieredCompiler* GetTieredCompiler() const noexcept {
+			return m_Tiers.get();
+		}
+
+		//
+		// script calls that may be in progress at once; a chain of tail calls counts as one.
+		// whatever the limit, a call that would leave too little native stack fails as well
+		//
+		static constexpr int DefaultMaxCallDepth = 10000;
+
+		void SetMaxCallDepth(int depth) noexcept {
+			m_MaxCallDepth = depth;
+		}
+		int MaxCallDepth() const noexcept {
+			return m_MaxCallDepth;
+		}
+		int CallDepth() const noexcept {
+			return m_CallDepth;
+		}
+		// size of a native stack dedicated to running top level code; 0 runs on the calling thread's stack
+		void SetStackSize(size_t size) noexcept {
+			m_StackSize = size;
+		}
+		size_t StackSize() const noexcept {
+			return m_StackSize;
+		}
+
+		Value CallFunction(Value f, std::vector<Value>& args, AstNode const* site);
+		Value GetMemberValue(Value const& value, GetMemberExpression const* expr);
+		Value InvokeMember(Value const& target, std::vector<Value>& args, InvokeFunctionExpression const* site);
+		Value BinaryOperation(Value const& left, TokenType op, Value const& right);
+
+		Element* FindVariable(Atom name, SlotRef slot);
+		bool IsDeclared(VarValStatement const* decl);
+		void DeclareVariable(VarValStatement const* decl, Value value);
 
 		void RunConstructor(RuntimeObject* instance, MethodInfo const* ctor, std::vector<Value> const& args);
+		Value CompleteCall(Value result);
 
 		// Inherited via Visitor
 		Value VisitLiteral(LiteralExpression const* expr) override;
@@ -57,6 +126,8 @@ namespace Dynamix {
 		Scope& CurrentScope();
 
 		friend struct Scoper;
+		friend struct CallFrame;
+		friend class Arguments;
 
 		CodeLocation Location() const noexcept;
 
@@ -64,23 +135,75 @@ namespace Dynamix {
 		Value RunMain(int argc, const char* argv[], const char* envp[]);
 		Value RunFunction(const char* name, std::vector<Value> const* args = nullptr);
 
+		//
+		// native code to run in place of a function's body, for programs built by 'dynamix compile'.
+		// a bound method receives its instance as the first argument
+		//
+		void BindNative(FunctionDeclaration const* decl, NativeFunction code);
+		NativeFunction BoundNative(FunctionDeclaration const* decl) const noexcept;
+
 		Runtime& GetRuntime() {
 			return m_Runtime;
 		}
 
 	protected:
-		void PushScope();
+		void PushScope(int slots = 0);
 		void PopScope();
+		void EnterCall();
+		void LeaveCall() noexcept {
+			m_CallDepth--;
+		}
+		Value RunOnStack(std::function<Value()> const& run);
+		std::vector<Value>& BorrowArguments();
+		void ReturnArguments() noexcept;
+		bool EndIteration(Value& result) noexcept;
+		Value RunTailCall();
+		bool CanLeaveScope(FunctionEssentials const* caller) const noexcept;
+		Value ExecuteTiered(AstNode const* body);
+		void CountIteration(LoopCounter const* loop);
+
+		//
+		// the function body whose loops count toward compiling it, for as long as it runs
+		//
+		struct RunningBody {
+			RunningBody(Interpreter* intr, AstNode const* body) noexcept : m_Intr(intr), m_Saved(std::exchange(intr->m_Body, body)) {}
+			~RunningBody() {
+				m_Intr->m_Body = m_Saved;
+			}
+
+		private:
+			Interpreter* m_Intr;
+			AstNode const* m_Saved;
+		};
 
 	private:
 		Runtime& m_Runtime;
-		std::stack<Scope> m_Scopes;
+		FrameStack m_Scopes;
+		//
+		// argument vectors reused by nested calls, so a call does not allocate once the pool is warm
+		//
+		std::vector<std::unique_ptr<std::vector<Value>>> m_ArgumentPool;
+		size_t m_ArgumentDepth{ 0 };
+		std::vector<Element*> m_Lookup;
+		std::unordered_map<FunctionDeclaration const*, NativeFunction> m_Natives;
+		FunctionEssentials const* m_TailCall{ nullptr };
+		std::vector<Value> m_TailArgs;
 		AstNode const* m_CurrentNode{ nullptr };
+		int m_CallDepth{ 0 };
+		int m_MaxCallDepth{ DefaultMaxCallDepth };
+		size_t m_StackSize{ 0 };
+		bool m_OnStack{ false };
+		std::unique_ptr<VirtualMachine> m_VM;
+		std::unique_ptr<TieredCompiler> m_Tiers;
+		// function body the tree-walker is running, whose loops count toward compiling it
+		AstNode const* m_Body{ nullptr };
+		ExecutionEngine m_Engine{ ExecutionEngine::TreeWalker };
+		Completion m_Completion{ Completion::Normal };
 	};
 
 	struct Scoper {
-		Scoper(Interpreter* intr) : m_Intr(intr) {
-			intr->PushScope();
+		Scoper(Interpreter* intr, int slots = 0) : m_Intr(intr) {
+			intr->PushScope(slots);
 		}
 		~Scoper() {
 			m_Intr->PopScope();
@@ -90,4 +213,34 @@ namespace Dynamix {
 		Interpreter* m_Intr;
 	};
 
+	//
+	// a script function's body running; counts toward the call depth limit
+	//
+	struct CallFrame {
+		CallFrame(Interpreter* intr) : m_Intr(intr) {
+			intr->EnterCall();
+		}
+		~CallFrame() {
+			m_Intr->LeaveCall();
+		}
+
+	private:
+		Interpreter* m_Intr;
+	};
+
+	class Arguments : NoCopy {
+	public:
+		explicit Arguments(Interpreter* intr) : m_Intr(intr), m_Values(intr->BorrowArguments()) {}
+		~Arguments() {
+			m_Intr->ReturnArguments();
+		}
+		std::vector<Value>& Get() noexcept {
+			return m_Values;
+		}
+
+	private:
+		Interpreter* m_Intr;
+		std::vector<Value>& m_Values;
+	};
+
 }
@@ -0,0 +1,785 @@
+#include <cassert>
+#include <climits>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <vector>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "Jit.h"
+#include "VirtualMachine.h"
+#include "AstNode.h"
+#include "Scope.h"
+
+using namespace Dynamix;
+using namespace std;
+
+#ifdef DYNAMIX_JIT
+
+namespace {
+	enum Reg : uint8_t {
+		RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+		R8, R9, R10, R11, R12, R13, R14, R15,
+	};
+
+	enum Xmm : uint8_t {
+		XMM0, XMM1, XMM2,
+	};
+
+	enum class Cond : uint8_t {
+		Below = 0x2,
+		AboveEqual = 0x3,
+		Equal = 0x4,
+		NotEqual = 0x5,
+		BelowEqual = 0x6,
+		Above = 0x7,
+		Parity = 0xa,
+		NoParity = 0xb,
+		Less = 0xc,
+		GreaterEqual = 0xd,
+		LessEqual = 0xe,
+		Greater = 0xf,
+	};
+
+	//
+	// just enough of an x86-64 assembler for the code the JIT emits. memory operands are [base + disp32];
+	// jumps are emitted with a zero displacement and patched once their target is known
+	//
+	class Assembler {
+	public:
+		vector<uint8_t> const& Code() const noexcept {
+			return m_Code;
+		}
+		size_t Here() const noexcept {
+			return m_Code.size();
+		}
+
+		void Push(Reg r) {
+			Rex(false, 0, r);
+			Byte(0x50 + (r & 7));
+		}
+		void Pop(Reg r) {
+			Rex(false, 0, r);
+			Byte(0x58 + (r & 7));
+		}
+		void Ret() {
+			Byte(0xc3);
+		}
+		void CallReg(Reg r) {
+			Rex(false, 0, r);
+			Byte(0xff);
+			ModRR(2, r);
+		}
+
+		void Mov(Reg dst, Reg src) {
+			Rex(true, src, dst);
+			Byte(0x89);
+			ModRR(src, dst);
+		}
+		void MovImm(Reg dst, uint64_t imm) {
+			Rex(true, 0, dst);
+			Byte(0xb8 + (dst & 7));
+			Qword(imm);
+		}
+		void MovImm32(Reg dst, uint32_t imm) {
+			Rex(false, 0, dst);
+			Byte(0xb8 + (dst & 7));
+			Dword(imm);
+		}
+		void Load(Reg dst, Reg base, int32_t disp) {
+			Rex(true, dst, base);
+			Byte(0x8b);
+			ModRM(dst, base, disp);
+		}
+		void Store(Reg base, int32_t disp, Reg src) {
+			Rex(true, src, base);
+			Byte(0x89);
+			ModRM(src, base, disp);
+		}
+		// movzx dst, word [base + disp]
+		void LoadWord(Reg dst, Reg base, int32_t disp) {
+			Rex(false, dst, base);
+			Byte(0x0f);
+			Byte(0xb7);
+			ModRM(dst, base, disp);
+		}
+		void StoreWord(Reg base, int32_t disp, uint16_t imm) {
+			Byte(0x66);
+			Rex(false, 0, base);
+			Byte(0xc7);
+			ModRM(0, base, disp);
+			Word(imm);
+		}
+		void CmpWord(Reg base, int32_t disp, uint16_t imm) {
+			Byte(0x66);
+			Rex(false, 0, base);
+			Byte(0x81);
+			ModRM(7, base, disp);
+			Word(imm);
+		}
+		void CmpDword(Reg base, int32_t disp, int8_t imm) {
+			Rex(false, 0, base);
+			Byte(0x83);
+			ModRM(7, base, disp);
+			Byte(uint8_t(imm));
+		}
+		void CmpByte(Reg base, int32_t disp, uint8_t imm) {
+			Rex(false, 0, base);
+			Byte(0x80);
+			ModRM(7, base, disp);
+			Byte(imm);
+		}
+
+		void Add(Reg dst, Reg src) {
+			Alu(0x01, dst, src);
+		}
+		void Sub(Reg dst, Reg src) {
+			Alu(0x29, dst, src);
+		}
+		void Cmp(Reg lhs, Reg rhs) {
+			Alu(0x39, lhs, rhs);
+		}
+		void Test(Reg lhs, Reg rhs) {
+			Alu(0x85, lhs, rhs);
+		}
+		void Imul(Reg dst, Reg src) {
+			Rex(true, dst, src);
+			Byte(0x0f);
+			Byte(0xaf);
+			ModRR(dst, src);
+		}
+		// 32 bit sub and 64 bit cmp against a small immediate
+		void SubImm32(Reg r, int8_t imm) {
+			Rex(false, 0, r);
+			Byte(0x83);
+			ModRR(5, r);
+			Byte(uint8_t(imm));
+		}
+		void CmpImm(Reg r, int8_t imm) {
+			Rex(true, 0, r);
+			Byte(0x83);
+			ModRR(7, r);
+			Byte(uint8_t(imm));
+		}
+		void CmpImm32(Reg r, int8_t imm) {
+			Rex(false, 0, r);
+			Byte(0x83);
+			ModRR(7, r);
+			Byte(uint8_t(imm));
+		}
+
+		// byte forms, limited to al, cl and dl
+		void SetCC(Cond cond, Reg r) {
+			assert(r < RSP);
+			Byte(0x0f);
+			Byte(0x90 + uint8_t(cond));
+			ModRR(0, r);
+		}
+		void AndByte(Reg dst, Reg src) {
+			Byte(0x20);
+			ModRR(src, dst);
+		}
+		void OrByte(Reg dst, Reg src) {
+			Byte(0x08);
+			ModRR(src, dst);
+		}
+		void MovzxByte(Reg dst, Reg src) {
+			Byte(0x0f);
+			Byte(0xb6);
+			ModRR(dst, src);
+		}
+
+		void MovsdLoad(Xmm dst, Reg base, int32_t disp) {
+			Byte(0xf2);
+			Rex(false, dst, base);
+			Byte(0x0f);
+			Byte(0x10);
+			ModRM(dst, base, disp);
+		}
+		void MovsdStore(Reg base, int32_t disp, Xmm src) {
+			Byte(0xf2);
+			Rex(false, src, base);
+			Byte(0x0f);
+			Byte(0x11);
+			ModRM(src, base, disp);
+		}
+		void Addsd(Xmm dst, Xmm src) {
+			Sse(0xf2, 0x58, dst, src);
+		}
+		void Mulsd(Xmm dst, Xmm src) {
+			Sse(0xf2, 0x59, dst, src);
+		}
+		void Subsd(Xmm dst, Xmm src) {
+			Sse(0xf2, 0x5c, dst, src);
+		}
+		void Divsd(Xmm dst, Xmm src) {
+			Sse(0xf2, 0x5e, dst, src);
+		}
+		void Ucomisd(Xmm lhs, Xmm rhs) {
+			Sse(0x66, 0x2e, lhs, rhs);
+		}
+		void Xorpd(Xmm dst, Xmm src) {
+			Sse(0x66, 0x57, dst, src);
+		}
+
+		// return the position of the displacement to patch
+		size_t Jmp() {
+			Byte(0xe9);
+			return Rel32();
+		}
+		size_t Jcc(Cond cond) {
+			Byte(0x0f);
+			Byte(0x80 + uint8_t(cond));
+			return Rel32();
+		}
+		void Patch(size_t at, size_t target) noexcept {
+			auto rel = int32_t(int64_t(target) - int64_t(at + 4));
+			memcpy(m_Code.data() + at, &rel, sizeof(rel));
+		}
+
+	private:
+		void Byte(uint8_t b) {
+			m_Code.push_back(b);
+		}
+		void Word(uint16_t w) {
+			Byte(uint8_t(w));
+			Byte(uint8_t(w >> 8));
+		}
+		void Dword(uint32_t d) {
+			for (int i = 0; i < 4; i++)
+				Byte(uint8_t(d >> (i * 8)));
+		}
+		void Qword(uint64_t q) {
+			Dword(uint32_t(q));
+			Dword(uint32_t(q >> 32));
+		}
+		size_t Rel32() {
+			Dword(0);
+			return Here() - 4;
+		}
+		void Rex(bool wide, int reg, int rm) {
+			uint8_t rex = 0x40 | (wide ? 8 : 0) | ((reg & 8) >> 1) | ((rm & 8) >> 3);
+			if (rex != 0x40)
+				Byte(rex);
+		}
+		void ModRR(int reg, int rm) {
+			Byte(uint8_t(0xc0 | (reg & 7) << 3 | (rm & 7)));
+		}
+		void ModRM(int reg, Reg base, int32_t disp) {
+			Byte(uint8_t(0x80 | (reg & 7) << 3 | (base & 7)));
+			// rsp and r12 as a base need a SIB byte
+			if ((base & 7) == RSP)
+				Byte(0x24);
+			Dword(uint32_t(disp));
+		}
+		void Alu(uint8_t op, Reg dst, Reg src) {
+			Rex(true, src, dst);
+			Byte(op);
+			ModRR(src, dst);
+		}
+		void Sse(uint8_t prefix, uint8_t op, Xmm dst, Xmm src) {
+			Byte(prefix);
+			Byte(0x0f);
+			Byte(op);
+			ModRR(dst, src);
+		}
+
+		vector<uint8_t> m_Code;
+	};
+}
+
+//
+// emits a chunk's machine code. rbx holds the register file and r12 the JitContext throughout.
+// each instruction gets a label for jumps to land on; its slow path, if it has a fast one,
+// is emitted out of line after the epilogue and rejoins the code at the next instruction
+//
+class Jit::Builder {
+public:
+	explicit Builder(CodeChunk const& chunk) : m_Chunk(chunk), m_Labels(chunk.Code.size() + 1) {}
+
+	vector<uint8_t> const& Build() {
+		m_Asm.Push(RBP);
+		m_Asm.Mov(RBP, RSP);
+		m_Asm.Push(RBX);
+		m_Asm.Push(R12);
+		m_Asm.Mov(RBX, RDI);
+		m_Asm.Mov(R12, RSI);
+
+		auto count = (int)m_Chunk.Code.size();
+		for (int pc = 0; pc < count; pc++) {
+			m_Labels[pc] = m_Asm.Here();
+			Emit(pc);
+		}
+		// running off the end returns empty, which the compiler never lets happen
+		m_Labels[count] = m_Asm.Here();
+		m_Asm.MovImm(RAX, uint64_t(JitCode::Exit));
+
+		auto epilogue = m_Asm.Here();
+		m_Asm.Pop(R12);
+		m_Asm.Pop(RBX);
+		m_Asm.Pop(RBP);
+		m_Asm.Ret();
+
+		for (auto& slow : m_SlowPaths) {
+			for (auto at : slow.Jumps)
+				m_Asm.Patch(at, m_Asm.Here());
+			Step(slow.Pc);
+		}
+		for (auto [at, pc] : m_Fixups)
+			m_Asm.Patch(at, m_Labels[pc]);
+		for (auto at : m_Exits)
+			m_Asm.Patch(at, epilogue);
+		return m_Asm.Code();
+	}
+
+private:
+	struct SlowPath {
+		int Pc;
+		vector<size_t> Jumps;
+	};
+
+	static int32_t Payload(int reg) noexcept {
+		return reg * int32_t(sizeof(Value));
+	}
+	static int32_t Type(int reg) noexcept {
+		return Payload(reg) + int32_t(offsetof(Value, m_Type));
+	}
+
+	static int64_t RunStep(JitContext* ctx, Value* R, int pc) noexcept {
+		return ctx->VM->Step(*ctx, R, pc);
+	}
+
+	void Emit(int pc) {
+		auto inst = m_Chunk.Code[pc];
+		switch (inst.Op) {
+			case OpCode::Nop:
+				return;
+
+			case OpCode::LoadConst:
+				if (auto& k = m_Chunk.Constants[inst.Bx]; k.IsInteger())
+					Load(pc, inst.A, ValueType::Integer, uint64_t(k.AsInteger()));
+				else if (k.IsReal())
+					Load(pc, inst.A, ValueType::Real, bit_cast<uint64_t>(k.AsReal()));
+				else if (k.IsBoolean())
+					Load(pc, inst.A, ValueType::Boolean, k.ToBoolean() ? 1 : 0);
+				else
+					Step(pc);
+				return;
+
+			case OpCode::LoadEmpty:
+				Load(pc, inst.A, ValueType::Empty, 0);
+				return;
+
+			case OpCode::LoadTrue:
+				Load(pc, inst.A, ValueType::Boolean, 1);
+				return;
+
+			case OpCode::LoadFalse:
+				Load(pc, inst.A, ValueType::Boolean, 0);
+				return;
+
+			case OpCode::Move:
+				if (inst.A == inst.B)
+					return;
+				BeginSlowPath(pc);
+				BailUnlessPlain(inst.B);
+				BailUnlessPlain(inst.A);
+				m_Asm.Load(RAX, RBX, Payload(inst.B));
+				m_Asm.Load(RCX, RBX, Payload(inst.B) + 8);
+				m_Asm.Store(RBX, Payload(inst.A), RAX);
+				m_Asm.Store(RBX, Payload(inst.A) + 8, RCX);
+				return;
+
+			case OpCode::ClearRegs:
+				// registers holding plain values are cleared in place, the rest by the VM
+				BeginSlowPath(pc);
+				for (int i = 0; i < inst.B; i++)
+					BailUnlessPlain(inst.A + i);
+				m_Asm.MovImm32(RAX, 0);
+				for (int i = 0; i < inst.B; i++)
+					Store(inst.A + i, RAX, ValueType::Empty);
+				return;
+
+			case OpCode::LoadName:
+				if (auto slot = static_cast<NameExpression const*>(m_Chunk.Origins[pc])->Slot(); slot.IsResolved()) {
+					LoadSlot(pc, inst.A, slot);
+					return;
+				}
+				break;
+
+			case OpCode::Assign:
+				if (auto expr = static_cast<AssignExpression const*>(m_Chunk.Origins[pc]); expr->Slot().IsResolved()) {
+					AssignSlot(pc, inst.A, expr->Slot(), expr->AssignType());
+					return;
+				}
+				break;
+
+			case OpCode::Add: case OpCode::Sub: case OpCode::Mul: case OpCode::Div:
+			case OpCode::Equal: case OpCode::NotEqual: case OpCode::Less: case OpCode::LessEqual:
+			case OpCode::Greater: case OpCode::GreaterEqual:
+				Arithmetic(pc, inst);
+				return;
+
+			case OpCode::Jump:
+				JumpTo(pc + 1 + inst.sBx);
+				return;
+
+			case OpCode::JumpIfFalse:
+			case OpCode::JumpIfTrue:
+				BeginSlowPath(pc);
+				BailUnless(inst.A, ValueType::Boolean);
+				m_Asm.CmpByte(RBX, Payload(inst.A), 0);
+				JumpTo(inst.Op == OpCode::JumpIfFalse ? Cond::Equal : Cond::NotEqual, pc + 1 + inst.sBx);
+				return;
+		}
+		Step(pc);
+	}
+
+	void Load(int pc, int reg, ValueType type, uint64_t payload) {
+		BeginSlowPath(pc);
+		BailUnlessPlain(reg);
+		m_Asm.MovImm(RAX, payload);
+		Store(reg, RAX, type);
+	}
+
+	//
+	// leaves the address of a resolved variable's slot in rdx, following the scope chain as
+	// Scope::SlotElement does. a slot whose declaration has not run yet has no name and takes the slow path
+	//
+	void FindSlot(SlotRef slot) {
+		m_Asm.Load(RDX, R12, int32_t(offsetof(JitContext, Scopes)));
+		m_Asm.Load(RDX, RDX, 0);
+		for (int depth = slot.Depth; depth > 0; --depth)
+			m_Asm.Load(RDX, RDX, int32_t(offsetof(Scope, m_Parent)));
+		m_Asm.Load(RDX, RDX, int32_t(offsetof(Scope, m_Slots)));
+		m_Asm.CmpDword(RDX, SlotAt(slot) + int32_t(offsetof(Scope::Slot, Name)), 0);
+		Bail(Cond::Equal);
+	}
+	static int32_t SlotAt(SlotRef slot) noexcept {
+		return slot.Index * int32_t(sizeof(Scope::Slot));
+	}
+	static int32_t SlotVar(SlotRef slot) noexcept {
+		return SlotAt(slot) + int32_t(offsetof(Scope::Slot, Var) + offsetof(Element, VarValue));
+	}
+
+	void LoadSlot(int pc, int reg, SlotRef slot) {
+		BeginSlowPath(pc);
+		BailUnlessPlain(reg);
+		FindSlot(slot);
+		BailUnlessPlain(RDX, SlotVar(slot));
+		m_Asm.Load(RAX, RDX, SlotVar(slot));
+		m_Asm.Load(RCX, RDX, SlotVar(slot) + 8);
+		m_Asm.Store(RBX, Payload(reg), RAX);
+		m_Asm.Store(RBX, Payload(reg) + 8, RCX);
+	}
+
+	//
+	// a plain assignment copies a plain value over a plain one; += and -= add and subtract integers in place.
+	// either way the register ends up holding the variable's new value
+	//
+	void AssignSlot(int pc, int reg, SlotRef slot, TokenType assign) {
+		if (assign != TokenType::Assign && assign != TokenType::Assign_Add && assign != TokenType::Assign_Sub) {
+			Step(pc);
+			return;
+		}
+		BeginSlowPath(pc);
+		FindSlot(slot);
+		auto var = SlotVar(slot);
+		if (assign == TokenType::Assign) {
+			BailUnlessPlain(reg);
+			BailUnlessPlain(RDX, var);
+			m_Asm.Load(RAX, RBX, Payload(reg));
+			m_Asm.Load(RCX, RBX, Payload(reg) + 8);
+			m_Asm.Store(RDX, var, RAX);
+			m_Asm.Store(RDX, var + 8, RCX);
+			return;
+		}
+		BailUnless(reg, ValueType::Integer);
+		m_Asm.CmpWord(RDX, var + int32_t(offsetof(Value, m_Type)), uint16_t(ValueType::Integer));
+		Bail(Cond::NotEqual);
+		m_Asm.Load(RAX, RDX, var);
+		m_Asm.Load(RCX, RBX, Payload(reg));
+		if (assign == TokenType::Assign_Add)
+			m_Asm.Add(RAX, RCX);
+		else
+			m_Asm.Sub(RAX, RCX);
+		m_Asm.Store(RDX, var, RAX);
+		m_Asm.Store(RBX, Payload(reg), RAX);
+	}
+
+	//
+	// an integer path, then a real one; mixed operands and everything else take the slow path.
+	// integer division may throw and real division by zero is an error value, both left to the VM
+	//
+	void Arithmetic(int pc, Dynamix::Instruction inst) {
+		BeginSlowPath(pc);
+		BailUnlessPlain(inst.A);
+
+		size_t real = 0;
+		if (inst.Op != OpCode::Div) {
+			m_Asm.CmpWord(RBX, Type(inst.B), uint16_t(ValueType::Integer));
+			real = m_Asm.Jcc(Cond::NotEqual);
+			BailUnless(inst.C, ValueType::Integer);
+			m_Asm.Load(RAX, RBX, Payload(inst.B));
+			m_Asm.Load(RCX, RBX, Payload(inst.C));
+			switch (inst.Op) {
+				case OpCode::Add:
+					m_Asm.Add(RAX, RCX);
+					Store(inst.A, RAX, ValueType::Integer);
+					break;
+				case OpCode::Sub:
+					m_Asm.Sub(RAX, RCX);
+					Store(inst.A, RAX, ValueType::Integer);
+					break;
+				case OpCode::Mul:
+					m_Asm.Imul(RAX, RCX);
+					Store(inst.A, RAX, ValueType::Integer);
+					break;
+				default:
+					m_Asm.Cmp(RAX, RCX);
+					m_Asm.SetCC(IntegerCondition(inst.Op), RAX);
+					m_Asm.MovzxByte(RAX, RAX);
+					Store(inst.A, RAX, ValueType::Boolean);
+					break;
+			}
+			JumpTo(pc + 1);
+			m_Asm.Patch(real, m_Asm.Here());
+		}
+
+		BailUnless(inst.B, ValueType::Real);
+		BailUnless(inst.C, ValueType::Real);
+		m_Asm.MovsdLoad(XMM0, RBX, Payload(inst.B));
+		m_Asm.MovsdLoad(XMM1, RBX, Payload(inst.C));
+		switch (inst.Op) {
+			case OpCode::Add:
+				m_Asm.Addsd(XMM0, XMM1);
+				break;
+			case OpCode::Sub:
+				m_Asm.Subsd(XMM0, XMM1);
+				break;
+			case OpCode::Mul:
+				m_Asm.Mulsd(XMM0, XMM1);
+				break;
+			case OpCode::Div:
+				// zero, or a NaN, compares equal here
+				m_Asm.Xorpd(XMM2, XMM2);
+				m_Asm.Ucomisd(XMM1, XMM2);
+				Bail(Cond::Equal);
+				m_Asm.Divsd(XMM0, XMM1);
+				break;
+
+			default:
+				RealCompare(inst.Op);
+				m_Asm.MovzxByte(RAX, RAX);
+				Store(inst.A, RAX, ValueType::Boolean);
+				return;
+		}
+		m_Asm.MovsdStore(RBX, Payload(inst.A), XMM0);
+		m_Asm.StoreWord(RBX, Type(inst.A), uint16_t(ValueType::Real));
+	}
+
+	static Cond IntegerCondition(OpCode op) noexcept {
+		switch (op) {
+			case OpCode::Equal: return Cond::Equal;
+			case OpCode::NotEqual: return Cond::NotEqual;
+			case OpCode::Less: return Cond::Less;
+			case OpCode::LessEqual: return Cond::LessEqual;
+			case OpCode::Greater: return Cond::Greater;
+		}
+		return Cond::GreaterEqual;
+	}
+
+	//
+	// leaves the result in al. ucomisd reports an unordered (NaN) operand as equal and below,
+	// so orderings compare with the operands swapped to come out false, as they do in C++
+	//
+	void RealCompare(OpCode op) {
+		switch (op) {
+			case OpCode::Equal:
+				m_Asm.Ucomisd(XMM0, XMM1);
+				m_Asm.SetCC(Cond::Equal, RAX);
+				m_Asm.SetCC(Cond::NoParity, RCX);
+				m_Asm.AndByte(RAX, RCX);
+				break;
+			case OpCode::NotEqual:
+				m_Asm.Ucomisd(XMM0, XMM1);
+				m_Asm.SetCC(Cond::NotEqual, RAX);
+				m_Asm.SetCC(Cond::Parity, RCX);
+				m_Asm.OrByte(RAX, RCX);
+				break;
+			case OpCode::Less:
+				m_Asm.Ucomisd(XMM1, XMM0);
+				m_Asm.SetCC(Cond::Above, RAX);
+				break;
+			case OpCode::LessEqual:
+				m_Asm.Ucomisd(XMM1, XMM0);
+				m_Asm.SetCC(Cond::AboveEqual, RAX);
+				break;
+			case OpCode::Greater:
+				m_Asm.Ucomisd(XMM0, XMM1);
+				m_Asm.SetCC(Cond::Above, RAX);
+				break;
+			default:
+				m_Asm.Ucomisd(XMM0, XMM1);
+				m_Asm.SetCC(Cond::AboveEqual, RAX);
+				break;
+		}
+	}
+
+	//
+	// runs the instruction through the VM and acts on the status it returns
+	//
+	void Step(int pc) {
+		auto inst = m_Chunk.Code[pc];
+		m_Asm.Mov(RDI, R12);
+		m_Asm.Mov(RSI, RBX);
+		m_Asm.MovImm32(RDX, uint32_t(pc));
+		m_Asm.MovImm(RAX, reinterpret_cast<uint64_t>(&RunStep));
+		m_Asm.CallReg(RAX);
+		m_Asm.Test(RAX, RAX);
+		JumpTo(Cond::Equal, pc + 1);
+		if (HasJump(inst.Op)) {
+			m_Asm.CmpImm(RAX, int8_t(JitCode::Jump));
+			JumpTo(Cond::Equal, pc + 1 + inst.sBx);
+		}
+		m_Exits.push_back(m_Asm.Jmp());
+	}
+
+	static bool HasJump(OpCode op) noexcept {
+		switch (op) {
+			case OpCode::TestVar:
+			case OpCode::Jump:
+			case OpCode::JumpIfFalse:
+			case OpCode::JumpIfTrue:
+			case OpCode::JumpIfError:
+			case OpCode::RepeatNext:
+			case OpCode::IterNext:
+				return true;
+		}
+		return false;
+	}
+
+	void JumpTo(int pc) {
+		m_Fixups.push_back({ m_Asm.Jmp(), pc });
+	}
+	void JumpTo(Cond cond, int pc) {
+		m_Fixups.push_back({ m_Asm.Jcc(cond), pc });
+	}
+
+	// the instruction being emitted gets a slow path; Bail jumps to it
+	void BeginSlowPath(int pc) {
+		m_SlowPaths.push_back({ pc });
+	}
+	void Bail(Cond cond) {
+		m_SlowPaths.back().Jumps.push_back(m_Asm.Jcc(cond));
+	}
+	void BailUnless(int reg, ValueType type) {
+		m_Asm.CmpWord(RBX, Type(reg), uint16_t(type));
+		Bail(Cond::NotEqual);
+	}
+	//
+	// an inline store must not drop a value that owns memory. empty, integer, real and boolean,
+	// types 1 to 8, are the ones that do not
+	//
+	void BailUnlessPlain(int reg) {
+		BailUnlessPlain(RBX, Payload(reg));
+	}
+	// the same for the value at [base + disp], using only rax
+	void BailUnlessPlain(Reg base, int32_t disp) {
+		m_Asm.LoadWord(RAX, base, disp + int32_t(offsetof(Value, m_Type)));
+		m_Asm.SubImm32(RAX, 1);
+		m_Asm.CmpImm32(RAX, 7);
+		Bail(Cond::Above);
+	}
+	void Store(int reg, Reg value, ValueType type) {
+		m_Asm.Store(RBX, Payload(reg), value);
+		m_Asm.StoreWord(RBX, Type(reg), uint16_t(type));
+	}
+
+	CodeChunk const& m_Chunk;
+	Assembler m_Asm;
+	vector<size_t> m_Labels;
+	vector<pair<size_t, int>> m_Fixups;
+	vector<size_t> m_Exits;
+	vector<SlowPath> m_SlowPaths;
+};
+
+#endif
+
+JitCode::JitCode(void* memory, size_t size, size_t codeSize) noexcept
+	: m_Memory(memory), m_Size(size), m_CodeSize(codeSize), m_Entry(reinterpret_cast<Entry>(memory)) {
+}
+
+JitCode::~JitCode() {
+#ifdef DYNAMIX_JIT
+	munmap(m_Memory, m_Size);
+#endif
+}
+
+Jit::~Jit() {
+	EnablePerfMap(false);
+}
+
+bool Jit::IsSupported() noexcept {
+#ifdef DYNAMIX_JIT
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool Jit::Compile(CodeChunk const& chunk, AstNode const* body) {
+#ifdef DYNAMIX_JIT
+	Builder builder(chunk);
+	auto& code = builder.Build();
+	//
+	// written while writable, then sealed to read and execute
+	//
+	auto page = size_t(sysconf(_SC_PAGESIZE));
+	auto size = (code.size() + page - 1) / page * page;
+	auto memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (memory != MAP_FAILED) {
+		memcpy(memory, code.data(), code.size());
+		if (mprotect(memory, size, PROT_READ | PROT_EXEC) == 0) {
+			chunk.Native = make_shared<JitCode>(memory, size, code.size());
+			m_Compiled++;
+			if (m_PerfMap) {
+				auto& loc = body->Location();
+				auto line = format("{:x} {:x} dynamix::{}:{}:{}\n", reinterpret_cast<uintptr_t>(memory), code.size(),
+					loc.File.IsEmpty() ? "<code>" : loc.FileName(), loc.Line, loc.Col);
+				fputs(line.c_str(), m_PerfMap);
+				fflush(m_PerfMap);
+			}
+			return true;
+		}
+		munmap(memory, size);
+	}
+#endif
+	chunk.Hotness = INT_MIN;
+	return false;
+}
+
+void Jit::EnablePerfMap(bool enable) {
+	if (!enable) {
+		if (m_PerfMap)
+			fclose(m_PerfMap);
+		m_PerfMap = nullptr;
+	}
+#ifdef DYNAMIX_JIT
+	else if (!m_PerfMap) {
+		m_PerfMap = fopen(PerfMapPath().c_str(), "a");
+	}
+#endif
+}
+
+string Jit::PerfMapPath() const {
+#ifdef DYNAMIX_JIT
+	return format("/tmp/perf-{}.map", getpid());
+#else
+	return "";
+#endif
+}
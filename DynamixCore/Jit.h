@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <string>
+
+#include "Bytecode.h"
+#include "NoCopyMove.h"
+
+//
+// the baseline JIT generates x86-64 code for the System V calling convention,
+// against the 16 byte Value layout
+//
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__linux__) && !defined(DYNAMIX_NAN_BOXING)
+#define DYNAMIX_JIT
+#endif
+
+namespace Dynamix {
+	class AstNode;
+	class Scope;
+	class VirtualMachine;
+
+	//
+	// what machine code and the VM's slow path share while a compiled chunk runs
+	//
+	struct JitContext {
+		VirtualMachine* VM;
+		CodeChunk const* Chunk;
+		Scope* const* Scopes;
+		Value Result;
+		std::exception_ptr Error;
+		int ResumePc{ 0 };
+	};
+
+	//
+	// machine code compiled from a function body's bytecode, in executable memory of its own
+	//
+	class JitCode final : NoCopy {
+	public:
+		//
+		// status returned by the code and by VirtualMachine::Step, the slow path it calls:
+		// Exit leaves Result, Failed leaves Error, Resume hands the rest of the call to the VM at ResumePc
+		//
+		enum Status : int64_t {
+			Continue = 0,
+			Jump = 1,
+			Exit = -1,
+			Failed = -2,
+			Resume = -3,
+		};
+
+		using Entry = int64_t(*)(Value* R, JitContext* ctx);
+
+		JitCode(void* memory, size_t size, size_t codeSize) noexcept;
+		~JitCode();
+
+		int64_t Run(Value* R, JitContext& ctx) const {
+			return m_Entry(R, &ctx);
+		}
+		void const* Address() const noexcept {
+			return m_Memory;
+		}
+		size_t Size() const noexcept {
+			return m_CodeSize;
+		}
+
+	private:
+		void* m_Memory;
+		size_t m_Size;
+		size_t m_CodeSize;
+		Entry m_Entry;
+	};
+
+	//
+	// compiles hot function bodies, picked by the VM's call and loop counters.
+	// integer and real arithmetic, comparisons, constants, moves, branches and resolved local variables
+	// run inline behind type guards;
+	// everything else, and every failed guard, runs that one instruction through the VM
+	//
+	class Jit final : NoCopy {
+	public:
+		// calls of a function body, each back edge of its loops counting as one call, before it is compiled
+		static constexpr int HotThreshold = 1000;
+
+		static bool IsSupported() noexcept;
+
+		Jit() = default;
+		~Jit();
+
+		// returns false if the chunk could not be compiled; it is not tried again
+		bool Compile(CodeChunk const& chunk, AstNode const* body);
+
+		// records compiled code in /tmp/perf-<pid>.map so perf can name its frames
+		void EnablePerfMap(bool enable);
+		std::string PerfMapPath() const;
+
+		int CompiledCount() const noexcept {
+			return m_Compiled;
+		}
+
+	private:
+		class Builder;
+
+		FILE* m_PerfMap{ nullptr };
+		int m_Compiled{ 0 };
+	};
+}
@@ -0,0 +1,131 @@
+#include <string>
+
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Dynamix;
+using namespace std;
+
+namespace {
+	size_t PageSize() noexcept {
+#ifdef _WIN32
+		SYSTEM_INFO info;
+		::GetSystemInfo(&info);
+		return info.dwPageSize;
+#else
+		return size_t(::sysconf(_SC_PAGESIZE));
+#endif
+	}
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+bool MappedFile::Open(string_view path) {
+	Close();
+	string name(path);
+#ifdef _WIN32
+	auto hFile = ::CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER size;
+	if (!::GetFileSizeEx(hFile, &size)) {
+		::CloseHandle(hFile);
+		return false;
+	}
+	m_Size = size_t(size.QuadPart);
+	void* data = nullptr;
+	if (m_Size > 0) {
+		// the view keeps the mapping alive after the handles are closed
+		if (auto hMap = ::CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr)) {
+			data = ::MapViewOfFile(hMap, FILE_MAP_READ, 0, 0, 0);
+			::CloseHandle(hMap);
+		}
+	}
+	::CloseHandle(hFile);
+#else
+	auto fd = ::open(name.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		return false;
+	}
+	m_Size = size_t(st.st_size);
+	if (m_Size > 0 && m_Size <= CopyLimit) {
+		// a copy can't fault if the file shrinks while it is read
+		auto copy = make_unique<char[]>(m_Size + 1);
+		size_t done = 0;
+		while (done < m_Size) {
+			auto n = ::read(fd, copy.get() + done, m_Size - done);
+			if (n < 0 && errno == EINTR)
+				continue;
+			if (n < 0) {
+				::close(fd);
+				m_Size = 0;
+				return false;
+			}
+			// a file cut short since fstat is read as far as it goes
+			if (n == 0)
+				break;
+			done += size_t(n);
+		}
+		::close(fd);
+		copy[done] = 0;
+		m_Size = done;
+		m_Copy = move(copy);
+		m_Data = m_Copy.get();
+		return true;
+	}
+	void* data = nullptr;
+	if (m_Size > 0) {
+		data = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED)
+			data = nullptr;
+	}
+	::close(fd);
+#endif
+	if (m_Size == 0) {
+		// nothing to map
+		m_Data = "";
+		return true;
+	}
+	if (!data) {
+		m_Size = 0;
+		return false;
+	}
+	m_Data = static_cast<const char*>(data);
+	m_Mapped = true;
+	return true;
+}
+
+void MappedFile::Close() noexcept {
+	if (m_Mapped) {
+#ifdef _WIN32
+		::UnmapViewOfFile(m_Data);
+#else
+		::munmap(const_cast<char*>(m_Data), m_Size);
+#endif
+	}
+	m_Copy.reset();
+	m_Data = nullptr;
+	m_Size = 0;
+	m_Mapped = false;
+}
+
+bool MappedFile::IsTerminated() const noexcept {
+	static const auto pageSize = PageSize();
+	return m_Data && (!m_Mapped || m_Size % pageSize != 0);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+#include "NoCopyMove.h"
+
+namespace Dynamix {
+	//
+	// a file mapped read-only into memory; processes that map the same file share its pages.
+	// small files are read into memory instead: a mapped file truncated by another process
+	// faults on the pages past its new end, and at that size reading costs no more than mapping
+	//
+	class MappedFile final : NoCopy {
+	public:
+		static constexpr size_t CopyLimit = 256 << 10;
+
+		MappedFile() = default;
+		~MappedFile();
+
+		bool Open(std::string_view path);
+		void Close() noexcept;
+
+		bool IsOpen() const noexcept {
+			return m_Data != nullptr;
+		}
+		const char* Data() const noexcept {
+			return m_Data;
+		}
+		size_t Size() const noexcept {
+			return m_Size;
+		}
+		std::string_view View() const noexcept {
+			return { m_Data, m_Size };
+		}
+
+		// copies are followed by a NUL; in a mapping the rest of the last page reads as zeros,
+		// unless the file ends exactly on a page boundary
+		bool IsTerminated() const noexcept;
+
+	private:
+		const char* m_Data{ nullptr };
+		size_t m_Size{ 0 };
+		bool m_Mapped{ false };
+		std::unique_ptr<char[]> m_Copy;
+	};
+}
@@ -0,0 +1,874 @@
+#include <bit>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include "ModuleCache.h"
+#include "MappedFile.h"
+#include "AstNode.h"
+#include "Resolver.h"
+
+using namespace Dynamix;
+using namespace std;
+
+namespace {
+	//
+	// the file starts with the header, then the string table and the root Statements.
+	// numbers are LEB128 varints, signed ones zigzagged; strings and names are indices into the table.
+	// each node is its AstNodeType, its location (line, column, file), then its fields and children in order;
+	// a missing child is AstNodeType::None
+	//
+	struct ModuleHeader {
+		char Magic[4];
+		uint32_t Version;
+		uint64_t SourceHash;
+		uint64_t SourceSize;
+		uint64_t Size;
+		uint32_t Passes;
+		uint32_t Strings;
+	};
+
+	constexpr char Magic[4] = { 'D', 'X', 'C', 0 };
+
+	enum class LiteralKind : uint8_t {
+		Empty,
+		Integer,
+		Real,
+		Boolean,
+		String,
+	};
+
+	// a module that cannot be written or read; the file is parsed instead
+	struct BadModule {};
+
+	uint64_t HashText(string_view text) noexcept {
+		// FNV-1a
+		uint64_t hash = 0xcbf29ce484222325;
+		for (auto ch : text) {
+			hash ^= uint8_t(ch);
+			hash *= 0x100000001b3;
+		}
+		return hash;
+	}
+
+	class ModuleWriter final : public Visitor {
+	public:
+		vector<char> Write(Statements const* root, uint64_t sourceHash, uint64_t sourceSize, OptimizerPasses passes) {
+			WriteNode(root);
+
+			vector<char> module(sizeof(ModuleHeader));
+			for (auto& str : m_Strings) {
+				Encode(module, str.size());
+				module.insert(module.end(), str.begin(), str.end());
+			}
+			module.insert(module.end(), m_Nodes.begin(), m_Nodes.end());
+
+			ModuleHeader header{};
+			memcpy(header.Magic, Magic, sizeof(Magic));
+			header.Version = ModuleCache::Version;
+			header.SourceHash = sourceHash;
+			header.SourceSize = sourceSize;
+			header.Size = module.size();
+			header.Passes = static_cast<uint32_t>(passes);
+			header.Strings = static_cast<uint32_t>(m_Strings.size());
+			memcpy(module.data(), &header, sizeof(header));
+			return module;
+		}
+
+		Value VisitLiteral(LiteralExpression const* expr) override {
+			Begin(AstNodeType::Literal, expr);
+			auto& value = expr->Literal();
+			switch (value.Type()) {
+				case ValueType::Empty:
+					WriteByte(LiteralKind::Empty);
+					break;
+				case ValueType::Integer:
+					WriteByte(LiteralKind::Integer);
+					WriteSigned(value.AsInteger());
+					break;
+				case ValueType::Real:
+				{
+					WriteByte(LiteralKind::Real);
+					auto bits = bit_cast<uint64_t>(value.AsReal());
+					for (int i = 0; i < 8; i++)
+						m_Nodes.push_back(char(bits >> (i * 8)));
+					break;
+				}
+				case ValueType::Boolean:
+					WriteByte(LiteralKind::Boolean);
+					WriteNumber(value.ToBoolean() ? 1 : 0);
+					break;
+				case ValueType::String:
+					WriteByte(LiteralKind::String);
+					WriteString(value.ToString());
+					break;
+				default:
+					// objects folded into the tree have no encoding
+					throw BadModule();
+			}
+			return Value();
+		}
+
+		Value VisitBinary(BinaryExpression const* expr) override {
+			Begin(AstNodeType::Binary, expr);
+			WriteNode(expr->Left());
+			WriteNumber(expr->Operator());
+			WriteNode(expr->Right());
+			return Value();
+		}
+
+		Value VisitUnary(UnaryExpression const* expr) override {
+			Begin(AstNodeType::Unary, expr);
+			WriteNumber(expr->Operator());
+			WriteNode(expr->Arg());
+			return Value();
+		}
+
+		Value VisitName(NameExpression const* expr) override {
+			Begin(AstNodeType::Name, expr);
+			WriteString(expr->Name());
+			return Value();
+		}
+
+		Value VisitVar(VarValStatement const* stmt) override {
+			Begin(AstNodeType::VarValStatement, stmt);
+			WriteString(stmt->Name());
+			WriteNumber(stmt->Flags());
+			WriteNode(stmt->Init());
+			return Value();
+		}
+
+		Value VisitAssign(AssignExpression const* expr) override {
+			Begin(AstNodeType::Assign, expr);
+			WriteString(expr->Lhs());
+			WriteNumber(expr->AssignType());
+			WriteNode(expr->Value());
+			return Value();
+		}
+
+		Value VisitInvokeFunction(InvokeFunctionExpression const* expr) override {
+			Begin(AstNodeType::InvokeFunction, expr);
+			WriteNode(expr->Callable());
+			WriteNodes(expr->Arguments());
+			return Value();
+		}
+
+		Value VisitRepeat(RepeatStatement const* stmt) override {
+			Begin(AstNodeType::Repeat, stmt);
+			WriteNode(stmt->Times());
+			WriteNode(stmt->Body());
+			return Value();
+		}
+
+		Value VisitWhile(WhileStatement const* stmt) override {
+			Begin(AstNodeType::While, stmt);
+			WriteNode(stmt->Condition());
+			WriteNode(stmt->Body());
+			return Value();
+		}
+
+		Value VisitIfThenElse(IfThenElseExpression const* expr) override {
+			Begin(AstNodeType::IfThenElse, expr);
+			WriteNode(expr->Condition());
+			WriteNode(expr->Then());
+			WriteNode(expr->Else());
+			return Value();
+		}
+
+		Value VisitFunctionDeclaration(FunctionDeclaration const* decl) override {
+			Begin(AstNodeType::FunctionDeclaration, decl);
+			WriteString(decl->Name());
+			WriteNumber((decl->IsMethod() ? 1 : 0) | (decl->IsStatic() ? 2 : 0));
+			WriteFunction(decl);
+			return Value();
+		}
+
+		Value VisitReturn(ReturnStatement const* stmt) override {
+			Begin(AstNodeType::Return, stmt);
+			WriteNode(stmt->ReturnValue());
+			return Value();
+		}
+
+		Value VisitBreakContinue(BreakOrContinueStatement const* stmt) override {
+			Begin(AstNodeType::BreakContinue, stmt);
+			WriteNumber(stmt->BreakType());
+			return Value();
+		}
+
+		Value VisitFor(ForStatement const* stmt) override {
+			Begin(AstNodeType::For, stmt);
+			WriteNode(stmt->Init());
+			WriteNode(stmt->While());
+			WriteNode(stmt->Inc());
+			WriteNode(stmt->Body());
+			return Value();
+		}
+
+		Value VisitStatements(Statements const* stmts) override {
+			Begin(AstNodeType::Statements, stmts);
+			WriteNodes(stmts->All());
+			return Value();
+		}
+
+		Value VisitAnonymousFunction(AnonymousFunctionExpression const* func) override {
+			Begin(AstNodeType::AnonymousFunction, func);
+			WriteFunction(func);
+			return Value();
+		}
+
+		Value VisitEnumDeclaration(EnumDeclaration const* decl) override {
+			Begin(AstNodeType::EnumDeclararion, decl);
+			WriteString(decl->Name());
+			WriteNumber(decl->Values().size());
+			for (auto& [name, value] : decl->Values()) {
+				WriteString(name.ToString());
+				WriteSigned(value);
+			}
+			return Value();
+		}
+
+		Value VisitExpressionStatement(ExpressionStatement const* stmt) override {
+			Begin(AstNodeType::ExpressionStatement, stmt);
+			WriteNumber(stmt->HasSemicolon() ? 1 : 0);
+			WriteNode(stmt->Expr());
+			return Value();
+		}
+
+		Value VisitArrayExpression(ArrayExpression const* expr) override {
+			Begin(AstNodeType::Array, expr);
+			WriteNodes(expr->Items());
+			return Value();
+		}
+
+		Value VisitGetMember(GetMemberExpression const* expr) override {
+			Begin(AstNodeType::GetMember, expr);
+			WriteNode(expr->Left());
+			WriteString(expr->Member());
+			WriteNumber(expr->Operator());
+			return Value();
+		}
+
+		Value VisitAccessArray(AccessArrayExpression const* expr) override {
+			Begin(AstNodeType::ArrayAccess, expr);
+			WriteNode(expr->Left());
+			WriteNode(expr->Index());
+			return Value();
+		}
+
+		Value VisitAssignArrayIndex(AssignArrayIndexExpression const* expr) override {
+			Begin(AstNodeType::AssignArrayIndex, expr);
+			WriteNode(expr->ArrayAccess());
+			WriteNumber(expr->AssignType());
+			WriteNode(expr->Value());
+			return Value();
+		}
+
+		Value VisitClassDeclaration(ClassDeclaration const* decl) override {
+			Begin(AstNodeType::ClassDeclaration, decl);
+			WriteString(decl->Name());
+			WriteString(decl->BaseName());
+			WriteStrings(decl->Interfaces());
+			WriteNodes(decl->Methods());
+			WriteNodes(decl->Fields());
+			WriteNodes(decl->Types());
+			return Value();
+		}
+
+		Value VisitNewObjectExpression(NewObjectExpression const* expr) override {
+			Begin(AstNodeType::NewObject, expr);
+			WriteString(expr->ClassName());
+			WriteNodes(expr->Arguments());
+			WriteNumber(expr->FieldInitializers().size());
+			for (auto& init : expr->FieldInitializers()) {
+				WriteString(init.Name.ToString());
+				WriteNode(init.Init.get());
+			}
+			return Value();
+		}
+
+		Value VisitAssignField(AssignFieldExpression const* expr) override {
+			Begin(AstNodeType::AssignField, expr);
+			WriteNode(expr->Lhs());
+			WriteNumber(expr->AssignType());
+			WriteNode(expr->Value());
+			return Value();
+		}
+
+		Value VisitForEach(ForEachStatement const* stmt) override {
+			Begin(AstNodeType::ForEach, stmt);
+			WriteString(stmt->Name());
+			WriteNode(stmt->Collection());
+			WriteNode(stmt->Body());
+			return Value();
+		}
+
+		Value VisitRange(RangeExpression const* expr) override {
+			Begin(AstNodeType::Range, expr);
+			WriteNode(expr->Start());
+			WriteNode(expr->End());
+			WriteNumber(expr->EndInclusive() ? 1 : 0);
+			return Value();
+		}
+
+		Value VisitMatch(MatchExpression const* expr) override {
+			Begin(AstNodeType::Match, expr);
+			WriteNode(expr->ToMatch());
+			WriteNumber(expr->HasDefault() ? 1 : 0);
+			WriteNumber(expr->MatchCases().size());
+			for (auto& matchCase : expr->MatchCases()) {
+				WriteNode(matchCase.Action());
+				WriteNodes(matchCase.Cases());
+			}
+			return Value();
+		}
+
+		Value VisitUse(UseStatement const* use) override {
+			Begin(AstNodeType::Use, use);
+			WriteString(use->Name());
+			WriteNumber(use->Type());
+			return Value();
+		}
+
+	private:
+		void WriteNode(AstNode const* node) {
+			if (node == nullptr)
+				WriteNumber(AstNodeType::None);
+			else if (node->NodeType() == AstNodeType::InterfaceDeclaration)
+				// interfaces have no visitor method
+				WriteInterface(static_cast<InterfaceDeclaration const*>(node));
+			else
+				node->Accept(this);
+		}
+
+		template<typename T>
+		void WriteNodes(AstVector<unique_ptr<T>> const& nodes) {
+			WriteNumber(nodes.size());
+			for (auto& node : nodes)
+				WriteNode(node.get());
+		}
+
+		void WriteInterface(InterfaceDeclaration const* decl) {
+			Begin(AstNodeType::InterfaceDeclaration, decl);
+			WriteString(decl->Name());
+			WriteStrings(decl->BaseNames());
+			WriteNodes(decl->Methods());
+		}
+
+		void WriteFunction(FunctionEssentials const* func) {
+			WriteNumber(func->Parameters().size());
+			for (auto& param : func->Parameters()) {
+				WriteString(param.Name.ToString());
+				WriteNumber(param.Flags);
+				WriteNode(param.DefaultValue.get());
+			}
+			WriteNode(func->Body());
+		}
+
+		void Begin(AstNodeType type, AstNode const* node) {
+			WriteNumber(type);
+			auto& loc = node->Location();
+			WriteNumber(uint32_t(loc.Line));
+			WriteNumber(uint32_t(loc.Col));
+			WriteString(loc.FileName());
+		}
+
+		template<typename T>
+		static void Encode(vector<char>& out, T value) {
+			auto n = uint64_t(value);
+			while (n >= 0x80) {
+				out.push_back(char(n | 0x80));
+				n >>= 7;
+			}
+			out.push_back(char(n));
+		}
+
+		template<typename T>
+		void WriteNumber(T value) {
+			Encode(m_Nodes, value);
+		}
+
+		void WriteSigned(int64_t value) {
+			WriteNumber((uint64_t(value) << 1) ^ uint64_t(value >> 63));
+		}
+
+		void WriteByte(LiteralKind kind) {
+			m_Nodes.push_back(char(kind));
+		}
+
+		void WriteString(string const& str) {
+			auto [it, added] = m_StringIndex.try_emplace(str, uint32_t(m_Strings.size()));
+			if (added)
+				m_Strings.push_back(str);
+			WriteNumber(it->second);
+		}
+
+		void WriteStrings(AstVector<Atom> const& names) {
+			WriteNumber(names.size());
+			for (auto name : names)
+				WriteString(name.ToString());
+		}
+
+		vector<char> m_Nodes;
+		vector<string> m_Strings;
+		unordered_map<string, uint32_t> m_StringIndex;
+	};
+
+	class ModuleReader final {
+	public:
+		ModuleReader(const char* data, size_t size, uint32_t strings) : m_Next(data), m_End(data + size) {
+			// every string is interned up front; nodes keep names as atoms anyway
+			m_Atoms.reserve(strings);
+			for (uint32_t i = 0; i < strings; i++) {
+				auto len = ReadNumber();
+				if (len > size_t(m_End - m_Next))
+					throw BadModule();
+				m_Atoms.emplace_back(string_view(m_Next, len));
+				m_Next += len;
+			}
+		}
+
+		void ReadRoot(Statements* root) {
+			if (ReadType() != AstNodeType::Statements)
+				throw BadModule();
+			root->SetLocation(ReadLocation());
+			ReadStatements(root);
+			if (m_Next != m_End)
+				throw BadModule();
+		}
+
+	private:
+		template<typename T>
+		unique_ptr<T> Read() {
+			auto type = ReadType();
+			if (type == AstNodeType::None)
+				return nullptr;
+
+			auto loc = ReadLocation();
+			auto node = ReadFields(type);
+			node->SetLocation(loc);
+			// every node is an expression, and the type says which are statements; others are checked
+			T* typed;
+			if constexpr (is_same_v<T, Expression>)
+				typed = static_cast<T*>(node.get());
+			else if constexpr (is_same_v<T, Statement>)
+				typed = (type & AstNodeType::Statement) == AstNodeType::Statement ? static_cast<T*>(node.get()) : nullptr;
+			else
+				typed = dynamic_cast<T*>(node.get());
+			if (typed == nullptr)
+				throw BadModule();
+			node.release();
+			return unique_ptr<T>(typed);
+		}
+
+		template<typename T>
+		vector<unique_ptr<T>> ReadNodes() {
+			vector<unique_ptr<T>> nodes(ReadCount());
+			for (auto& node : nodes)
+				node = Read<T>();
+			return nodes;
+		}
+
+		unique_ptr<AstNode> ReadFields(AstNodeType type) {
+			switch (type) {
+				case AstNodeType::Literal:
+					return make_unique<LiteralExpression>(ReadLiteral());
+
+				case AstNodeType::Binary:
+				{
+					auto left = Read<Expression>();
+					auto op = ReadToken();
+					return make_unique<BinaryExpression>(move(left), op, Read<Expression>());
+				}
+				case AstNodeType::Unary:
+				{
+					auto op = ReadToken();
+					return make_unique<UnaryExpression>(op, Read<Expression>());
+				}
+				case AstNodeType::Name:
+					return make_unique<NameExpression>(ReadAtom());
+
+				case AstNodeType::VarValStatement:
+				{
+					auto name = ReadAtom();
+					auto flags = SymbolFlags(ReadNumber());
+					return make_unique<VarValStatement>(name, flags, Read<Expression>());
+				}
+				case AstNodeType::Assign:
+				{
+					auto lhs = ReadAtom();
+					auto op = ReadToken();
+					return make_unique<AssignExpression>(lhs, Read<Expression>(), op);
+				}
+				case AstNodeType::InvokeFunction:
+				{
+					auto callable = Read<Expression>();
+					return make_unique<InvokeFunctionExpression>(move(callable), ReadNodes<Expression>());
+				}
+				case AstNodeType::Repeat:
+				{
+					auto times = Read<Expression>();
+					return make_unique<RepeatStatement>(move(times), Read<Statement>());
+				}
+				case AstNodeType::While:
+				{
+					auto condition = Read<Expression>();
+					return make_unique<WhileStatement>(move(condition), Read<Statement>());
+				}
+				case AstNodeType::IfThenElse:
+				{
+					auto condition = Read<Expression>();
+					auto then = Read<Statement>();
+					return make_unique<IfThenElseExpression>(move(condition), move(then), Read<Statement>());
+				}
+				case AstNodeType::FunctionDeclaration:
+					return ReadFunctionDeclaration();
+
+				case AstNodeType::Return:
+					return make_unique<ReturnStatement>(Read<Expression>());
+
+				case AstNodeType::BreakContinue:
+					return make_unique<BreakOrContinueStatement>(ReadToken());
+
+				case AstNodeType::For:
+				{
+					auto init = Read<Statement>();
+					auto whileExpr = Read<Expression>();
+					auto inc = Read<Expression>();
+					return make_unique<ForStatement>(move(init), move(whileExpr), move(inc), Read<Statement>());
+				}
+				case AstNodeType::Statements:
+				{
+					auto block = make_unique<Statements>();
+					ReadStatements(block.get());
+					return block;
+				}
+				case AstNodeType::AnonymousFunction:
+				{
+					auto params = ReadParameters();
+					return make_unique<AnonymousFunctionExpression>(move(params), Read<Expression>());
+				}
+				case AstNodeType::EnumDeclararion:
+				{
+					auto name = ReadString();
+					unordered_map<string, long long> values;
+					for (auto count = ReadCount(); count > 0; count--) {
+						auto valueName = ReadString();
+						values.emplace(move(valueName), ReadSigned());
+					}
+					return make_unique<EnumDeclaration>(move(name), move(values));
+				}
+				case AstNodeType::ExpressionStatement:
+				{
+					auto semicolon = ReadNumber() != 0;
+					auto expr = Read<Expression>();
+					if (expr == nullptr)
+						throw BadModule();
+					return make_unique<ExpressionStatement>(move(expr), semicolon);
+				}
+				case AstNodeType::Array:
+				{
+					auto array = make_unique<ArrayExpression>();
+					for (auto& item : ReadNodes<Expression>())
+						array->Add(move(item));
+					return array;
+				}
+				case AstNodeType::GetMember:
+				{
+					auto left = Read<Expression>();
+					auto member = ReadAtom();
+					return make_unique<GetMemberExpression>(move(left), member, ReadToken());
+				}
+				case AstNodeType::ArrayAccess:
+				{
+					auto left = Read<Expression>();
+					return make_unique<AccessArrayExpression>(move(left), Read<Expression>());
+				}
+				case AstNodeType::AssignArrayIndex:
+				{
+					auto access = Read<AccessArrayExpression>();
+					auto op = ReadToken();
+					return make_unique<AssignArrayIndexExpression>(move(access), Read<Expression>(), op);
+				}
+				case AstNodeType::ClassDeclaration:
+					return ReadClass(nullptr);
+
+				case AstNodeType::NewObject:
+				{
+					auto className = ReadAtom();
+					auto args = ReadNodes<Expression>();
+					vector<FieldInitializer> inits(ReadCount());
+					for (auto& init : inits) {
+						init.Name = ReadAtom();
+						init.Init = Read<Expression>();
+					}
+					return make_unique<NewObjectExpression>(move(className), move(args), move(inits));
+				}
+				case AstNodeType::AssignField:
+				{
+					auto lhs = Read<GetMemberExpression>();
+					auto op = ReadToken();
+					return make_unique<AssignFieldExpression>(move(lhs), Read<Expression>(), op);
+				}
+				case AstNodeType::ForEach:
+				{
+					auto name = ReadAtom();
+					auto collection = Read<Expression>();
+					return make_unique<ForEachStatement>(name, move(collection), Read<Statement>());
+				}
+				case AstNodeType::Range:
+				{
+					auto start = Read<Expression>();
+					auto end = Read<Expression>();
+					return make_unique<RangeExpression>(move(start), move(end), ReadNumber() != 0);
+				}
+				case AstNodeType::Match:
+				{
+					auto match = make_unique<MatchExpression>(Read<Expression>());
+					if (ReadNumber() != 0)
+						match->SetHasDefault();
+					for (auto count = ReadCount(); count > 0; count--) {
+						MatchCaseExpression matchCase(Read<Statements>());
+						matchCase.SetCases(ReadNodes<Expression>());
+						match->AddMatchCase(move(matchCase));
+					}
+					return match;
+				}
+				case AstNodeType::Use:
+				{
+					auto name = ReadString();
+					return make_unique<UseStatement>(move(name), UseType(ReadNumber()));
+				}
+				case AstNodeType::InterfaceDeclaration:
+				{
+					auto decl = make_unique<InterfaceDeclaration>(ReadString());
+					for (auto count = ReadCount(); count > 0; count--)
+						decl->AddBaseInterface(ReadString());
+					decl->SetMethods(ReadNodes<FunctionDeclaration>());
+					return decl;
+				}
+			}
+			throw BadModule();
+		}
+
+		void ReadStatements(Statements* block) {
+			for (auto& stmt : ReadNodes<Statement>()) {
+				if (stmt == nullptr)
+					throw BadModule();
+				block->Add(move(stmt));
+			}
+		}
+
+		unique_ptr<FunctionDeclaration> ReadFunctionDeclaration() {
+			auto name = ReadString();
+			auto flags = ReadNumber();
+			auto decl = make_unique<FunctionDeclaration>(move(name), (flags & 1) != 0, (flags & 2) != 0);
+			decl->SetParameters(ReadParameters());
+			decl->SetBody(Read<Expression>());
+			return decl;
+		}
+
+		unique_ptr<ClassDeclaration> ReadClass(ClassDeclaration const* parent) {
+			auto decl = make_unique<ClassDeclaration>(ReadString(), parent);
+			decl->SetBaseType(ReadString());
+			for (auto count = ReadCount(); count > 0; count--)
+				decl->AddInterface(ReadString());
+			decl->SetMethods(ReadNodes<FunctionDeclaration>());
+			decl->SetFields(ReadNodes<Statement>());
+			// nested classes know the class they are declared in
+			vector<unique_ptr<ClassDeclaration>> types(ReadCount());
+			for (auto& type : types) {
+				if (ReadType() != AstNodeType::ClassDeclaration)
+					throw BadModule();
+				auto loc = ReadLocation();
+				type = ReadClass(decl.get());
+				type->SetLocation(loc);
+			}
+			decl->SetTypes(move(types));
+			return decl;
+		}
+
+		vector<Parameter> ReadParameters() {
+			vector<Parameter> params(ReadCount());
+			for (auto& param : params) {
+				param.Name = ReadAtom();
+				param.Flags = ParameterFlags(ReadNumber());
+				param.DefaultValue = Read<Expression>();
+			}
+			return params;
+		}
+
+		Value ReadLiteral() {
+			auto kind = LiteralKind(ReadByte());
+			switch (kind) {
+				case LiteralKind::Empty:
+					return Value();
+				case LiteralKind::Integer:
+					return Value(Int(ReadSigned()));
+				case LiteralKind::Real:
+				{
+					uint64_t bits = 0;
+					for (int i = 0; i < 8; i++)
+						bits |= uint64_t(ReadByte()) << (i * 8);
+					return Value(bit_cast<Real>(bits));
+				}
+				case LiteralKind::Boolean:
+					return Value(Bool(ReadNumber() != 0));
+				case LiteralKind::String:
+					return Value(string_view(ReadAtom().ToString()));
+			}
+			throw BadModule();
+		}
+
+		CodeLocation ReadLocation() {
+			auto line = int(ReadNumber());
+			auto col = int(ReadNumber());
+			return CodeLocation{ line, col, ReadAtom() };
+		}
+
+		AstNodeType ReadType() {
+			return AstNodeType(ReadNumber());
+		}
+
+		TokenType ReadToken() {
+			return TokenType(ReadNumber());
+		}
+
+		uint8_t ReadByte() {
+			if (m_Next == m_End)
+				throw BadModule();
+			return uint8_t(*m_Next++);
+		}
+
+		uint64_t ReadNumber() {
+			uint64_t n = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				auto byte = ReadByte();
+				n |= uint64_t(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0)
+					return n;
+			}
+			throw BadModule();
+		}
+
+		int64_t ReadSigned() {
+			auto n = ReadNumber();
+			return int64_t(n >> 1) ^ -int64_t(n & 1);
+		}
+
+		// a count of items that each take at least a byte
+		size_t ReadCount() {
+			auto count = ReadNumber();
+			if (count > uint64_t(m_End - m_Next))
+				throw BadModule();
+			return size_t(count);
+		}
+
+		Atom ReadAtom() {
+			auto index = ReadNumber();
+			if (index >= m_Atoms.size())
+				throw BadModule();
+			return m_Atoms[index];
+		}
+
+		string ReadString() {
+			return ReadAtom().ToString();
+		}
+
+		const char* m_Next;
+		const char* m_End;
+		vector<Atom> m_Atoms;
+	};
+}
+
+ModuleCache::ModuleCache(string directory) : m_Directory(move(directory)) {
+}
+
+string ModuleCache::ModulePath(string_view filename) const {
+	filesystem::path source(filename);
+	if (m_Directory.empty())
+		return source.replace_extension(".dxc").string();
+
+	// files of the same name in different directories get different modules
+	error_code ec;
+	auto absolute = filesystem::absolute(source, ec).string();
+	auto name = format("{}-{:016x}.dxc", source.stem().string(), HashText(absolute));
+	return (filesystem::path(m_Directory) / name).string();
+}
+
+unique_ptr<Statements> ModuleCache::Load(string_view filename, OptimizerPasses passes) {
+	MappedFile source, module;
+	if (!source.Open(filename) || !module.Open(ModulePath(filename))) {
+		m_Stats.Misses++;
+		return nullptr;
+	}
+
+	ModuleHeader header;
+	if (module.Size() < sizeof(header)) {
+		m_Stats.Misses++;
+		return nullptr;
+	}
+	memcpy(&header, module.Data(), sizeof(header));
+	if (memcmp(header.Magic, Magic, sizeof(Magic)) != 0 || header.Version != Version || header.Size != module.Size()
+		|| header.Passes != static_cast<uint32_t>(passes) || header.SourceSize != source.Size()
+		|| header.SourceHash != HashText(source.View())) {
+		m_Stats.Misses++;
+		return nullptr;
+	}
+
+	auto root = Statements::NewTree();
+	AstArena::Scope arena(root->Arena());
+	try {
+		ModuleReader reader(module.Data() + sizeof(header), module.Size() - sizeof(header), header.Strings);
+		reader.ReadRoot(root.get());
+	}
+	catch (BadModule const&) {
+		m_Stats.Misses++;
+		return nullptr;
+	}
+
+	Resolver resolver;
+	resolver.Resolve(root.get());
+	m_Stats.Hits++;
+	return root;
+}
+
+bool ModuleCache::Store(string_view filename, string_view text, Statements const* tree, OptimizerPasses passes) {
+	vector<char> module;
+	try {
+		ModuleWriter writer;
+		module = writer.Write(tree, HashText(text), text.size(), passes);
+	}
+	catch (BadModule const&) {
+		return false;
+	}
+
+	auto path = ModulePath(filename);
+	error_code ec;
+	if (!m_Directory.empty())
+		filesystem::create_directories(m_Directory, ec);
+
+	// written aside and renamed over, so a module is never seen half written
+	auto temp = format("{}.{}.tmp", path, getpid());
+	{
+		ofstream out(temp, ios::binary | ios::trunc);
+		if (!out || !out.write(module.data(), module.size()))
+			return false;
+	}
+	filesystem::rename(temp, path, ec);
+	if (ec) {
+		filesystem::remove(temp, ec);
+		return false;
+	}
+	m_Stats.Stores++;
+	return true;
+}
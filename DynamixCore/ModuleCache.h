@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "Optimizer.h"
+
+namespace Dynamix {
+	class Statements;
+
+	//
+	// parsed files saved as binary modules (.dxc) that load without tokenizing or parsing.
+	// a module holds the tree as the parser left it, after the optimizer passes it was parsed with:
+	// the nodes in preorder, with every name and string in a table ahead of them, so it holds no addresses.
+	// it is keyed by a hash of the source text and the passes; a module that does not match is ignored.
+	// modules are read through a read-only mapping, so processes loading the same one share its pages.
+	// they are written next to the source file, or into a cache directory if one is given
+	//
+	class ModuleCache final {
+	public:
+		// bump whenever the encoding or the nodes change
+		static constexpr uint32_t Version = 1;
+
+		struct Stats {
+			size_t Hits{ 0 };
+			size_t Misses{ 0 };
+			size_t Stores{ 0 };
+		};
+
+		explicit ModuleCache(std::string directory = "");
+
+		// the tree of a file if its module is current, resolved and ready to run; null otherwise
+		std::unique_ptr<Statements> Load(std::string_view filename, OptimizerPasses passes);
+		// saves the tree parsed from the text of a file
+		bool Store(std::string_view filename, std::string_view text, Statements const* tree, OptimizerPasses passes);
+
+		std::string ModulePath(std::string_view filename) const;
+
+		Stats const& GetStats() const noexcept {
+			return m_Stats;
+		}
+
+	private:
+		std::string m_Directory;
+		Stats m_Stats;
+	};
+}
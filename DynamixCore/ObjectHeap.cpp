@@ -0,0 +1,270 @@
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#include "ObjectHeap.h"
+#include "SlabAllocator.h"
+
+using namespace Dynamix;
+using namespace std;
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+static HANDLE s_hHeap = ::HeapCreate(HEAP_NO_SERIALIZE, 1 << 18, 0);
+
+#else
+#include <sys/mman.h>
+#endif
+
+//
+// chunks are carved out of one range of address space, reserved the first time a heap is made and aligned
+// to the chunk size: an object finds its chunk by masking its address, and objects outside the range,
+// which is all of them unless the mode is on, carry nothing extra
+//
+namespace {
+	constexpr size_t ReservedSize = sizeof(void*) == 8 ? size_t(1) << 30 : size_t(64) << 20;
+
+	atomic<char*> s_Base;
+	once_flag s_Reserve;
+
+	// taken only when a chunk changes hands, once per chunk's worth of objects
+	mutex s_ChunkLock;
+	// guarded by the chunk lock: the part of the range not carved yet, and chunks given back to it
+	size_t s_Carved;
+	vector<void*> s_FreeChunks;
+
+	void Reserve() noexcept {
+#ifdef _WIN32
+		// reservations are aligned to 64 KB, the chunk size
+		auto base = static_cast<char*>(::VirtualAlloc(nullptr, ReservedSize, MEM_RESERVE, PAGE_NOACCESS));
+#else
+		// pages are backed only once touched
+		constexpr auto chunk = ObjectHeap::ChunkSize;
+		auto p = ::mmap(nullptr, ReservedSize + chunk, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		char* base = nullptr;
+		if (p != MAP_FAILED)
+			base = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + chunk - 1) & ~uintptr_t(chunk - 1));
+#endif
+		// a chunk handed back always fits, so giving it back needs no allocation
+		s_FreeChunks.reserve(ReservedSize / ObjectHeap::ChunkSize);
+		s_Base.store(base, memory_order_release);
+	}
+
+	bool InChunk(void const* p) noexcept {
+		auto base = s_Base.load(memory_order_acquire);
+		return base && p >= base && p < base + ReservedSize;
+	}
+
+	// call with the chunk lock held; null once the range is used up
+	void* MapChunk() noexcept {
+		void* chunk = nullptr;
+		if (!s_FreeChunks.empty()) {
+			chunk = s_FreeChunks.back();
+			s_FreeChunks.pop_back();
+		}
+		else if (auto base = s_Base.load(memory_order_relaxed); base && s_Carved < ReservedSize) {
+			chunk = base + s_Carved;
+			s_Carved += ObjectHeap::ChunkSize;
+		}
+#ifdef _WIN32
+		if (chunk && !::VirtualAlloc(chunk, ObjectHeap::ChunkSize, MEM_COMMIT, PAGE_READWRITE)) {
+			s_FreeChunks.push_back(chunk);
+			chunk = nullptr;
+		}
+#endif
+		return chunk;
+	}
+
+	// call with the chunk lock held; the pages go back to the system, the address range stays reserved
+	void UnmapChunk(void* chunk) noexcept {
+#ifdef _WIN32
+		::VirtualFree(chunk, ObjectHeap::ChunkSize, MEM_DECOMMIT);
+#else
+		::madvise(chunk, ObjectHeap::ChunkSize, MADV_DONTNEED);
+#endif
+		s_FreeChunks.push_back(chunk);
+	}
+
+	void* AllocateOutside(size_t size) {
+#ifdef _WIN32
+		auto p = ::HeapAlloc(s_hHeap, 0, size);
+		if (!p)
+			throw bad_alloc();
+		return p;
+#else
+		return SlabAllocator::Allocate(size);
+#endif
+	}
+
+	void FreeOutside(void* p, size_t size) noexcept {
+#ifdef _WIN32
+		::HeapFree(s_hHeap, 0, p);
+#else
+		SlabAllocator::Free(p, size);
+#endif
+	}
+}
+
+ObjectHeap::ObjectHeap() : m_Nursery(nullptr), m_Previous(s_Current) {
+	call_once(s_Reserve, Reserve);
+	m_Spare.reserve(MaxSpareChunks);
+	s_Current = this;
+}
+
+ObjectHeap::~ObjectHeap() {
+	//
+	// chunks with objects left are orphaned, and freed by whoever releases their last object
+	//
+	{
+		lock_guard lock(s_ChunkLock);
+		for (auto chunk : m_Spare)
+			UnmapChunk(chunk);
+		for (auto chunk : m_Old)
+			chunk->Heap = nullptr;
+		if (m_Nursery)
+			m_Nursery->Heap = nullptr;
+	}
+	if (m_Nursery && m_Nursery->Live.fetch_sub(1, memory_order_acq_rel) == 1) {
+		lock_guard lock(s_ChunkLock);
+		UnmapChunk(m_Nursery);
+	}
+
+	if (s_Current == this) {
+		s_Current = m_Previous;
+		return;
+	}
+	for (auto heap = s_Current; heap; heap = heap->m_Previous)
+		if (heap->m_Previous == this) {
+			heap->m_Previous = m_Previous;
+			break;
+		}
+}
+
+char* ObjectHeap::Start(Chunk* chunk) noexcept {
+	return reinterpret_cast<char*>(chunk) + ((sizeof(Chunk) + Alignment - 1) & ~(Alignment - 1));
+}
+
+void* ObjectHeap::Allocate(size_t size) {
+	if (s_Current)
+		return s_Current->AllocateInNursery(size);
+	return AllocateOutside(size);
+}
+
+void ObjectHeap::Free(void* p, size_t size) noexcept {
+	if (!InChunk(p)) {
+		FreeOutside(p, size);
+		return;
+	}
+
+	auto chunk = reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(ChunkSize - 1));
+	auto live = chunk->Live.fetch_sub(1, memory_order_acq_rel) - 1;
+	if (live == 0) {
+		Release(chunk);
+	}
+	else if (live == 1 && s_Current && s_Current->m_Nursery == chunk) {
+		//
+		// the nursery's last object, released on the heap's own thread: nothing else can reach the chunk,
+		// so it is rewound in place. a nursery emptied from another thread is rewound once it fills up
+		//
+		chunk->Next = Start(chunk);
+		s_Current->m_Rewound++;
+	}
+}
+
+void ObjectHeap::Release(Chunk* chunk) noexcept {
+	lock_guard lock(s_ChunkLock);
+	if (chunk->Heap)
+		chunk->Heap->Emptied(chunk);
+	else
+		UnmapChunk(chunk);
+}
+
+void* ObjectHeap::AllocateInNursery(size_t size) {
+	auto bytes = (size + Alignment - 1) & ~(Alignment - 1);
+	if (!m_Nursery && !(m_Nursery = NewChunk()))
+		return AllocateOutside(size);
+	if (bytes > ChunkSize - (Start(m_Nursery) - reinterpret_cast<char*>(m_Nursery)))
+		return AllocateOutside(size);
+
+	if (m_Nursery->Next + bytes > reinterpret_cast<char*>(m_Nursery) + ChunkSize) {
+		if (m_Nursery->Live.load(memory_order_acquire) == 1) {
+			m_Nursery->Next = Start(m_Nursery);
+			m_Rewound++;
+		}
+		else {
+			Retire(m_Nursery);
+			// with the reserved range used up, objects come from the general heap
+			if (!(m_Nursery = NewChunk()))
+				return AllocateOutside(size);
+		}
+	}
+	auto p = m_Nursery->Next;
+	m_Nursery->Next += bytes;
+	m_Nursery->Live.fetch_add(1, memory_order_relaxed);
+
+	m_Stats.Allocated++;
+	m_Stats.AllocatedBytes += bytes;
+	return p;
+}
+
+ObjectHeap::Chunk* ObjectHeap::NewChunk() {
+	void* memory = nullptr;
+	{
+		lock_guard lock(s_ChunkLock);
+		if (!m_Spare.empty()) {
+			memory = m_Spare.back();
+			m_Spare.pop_back();
+		}
+		else if (!(memory = MapChunk())) {
+			return nullptr;
+		}
+	}
+
+	// the heap's own count keeps the nursery from being emptied under it
+	auto chunk = new (memory) Chunk{ this, nullptr, 1, -1 };
+	chunk->Next = Start(chunk);
+	return chunk;
+}
+
+void ObjectHeap::Retire(Chunk* chunk) {
+	{
+		lock_guard lock(s_ChunkLock);
+		chunk->Old = (int)m_Old.size();
+		m_Old.push_back(chunk);
+		m_Stats.Promoted++;
+		m_Stats.OldChunks = m_Old.size();
+	}
+	// its objects may all have gone meanwhile, on another thread
+	if (chunk->Live.fetch_sub(1, memory_order_acq_rel) == 1)
+		Release(chunk);
+}
+
+void ObjectHeap::Emptied(Chunk* chunk) noexcept {
+	// only chunks in the old space empty; the nursery holds a count of its own
+	assert(chunk->Old >= 0);
+	m_Stats.Reclaimed++;
+	auto last = m_Old.back();
+	m_Old[chunk->Old] = last;
+	last->Old = chunk->Old;
+	m_Old.pop_back();
+	m_Stats.OldChunks = m_Old.size();
+
+	if (m_Spare.size() < MaxSpareChunks) {
+		// reserved up front, so this does not allocate
+		m_Spare.push_back(chunk);
+	}
+	else {
+		UnmapChunk(chunk);
+	}
+}
+
+ObjectHeap::Stats ObjectHeap::GetStats() const {
+	lock_guard lock(s_ChunkLock);
+	auto stats = m_Stats;
+	stats.Reclaimed += m_Rewound;
+	return stats;
+}
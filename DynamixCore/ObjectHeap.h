@@ -0,0 +1,81 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "NoCopyMove.h"
+
+namespace Dynamix {
+	//
+	// bump-pointer allocation for the objects of a Runtime in the nursery heap mode.
+	// objects are laid out one after another in fixed size chunks; the chunk being filled is the nursery.
+	// reference counts still decide when an object dies, but its memory is not handed back piecemeal:
+	// a chunk is reused whole once the last of its objects is gone, so a short-lived object costs a pointer bump
+	// and a decrement. a full chunk still holding objects is retired to the old space until they are released.
+	// each Runtime in the mode has one, serving the objects created on its thread. shared objects may be
+	// released on any thread, so the objects in a chunk are counted atomically, and a chunk changes hands
+	// (retired, emptied, orphaned) under a lock; only the heap's own thread allocates from or rewinds the nursery
+	//
+	class ObjectHeap final : NoCopy {
+	public:
+		static constexpr size_t ChunkSize = 64 << 10;
+		// objects are aligned as operator new aligns them
+		static constexpr size_t Alignment = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+		// emptied chunks kept for reuse
+		static constexpr size_t MaxSpareChunks = 4;
+
+		struct Stats {
+			uint64_t Allocated{ 0 };
+			uint64_t AllocatedBytes{ 0 };
+			// chunks emptied and reused, and chunks retired while still holding objects
+			uint64_t Reclaimed{ 0 };
+			uint64_t Promoted{ 0 };
+			// retired chunks still holding objects
+			size_t OldChunks{ 0 };
+		};
+
+		ObjectHeap();
+		~ObjectHeap();
+
+		static ObjectHeap* Current() noexcept {
+			return s_Current;
+		}
+
+		// memory for a RuntimeObject, from the current heap if there is one
+		static void* Allocate(size_t size);
+		static void Free(void* p, size_t size) noexcept;
+
+		// call on the heap's thread
+		Stats GetStats() const;
+
+	private:
+		struct Chunk {
+			// null once the heap is gone; the chunk is then freed with its last object
+			ObjectHeap* Heap;
+			char* Next;
+			// objects in the chunk, plus one while it is the nursery
+			std::atomic<int> Live;
+			// index in the old space, or -1
+			int Old;
+		};
+
+		void* AllocateInNursery(size_t size);
+		Chunk* NewChunk();
+		void Retire(Chunk* chunk);
+		void Emptied(Chunk* chunk) noexcept;
+		static void Release(Chunk* chunk) noexcept;
+		static char* Start(Chunk* chunk) noexcept;
+
+		Chunk* m_Nursery;
+		// guarded by the chunk lock, as are Reclaimed, Promoted and OldChunks of the stats
+		std::vector<Chunk*> m_Old;
+		std::vector<Chunk*> m_Spare;
+		Stats m_Stats;
+		// nursery rewinds, counted on the heap's thread
+		uint64_t m_Rewound{ 0 };
+		ObjectHeap* m_Previous;
+		inline static thread_local ObjectHeap* s_Current;
+	};
+}
@@ -3,6 +3,8 @@
 #include <type_traits>
 
 namespace Dynamix {
+	class RuntimeObject;
+
 	template<typename T = RuntimeObject>
 	class ObjectPtr {
 		//static_assert(std::is_base_of_v<RuntimeObject, T>, "T must derive from RuntimeObject");
@@ -10,22 +10,33 @@
 
 using namespace Dynamix;
 
-Value ObjectType::Invoke(Interpreter& intr, RuntimeObject* instance, std::string const& name, std::vector<Value>& args, InvokeFlags flags) const {
+Value ObjectType::Invoke(Interpreter& intr, RuntimeObject* instance, Atom name, std::vector<Value>& args, InvokeFlags flags) const {
 	auto count = (int8_t)args.size();// -((flags & InvokeFlags::Static) == InvokeFlags::Static ? 0 : 1);
 	assert(count >= 0);
+	ObjectType const* owner = nullptr;
+	auto method = ResolveMethod(name, count, owner);
+	if (!method)
+		throw RuntimeError(RuntimeErrorType::MethodNotFound,
+			std::format("Method {} with {} args not found in type {}", name, args.size(), owner->Name()));
+
+	return owner->InvokeMethod(intr, instance, method, args);
+}
+
+MethodInfo const* ObjectType::ResolveMethod(Atom name, int8_t count, ObjectType const*& owner) const {
 	auto method = GetMethod(name, count);
 	if (!method && m_Base)
-		return m_Base->Invoke(intr, instance, name, args, flags);
+		return m_Base->ResolveMethod(name, count, owner);
 	if (!method) {
 		method = GetMethod(name, -1);
-		if (method && method->Arity != -1 && method->Arity != args.size())
+		if (method && method->Arity != -1 && method->Arity != count)
 			method = nullptr;
 	}
-	if (!method)
-		throw RuntimeError(RuntimeErrorType::MethodNotFound,
-			std::format("Method {} with {} args not found in type {}", name, args.size(), Name()));
+	owner = this;
+	return method;
+}
 
-	Scoper scope(&intr);
+Value ObjectType::InvokeMethod(Interpreter& intr, RuntimeObject* instance, MethodInfo const* method, std::vector<Value>& args) const {
+	Scoper scope(&intr, method->SlotCount);
 	if ((method->Flags & SymbolFlags::Native) == SymbolFlags::Native) {
 		if (instance) {
 			args.insert(args.begin(), instance);
@@ -33,17 +44,17 @@ Value ObjectType::Invoke(Interpreter& intr, RuntimeObject* instance, std::string
 		return (*method->Code.Native)(intr, args);
 	}
 	if (instance && !instance->IsObjectType())
-		intr.CurrentScope().AddElement("this", { instance });
+		intr.CurrentScope().AddElement(Atom::This, { instance });
 	else {
 		for (auto& [name, v] : m_FieldValues)
 			intr.CurrentScope().AddElement(name, { v });
 	}
 	for (size_t i = 0; i < method->Parameters.size(); i++)
-		intr.CurrentScope().AddElement(method->Parameters[i].Name, { args[i] });
-	return intr.Eval(method->Code.Node);
+		intr.CurrentScope().DefineSlot((int)i, method->Parameters[i].Name, { args[i] });
+	return intr.CompleteCall(intr.ExecuteBody(method->Code.Node));
 }
 
-Value ObjectType::Invoke(Interpreter& intr, std::string const& name, std::vector<Value>& args, InvokeFlags flags) const {
+Value ObjectType::Invoke(Interpreter& intr, Atom name, std::vector<Value>& args, InvokeFlags flags) const {
 	return Invoke(intr, nullptr, name, args, flags);
 }
 
@@ -63,51 +74,39 @@ void ObjectType::RunClassConstructor(Interpreter& intr) {
 }
 
 unsigned ObjectType::GetObjectCount() const noexcept {
-	return m_ObjectCount;
+	return m_ObjectCount.load(std::memory_order_relaxed);
 }
 
 bool ObjectType::AddField(std::unique_ptr<FieldInfo> field, Value value) {
 	if(field->IsStatic()) {
-		m_FieldValues.insert({ field->Name(), std::move(value) });
+		m_FieldValues.insert({ field->NameAtom(), std::move(value) });
 	}
-	m_Members.insert({ field->Name(), field.get() });
-	return m_Fields.insert({ field->Name(), std::move(field) }).second;
+	m_Members.insert({ field->NameAtom(), field.get() });
+	return m_Fields.insert({ field->NameAtom(), std::move(field) }).second;
 }
 
 bool ObjectType::AddMethod(std::unique_ptr<MethodInfo> method) {
 	if ((method->Flags & SymbolFlags::Ctor) == SymbolFlags::Ctor) {
 		return m_Constructors.insert({ method->IsStatic() ? "class/new" : std::format("new/{}", method->Arity), move(method) }).second;
 	}
-	auto clone = std::make_unique<MethodInfo>(method->Name());
-	clone->Flags = method->Flags;
-	clone->Code = method->Code;
-	clone->Arity = method->Arity;
-
-	m_Members.insert({ method->Name(), clone.get() });
-	m_Methods.insert({ method->Name(), std::move(clone) });
-
-	if (method->Arity >= 0)
-		return m_Methods.insert({ std::format("{}/{}", method->Name(), method->Arity), std::move(method) }).second;
-	return false;
+	m_Members.insert({ method->NameAtom(), method.get() });
+	auto key = std::pair(method->NameAtom(), method->Arity < 0 ? int8_t(-1) : method->Arity);
+	return m_Methods.insert({ key, std::move(method) }).second;
 }
 
 bool ObjectType::AddType(ObjectPtr<ObjectType> type) {
-	m_Members.insert({ type->Name(), type });
-	return m_Types.insert({ type->Name(), std::move(type) }).second;
+	m_Members.insert({ type->NameAtom(), type });
+	return m_Types.insert({ type->NameAtom(), std::move(type) }).second;
 }
 
-FieldInfo const* ObjectType::GetField(std::string const& name) const noexcept {
+FieldInfo const* ObjectType::GetField(Atom name) const noexcept {
 	if(auto it = m_Fields.find(name); it != m_Fields.end())
 		return it->second.get();
 	return m_Base ? m_Base->GetField(name) : nullptr;
 }
 
-MethodInfo const* ObjectType::GetMethod(std::string const& name, int8_t arity) const noexcept {
-	if (arity < 0)
-		if (auto it = m_Methods.find(name); it != m_Methods.end() && it->second->Arity == -1)
-			return it->second.get();
-
-	if (auto it = m_Methods.find(std::format("{}/{}", name, arity)); it != m_Methods.end())
+MethodInfo const* ObjectType::GetMethod(Atom name, int8_t arity) const noexcept {
+	if (auto it = m_Methods.find({ name, arity < 0 ? int8_t(-1) : arity }); it != m_Methods.end())
 		return it->second.get();
 	return m_Base ? m_Base->GetMethod(name, arity) : nullptr;
 }
@@ -118,7 +117,7 @@ MethodInfo const* ObjectType::GetClassConstructor() const {
 	return nullptr;
 }
 
-MemberInfo const* ObjectType::GetMember(std::string const& name) const {
+MemberInfo const* ObjectType::GetMember(Atom name) const {
 	if (auto it = m_Members.find(name); it != m_Members.end())
 		return it->second;
 	return m_Base ? m_Base->GetMember(name) : nullptr;
@@ -131,26 +130,30 @@ void ObjectType::AddTypesToScope(Scope& scope) {
 	}
 }
 
-Value& ObjectType::GetStaticField(std::string const& name) {
+Value& ObjectType::GetStaticField(Atom name) {
 	assert(m_FieldValues.contains(name));
 	return m_FieldValues.at(name);
 }
 
-void ObjectType::SetStaticField(std::string const& name, Value value) {
+void ObjectType::SetStaticField(Atom name, Value value) {
 	assert(m_FieldValues.contains(name));
+	Publish(value);
 	m_FieldValues[name] = std::move(value);
 }
 
+//
+// the built-in types are shared by every runtime, so these stay atomic, but need no ordering
+//
 void ObjectType::ObjectCreated(RuntimeObject* obj) {
-	m_ObjectCount++;
+	m_ObjectCount.fetch_add(1, std::memory_order_relaxed);
 }
 
 void ObjectType::ObjectDestroyed(RuntimeObject* obj) {
-	m_ObjectCount--;
+	m_ObjectCount.fetch_sub(1, std::memory_order_relaxed);
 }
 
 ObjectType::ObjectType(std::string name, ObjectType* base)
-	: RuntimeObject(this), MemberInfo(move(name), MemberType::Class), m_Base(base) {
+	: RuntimeObject(this), MemberInfo(Atom(name), MemberType::Class), m_Base(base) {
 
 	BEGIN_METHODS(ObjectType)
 		METHOD(ObjectCount, 0, return Value((Int)inst->GetObjectCount());),
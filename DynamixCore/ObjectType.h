@@ -38,8 +38,11 @@ namespace Dynamix {
 	};
 
 	struct MemberInfo {
-		MemberInfo(std::string name, MemberType type) : m_Name(std::move(name)), m_Type(type) {}
+		MemberInfo(Atom name, MemberType type) : m_Name(name), m_Type(type) {}
 		std::string const& Name() const {
+			return m_Name.ToString();
+		}
+		Atom NameAtom() const noexcept {
 			return m_Name;
 		}
 		MemberType Type() const {
@@ -51,25 +54,26 @@ namespace Dynamix {
 		SymbolFlags Flags{ SymbolFlags::None };
 
 	private:
-		std::string m_Name;
+		Atom m_Name;
 		MemberType m_Type;
 	};
 
 	struct MethodParameter {
-		std::string Name;
+		Atom Name;
 		Expression* DefaultValue;
 	};
 
 	struct MethodInfo : MemberInfo {
-		explicit MethodInfo(std::string name) : MemberInfo(name, MemberType::Method) {}
+		explicit MethodInfo(Atom name) : MemberInfo(name, MemberType::Method) {}
 
 		MemberCode Code{};
 		int8_t Arity{ 0 };
+		int SlotCount{ 0 };
 		std::vector<MethodParameter> Parameters;
 	};
 
 	struct FieldInfo : MemberInfo {
-		explicit FieldInfo(std::string name) : MemberInfo(name, MemberType::Field) {}
+		explicit FieldInfo(Atom name) : MemberInfo(name, MemberType::Field) {}
 		Expression const* Init{};
 	};
 
@@ -87,9 +91,21 @@ namespace Dynamix {
 		}
 
 		// instance 
-		virtual Value Invoke(Interpreter& intr, RuntimeObject* instance, std::string const& name, std::vector<Value>& args, InvokeFlags flags) const;
+		virtual Value Invoke(Interpreter& intr, RuntimeObject* instance, Atom name, std::vector<Value>& args, InvokeFlags flags) const;
 		// static
-		virtual Value Invoke(Interpreter& intr, std::string const& name, std::vector<Value>& args, InvokeFlags flags) const;
+		virtual Value Invoke(Interpreter& intr, Atom name, std::vector<Value>& args, InvokeFlags flags) const;
+
+		//
+		// the two halves of Invoke: find the method (and the type that runs it) for a name and argument count,
+		// then run it. call sites cache the first half per receiver type
+		//
+		MethodInfo const* ResolveMethod(Atom name, int8_t count, ObjectType const*& owner) const;
+		Value InvokeMethod(Interpreter& intr, RuntimeObject* instance, MethodInfo const* method, std::vector<Value>& args) const;
+
+		// members can change per object, so lookups cannot be cached by type
+		virtual bool HasDynamicMembers() const noexcept {
+			return false;
+		}
 
 		void RunClassConstructor(Interpreter& intr);
 
@@ -99,15 +115,15 @@ namespace Dynamix {
 		bool AddMethod(std::unique_ptr<MethodInfo> method);
 		bool AddType(ObjectPtr<ObjectType> type);
 
-		FieldInfo const* GetField(std::string const& name) const noexcept;
-		MethodInfo const* GetMethod(std::string const& name, int8_t arity = -1) const noexcept;
+		FieldInfo const* GetField(Atom name) const noexcept;
+		MethodInfo const* GetMethod(Atom name, int8_t arity = -1) const noexcept;
 		MethodInfo const* GetClassConstructor() const;
-		MemberInfo const* GetMember(std::string const& name) const;
+		MemberInfo const* GetMember(Atom name) const;
 
 		void AddTypesToScope(Scope& scope);
 
-		Value& GetStaticField(std::string const& name);
-		void SetStaticField(std::string const& name, Value value);
+		Value& GetStaticField(Atom name);
+		void SetStaticField(Atom name, Value value);
 
 		Value GetFields() const;
 
@@ -132,11 +148,12 @@ namespace Dynamix {
 		void ObjectDestroyed(RuntimeObject* obj);
 
 		mutable std::atomic<unsigned> m_ObjectCount{ 0 };
-		std::map<std::string, std::unique_ptr<FieldInfo>> m_Fields;
-		std::map<std::string, std::unique_ptr<MethodInfo>> m_Methods;
+		std::map<Atom, std::unique_ptr<FieldInfo>> m_Fields;
+		// keyed by name and arity; variable-arity methods use -1
+		std::map<std::pair<Atom, int8_t>, std::unique_ptr<MethodInfo>> m_Methods;
 		std::map<std::string, std::unique_ptr<MethodInfo>> m_Constructors;
-		std::map<std::string, ObjectPtr<ObjectType>> m_Types;
-		std::map<std::string, MemberInfo*> m_Members;
+		std::map<Atom, ObjectPtr<ObjectType>> m_Types;
+		std::map<Atom, MemberInfo*> m_Members;
 		ObjectType* m_Base;
 		bool m_ClassCtorRun{ false };
 	};
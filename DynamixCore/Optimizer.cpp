@@ -0,0 +1,516 @@
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Optimizer.h"
+#include "AstNode.h"
+#include "Runtime.h"
+
+using namespace Dynamix;
+using namespace std;
+
+namespace {
+	//
+	// the values a literal can hold and a rewrite may produce; errors and objects are left to run time
+	//
+	Value const* Constant(Expression const* expr) noexcept {
+		auto literal = dynamic_cast<LiteralExpression const*>(expr);
+		if (literal == nullptr)
+			return nullptr;
+		auto& value = literal->Literal();
+		return value.IsInteger() || value.IsReal() || value.IsBoolean() || value.IsString() ? &value : nullptr;
+	}
+
+	unique_ptr<Expression> MakeLiteral(Value value, AstNode const* replaced) {
+		auto literal = make_unique<LiteralExpression>(move(value));
+		literal->SetLocation(replaced->Location());
+		return literal;
+	}
+
+	//
+	// evaluates operators whose operands are literals, the way the Interpreter would
+	//
+	class ConstantFolding final : public OptimizerPass {
+	public:
+		ConstantFolding() noexcept : OptimizerPass(OptimizerPasses::ConstantFolding) {}
+
+		unique_ptr<Expression> Rewrite(Expression* expr) override {
+			if (auto binary = dynamic_cast<BinaryExpression const*>(expr)) {
+				auto left = Constant(binary->Left());
+				if (left == nullptr)
+					return nullptr;
+				// And and Or do not evaluate the right side once the left one decides
+				switch (binary->Operator()) {
+					case TokenType::And:
+						if (!left->ToBoolean())
+							return Fold(false, expr);
+						break;
+					case TokenType::Or:
+						if (left->ToBoolean())
+							return Fold(true, expr);
+						break;
+				}
+				auto right = Constant(binary->Right());
+				if (right == nullptr)
+					return nullptr;
+				try {
+					return Fold(left->BinaryOperator(binary->Operator(), *right), expr);
+				}
+				catch (RuntimeError const&) {
+					return nullptr;
+				}
+			}
+			if (auto unary = dynamic_cast<UnaryExpression const*>(expr)) {
+				auto arg = Constant(unary->Arg());
+				if (arg == nullptr || unary->Operator() == TokenType::TypeOf)
+					return nullptr;
+				try {
+					return Fold(arg->UnaryOperator(unary->Operator()), expr);
+				}
+				catch (RuntimeError const&) {
+					return nullptr;
+				}
+			}
+			return nullptr;
+		}
+
+	private:
+		unique_ptr<Expression> Fold(Value result, Expression const* expr) {
+			// an operation that fails (e.g. division by zero) must still fail when the code runs
+			if (!result.IsInteger() && !result.IsReal() && !result.IsBoolean() && !result.IsString())
+				return nullptr;
+			Count();
+			return MakeLiteral(move(result), expr);
+		}
+	};
+
+	//
+	// replaces reads of literal vals and enum members with their values.
+	// a name qualifies only if it is declared once in the whole tree and never assigned, so no other
+	// binding can shadow it; uses are replaced after the declaration, inside its scope.
+	// top level vals and enums also reach into functions declared after them, which can only run once
+	// the declaration has
+	//
+	class ConstantPropagation final : public OptimizerPass {
+	public:
+		ConstantPropagation() noexcept : OptimizerPass(OptimizerPasses::ConstantPropagation) {}
+
+		void Scan(AstNode const* node) override {
+			if (auto decl = dynamic_cast<VarValStatement const*>(node))
+				m_Declarations[decl->NameAtom()]++;
+			else if (auto assign = dynamic_cast<AssignExpression const*>(node))
+				m_Assigned.insert(assign->LhsAtom());
+			else if (auto func = dynamic_cast<FunctionDeclaration const*>(node)) {
+				m_Declarations[Atom(func->Name())]++;
+				DeclareParameters(func);
+			}
+			else if (auto lambda = dynamic_cast<AnonymousFunctionExpression const*>(node))
+				DeclareParameters(lambda);
+			else if (auto stmt = dynamic_cast<ForEachStatement const*>(node))
+				m_Declarations[stmt->NameAtom()]++;
+			else if (auto cls = dynamic_cast<ClassDeclaration const*>(node))
+				m_Declarations[Atom(cls->Name())]++;
+			else if (auto enm = dynamic_cast<EnumDeclaration const*>(node))
+				m_Declarations[Atom(enm->Name())]++;
+		}
+
+		void Enter(AstNode const* node) override {
+			if (dynamic_cast<FunctionEssentials const*>(node))
+				m_Scopes.push_back({ ScopeKind::Function });
+			else if (dynamic_cast<ClassDeclaration const*>(node))
+				m_Scopes.push_back({ ScopeKind::Class });
+			else if (dynamic_cast<ScopeSlots const*>(node) || dynamic_cast<Statements const*>(node) || dynamic_cast<RepeatStatement const*>(node))
+				m_Scopes.push_back({ ScopeKind::Block });
+		}
+
+		void Leave(AstNode const* node) override {
+			if (auto decl = dynamic_cast<VarValStatement const*>(node)) {
+				if (auto value = Constant(decl->Init()); value && decl->IsConst())
+					Bind(decl->NameAtom(), *value, nullptr);
+			}
+			else if (auto enm = dynamic_cast<EnumDeclaration const*>(node))
+				Bind(Atom(enm->Name()), Value(), &enm->Values());
+			else if (dynamic_cast<FunctionEssentials const*>(node) || dynamic_cast<ClassDeclaration const*>(node) ||
+				dynamic_cast<ScopeSlots const*>(node) || dynamic_cast<Statements const*>(node) || dynamic_cast<RepeatStatement const*>(node)) {
+				for (auto name : m_Scopes.back().Names)
+					m_Bindings.erase(name);
+				m_Scopes.pop_back();
+			}
+		}
+
+		unique_ptr<Expression> Rewrite(Expression* expr) override {
+			if (auto name = dynamic_cast<NameExpression const*>(expr)) {
+				auto binding = Find(name->NameAtom());
+				if (binding == nullptr || binding->Enum)
+					return nullptr;
+				Count();
+				return MakeLiteral(binding->Constant, expr);
+			}
+			if (auto member = dynamic_cast<GetMemberExpression const*>(expr)) {
+				auto name = dynamic_cast<NameExpression const*>(member->Left());
+				if (name == nullptr || (member->Operator() != TokenType::Dot && member->Operator() != TokenType::DoubleColon))
+					return nullptr;
+				auto binding = Find(name->NameAtom());
+				if (binding == nullptr || binding->Enum == nullptr)
+					return nullptr;
+				auto it = binding->Enum->find(member->MemberAtom());
+				if (it == binding->Enum->end())
+					return nullptr;
+				Count();
+				return MakeLiteral(Value(Int(it->second)), expr);
+			}
+			return nullptr;
+		}
+
+	private:
+		enum class ScopeKind : uint8_t {
+			Block,
+			Function,
+			Class,
+		};
+
+		struct ScopeInfo {
+			ScopeKind Kind;
+			vector<Atom> Names;
+		};
+
+		struct Binding {
+			Value Constant;
+			pmr::unordered_map<Atom, long long> const* Enum;
+			int Scope;
+		};
+
+		void DeclareParameters(FunctionEssentials const* func) {
+			for (auto& p : func->Parameters())
+				m_Declarations[p.Name]++;
+		}
+
+		void Bind(Atom name, Value value, pmr::unordered_map<Atom, long long> const* values) {
+			// class members are not plain names
+			if (m_Scopes.empty() || m_Scopes.back().Kind == ScopeKind::Class)
+				return;
+			if (m_Declarations[name] != 1 || m_Assigned.contains(name))
+				return;
+			auto scope = (int)m_Scopes.size() - 1;
+			m_Bindings.insert_or_assign(name, Binding{ move(value), values, scope });
+			m_Scopes.back().Names.push_back(name);
+		}
+
+		Binding const* Find(Atom name) const {
+			auto it = m_Bindings.find(name);
+			if (it == m_Bindings.end())
+				return nullptr;
+			auto& binding = it->second;
+			if (binding.Scope > 0) {
+				for (auto i = binding.Scope + 1; i < (int)m_Scopes.size(); i++)
+					if (m_Scopes[i].Kind != ScopeKind::Block)
+						return nullptr;
+			}
+			return &binding;
+		}
+
+		unordered_map<Atom, int> m_Declarations;
+		unordered_set<Atom> m_Assigned;
+		unordered_map<Atom, Binding> m_Bindings;
+		vector<ScopeInfo> m_Scopes;
+	};
+
+	//
+	// replaces an if whose condition is a literal with the branch it always takes
+	//
+	class DeadBranches final : public OptimizerPass {
+	public:
+		DeadBranches() noexcept : OptimizerPass(OptimizerPasses::DeadBranches) {}
+
+		unique_ptr<Expression> Rewrite(Expression* expr) override {
+			auto ifThenElse = dynamic_cast<IfThenElseExpression*>(expr);
+			if (ifThenElse == nullptr)
+				return nullptr;
+			auto condition = Constant(ifThenElse->Condition());
+			if (condition == nullptr)
+				return nullptr;
+
+			Count();
+			auto branch = condition->ToBoolean() ? ifThenElse->ReleaseThen() : ifThenElse->ReleaseElse();
+			if (branch)
+				return branch;
+			auto empty = make_unique<Statements>();
+			empty->SetLocation(expr->Location());
+			return empty;
+		}
+	};
+
+	//
+	// drops statements that follow a return, break or continue in the same block
+	//
+	class UnreachableCode final : public OptimizerPass {
+	public:
+		UnreachableCode() noexcept : OptimizerPass(OptimizerPasses::UnreachableCode) {}
+
+		void RewriteStatements(AstVector<unique_ptr<Statement>>& stmts) override {
+			for (size_t i = 0; i + 1 < stmts.size(); i++) {
+				if (dynamic_cast<ReturnStatement const*>(stmts[i].get()) || dynamic_cast<BreakOrContinueStatement const*>(stmts[i].get())) {
+					Count(int(stmts.size() - i - 1));
+					stmts.erase(stmts.begin() + i + 1, stmts.end());
+					break;
+				}
+			}
+		}
+	};
+}
+
+Optimizer::Optimizer(OptimizerPasses passes) : m_Enabled(passes) {
+	// propagation first, so the other passes see the values it substitutes
+	m_Passes.push_back(make_unique<ConstantPropagation>());
+	m_Passes.push_back(make_unique<ConstantFolding>());
+	m_Passes.push_back(make_unique<DeadBranches>());
+	m_Passes.push_back(make_unique<UnreachableCode>());
+}
+
+void Optimizer::AddPass(unique_ptr<OptimizerPass> pass) {
+	m_Enabled |= pass->Id();
+	m_Passes.push_back(move(pass));
+}
+
+void Optimizer::Enable(OptimizerPasses passes, bool enable) noexcept {
+	if (enable)
+		m_Enabled |= passes;
+	else
+		m_Enabled = m_Enabled & (OptimizerPasses::All ^ passes);
+}
+
+bool Optimizer::IsEnabled(OptimizerPasses pass) const noexcept {
+	return (m_Enabled & pass) == pass;
+}
+
+OptimizerPass const* Optimizer::GetPass(OptimizerPasses id) const noexcept {
+	for (auto& pass : m_Passes)
+		if (pass->Id() == id)
+			return pass.get();
+	return nullptr;
+}
+
+template<typename T>
+void Optimizer::Walk(unique_ptr<T>& node) {
+	if (node == nullptr)
+		return;
+
+	Visit(node.get());
+	for (auto pass : m_Active) {
+		auto replacement = pass->Rewrite(node.get());
+		// a statement slot cannot hold a plain expression
+		if (auto fits = dynamic_cast<T*>(replacement.get())) {
+			replacement.release();
+			node.reset(fits);
+		}
+	}
+}
+
+template<typename F>
+void Optimizer::ForEachChild(AstNode* node, F&& f) {
+	if (auto stmt = dynamic_cast<ExpressionStatement*>(node)) {
+		f(stmt->m_Expr);
+		return;
+	}
+
+	switch (node->NodeType()) {
+		case AstNodeType::Statements:
+			for (auto& stmt : static_cast<Statements*>(node)->Get())
+				f(stmt);
+			break;
+
+		case AstNodeType::VarValStatement:
+			f(static_cast<VarValStatement*>(node)->m_Init);
+			break;
+
+		case AstNodeType::Assign:
+			f(static_cast<AssignExpression*>(node)->m_Value);
+			break;
+
+		case AstNodeType::AssignField:
+		{
+			auto assign = static_cast<AssignFieldExpression*>(node);
+			f(assign->m_Lhs);
+			f(assign->m_Value);
+			break;
+		}
+
+		case AstNodeType::AssignArrayIndex:
+		{
+			auto assign = static_cast<AssignArrayIndexExpression*>(node);
+			f(assign->m_ArrayAccess);
+			f(assign->m_Value);
+			break;
+		}
+
+		case AstNodeType::Binary:
+		{
+			auto binary = static_cast<BinaryExpression*>(node);
+			f(binary->m_Left);
+			f(binary->m_Right);
+			break;
+		}
+
+		case AstNodeType::Unary:
+			f(static_cast<UnaryExpression*>(node)->m_Arg);
+			break;
+
+		case AstNodeType::Range:
+		{
+			auto range = static_cast<RangeExpression*>(node);
+			f(range->m_Start);
+			f(range->m_End);
+			break;
+		}
+
+		case AstNodeType::InvokeFunction:
+		{
+			auto invoke = static_cast<InvokeFunctionExpression*>(node);
+			f(invoke->m_Callable);
+			for (auto& arg : invoke->m_Arguments)
+				f(arg);
+			break;
+		}
+
+		case AstNodeType::GetMember:
+			f(static_cast<GetMemberExpression*>(node)->m_Left);
+			break;
+
+		case AstNodeType::ArrayAccess:
+		{
+			auto access = static_cast<AccessArrayExpression*>(node);
+			f(access->m_Left);
+			f(access->m_Index);
+			break;
+		}
+
+		case AstNodeType::Array:
+			for (auto& item : static_cast<ArrayExpression*>(node)->m_Items)
+				f(item);
+			break;
+
+		case AstNodeType::Match:
+		{
+			auto match = static_cast<MatchExpression*>(node);
+			f(match->m_Expr);
+			for (auto& mc : match->m_MatchCases) {
+				for (auto& c : mc.m_Cases)
+					f(c);
+				f(mc.m_Action);
+			}
+			break;
+		}
+
+		case AstNodeType::IfThenElse:
+		{
+			auto ifThenElse = static_cast<IfThenElseExpression*>(node);
+			f(ifThenElse->m_Condition);
+			f(ifThenElse->m_Then);
+			f(ifThenElse->m_Else);
+			break;
+		}
+
+		case AstNodeType::While:
+		{
+			auto stmt = static_cast<WhileStatement*>(node);
+			f(stmt->m_Condition);
+			f(stmt->m_Body);
+			break;
+		}
+
+		case AstNodeType::For:
+		{
+			auto stmt = static_cast<ForStatement*>(node);
+			f(stmt->m_Init);
+			f(stmt->m_While);
+			f(stmt->m_Inc);
+			f(stmt->m_Body);
+			break;
+		}
+
+		case AstNodeType::ForEach:
+		{
+			auto stmt = static_cast<ForEachStatement*>(node);
+			f(stmt->m_Collection);
+			f(stmt->m_Body);
+			break;
+		}
+
+		case AstNodeType::Repeat:
+		{
+			auto stmt = static_cast<RepeatStatement*>(node);
+			f(stmt->m_Times);
+			f(stmt->m_Body);
+			break;
+		}
+
+		case AstNodeType::Return:
+			f(static_cast<ReturnStatement*>(node)->m_Expr);
+			break;
+
+		case AstNodeType::FunctionDeclaration:
+		case AstNodeType::AnonymousFunction:
+		{
+			FunctionEssentials* func = node->NodeType() == AstNodeType::FunctionDeclaration ?
+				static_cast<FunctionEssentials*>(static_cast<FunctionDeclaration*>(node)) :
+				static_cast<FunctionEssentials*>(static_cast<AnonymousFunctionExpression*>(node));
+			for (auto& p : func->m_Parameters)
+				f(p.DefaultValue);
+			f(func->m_Body);
+			break;
+		}
+
+		case AstNodeType::ClassDeclaration:
+		{
+			auto decl = static_cast<ClassDeclaration*>(node);
+			for (auto& field : decl->m_Fields)
+				f(field);
+			for (auto& method : decl->m_Methods)
+				f(method);
+			for (auto& type : decl->m_Types)
+				f(type);
+			break;
+		}
+
+		case AstNodeType::NewObject:
+		{
+			auto expr = static_cast<NewObjectExpression*>(node);
+			for (auto& arg : expr->m_Arguments)
+				f(arg);
+			for (auto& init : expr->m_FieldInit)
+				f(init.Init);
+			break;
+		}
+	}
+}
+
+void Optimizer::Optimize(Statements* root) {
+	m_Active.clear();
+	for (auto& pass : m_Passes)
+		if (IsEnabled(pass->Id()))
+			m_Active.push_back(pass.get());
+	if (m_Active.empty() || root == nullptr)
+		return;
+
+	Scan(root);
+	Visit(root);
+}
+
+void Optimizer::Scan(AstNode* node) {
+	for (auto pass : m_Active)
+		pass->Scan(node);
+	ForEachChild(node, [this](auto& child) {
+		if (child)
+			Scan(child.get());
+		});
+}
+
+void Optimizer::Visit(AstNode* node) {
+	for (auto pass : m_Active)
+		pass->Enter(node);
+	ForEachChild(node, [this](auto& child) { Walk(child); });
+	if (auto stmts = dynamic_cast<Statements*>(node))
+		for (auto pass : m_Active)
+			pass->RewriteStatements(stmts->Get());
+	for (auto pass : m_Active)
+		pass->Leave(node);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "AstArena.h"
+#include "EnumClassBitwise.h"
+
+namespace Dynamix {
+	class AstNode;
+	class Expression;
+	class Statement;
+	class Statements;
+
+	enum class OptimizerPasses : uint32_t {
+		None = 0,
+		ConstantFolding = 1,
+		ConstantPropagation = 2,
+		DeadBranches = 4,
+		UnreachableCode = 8,
+		All = 0xf,
+	};
+
+	//
+	// one rewrite applied during the optimizer's walk.
+	// Scan sees every node before anything changes; Enter and Leave bracket a node's children
+	// and Rewrite runs after them, so operands are already simplified
+	//
+	class OptimizerPass {
+	public:
+		explicit OptimizerPass(OptimizerPasses id) noexcept : m_Id(id) {}
+		virtual ~OptimizerPass() = default;
+
+		OptimizerPasses Id() const noexcept {
+			return m_Id;
+		}
+		// number of nodes this pass replaced or removed
+		int Rewrites() const noexcept {
+			return m_Rewrites;
+		}
+
+		virtual void Scan(AstNode const* node) {}
+		virtual void Enter(AstNode const* node) {}
+		virtual void Leave(AstNode const* node) {}
+		// returns a replacement for the node, or null to keep it
+		virtual std::unique_ptr<Expression> Rewrite(Expression* expr) {
+			return nullptr;
+		}
+		virtual void RewriteStatements(AstVector<std::unique_ptr<Statement>>& stmts) {}
+
+	protected:
+		void Count(int rewrites = 1) noexcept {
+			m_Rewrites += rewrites;
+		}
+
+	private:
+		OptimizerPasses m_Id;
+		int m_Rewrites{ 0 };
+	};
+
+	//
+	// rewrites a parsed tree in place before the Resolver binds it.
+	// the built-in passes only touch code whose result is known at parse time,
+	// so an optimized tree evaluates exactly like the original one
+	//
+	class Optimizer final {
+	public:
+		explicit Optimizer(OptimizerPasses passes = OptimizerPasses::All);
+
+		void AddPass(std::unique_ptr<OptimizerPass> pass);
+		void Enable(OptimizerPasses passes, bool enable = true) noexcept;
+		bool IsEnabled(OptimizerPasses pass) const noexcept;
+		OptimizerPass const* GetPass(OptimizerPasses id) const noexcept;
+
+		void Optimize(Statements* root);
+
+	private:
+		void Scan(AstNode* node);
+		void Visit(AstNode* node);
+		template<typename T>
+		void Walk(std::unique_ptr<T>& node);
+		template<typename F>
+		static void ForEachChild(AstNode* node, F&& f);
+
+		std::vector<std::unique_ptr<OptimizerPass>> m_Passes;
+		std::vector<OptimizerPass*> m_Active;
+		OptimizerPasses m_Enabled;
+	};
+}
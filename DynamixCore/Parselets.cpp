@@ -33,7 +33,7 @@ int PostfixOperatorParslet::Precedence() const noexcept {
 }
 
 unique_ptr<Expression> NameParslet::Parse(Parser& parser, Token const& token) {
-	auto node = make_unique<NameExpression>(token.Lexeme);
+	auto node = make_unique<NameExpression>(Atom(token.Lexeme));
 	node->SetLocation(token.Location);
 	return node;
 }
@@ -71,7 +71,7 @@ unique_ptr<Expression> GroupParslet::Parse(Parser& parser, Token const& token) {
 unique_ptr<Expression> AssignParslet::Parse(Parser& parser, unique_ptr<Expression> left, Token const& token) {
 	auto right = parser.ParseExpression(Precedence() - 1);
 	if (left->NodeType() == AstNodeType::Name)
-		return make_unique<AssignExpression>(reinterpret_cast<NameExpression const*>(left.get())->Name(), move(right), token.Type);
+		return make_unique<AssignExpression>(reinterpret_cast<NameExpression const*>(left.get())->NameAtom(), move(right), token.Type);
 
 	if (left->NodeType() == AstNodeType::ArrayAccess) {
 		return make_unique<AssignArrayIndexExpression>(move(left), move(right), token.Type);
@@ -126,7 +126,7 @@ unique_ptr<Expression> AnonymousFunctionParslet::Parse(Parser& parser, Token con
 		auto arg = parser.Next();
 		if (arg.Type != TokenType::Identifier)
 			parser.AddError(ParseError(ParseErrorType::IdentifierExpected, arg));
-		args.push_back(Parameter{ move(arg.Lexeme) });
+		args.push_back(Parameter{ Atom(arg.Lexeme) });
 		if (parser.Match(TokenType::Comma) || parser.Match(TokenType::BitwiseOr, false))
 			continue;
 		parser.AddError(ParseError(ParseErrorType::UnexpectedToken, parser.Peek(), "Expected: ',' or '|'"));
@@ -158,7 +158,7 @@ unique_ptr<Expression> ArrayExpressionParslet::Parse(Parser& parser, Token const
 
 unique_ptr<Expression> GetMemberParslet::Parse(Parser& parser, std::unique_ptr<Expression> left, Token const& token) {
 	auto next = parser.Next();
-	return std::make_unique<GetMemberExpression>(move(left), next.Lexeme, token.Type);
+	return std::make_unique<GetMemberExpression>(move(left), Atom(next.Lexeme), token.Type);
 }
 
 unique_ptr<Expression> ArrayAccessParslet::Parse(Parser& parser, std::unique_ptr<Expression> left, Token const& token) {
@@ -217,7 +217,7 @@ unique_ptr<Expression> NewOperatorParslet::Parse(Parser& parser, Token const& to
 				parser.SkipTo(TokenType::CloseBrace);
 				return nullptr;
 			}
-			inits.push_back(FieldInitializer{ move(field), move(init) });
+			inits.push_back(FieldInitializer{ Atom(field), move(init) });
 			if (!parser.Match(TokenType::Comma) && parser.Peek().Type != TokenType::CloseBrace) {
 				parser.AddError(ParseError(ParseErrorType::Expected, parser.Peek().Location, "Expected: ',' or '}'"));
 			}
@@ -225,7 +225,7 @@ unique_ptr<Expression> NewOperatorParslet::Parse(Parser& parser, Token const& to
 		parser.Next();
 	}
 
-	return make_unique<NewObjectExpression>(move(name), move(args), move(inits));
+	return make_unique<NewObjectExpression>(Atom(name), move(args), move(inits));
 }
 
 unique_ptr<Expression> MatchParslet::Parse(Parser& parser, Token const& token) {
@@ -1,5 +1,8 @@
 #include "Parser.h"
 #include "AstNode.h"
+#include "AstTables.h"
+#include "Resolver.h"
+#include "ModuleCache.h"
 #include <format>
 
 using namespace std;
@@ -176,10 +179,67 @@ unique_ptr<Statements> Parser::Parse(string_view text, bool repl, int line) {
 }
 
 unique_ptr<Statements> Parser::ParseFile(std::string_view filename) {
+	if (m_Cache) {
+		if (auto tree = m_Cache->Load(filename, m_Optimizations)) {
+			m_Errors.clear();
+			return DeclareModule(tree.get()) ? move(tree) : nullptr;
+		}
+	}
 	if (!m_Tokenizer.TokenizeFile(filename))
 		return nullptr;
 
-	return DoParse();
+	auto tree = DoParse();
+	if (tree && m_Cache)
+		m_Cache->Store(filename, m_Tokenizer.Source(), tree.get(), m_Optimizations);
+	return tree;
+}
+
+bool Parser::DeclareModule(Statements const* module) {
+	auto declare = [&](Symbol sym, AstNode const* node, string desc) {
+		if (FindSymbol(sym.Name, true))
+			AddError(ParseError(ParseErrorType::DuplicateDefinition, node->Location(), move(desc)));
+		else
+			AddSymbol(move(sym));
+	};
+	auto declareVar = [&](AstNode const* node) {
+		if (node->NodeType() != AstNodeType::VarValStatement)
+			return;
+		auto var = reinterpret_cast<VarValStatement const*>(node);
+		declare(Symbol{ var->Name(), SymbolType::Element, var->Flags() }, var, format("Symbol {} already defined in scope", var->Name()));
+	};
+
+	for (auto& stmt : module->Get()) {
+		switch (stmt->NodeType()) {
+			case AstNodeType::VarValStatement:
+				declareVar(stmt.get());
+				break;
+
+			case AstNodeType::Statements:
+				// var a, b;
+				for (auto& var : reinterpret_cast<Statements const*>(stmt.get())->Get())
+					declareVar(var.get());
+				break;
+
+			case AstNodeType::FunctionDeclaration:
+			{
+				auto decl = reinterpret_cast<FunctionDeclaration const*>(stmt.get());
+				auto name = format("{}/{}", decl->Name(), decl->Parameters().size());
+				declare(Symbol{ name, SymbolType::Function }, decl, format("Duplicate definition of '{}'", name));
+				break;
+			}
+
+			case AstNodeType::EnumDeclararion:
+				declare(Symbol{ reinterpret_cast<EnumDeclaration const*>(stmt.get())->Name(), SymbolType::Enum }, stmt.get(),
+					"Idenitifier already defined in current scope");
+				break;
+
+			case AstNodeType::Use:
+				if (auto use = reinterpret_cast<UseStatement const*>(stmt.get()); use->Type() == UseType::Class)
+					AddSymbol(Symbol{ use->Name(), SymbolType::UseClass });
+				break;
+		}
+	}
+	return !HasErrors();
 }
 
 vector<unique_ptr<Statements>> Parser::ParseFiles(std::initializer_list<std::string_view> filenames) {
@@ -196,8 +256,10 @@ vector<unique_ptr<Statements>> Parser::ParseFiles(std::initializer_list<std::str
 unique_ptr<Statements> Parser::DoParse() {
 	m_Errors.clear();
 
-	auto block = make_unique<Statements>();
-	block->SetParentSymbols(m_Symbols.top());
+	auto block = Statements::NewTree();
+	block->SetTables(make_unique<AstTables>());
+	AstArena::Scope arena(block->Arena());
+	AstTables::Scope scope(block->Tables());
 	while (true) {
 		auto stmt = ParseStatement(!m_Repl);
 		if (stmt == nullptr)
@@ -208,6 +270,13 @@ unique_ptr<Statements> Parser::DoParse() {
 	if (HasErrors())
 		return nullptr;
 
+	if (m_Optimizations != OptimizerPasses::None) {
+		Optimizer optimizer(m_Optimizations);
+		optimizer.Optimize(block.get());
+	}
+
+	Resolver resolver;
+	resolver.Resolve(block.get());
 	return block;
 }
 
@@ -345,7 +414,7 @@ unique_ptr<Statement> Parser::ParseVarValStatement(bool constant, SymbolFlags ex
 			sym.Name = name.Lexeme;
 			sym.Type = SymbolType::Element;
 			sym.Flags = extraFlags | (constant ? SymbolFlags::Const : SymbolFlags::None);
-			auto stmt = make_unique<VarValStatement>(name.Lexeme, sym.Flags, move(init));
+			auto stmt = make_unique<VarValStatement>(Atom(name.Lexeme), sym.Flags, move(init));
 			stmt->SetLocation(move(loc));
 			stmts->Add(move(stmt));
 			AddSymbol(sym);
@@ -415,7 +484,9 @@ unique_ptr<RepeatStatement> Parser::ParseRepeatStatement() {
 	auto times = empty ? make_unique<LiteralExpression>(true) : ParseExpression();
 	if (!times)
 		return nullptr;
+	m_LoopCount++;
 	auto body = ParseBlock();
+	m_LoopCount--;
 	if (!body)
 		return nullptr;
 	return make_unique<RepeatStatement>(move(times), move(body));
@@ -426,7 +497,7 @@ bool Parser::AddSymbol(Symbol sym) noexcept {
 }
 
 Symbol const* Parser::FindSymbol(string const& name, bool localOnly) const noexcept {
-	return m_Symbols.top()->FindSymbol(name, localOnly);
+	return m_Symbols.top()->FindSymbol(Atom::Find(name), localOnly);
 }
 
 vector<Symbol const*> Parser::GlobalSymbols() const noexcept {
@@ -434,7 +505,9 @@ vector<Symbol const*> Parser::GlobalSymbols() const noexcept {
 }
 
 void Parser::PushScope(AstNode* node) {
-	m_Symbols.push(node->Symbols());
+	// outside a parse there is no tree to keep the table; declarations go to the enclosing scope
+	auto tables = AstTables::Current();
+	m_Symbols.push(tables ? tables->AddScope(node, m_Symbols.top()) : m_Symbols.top());
 }
 
 void Parser::PopScope() {
@@ -451,7 +524,6 @@ unique_ptr<Statements> Parser::ParseStatementsForMatch(bool newScope) {
 		if (!stmt)
 			break;
 		stmt->SetLocation(next.Location);
-		stmt->SetParent(block.get());
 		block->Add(move(stmt));
 
 		next = Peek();
@@ -485,7 +557,7 @@ vector<Parameter> Parser::ParseParameters() {
 		}
 		if (param.Type != TokenType::Identifier)
 			AddError(ParseError{ ParseErrorType::IdentifierExpected, param });
-		parameter.Name = param.Lexeme;
+		parameter.Name = Atom(param.Lexeme);
 		if (Peek().Type == TokenType::Assign) {
 			// default param value
 			Next();
@@ -540,7 +612,7 @@ unique_ptr<Statement> Parser::ParseBlock(vector<Parameter> const& args, bool new
 
 	for (auto& arg : args) {
 		Symbol sym;
-		sym.Name = arg.Name;
+		sym.Name = arg.Name.ToString();
 		sym.Flags = SymbolFlags::None;
 		sym.Type = SymbolType::Argument;
 		AddSymbol(sym);
@@ -556,7 +628,6 @@ unique_ptr<Statement> Parser::ParseBlock(vector<Parameter> const& args, bool new
 		if (!stmt)
 			continue;
 		stmt->SetLocation(peek.Location);
-		stmt->SetParent(block.get());
 		block->Add(move(stmt));
 	}
 	Match(TokenType::CloseBrace, true, true);
@@ -924,7 +995,10 @@ unique_ptr<Statement> Parser::ParseForEachStatement() {
 	if (openParen)
 		Match(TokenType::CloseParen, true, true);
 
-	return make_unique<ForEachStatement>(ident.Lexeme, move(collection), ParseBlock());
+	m_LoopCount++;
+	auto body = ParseBlock();
+	m_LoopCount--;
+	return make_unique<ForEachStatement>(Atom(ident.Lexeme), move(collection), move(body));
 }
 
 unique_ptr<ReturnStatement> Parser::ParseReturnStatement() {
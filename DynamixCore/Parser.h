@@ -12,9 +12,11 @@
 #include "Parselets.h"
 #include "AstNode.h"
 #include "SymbolTable.h"
+#include "Optimizer.h"
 
 namespace Dynamix {
 	class AstNode;
+	class ModuleCache;
 
 	class Parser {
 	public:
@@ -32,6 +34,19 @@ namespace Dynamix {
 		bool HasErrors() const;
 		std::span<const ParseError> Errors() const;
 
+		// passes run over each parsed tree before it is resolved; none by default
+		void SetOptimizations(OptimizerPasses passes) noexcept {
+			m_Optimizations = passes;
+		}
+		OptimizerPasses Optimizations() const noexcept {
+			return m_Optimizations;
+		}
+
+		// ParseFile loads a current module from the cache instead of parsing, and saves the trees it parses
+		void SetModuleCache(ModuleCache* cache) noexcept {
+			m_Cache = cache;
+		}
+
 		std::unique_ptr<Expression> ParseExpression(int precedence = 0);
 		std::unique_ptr<Statement> ParseVarValStatement(bool constant, SymbolFlags extraFlags = SymbolFlags::None);
 		std::unique_ptr<FunctionDeclaration> ParseFunctionDeclaration(bool method = false, SymbolFlags extraFlags = SymbolFlags::None);
@@ -64,6 +79,8 @@ namespace Dynamix {
 		bool AddSymbol(Symbol sym) noexcept;
 		Symbol const* FindSymbol(std::string const& name, bool localOnly = false) const noexcept;
 		std::vector<Symbol const*> GlobalSymbols() const noexcept;
+		// declares what a module loaded from the cache defines at top level, as parsing it would have
+		bool DeclareModule(Statements const* module);
 
 		int GetPrecedence() const;
 		int AddConstString(std::string str);
@@ -83,5 +100,7 @@ namespace Dynamix {
 		int m_LoopCount{ 0 };
 		int m_InClass{ 0 };
 		bool m_Repl{ false };
+		OptimizerPasses m_Optimizations{ OptimizerPasses::None };
+		ModuleCache* m_Cache{ nullptr };
 	};
 }
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+
+#include "Value.h"
+#include "Token.h"
+
+namespace Dynamix {
+	//
+	// the operation an operator node has specialized itself to after seeing its operand types.
+	// every specialized operation is guarded by a type check; a failed guard sends the node back
+	// to the generic path for good, so a site with mixed types stops trying to specialize
+	//
+	enum class QuickOp : uint8_t {
+		Unobserved,
+		Generic,
+
+		AddInt,
+		SubInt,
+		MulInt,
+		EqualInt,
+		NotEqualInt,
+		LessInt,
+		LessEqualInt,
+		GreaterInt,
+		GreaterEqualInt,
+
+		AddReal,
+		SubReal,
+		MulReal,
+		DivReal,
+		EqualReal,
+		NotEqualReal,
+		LessReal,
+		LessEqualReal,
+		GreaterReal,
+		GreaterEqualReal,
+
+		NegateInt,
+		NegateReal,
+		NotBoolean,
+
+		IndexArrayInt,
+	};
+
+	//
+	// a node that quickens; the Interpreter records the specialization it picked
+	//
+	class QuickSite {
+	public:
+		QuickOp Quick() const noexcept {
+			return m_Quick;
+		}
+		void Quicken(QuickOp op) const noexcept {
+			m_Quick = op;
+		}
+		void Deoptimize() const noexcept {
+			m_Quick = QuickOp::Generic;
+		}
+
+	private:
+		mutable QuickOp m_Quick{ QuickOp::Unobserved };
+	};
+
+	// the binary operator a compound assignment applies, Invalid for anything else
+	constexpr TokenType CompoundOperator(TokenType assign) noexcept {
+		switch (assign) {
+			case TokenType::Assign_Add: return TokenType::Plus;
+			case TokenType::Assign_Sub: return TokenType::Minus;
+			case TokenType::Assign_Mul: return TokenType::Mul;
+			case TokenType::Assign_Div: return TokenType::Div;
+		}
+		return TokenType::Invalid;
+	}
+
+	inline QuickOp QuickenBinary(TokenType op, Value const& lhs, Value const& rhs) noexcept {
+		auto ints = lhs.IsInteger() && rhs.IsInteger();
+		if (!ints && !(lhs.IsReal() && rhs.IsReal()))
+			return QuickOp::Generic;
+
+		switch (op) {
+			case TokenType::Plus: return ints ? QuickOp::AddInt : QuickOp::AddReal;
+			case TokenType::Minus: return ints ? QuickOp::SubInt : QuickOp::SubReal;
+			case TokenType::Mul: return ints ? QuickOp::MulInt : QuickOp::MulReal;
+			// integer division throws on zero, left to the generic path
+			case TokenType::Div: return ints ? QuickOp::Generic : QuickOp::DivReal;
+			case TokenType::Equal: return ints ? QuickOp::EqualInt : QuickOp::EqualReal;
+			case TokenType::NotEqual: return ints ? QuickOp::NotEqualInt : QuickOp::NotEqualReal;
+			case TokenType::LessThan: return ints ? QuickOp::LessInt : QuickOp::LessReal;
+			case TokenType::LessThanOrEqual: return ints ? QuickOp::LessEqualInt : QuickOp::LessEqualReal;
+			case TokenType::GreaterThan: return ints ? QuickOp::GreaterInt : QuickOp::GreaterReal;
+			case TokenType::GreaterThanOrEqual: return ints ? QuickOp::GreaterEqualInt : QuickOp::GreaterEqualReal;
+		}
+		return QuickOp::Generic;
+	}
+
+	//
+	// runs a specialized binary operation; returns false if the operands fail its guard.
+	// result may alias lhs
+	//
+	inline bool QuickBinary(QuickOp op, Value const& lhs, Value const& rhs, Value& result) noexcept {
+		if (op >= QuickOp::AddInt && op <= QuickOp::GreaterEqualInt) {
+			if (!lhs.IsInteger() || !rhs.IsInteger())
+				return false;
+			auto l = lhs.AsInteger(), r = rhs.AsInteger();
+			switch (op) {
+				case QuickOp::AddInt: result = l + r; break;
+				case QuickOp::SubInt: result = l - r; break;
+				case QuickOp::MulInt: result = l * r; break;
+				case QuickOp::EqualInt: result = l == r; break;
+				case QuickOp::NotEqualInt: result = l != r; break;
+				case QuickOp::LessInt: result = l < r; break;
+				case QuickOp::LessEqualInt: result = l <= r; break;
+				case QuickOp::GreaterInt: result = l > r; break;
+				case QuickOp::GreaterEqualInt: result = l >= r; break;
+			}
+			return true;
+		}
+		if (op >= QuickOp::AddReal && op <= QuickOp::GreaterEqualReal) {
+			if (!lhs.IsReal() || !rhs.IsReal())
+				return false;
+			auto l = lhs.AsReal(), r = rhs.AsReal();
+			switch (op) {
+				case QuickOp::AddReal: result = l + r; break;
+				case QuickOp::SubReal: result = l - r; break;
+				case QuickOp::MulReal: result = l * r; break;
+				case QuickOp::DivReal: result = r == 0 ? Value::Error() : Value(l / r); break;
+				case QuickOp::EqualReal: result = l == r; break;
+				case QuickOp::NotEqualReal: result = l != r; break;
+				case QuickOp::LessReal: result = l < r; break;
+				case QuickOp::LessEqualReal: result = l <= r; break;
+				case QuickOp::GreaterReal: result = l > r; break;
+				case QuickOp::GreaterEqualReal: result = l >= r; break;
+			}
+			return true;
+		}
+		return false;
+	}
+
+	inline QuickOp QuickenUnary(TokenType op, Value const& arg) noexcept {
+		switch (op) {
+			case TokenType::Minus:
+				return arg.IsInteger() ? QuickOp::NegateInt : arg.IsReal() ? QuickOp::NegateReal : QuickOp::Generic;
+			case TokenType::Not:
+				return arg.IsBoolean() ? QuickOp::NotBoolean : QuickOp::Generic;
+		}
+		return QuickOp::Generic;
+	}
+
+	inline bool QuickUnary(QuickOp op, Value const& arg, Value& result) noexcept {
+		switch (op) {
+			case QuickOp::NegateInt:
+				if (!arg.IsInteger())
+					return false;
+				result = -arg.AsInteger();
+				return true;
+			case QuickOp::NegateReal:
+				if (!arg.IsReal())
+					return false;
+				result = -arg.AsReal();
+				return true;
+			case QuickOp::NotBoolean:
+				if (!arg.IsBoolean())
+					return false;
+				result = !arg.ToBoolean();
+				return true;
+		}
+		return false;
+	}
+}
@@ -0,0 +1,401 @@
+#include <cassert>
+#include <algorithm>
+#include <utility>
+
+#include "Resolver.h"
+#include "AstNode.h"
+
+using namespace Dynamix;
+using namespace std;
+
+void Resolver::Resolve(AstNode const* root) {
+	m_Scopes.clear();
+	m_Regions.clear();
+	m_Current = -1;
+	m_TailCaller = nullptr;
+
+	BeginRegion(nullptr);
+	Visit(root);
+	EndRegion();
+}
+
+void Resolver::Visit(AstNode const* node) {
+	if (node)
+		node->Accept(this);
+}
+
+void Resolver::BeginRegion(ScopeSlots const* node) {
+	Region region;
+	region.Outer = m_Current;
+	m_Regions.push_back(move(region));
+	m_Scopes.push_back(ScopeInfo{ node, -1 });
+	m_Current = (int)m_Scopes.size() - 1;
+}
+
+Resolver::Region Resolver::EndRegion() {
+	auto region = move(m_Regions.back());
+	m_Regions.pop_back();
+	unordered_set<Atom> free;
+	for (auto& b : region.Bindings) {
+		auto slot = Lookup(region, b.Name, b.Scope);
+		b.Node->SetSlot(slot);
+		if (!slot.IsResolved() && !region.Declared.contains(b.Name) && !region.Dynamic.contains(b.Name) && free.insert(b.Name).second)
+			region.Free.push_back(b.Name);
+	}
+	for (auto name : region.Nested)
+		if (free.insert(name).second)
+			region.Free.push_back(name);
+	if (!m_Regions.empty())
+		m_Regions.back().Nested.insert(region.Free.begin(), region.Free.end());
+
+	auto root = m_Current;
+	while (m_Scopes[root].Parent >= 0)
+		root = m_Scopes[root].Parent;
+	assert(root == m_Current);
+	if (auto node = m_Scopes[root].Node)
+		node->SetSlotCount((int)m_Scopes[root].Slots.size());
+
+	m_Current = region.Outer;
+	return region;
+}
+
+void Resolver::PushScope(ScopeSlots const* node) {
+	m_Scopes.push_back(ScopeInfo{ node, m_Current });
+	m_Current = (int)m_Scopes.size() - 1;
+}
+
+void Resolver::PopScope() {
+	auto& scope = m_Scopes[m_Current];
+	if (scope.Node)
+		scope.Node->SetSlotCount((int)scope.Slots.size());
+	m_Current = scope.Parent;
+}
+
+int Resolver::Declare(Atom name) {
+	m_Regions.back().Declared.insert(name);
+	auto& scope = m_Scopes[m_Current];
+	if (scope.Node == nullptr)
+		return -1;
+
+	auto [it, _] = scope.Slots.try_emplace(name, (int)scope.Slots.size());
+	return it->second;
+}
+
+void Resolver::Bind(VariableSlot const* node, Atom name) {
+	m_Regions.back().Bindings.push_back(Binding{ node, name, m_Current });
+}
+
+SlotRef Resolver::Lookup(Region const& region, Atom name, int scope) const {
+	if (region.Dynamic.contains(name))
+		return SlotRef();
+
+	int depth = 0;
+	for (auto index = scope; index >= 0 && depth <= INT16_MAX; index = m_Scopes[index].Parent, depth++) {
+		auto& info = m_Scopes[index];
+		if (info.Node == nullptr)
+			break;
+		if (auto it = info.Slots.find(name); it != info.Slots.end())
+			return SlotRef{ (int16_t)depth, (int16_t)it->second };
+	}
+	return SlotRef();
+}
+
+void Resolver::ResolveFunction(FunctionEssentials const* func, bool slotted, vector<Atom> const& dynamic) {
+	auto& params = func->Parameters();
+	for (size_t i = 0; i < params.size() && slotted; i++)
+		for (size_t j = 0; j < i; j++)
+			if (params[i].Name == params[j].Name) {
+				//
+				// parameters are stored by position; duplicates can only be looked up by name
+				//
+				slotted = false;
+				break;
+			}
+
+	BeginRegion(slotted ? func : nullptr);
+	m_Regions.back().Dynamic.insert(dynamic.begin(), dynamic.end());
+	for (auto& p : params)
+		Declare(p.Name);
+	Visit(func->Body());
+	auto region = EndRegion();
+	vector<Atom> frame(region.Declared.begin(), region.Declared.end());
+	for (auto name : region.Dynamic)
+		if (!region.Declared.contains(name))
+			frame.push_back(name);
+	func->SetNames(move(frame), move(region.Free));
+	if (!slotted)
+		func->SetSlotCount(0);
+}
+
+//
+// a call is in tail position if the function returns its result unchanged:
+// the operand of a return, or the last statement of the body, looking through if and match
+//
+void Resolver::MarkTailCalls(AstNode const* node) {
+	if (node == nullptr)
+		return;
+	if (auto stmt = dynamic_cast<ExpressionStatement const*>(node)) {
+		// a statement ending in a semicolon yields nothing, whatever its call returns
+		if (!stmt->HasSemicolon())
+			MarkTailCalls(stmt->Expr());
+		return;
+	}
+
+	switch (node->NodeType()) {
+		case AstNodeType::Statements:
+			if (auto stmts = reinterpret_cast<Statements const*>(node); stmts->Count() > 0)
+				MarkTailCalls(stmts->Get().back().get());
+			break;
+
+		case AstNodeType::IfThenElse:
+		{
+			auto expr = reinterpret_cast<IfThenElseExpression const*>(node);
+			MarkTailCalls(expr->Then());
+			MarkTailCalls(expr->Else());
+			break;
+		}
+
+		case AstNodeType::Match:
+			for (auto& mc : reinterpret_cast<MatchExpression const*>(node)->MatchCases())
+				MarkTailCalls(mc.Action());
+			break;
+
+		case AstNodeType::InvokeFunction:
+		{
+			// member calls bind 'this' and always go through the receiver
+			auto call = reinterpret_cast<InvokeFunctionExpression const*>(node);
+			if (call->Callable()->NodeType() != AstNodeType::GetMember)
+				call->SetTailCall(m_TailCaller);
+			break;
+		}
+	}
+}
+
+Value Resolver::VisitLiteral(LiteralExpression const* expr) {
+	return Value();
+}
+
+Value Resolver::VisitBinary(BinaryExpression const* expr) {
+	Visit(expr->Left());
+	Visit(expr->Right());
+	return Value();
+}
+
+Value Resolver::VisitUnary(UnaryExpression const* expr) {
+	Visit(expr->Arg());
+	return Value();
+}
+
+Value Resolver::VisitName(NameExpression const* expr) {
+	Bind(expr, expr->NameAtom());
+	return Value();
+}
+
+Value Resolver::VisitVar(VarValStatement const* expr) {
+	Visit(expr->Init());
+	Declare(expr->NameAtom());
+	Bind(expr, expr->NameAtom());
+	return Value();
+}
+
+Value Resolver::VisitAssign(AssignExpression const* expr) {
+	Visit(expr->Value());
+	Bind(expr, expr->LhsAtom());
+	return Value();
+}
+
+Value Resolver::VisitInvokeFunction(InvokeFunctionExpression const* expr) {
+	Visit(expr->Callable());
+	for (auto& arg : expr->Arguments())
+		Visit(arg.get());
+	return Value();
+}
+
+Value Resolver::VisitWhile(WhileStatement const* stmt) {
+	PushScope(stmt);
+	Visit(stmt->Condition());
+	Visit(stmt->Body());
+	PopScope();
+	return Value();
+}
+
+Value Resolver::VisitIfThenElse(IfThenElseExpression const* expr) {
+	Visit(expr->Condition());
+	Visit(expr->Then());
+	Visit(expr->Else());
+	return Value();
+}
+
+Value Resolver::VisitFunctionDeclaration(FunctionDeclaration const* decl) {
+	m_Regions.back().Dynamic.insert(Atom(decl->Name()));
+	auto caller = exchange(m_TailCaller, decl);
+	MarkTailCalls(decl->Body());
+	ResolveFunction(decl, true);
+	m_TailCaller = caller;
+	return Value();
+}
+
+Value Resolver::VisitReturn(ReturnStatement const* decl) {
+	if (m_TailCaller)
+		MarkTailCalls(decl->ReturnValue());
+	Visit(decl->ReturnValue());
+	return Value();
+}
+
+Value Resolver::VisitBreakContinue(BreakOrContinueStatement const* stmt) {
+	return Value();
+}
+
+Value Resolver::VisitFor(ForStatement const* stmt) {
+	PushScope(stmt);
+	Visit(stmt->Init());
+	Visit(stmt->While());
+	Visit(stmt->Inc());
+	Visit(stmt->Body());
+	PopScope();
+	return Value();
+}
+
+Value Resolver::VisitStatements(Statements const* stmts) {
+	for (auto& stmt : stmts->Get())
+		Visit(stmt.get());
+	return Value();
+}
+
+Value Resolver::VisitAnonymousFunction(AnonymousFunctionExpression const* func) {
+	auto caller = exchange(m_TailCaller, func);
+	MarkTailCalls(func->Body());
+	ResolveFunction(func, true);
+	m_TailCaller = caller;
+	return Value();
+}
+
+Value Resolver::VisitEnumDeclaration(EnumDeclaration const* decl) {
+	m_Regions.back().Dynamic.insert(Atom(decl->Name()));
+	return Value();
+}
+
+Value Resolver::VisitExpressionStatement(ExpressionStatement const* expr) {
+	Visit(expr->Expr());
+	return Value();
+}
+
+Value Resolver::VisitArrayExpression(ArrayExpression const* expr) {
+	for (auto& item : expr->Items())
+		Visit(item.get());
+	return Value();
+}
+
+Value Resolver::VisitRepeat(RepeatStatement const* stmt) {
+	Visit(stmt->Times());
+	Visit(stmt->Body());
+	return Value();
+}
+
+Value Resolver::VisitGetMember(GetMemberExpression const* expr) {
+	Visit(expr->Left());
+	return Value();
+}
+
+Value Resolver::VisitAccessArray(AccessArrayExpression const* expr) {
+	Visit(expr->Left());
+	Visit(expr->Index());
+	return Value();
+}
+
+Value Resolver::VisitAssignArrayIndex(AssignArrayIndexExpression const* expr) {
+	Visit(expr->ArrayAccess());
+	Visit(expr->Value());
+	return Value();
+}
+
+Value Resolver::VisitClassDeclaration(ClassDeclaration const* decl) {
+	auto& dynamic = m_Regions.back().Dynamic;
+	dynamic.insert(Atom(decl->Name()));
+	for (auto parent = decl->Parent(); parent; parent = parent->Parent())
+		dynamic.insert(Atom(parent->Name() + "::" + decl->Name()));
+
+	//
+	// field initializers run in whatever scope creates the object
+	//
+	vector<Atom> fields;
+	BeginRegion(nullptr);
+	for (auto& f : decl->Fields()) {
+		Visit(f.get());
+		if (f->NodeType() == AstNodeType::VarValStatement)
+			fields.push_back(reinterpret_cast<VarValStatement const*>(f.get())->NameAtom());
+		else if (f->NodeType() == AstNodeType::Statements)
+			for (auto& s : reinterpret_cast<Statements const*>(f.get())->Get())
+				if (s->NodeType() == AstNodeType::VarValStatement)
+					fields.push_back(reinterpret_cast<VarValStatement const*>(s.get())->NameAtom());
+	}
+	decl->SetFreeNames(EndRegion().Free);
+
+	//
+	// methods keep ordinary calls: they run with a 'this' binding, and the class constructor
+	// is not completed the way calls are
+	//
+	auto caller = exchange(m_TailCaller, nullptr);
+	for (auto& m : decl->Methods()) {
+		if (m->IsStatic() && m->Name() == "new") {
+			// the class constructor runs in the scope of its first use
+			ResolveFunction(m.get(), false);
+		}
+		else if (m->IsStatic()) {
+			// static fields are copied into the method's scope by name
+			ResolveFunction(m.get(), true, fields);
+		}
+		else {
+			ResolveFunction(m.get(), true);
+		}
+	}
+	m_TailCaller = caller;
+
+	for (auto& t : decl->Types())
+		VisitClassDeclaration(t.get());
+	return Value();
+}
+
+Value Resolver::VisitNewObjectExpression(NewObjectExpression const* expr) {
+	for (auto& arg : expr->Arguments())
+		Visit(arg.get());
+	for (auto& init : expr->FieldInitializers())
+		Visit(init.Init.get());
+	return Value();
+}
+
+Value Resolver::VisitAssignField(AssignFieldExpression const* expr) {
+	Visit(expr->Lhs());
+	Visit(expr->Value());
+	return Value();
+}
+
+Value Resolver::VisitForEach(ForEachStatement const* stmt) {
+	Visit(stmt->Collection());
+	PushScope(stmt);
+	Declare(stmt->NameAtom());
+	Bind(stmt, stmt->NameAtom());
+	Visit(stmt->Body());
+	PopScope();
+	return Value();
+}
+
+Value Resolver::VisitRange(RangeExpression const* expr) {
+	Visit(expr->Start());
+	Visit(expr->End());
+	return Value();
+}
+
+Value Resolver::VisitMatch(MatchExpression const* expr) {
+	Visit(expr->ToMatch());
+	for (auto& mc : expr->MatchCases()) {
+		for (auto& c : mc.Cases())
+			Visit(c.get());
+		Visit(mc.Action());
+	}
+	return Value();
+}
+
+Value Resolver::VisitUse(UseStatement const* use) {
+	return Value();
+}
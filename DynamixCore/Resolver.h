@@ -0,0 +1,108 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Visitor.h"
+#include "SymbolTable.h"
+
+namespace Dynamix {
+	class AstNode;
+	class ScopeSlots;
+	class VariableSlot;
+	class FunctionEssentials;
+
+	//
+	// binds variables to (depth, slot) pairs after parsing.
+	// mirrors the scopes the Interpreter pushes at run time (calls, while, for and foreach loops),
+	// so a bound name indexes straight into the scope chain instead of searching it.
+	// globals, REPL code and names shadowed by functions, classes or enums keep name-based lookup.
+	//
+	class Resolver final : public Visitor {
+	public:
+		void Resolve(AstNode const* root);
+
+		// Inherited via Visitor
+		Value VisitLiteral(LiteralExpression const* expr) override;
+		Value VisitBinary(BinaryExpression const* expr) override;
+		Value VisitUnary(UnaryExpression const* expr) override;
+		Value VisitName(NameExpression const* expr) override;
+		Value VisitVar(VarValStatement const* expr) override;
+		Value VisitAssign(AssignExpression const* expr) override;
+		Value VisitInvokeFunction(InvokeFunctionExpression const* expr) override;
+		Value VisitWhile(WhileStatement const* stmt) override;
+		Value VisitIfThenElse(IfThenElseExpression const* expr) override;
+		Value VisitFunctionDeclaration(FunctionDeclaration const* decl) override;
+		Value VisitReturn(ReturnStatement const* decl) override;
+		Value VisitBreakContinue(BreakOrContinueStatement const* stmt) override;
+		Value VisitFor(ForStatement const* stmt) override;
+		Value VisitStatements(Statements const* stmts) override;
+		Value VisitAnonymousFunction(AnonymousFunctionExpression const* func) override;
+		Value VisitEnumDeclaration(EnumDeclaration const* decl) override;
+		Value VisitExpressionStatement(ExpressionStatement const* expr) override;
+		Value VisitArrayExpression(ArrayExpression const* expr) override;
+		Value VisitRepeat(RepeatStatement const* stmt) override;
+		Value VisitGetMember(GetMemberExpression const* expr) override;
+		Value VisitAccessArray(AccessArrayExpression const* expr) override;
+		Value VisitAssignArrayIndex(AssignArrayIndexExpression const* expr) override;
+		Value VisitClassDeclaration(ClassDeclaration const* decl) override;
+		Value VisitNewObjectExpression(NewObjectExpression const* expr) override;
+		Value VisitAssignField(AssignFieldExpression const* expr) override;
+		Value VisitForEach(ForEachStatement const* stmt) override;
+		Value VisitRange(RangeExpression const* expr) override;
+		Value VisitMatch(MatchExpression const* expr) override;
+		Value VisitUse(UseStatement const* use) override;
+
+	private:
+		//
+		// a runtime scope; Node is null for a scope the interpreter did not push for this code
+		// (top level, class bodies), whose names stay dynamic
+		//
+		struct ScopeInfo {
+			ScopeSlots const* Node;
+			int Parent;
+			std::unordered_map<Atom, int> Slots;
+		};
+
+		struct Binding {
+			VariableSlot const* Node;
+			Atom Name;
+			int Scope;
+		};
+
+		//
+		// code that runs in its own call scope; bindings are settled when it ends,
+		// once every declaration in it is known
+		//
+		struct Region {
+			std::vector<Binding> Bindings;
+			std::unordered_set<Atom> Dynamic;
+			// every name the region's own code declares, slotted or not
+			std::unordered_set<Atom> Declared;
+			// names bound to nothing in the region, found in the callers' scopes
+			std::vector<Atom> Free;
+			// free names of the functions and classes declared in the region, whose calls may come from anywhere
+			std::unordered_set<Atom> Nested;
+			int Outer{ -1 };
+		};
+
+		void Visit(AstNode const* node);
+		void ResolveFunction(FunctionEssentials const* func, bool slotted, std::vector<Atom> const& dynamic = {});
+		void MarkTailCalls(AstNode const* node);
+		void BeginRegion(ScopeSlots const* node);
+		Region EndRegion();
+		void PushScope(ScopeSlots const* node);
+		void PopScope();
+		int Declare(Atom name);
+		void Bind(VariableSlot const* node, Atom name);
+		SlotRef Lookup(Region const& region, Atom name, int scope) const;
+
+		std::vector<ScopeInfo> m_Scopes;
+		std::vector<Region> m_Regions;
+		int m_Current{ -1 };
+		// the function whose calls may complete as tail calls, if any
+		FunctionEssentials const* m_TailCaller{ nullptr };
+	};
+}
@@ -12,15 +12,16 @@
 #include "ComplexType.h"
 #include "ConsoleType.h"
 #include "RuntimeType.h"
-#include "COMType.h"
 #include "DebugType.h"
 #include "IntegerType.h"
 #include "BooleanType.h"
 #include "RealType.h"
 #include "ObjectInstance.h"
+#include "InlineCache.h"
 
 #ifdef _WIN32
 #include <Windows.h>
+#include "COMType.h"
 extern "C" int WINAPI InitModule(Dynamix::IRuntime*);
 #endif
 
@@ -34,19 +35,24 @@ RuntimeError::RuntimeError(RuntimeErrorType type, std::string msg, CodeLocation
 ObjectPtr<ObjectType> Runtime::BuildType(ClassDeclaration const* decl, Interpreter* intr) {
 	ObjectType* baseType = nullptr;
 	if (!decl->BaseName().empty()) {
-		auto e = intr->CurrentScope().FindElement(decl->BaseName());
+		auto e = intr->CurrentScope().FindElement(Atom(decl->BaseName()));
 		if (e && ((e->Flags & ElementFlags::Class) == ElementFlags::Class))
 			baseType = reinterpret_cast<ObjectType*>(e->VarValue.AsObject());
 	}
 
 	auto type = new ObjectType(decl->Name(), baseType);
 	for (auto& m : decl->Methods()) {
-		auto mi = std::make_unique<MethodInfo>(m->Name());
+		auto mi = std::make_unique<MethodInfo>(Atom(m->Name()));
 		mi->Arity = (int8_t)m->Parameters().size();
 		mi->Flags = m->IsStatic() ? SymbolFlags::Static : SymbolFlags::None;
 		if (m->Name() == "new")
 			mi->Flags = mi->Flags | SymbolFlags::Ctor;
 		mi->Code.Node = m->Body();
+		if (auto code = intr ? intr->BoundNative(m.get()) : nullptr) {
+			mi->Code.Native = code;
+			mi->Flags = mi->Flags | SymbolFlags::Native;
+		}
+		mi->SlotCount = m->SlotCount();
 		for (auto& p : m->Parameters()) {
 			mi->Parameters.emplace_back(MethodParameter{ p.Name, p.DefaultValue.get() });
 		}
@@ -54,14 +60,14 @@ ObjectPtr<ObjectType> Runtime::BuildType(ClassDeclaration const* decl, Interpret
 	}
 
 	auto addField = [&](auto vv) {
-		auto fi = make_unique<FieldInfo>(vv->Name());
+		auto fi = make_unique<FieldInfo>(vv->NameAtom());
 		fi->Flags = vv->Flags();
 		fi->Init = vv->Init();
 		auto f = fi.get();
 		type->AddField(move(fi));
 		if (f->IsStatic()) {
 			assert(intr);
-			type->SetStaticField(f->Name(), f->Init ? intr->Eval(f->Init) : Value());
+			type->SetStaticField(f->NameAtom(), f->Init ? intr->Eval(f->Init) : Value());
 		}
 		};
 
@@ -136,13 +142,14 @@ std::vector<ObjectType*> Runtime::GetTypes() {
 
 void Runtime::RegisterType(ObjectType* type) {
 	assert(!m_Types.contains(type));
-	m_GlobalScope.AddElement(type->Name(), Element{ static_cast<RuntimeObject*>(type), ElementFlags::Class });
+	m_GlobalScope.AddElement(type->NameAtom(), Element{ static_cast<RuntimeObject*>(type), ElementFlags::Class });
 	m_Types.insert(type);
 }
 
 void Runtime::RevokeType(ObjectType* type) {
 	assert(m_Types.contains(type));
 	m_Types.erase(type);
+	InlineCache::Invalidate();
 }
 
 Runtime* Runtime::Get() {
@@ -153,11 +160,30 @@ void Runtime::ClearCode() {
 	m_Code.clear();
 }
 
-Runtime::Runtime() {
+Runtime::Runtime() : m_WasConfined(RuntimeObject::IsConfined()) {
 	s_Runtime = this;
 	InitStdLibrary();
 }
 
+Runtime::~Runtime() {
+	RuntimeObject::SetConfined(m_WasConfined);
+}
+
+void Runtime::SetThreadingMode(ThreadingMode mode) noexcept {
+	m_Threading = mode;
+	RuntimeObject::SetConfined(mode == ThreadingMode::Confined);
+}
+
+void Runtime::SetHeapMode(HeapMode mode) {
+	if (mode == GetHeapMode())
+		return;
+
+	if (mode == HeapMode::Nursery)
+		m_Heap = std::make_unique<ObjectHeap>();
+	else
+		m_Heap.reset();
+}
+
 void Runtime::InitStdLibrary() {
 
 #define ADD_TYPE(name) RegisterType(name##Type::Get());
@@ -171,7 +197,9 @@ void Runtime::InitStdLibrary() {
 	ADD_TYPE(Complex);
 	ADD_TYPE(Console);
 	ADD_TYPE(Runtime);
+#ifdef _WIN32
 	ADD_TYPE(COM);
+#endif
 	ADD_TYPE(Debug);
 	ADD_TYPE(Integer);
 	ADD_TYPE(Real);
@@ -8,6 +8,8 @@
 #include "AstNode.h"
 #include "Scope.h"
 #include "CoreInterfaces.h"
+#include "CycleCollector.h"
+#include "ObjectHeap.h"
 
 namespace Dynamix {
 	class RuntimeObject;
@@ -45,17 +47,28 @@ namespace Dynamix {
 		TooFewArguments,
 	};
 
-	struct ReturnStatementException {
-		Value ReturnValue;
+	enum class ExecutionEngine : uint8_t {
+		TreeWalker,
+		Bytecode,
+		// the bytecode VM, with hot function bodies compiled to machine code where that is supported
+		Jit,
+		// the tree-walker, with hot function bodies compiled in the background (see TieredCompiler)
+		Tiered,
 	};
 
-	struct BreakStatementException {
+	enum class HeapMode : uint8_t {
+		// objects are allocated and freed one at a time
+		Default,
+		// objects are bump-allocated in chunks reused whole (see ObjectHeap)
+		Nursery,
 	};
 
-	struct BreakoutStatementException {
-	};
-
-	struct ContinueStatementException {
+	enum class ThreadingMode : uint8_t {
+		// objects may be reached from any thread, and are counted atomically
+		Shared,
+		// objects created on the runtime's thread stay there, and are counted with plain increments
+		// until shared (see RuntimeObject::Share)
+		Confined,
 	};
 
 	struct AssertFailedException {
@@ -85,6 +98,7 @@ namespace Dynamix {
 	class Runtime : public IRuntime, NoCopy {
 	public:
 		Runtime();
+		~Runtime();
 		void InitStdLibrary();
 
 		ObjectPtr<ObjectType> BuildType(ClassDeclaration const* decl, Interpreter* intr);
@@ -111,11 +125,58 @@ namespace Dynamix {
 
 		static Runtime* Get();
 
+		ExecutionEngine DefaultEngine() const noexcept {
+			return m_DefaultEngine;
+		}
+
+		void SetDefaultEngine(ExecutionEngine engine) noexcept {
+			m_DefaultEngine = engine;
+		}
+
+		CycleCollector& GetCollector() noexcept {
+			return m_Collector;
+		}
+
+		//
+		// names some declared function looks up in the scopes of its callers;
+		// a call whose caller holds one of them keeps the caller's scope (no tail call)
+		//
+		void AddFreeNames(AstVector<Atom> const& names) {
+			m_FreeNames.insert(names.begin(), names.end());
+		}
+		bool IsFreeName(Atom name) const noexcept {
+			return m_FreeNames.contains(name);
+		}
+
+		// applies to objects created on this thread from now on
+		void SetHeapMode(HeapMode mode);
+		HeapMode GetHeapMode() const noexcept {
+			return m_Heap ? HeapMode::Nursery : HeapMode::Default;
+		}
+		// null unless in the nursery mode
+		ObjectHeap const* GetHeap() const noexcept {
+			return m_Heap.get();
+		}
+
+		// applies to objects created on this thread from now on
+		void SetThreadingMode(ThreadingMode mode) noexcept;
+		ThreadingMode GetThreadingMode() const noexcept {
+			return m_Threading;
+		}
+
 	private:
+		// destroyed last, after everything that can release objects
+		CycleCollector m_Collector;
+		std::unique_ptr<ObjectHeap> m_Heap;
 		std::vector<std::unique_ptr<Statements>> m_Code;
 		inline static thread_local Runtime* s_Runtime;
 		Scope m_GlobalScope;
 		std::unordered_set<ObjectType*> m_Types;
+		std::unordered_set<Atom> m_FreeNames;
+		ExecutionEngine m_DefaultEngine{ ExecutionEngine::TreeWalker };
+		ThreadingMode m_Threading{ ThreadingMode::Shared };
+		// the thread's mode before this runtime, restored when it goes
+		bool m_WasConfined;
 	};
 }
 
@@ -3,32 +3,30 @@
 #include "Value.h"
 #include <format>
 #include "Interpreter.h"
+#include "CycleCollector.h"
+#include "ObjectHeap.h"
 
 using namespace Dynamix;
 
-#ifdef _WIN32
-#define WIN32_LEAN_AND_MEAN
-#include <Windows.h>
-
-static HANDLE s_hHeap = ::HeapCreate(HEAP_NO_SERIALIZE, 1 << 18, 0);
-
 void* RuntimeObject::operator new(size_t size) {
-	return ::HeapAlloc(s_hHeap, 0, size);
+	return ObjectHeap::Allocate(size);
 }
 
-void RuntimeObject::operator delete(void* p) {
-	::HeapFree(s_hHeap, 0, p);
+void RuntimeObject::operator delete(void* p, size_t size) {
+	ObjectHeap::Free(p, size);
 }
 
-#endif
-
 RuntimeObject::RuntimeObject(ObjectType* type) : m_Type(type) {
 	if (type) {
 		type->ObjectCreated(this);
 	}
+	if (auto collector = CycleCollector::Current())
+		collector->ObjectCreated();
 }
 
 RuntimeObject::~RuntimeObject() noexcept {
+	if (m_Root >= 0)
+		m_Collector->RemoveRoot(this);
 	if (m_Type) {
 		m_Type->ObjectDestroyed(this);
 	}
@@ -40,16 +38,18 @@ void RuntimeObject::Construct(std::vector<Value> const& args) {
 void RuntimeObject::Destruct() {
 }
 
-void RuntimeObject::AssignField(std::string const& name, Value value, TokenType assignType) {
-	m_FieldValues[name] = m_FieldValues[name].Assign(std::move(value), assignType);
+void RuntimeObject::AssignField(Atom name, Value value, TokenType assignType) {
+	auto& field = m_FieldValues[name];
+	field.Assign(std::move(value), assignType);
+	Publish(field);
 }
 
-bool RuntimeObject::HasField(std::string const& name) const noexcept {
+bool RuntimeObject::HasField(Atom name) const noexcept {
 	return Type()->GetField(name) != nullptr;
 }
 
 
-Value RuntimeObject::GetFieldValue(std::string const& name) const {
+Value RuntimeObject::GetFieldValue(Atom name) const {
 	if (auto it = m_FieldValues.find(name); it != m_FieldValues.end())
 		return it->second;
 
@@ -59,7 +59,7 @@ Value RuntimeObject::GetFieldValue(std::string const& name) const {
 	throw RuntimeError(RuntimeErrorType::UnknownMember, std::format("Member '{}' not found on type '{}", name, Type()->Name()));
 }
 
-Value RuntimeObject::Invoke(Interpreter& intr, std::string const& name, std::vector<Value>& args, InvokeFlags flags) {
+Value RuntimeObject::Invoke(Interpreter& intr, Atom name, std::vector<Value>& args, InvokeFlags flags) {
 	return (flags & InvokeFlags::Static) == InvokeFlags::Static ? m_Type->Invoke(intr, name, args, flags) : m_Type->Invoke(intr, this, name, args, flags);
 }
 
@@ -89,17 +89,67 @@ void RuntimeObject::InvokeSetIndexer(Value const& index, Value const& value, Tok
 }
 
 int RuntimeObject::AddRef() const noexcept {
-	return ++m_RefCount;
+	if (m_Shared)
+		return ++m_RefCount;
+
+	// no other thread can see the count; this compiles to a plain increment
+	auto count = m_RefCount.load(std::memory_order_relaxed) + 1;
+	m_RefCount.store(count, std::memory_order_relaxed);
+	return count;
 }
 
 int RuntimeObject::Release() const noexcept {
-	auto count = --m_RefCount;
+	int count;
+	if (m_Shared) {
+		count = --m_RefCount;
+	}
+	else {
+		count = m_RefCount.load(std::memory_order_relaxed) - 1;
+		m_RefCount.store(count, std::memory_order_relaxed);
+	}
 	if (count == 0) {
 		delete this;
 	}
+	else if (m_Root == NotBuffered) {
+		// may have been the last reference into a cycle
+		if (auto collector = CycleCollector::Current())
+			collector->AddRoot(this);
+	}
 	return count;
 }
 
+void RuntimeObject::Share() const {
+	if (m_Shared)
+		return;
+
+	m_Shared = true;
+	std::vector<RuntimeObject const*> pending{ this }, refs;
+	while (!pending.empty()) {
+		auto obj = pending.back();
+		pending.pop_back();
+		refs.clear();
+		obj->GetReferences(refs);
+		if (obj->m_Type)
+			refs.push_back(obj->m_Type);
+		for (auto ref : refs) {
+			if (!ref->m_Shared) {
+				ref->m_Shared = true;
+				pending.push_back(ref);
+			}
+		}
+	}
+}
+
+void RuntimeObject::GetReferences(std::vector<RuntimeObject const*>& refs) const {
+	for (auto& [name, value] : m_FieldValues)
+		if (value.IsObject())
+			refs.push_back(value.AsObject());
+}
+
+void RuntimeObject::ReleaseReferences() noexcept {
+	m_FieldValues.clear();
+}
+
 std::string RuntimeObject::ToString() const {
 	return std::format("Object ({})", Type()->Name());
 }
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <map>
+#include <vector>
 
 #include "Value.h"
 #include "CoreInterfaces.h"
@@ -11,6 +13,7 @@
 namespace Dynamix {
 	class ObjectType;
 	class Interpreter;
+	class CycleCollector;
 
 	enum class InvokeFlags {
 		Instance = 0,
@@ -24,11 +27,12 @@ namespace Dynamix {
 	};
 
 	class RuntimeObject : NoCopy, public IServices {
+		friend class CycleCollector;
 	public:
-#ifdef _WIN32
+		// see ObjectHeap
 		void* operator new(size_t size);
-		void operator delete(void* p);
-#endif
+		void operator delete(void* p, size_t size);
+
 		explicit RuntimeObject(ObjectType* type);
 		RuntimeObject(RuntimeObject&& other) = default;
 		RuntimeObject& operator=(RuntimeObject&& other) = default;
@@ -39,9 +43,9 @@ namespace Dynamix {
 		virtual bool IsObjectType() const noexcept {
 			return false;
 		}
-		virtual void AssignField(std::string const& name, Value value, TokenType assignType = TokenType::Assign);
-		virtual Value GetFieldValue(std::string const& name) const;
-		virtual bool HasField(std::string const& name) const noexcept;
+		virtual void AssignField(Atom name, Value value, TokenType assignType = TokenType::Assign);
+		virtual Value GetFieldValue(Atom name) const;
+		virtual bool HasField(Atom name) const noexcept;
 
 		virtual bool SkipCheckNames() const noexcept {
 			return false;
@@ -64,21 +68,64 @@ namespace Dynamix {
 		virtual int AddRef() const noexcept;
 		virtual int Release() const noexcept;
 
-		virtual Value Invoke(Interpreter& intr, std::string const& name, std::vector<Value>& args, InvokeFlags flags = InvokeFlags::Method);
+		//
+		// objects created while their thread is confined (see Runtime::SetThreadingMode) are counted
+		// with plain increments. sharing one switches it, and everything it references, to atomic counting;
+		// it must be shared before another thread can reach it. objects stored into a shared object are shared too
+		//
+		static void SetConfined(bool confined) noexcept {
+			s_Confined = confined;
+		}
+		static bool IsConfined() noexcept {
+			return s_Confined;
+		}
+		bool IsShared() const noexcept {
+			return m_Shared;
+		}
+		void Share() const;
+
+		virtual Value Invoke(Interpreter& intr, Atom name, std::vector<Value>& args, InvokeFlags flags = InvokeFlags::Method);
 		virtual Value InvokeOperator(Interpreter& intr, TokenType op, Value const& rhs) const;
 		virtual Value InvokeOperator(Interpreter& intr, TokenType op) const;
 		virtual Value InvokeGetIndexer(Value const& index);
 		virtual void InvokeSetIndexer(Value const& index, Value const& value, TokenType assign);
 
+		//
+		// the objects this one holds a reference to, for the cycle collector and for sharing,
+		// and dropping those references before it frees the object. whatever holds references reports them
+		//
+		virtual void GetReferences(std::vector<RuntimeObject const*>& refs) const;
+		virtual void ReleaseReferences() noexcept;
+
 	protected:
-		std::map<std::string, Value> m_FieldValues;
+		std::map<Atom, Value> m_FieldValues;
 		int RefCount() const noexcept {
 			return m_RefCount;
 		}
+		// call with what is stored into this object
+		void Publish(Value const& value) const {
+			if (m_Shared && value.IsObject())
+				value.AsObject()->Share();
+		}
 
 	private:
+		enum class GcColor : uint8_t {
+			Black,
+			Gray,
+			White,
+		};
+		static constexpr int NotBuffered = -1;
+		static constexpr int Freeing = -2;
+
 		mutable std::atomic<int> m_RefCount{ 1 };
+		// index among the cycle collector's possible roots, or NotBuffered, or Freeing while it collects this
+		mutable int m_Root{ NotBuffered };
+		// the collector holding it among its roots, whichever thread releases it
+		mutable CycleCollector* m_Collector{ nullptr };
+		mutable GcColor m_Color{ GcColor::Black };
+		mutable bool m_Shared{ !s_Confined };
 		ObjectType* m_Type;
+		inline static thread_local bool s_Confined;
 	};
 
 }
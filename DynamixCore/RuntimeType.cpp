@@ -50,7 +50,7 @@ void RuntimeType::DumpStats(Interpreter& intr) {
 	}
 }
 
-Value RuntimeType::CreateObject(Interpreter& intr, std::vector<Value> const& args) {
+Value RuntimeType::NewObject(Interpreter& intr, std::vector<Value> const& args) {
 	// TODO
 	return Value();
 }
@@ -61,6 +61,6 @@ RuntimeType::RuntimeType() : StaticObjectType("Runtime") {
 		METHOD_STATIC(Eval, 1, return RuntimeType::Eval(intr, args);),
 		METHOD_STATIC(Ticks, 0, return RuntimeType::Ticks();),
 		METHOD_STATIC(DumpStats, 0, RuntimeType::DumpStats(intr); return Value();),
-		METHOD_STATIC(CreateObject, -1, return RuntimeType::CreateObject(intr, args);),
+		METHOD_STATIC(CreateObject, -1, return RuntimeType::NewObject(intr, args);),
 		END_METHODS()
 }
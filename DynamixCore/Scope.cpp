@@ -1,6 +1,8 @@
 #include "Scope.h"
 #include "ObjectType.h"
 #include <ranges>
+#include <algorithm>
+#include <cassert>
 
 using namespace Dynamix;
 using namespace std::ranges;
@@ -8,11 +10,25 @@ using namespace std::ranges;
 Scope::Scope(Scope* parent) : m_Parent(parent) {
 }
 
-bool Scope::AddElement(std::string name, Element var) {
+void Scope::Enter(Scope* parent, Slot* slots, int count) noexcept {
+	m_Parent = parent;
+	m_Slots = slots;
+	m_SlotCount = count;
+}
+
+void Scope::Leave() noexcept {
+	for (int i = 0; i < m_SlotCount; i++)
+		m_Slots[i] = Slot();
+	m_Elements.clear();
+	m_Uses.clear();
+	m_SlotCount = 0;
+}
+
+bool Scope::AddElement(Atom name, Element var) {
 	if (auto it = find_if(m_Elements, [&](auto& e) { return e.first == name; }); it != m_Elements.end())
 		it->second.emplace_back(std::move(var));
 	else
-		m_Elements.push_back({ std::move(name), std::vector { std::move(var) } });
+		m_Elements.push_back({ name, std::vector { std::move(var) } });
 
 	//if (auto it = m_Elements.find(name); it != m_Elements.end())
 	//	it->second.emplace_back(std::move(var));
@@ -21,54 +37,152 @@ bool Scope::AddElement(std::string name, Element var) {
 	return true;
 }
 
-Element* Scope::FindElement(std::string const& name, int arity, bool localOnly) {
-	if (auto it = find_if(m_Elements, [&](auto& e) { return e.first == name; }); it != m_Elements.end()) {
-		//if (auto it = m_Elements.find(name); it != m_Elements.end()) {
-		if (it->second.empty())
+Element* Scope::DefineSlot(int index, Atom name, Element var) {
+	//
+	// code the Resolver left unbound has no slots - keep it a named element
+	//
+	if (index < 0 || index >= m_SlotCount) {
+		AddElement(name, std::move(var));
+		return FindElement(name, -1, true);
+	}
+
+	auto& slot = m_Slots[index];
+	slot.Var = std::move(var);
+	slot.Name = name;
+	return &slot.Var;
+}
+
+Element* Scope::SlotElement(SlotRef ref) noexcept {
+	auto scope = this;
+	for (auto depth = ref.Depth; depth > 0; --depth)
+		scope = scope->m_Parent;
+
+	assert(ref.Index < scope->m_SlotCount);
+	auto& slot = scope->m_Slots[ref.Index];
+	return slot.Name.IsEmpty() ? nullptr : &slot.Var;
+}
+
+Element* Scope::FindSlot(Atom name) noexcept {
+	for (int i = 0; i < m_SlotCount; i++)
+		if (m_Slots[i].Name == name)
+			return &m_Slots[i].Var;
+	return nullptr;
+}
+
+//
+// lookups walk the parent chain in a loop: the chain runs through every active call,
+// so with deep recursion it is far longer than the native stack could recurse
+//
+Element* Scope::FindElement(Atom name, int arity, bool localOnly) {
+	for (auto scope = this; scope; scope = localOnly ? nullptr : scope->m_Parent) {
+		if (auto it = find_if(scope->m_Elements, [&](auto& e) { return e.first == name; }); it != scope->m_Elements.end()) {
+			//if (auto it = m_Elements.find(name); it != m_Elements.end()) {
+			if (it->second.empty())
+				return nullptr;
+			if (arity < 0 || it->second[0].Arity < 0)
+				return &it->second[0];
+			for (auto& v : it->second)
+				if (v.Arity == arity)
+					return &v;
 			return nullptr;
-		if (arity < 0 || it->second[0].Arity < 0)
-			return &it->second[0];
-		for (auto& v : it->second)
-			if (v.Arity == arity)
-				return &v;
-		return nullptr;
+		}
+		if (auto slot = scope->FindSlot(name))
+			return slot;
 	}
+	return nullptr;
+}
 
-	return m_Parent && !localOnly ? m_Parent->FindElement(name, arity) : nullptr;
+std::vector<Element*> Scope::FindElements(Atom name, bool localOnly, bool withUse) {
+	std::vector<Element*> v;
+	FindElements(name, v, localOnly, withUse);
+	return v;
 }
 
-std::vector<Element*> Scope::FindElements(std::string const& name, bool localOnly, bool withUse) {
-	if (auto it = find_if(m_Elements, [&](auto& e) { return e.first == name; }); it != m_Elements.end()) {
-//	if (auto it = m_Elements.find(name); it != m_Elements.end()) {
-		std::vector<Element*> v;
-		v.reserve(it->second.size());
-		for (auto& e : it->second)
-			v.push_back(&e);
-		if (withUse) {
-			auto element = FindElementWithUse(name);
-			if (element)
-				v.push_back(element);
+void Scope::FindElements(Atom name, std::vector<Element*>& v, bool localOnly, bool withUse) {
+	v.clear();
+	for (auto scope = this; scope; scope = localOnly ? nullptr : scope->m_Parent) {
+		if (auto it = find_if(scope->m_Elements, [&](auto& e) { return e.first == name; }); it != scope->m_Elements.end()) {
+	//	if (auto it = m_Elements.find(name); it != m_Elements.end()) {
+			for (auto& e : it->second)
+				v.push_back(&e);
 		}
+		if (auto slot = scope->FindSlot(name))
+			v.push_back(slot);
 
-		return v;
+		if (!v.empty()) {
+			if (withUse) {
+				auto element = scope->FindElementWithUse(name);
+				if (element)
+					v.push_back(element);
+			}
+			return;
+		}
 	}
-
-	return m_Parent && !localOnly ? m_Parent->FindElements(name, false, withUse) : std::vector<Element*>();
 }
 
-Element* Scope::FindElementWithUse(std::string const& name) {
-	for (auto const& use : m_Uses) {
-		auto cls = FindElement(use.Name);
-		if (cls) {
-			auto type = reinterpret_cast<ObjectType const*>(cls->VarValue.ToObject());
-			if (type->GetMember(name))
-				return cls;
+Element* Scope::FindElementWithUse(Atom name) {
+	for (auto scope = this; scope; scope = scope->m_Parent) {
+		for (auto const& use : scope->m_Uses) {
+			auto cls = scope->FindElement(use.Name);
+			if (cls) {
+				auto type = reinterpret_cast<ObjectType const*>(cls->VarValue.ToObject());
+				if (type->GetMember(name))
+					return cls;
+			}
 		}
 	}
-	return m_Parent ? m_Parent->FindElementWithUse(name) : nullptr;
+	return nullptr;
 }
 
-bool Scope::AddUse(std::string name, ElementFlags type) {
-	m_Uses.push_back(UseElement{ std::move(name), type });
+bool Scope::AddUse(Atom name, ElementFlags type) {
+	m_Uses.push_back(UseElement{ name, type });
 	return true;
 }
+
+FrameStack::FrameStack(Scope* global) {
+	m_Scopes.push_back(std::make_unique<Scope[]>(ScopeBlockSize));
+	m_Slots.push_back({ std::make_unique<Scope::Slot[]>(SlotBlockSize), SlotBlockSize });
+	m_Top = &m_Scopes[0][0];
+	m_Top->Enter(global, m_Slots[0].Slots.get(), 0);
+}
+
+FrameStack::~FrameStack() {
+	while (m_Depth > 0)
+		Pop();
+	m_Top->Leave();
+}
+
+Scope* FrameStack::Push(int slots) {
+	if (m_SlotTop + slots > m_Slots[m_SlotBlock].Size) {
+		//
+		// blocks past the current one hold no live frames, so one too small for this frame is replaced
+		//
+		m_SlotBlock++;
+		m_SlotTop = 0;
+		if (m_SlotBlock == (int)m_Slots.size())
+			m_Slots.push_back({});
+		auto& block = m_Slots[m_SlotBlock];
+		if (block.Size < slots) {
+			block.Size = std::max(slots, SlotBlockSize);
+			block.Slots = std::make_unique<Scope::Slot[]>(block.Size);
+		}
+	}
+	if (m_Depth + 1 == (int)m_Scopes.size() * ScopeBlockSize)
+		m_Scopes.push_back(std::make_unique<Scope[]>(ScopeBlockSize));
+
+	auto parent = m_Top;
+	m_Top = &At(++m_Depth);
+	m_Top->Enter(parent, m_Slots[m_SlotBlock].Slots.get() + m_SlotTop, slots);
+	m_Top->m_SlotBlock = m_SlotBlock;
+	m_SlotTop += slots;
+	return m_Top;
+}
+
+void FrameStack::Pop() noexcept {
+	assert(m_Depth > 0);
+	auto& scope = *m_Top;
+	m_SlotBlock = scope.m_SlotBlock;
+	m_SlotTop = (int)(scope.m_Slots - m_Slots[m_SlotBlock].Slots.get());
+	scope.Leave();
+	m_Top = &At(--m_Depth);
+}
@@ -1,7 +1,10 @@
 #pragma once
 
+#include <memory>
+#include <vector>
 #include "Value.h"
 #include "NoCopyMove.h"
+#include "SymbolTable.h"
 
 namespace Dynamix {
 	enum class ElementFlags : uint16_t {
@@ -24,23 +27,92 @@ namespace Dynamix {
 	};
 
 	struct UseElement {
-		std::string Name;
+		Atom Name;
 		ElementFlags Type;
 	};
 
 	class Scope : public NoCopy {
+		friend class FrameStack;
+		// compiled code reads resolved slots in place
+		friend class Jit;
 	public:
+		//
+		// variable bound by the Resolver; Name is empty until its declaration has run
+		//
+		struct Slot {
+			Element Var;
+			Atom Name;
+		};
+
 		explicit Scope(Scope* parent = nullptr);
-		bool AddElement(std::string name, Element var);
-		Element* FindElement(std::string const& name, int arity = -1, bool localOnly = false);
-		std::vector<Element*> FindElements(std::string const& name, bool localOnly = false, bool withUse = false);
-		Element* FindElementWithUse(std::string const& name);
-		bool AddUse(std::string name, ElementFlags type = ElementFlags::DefaultClass);
+		// a scope on a FrameStack is reused: Enter binds it to its slots, Leave releases its variables
+		void Enter(Scope* parent, Slot* slots, int count) noexcept;
+		void Leave() noexcept;
+
+		bool AddElement(Atom name, Element var);
+		Element* DefineSlot(int index, Atom name, Element var);
+		Element* SlotElement(SlotRef slot) noexcept;
+		Element* FindElement(Atom name, int arity = -1, bool localOnly = false);
+		std::vector<Element*> FindElements(Atom name, bool localOnly = false, bool withUse = false);
+		void FindElements(Atom name, std::vector<Element*>& elements, bool localOnly = false, bool withUse = false);
+		Element* FindElementWithUse(Atom name);
+		bool AddUse(Atom name, ElementFlags type = ElementFlags::DefaultClass);
 		Scope Clone() const;
 
 	private:
-		std::vector<std::pair<std::string, std::vector<Element>>> m_Elements;
+		Element* FindSlot(Atom name) noexcept;
+
+		std::vector<std::pair<Atom, std::vector<Element>>> m_Elements;
 		std::vector<UseElement> m_Uses;
+		Slot* m_Slots{ nullptr };
+		int m_SlotCount{ 0 };
+		// the FrameStack slot block m_Slots points into
+		int m_SlotBlock{ 0 };
 		Scope* m_Parent;
 	};
-}
\ No newline at end of file
+
+	//
+	// the interpreter's scopes: scope headers and the variable slots they window into, kept in blocks
+	// that are allocated as the stack first grows and reused after. pushing bumps both tops,
+	// popping releases the frame's variables and drops them back. a frame's slots never span two blocks
+	//
+	class FrameStack : NoCopy {
+	public:
+		static constexpr int ScopeBlockSize = 256;
+		static constexpr int SlotBlockSize = 1 << 14;
+
+		explicit FrameStack(Scope* global);
+		~FrameStack();
+
+		Scope* Push(int slots);
+		void Pop() noexcept;
+
+		Scope& Top() noexcept {
+			return *m_Top;
+		}
+		int Depth() const noexcept {
+			return m_Depth;
+		}
+		// where the top scope is kept, for code that follows the stack while it runs
+		Scope* const* TopAddress() const noexcept {
+			return &m_Top;
+		}
+
+	private:
+		struct SlotBlock {
+			std::unique_ptr<Scope::Slot[]> Slots;
+			int Size;
+		};
+
+		Scope& At(int depth) noexcept {
+			return m_Scopes[depth / ScopeBlockSize][depth % ScopeBlockSize];
+		}
+
+		std::vector<std::unique_ptr<Scope[]>> m_Scopes;
+		std::vector<SlotBlock> m_Slots;
+		Scope* m_Top;
+		int m_Depth{ 0 };
+		int m_SlotBlock{ 0 };
+		int m_SlotTop{ 0 };
+	};
+}
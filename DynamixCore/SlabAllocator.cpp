@@ -0,0 +1,324 @@
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+#include "SlabAllocator.h"
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+using namespace Dynamix;
+using namespace std;
+
+namespace {
+	// classes are 16 bytes apart, so a block wastes no more than the global heap's rounding would
+	constexpr int ClassCount = SlabAllocator::MaxSize / 16;
+
+	constexpr int SizeClass(size_t size) noexcept {
+		return size ? int((size - 1) >> 4) : 0;
+	}
+
+	constexpr size_t ClassSize(int c) noexcept {
+		return size_t(c + 1) << 4;
+	}
+
+	struct Block {
+		Block* Next;
+	};
+
+	//
+	// a slab starts with its header, and is aligned to its size, so a block finds its slab by masking its address
+	//
+	struct Slab {
+		// among the class's slabs with a block to hand out
+		Slab* Prev;
+		Slab* Next;
+		// blocks handed back, and the part not handed out yet
+		Block* Free;
+		char* Carve;
+		// blocks out of the slab: in use, or in a thread's list
+		int Used;
+	};
+
+	constexpr size_t HeaderSize = (sizeof(Slab) + 15) & ~size_t(15);
+
+	Slab* SlabOf(void* block) noexcept {
+		return reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(block) & ~uintptr_t(SlabAllocator::SlabSize - 1));
+	}
+
+	bool IsFull(Slab const* slab, int c) noexcept {
+		return !slab->Free && reinterpret_cast<char const*>(slab) + SlabAllocator::SlabSize - slab->Carve < ptrdiff_t(ClassSize(c));
+	}
+
+	//
+	// slabs are mapped straight from the system, so returning one gives its pages back
+	//
+	void* MapSlab() {
+		constexpr auto size = SlabAllocator::SlabSize;
+#ifdef _WIN32
+		return ::operator new(size, align_val_t(size));
+#else
+		auto p = static_cast<char*>(::mmap(nullptr, 2 * size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		if (p == MAP_FAILED)
+			throw bad_alloc();
+		// keep the aligned half
+		auto slab = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(p) + size - 1) & ~uintptr_t(size - 1));
+		if (slab > p)
+			::munmap(p, slab - p);
+		if (auto end = p + 2 * size; slab + size < end)
+			::munmap(slab + size, end - (slab + size));
+		return slab;
+#endif
+	}
+
+	void UnmapSlab(void* slab) noexcept {
+#ifdef _WIN32
+		::operator delete(slab, align_val_t(SlabAllocator::SlabSize));
+#else
+		::munmap(slab, SlabAllocator::SlabSize);
+#endif
+	}
+
+	struct ThreadCache;
+
+	//
+	// what all threads share; never destroyed, as blocks are still freed during static destruction
+	//
+	struct Shared {
+		mutex Lock;
+		// per class, the slabs with a block to hand out, and how many of them are empty
+		Slab* Available[ClassCount]{};
+		int Empty[ClassCount]{};
+		size_t Slabs{ 0 };
+		// counts of the threads that are gone
+		size_t Allocated[ClassCount]{};
+		size_t Freed[ClassCount]{};
+		vector<ThreadCache*> Caches;
+
+		// count blocks, linked. call with the lock held
+		Block* Take(int c, int count) {
+			Block* head = nullptr;
+			for (int taken = 0; taken < count; taken++) {
+				auto slab = Available[c];
+				if (!slab)
+					slab = NewSlab(c);
+
+				Block* block;
+				if (slab->Free) {
+					block = slab->Free;
+					slab->Free = block->Next;
+				}
+				else {
+					block = reinterpret_cast<Block*>(slab->Carve);
+					slab->Carve += ClassSize(c);
+				}
+				if (slab->Used++ == 0)
+					Empty[c]--;
+				if (IsFull(slab, c))
+					Unlink(slab, c);
+				block->Next = head;
+				head = block;
+			}
+			return head;
+		}
+
+		// call with the lock held
+		void Give(int c, Block* block) noexcept {
+			auto slab = SlabOf(block);
+			if (IsFull(slab, c))
+				Link(slab, c);
+			block->Next = slab->Free;
+			slab->Free = block;
+			if (--slab->Used > 0)
+				return;
+
+			if (Empty[c] < SlabAllocator::SpareSlabs) {
+				Empty[c]++;
+				return;
+			}
+			Unlink(slab, c);
+			UnmapSlab(slab);
+			Slabs--;
+		}
+
+	private:
+		Slab* NewSlab(int c) {
+			auto slab = static_cast<Slab*>(MapSlab());
+			slab->Free = nullptr;
+			slab->Carve = reinterpret_cast<char*>(slab) + HeaderSize;
+			slab->Used = 0;
+			Link(slab, c);
+			Empty[c]++;
+			Slabs++;
+			return slab;
+		}
+
+		void Link(Slab* slab, int c) noexcept {
+			slab->Prev = nullptr;
+			slab->Next = Available[c];
+			if (slab->Next)
+				slab->Next->Prev = slab;
+			Available[c] = slab;
+		}
+
+		void Unlink(Slab* slab, int c) noexcept {
+			if (slab->Prev)
+				slab->Prev->Next = slab->Next;
+			else
+				Available[c] = slab->Next;
+			if (slab->Next)
+				slab->Next->Prev = slab->Prev;
+		}
+	};
+
+	Shared& TheShared() {
+		static auto shared = new Shared;
+		return *shared;
+	}
+
+	//
+	// a thread's free lists. the counts are written by the thread only, and read by GetStats.
+	// it is trivial to construct and destroy, so using it costs no initialization check;
+	// the thread registers it on first use, and a separate object hands it back when the thread ends
+	//
+	struct ThreadCache {
+		Block* Free[ClassCount];
+		int Count[ClassCount];
+		atomic<size_t> Allocated[ClassCount];
+		atomic<size_t> Freed[ClassCount];
+		bool Registered;
+
+		void Register();
+		void Unregister() noexcept;
+
+		void Refill(int c) {
+			auto& shared = TheShared();
+			lock_guard lock(shared.Lock);
+			Free[c] = shared.Take(c, SlabAllocator::Batch);
+			Count[c] = SlabAllocator::Batch;
+		}
+
+		void Flush(int c, int count) noexcept {
+			Count[c] -= count;
+			auto& shared = TheShared();
+			lock_guard lock(shared.Lock);
+			while (count-- > 0) {
+				auto block = Free[c];
+				Free[c] = block->Next;
+				shared.Give(c, block);
+			}
+		}
+	};
+
+	constinit thread_local ThreadCache t_Cache{};
+	// set once the thread's cache is handed back; later calls on the thread go to the shared lists
+	constinit thread_local bool t_CacheGone{ false };
+
+	struct ThreadExit {
+		~ThreadExit() {
+			t_Cache.Unregister();
+		}
+	};
+
+	void ThreadCache::Register() {
+		thread_local ThreadExit handBack;
+		auto& shared = TheShared();
+		lock_guard lock(shared.Lock);
+		shared.Caches.push_back(this);
+		Registered = true;
+	}
+
+	void ThreadCache::Unregister() noexcept {
+		for (int c = 0; c < ClassCount; c++)
+			if (Count[c])
+				Flush(c, Count[c]);
+
+		auto& shared = TheShared();
+		lock_guard lock(shared.Lock);
+		for (int c = 0; c < ClassCount; c++) {
+			shared.Allocated[c] += Allocated[c].load(memory_order_relaxed);
+			shared.Freed[c] += Freed[c].load(memory_order_relaxed);
+		}
+		erase(shared.Caches, this);
+		t_CacheGone = true;
+	}
+
+	// the owner's counter; a plain increment, visible to GetStats
+	void Count(atomic<size_t>& counter) noexcept {
+		counter.store(counter.load(memory_order_relaxed) + 1, memory_order_relaxed);
+	}
+}
+
+void* SlabAllocator::Allocate(size_t size) {
+	if (size > MaxSize)
+		return ::operator new(size);
+
+	auto c = SizeClass(size);
+	if (t_CacheGone) {
+		auto& shared = TheShared();
+		lock_guard lock(shared.Lock);
+		shared.Allocated[c]++;
+		return shared.Take(c, 1);
+	}
+
+	auto& cache = t_Cache;
+	if (!cache.Free[c]) {
+		if (!cache.Registered)
+			cache.Register();
+		cache.Refill(c);
+	}
+	auto block = cache.Free[c];
+	cache.Free[c] = block->Next;
+	cache.Count[c]--;
+	Count(cache.Allocated[c]);
+	return block;
+}
+
+void SlabAllocator::Free(void* p, size_t size) noexcept {
+	if (!p)
+		return;
+	if (size > MaxSize) {
+		::operator delete(p);
+		return;
+	}
+
+	auto c = SizeClass(size);
+	auto block = static_cast<Block*>(p);
+	if (t_CacheGone) {
+		auto& shared = TheShared();
+		lock_guard lock(shared.Lock);
+		shared.Freed[c]++;
+		shared.Give(c, block);
+		return;
+	}
+
+	auto& cache = t_Cache;
+	if (!cache.Registered)
+		cache.Register();
+	block->Next = cache.Free[c];
+	cache.Free[c] = block;
+	Count(cache.Freed[c]);
+	if (++cache.Count[c] > 2 * Batch)
+		cache.Flush(c, Batch);
+}
+
+SlabAllocator::Stats SlabAllocator::GetStats() {
+	auto& shared = TheShared();
+	lock_guard lock(shared.Lock);
+	Stats stats;
+	stats.Slabs = shared.Slabs;
+	for (int c = 0; c < ClassCount; c++) {
+		auto allocated = shared.Allocated[c];
+		auto freed = shared.Freed[c];
+		for (auto cache : shared.Caches) {
+			allocated += cache->Allocated[c].load(memory_order_relaxed);
+			freed += cache->Freed[c].load(memory_order_relaxed);
+		}
+		// another thread's free may be counted before the allocation it matches
+		auto live = allocated > freed ? allocated - freed : 0;
+		stats.Classes.push_back({ ClassSize(c), live, live * ClassSize(c) });
+	}
+	return stats;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Dynamix {
+	//
+	// size-class allocator behind RuntimeObject and AstNode where there is no private heap (everywhere but Windows).
+	// blocks of a class are carved out of 64 KB slabs and recycled through free lists: each thread
+	// keeps its own list per class, refilled from and flushed to the slabs a batch at a time, so most
+	// allocations and frees touch neither a lock nor an atomic. a slab keeps the blocks handed back to it;
+	// once all of them are back, a class keeps up to SpareSlabs such empty slabs and returns the rest to the system.
+	// callers pass the size to Free, as sized operator delete does; sizes above MaxSize go to the global heap
+	//
+	class SlabAllocator final {
+	public:
+		static constexpr size_t SlabSize = 64 << 10;
+		static constexpr size_t MaxSize = 512;
+		// blocks moved between a thread's list and the slabs at a time
+		static constexpr int Batch = 32;
+		// empty slabs a class keeps for the next burst of allocations
+		static constexpr int SpareSlabs = 2;
+
+		struct ClassStats {
+			size_t Size;
+			size_t LiveBlocks;
+			size_t LiveBytes;
+		};
+		struct Stats {
+			std::vector<ClassStats> Classes;
+			// slabs held now
+			size_t Slabs;
+		};
+
+		static void* Allocate(size_t size);
+		static void Free(void* p, size_t size) noexcept;
+
+		// totals over all threads; exact once other threads stop allocating
+		static Stats GetStats();
+
+		SlabAllocator() = delete;
+	};
+}
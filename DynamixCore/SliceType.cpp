@@ -43,6 +43,11 @@ SliceObject::~SliceObject() noexcept {
 	m_Target->Release();
 }
 
+void SliceObject::GetReferences(std::vector<RuntimeObject const*>& refs) const {
+	RuntimeObject::GetReferences(refs);
+	refs.push_back(m_Target);
+}
+
 std::string SliceObject::ToString() const {
 	std::string text("[ ");
 	for (Int i = 0; Size() < 0 ? true : (i < Size()); i++) {
@@ -41,6 +41,9 @@ namespace Dynamix {
 		void InvokeSetIndexer(Value const& index, Value const& value, TokenType assign) override;
 		Value GetByIndex(Int index) const;
 
+		// the target is released with the slice
+		void GetReferences(std::vector<RuntimeObject const*>& refs) const override;
+
 	private:
 		struct Enumerator : IEnumerator {
 			Enumerator(SliceObject const* slice);
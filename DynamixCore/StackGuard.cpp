@@ -0,0 +1,132 @@
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <utility>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <pthread.h>
+#include <ucontext.h>
+#endif
+
+#include "StackGuard.h"
+#include "Runtime.h"
+
+using namespace Dynamix;
+using namespace std;
+
+namespace {
+	//
+	// lowest usable address of the stack this thread runs on, looked up once per thread
+	// and replaced while code runs on a stack from RunOnStack
+	//
+	thread_local char const* s_Limit;
+	thread_local bool s_LimitKnown;
+
+	char const* ThreadStackLimit() noexcept {
+#ifdef _WIN32
+		ULONG_PTR low, high;
+		::GetCurrentThreadStackLimits(&low, &high);
+		return reinterpret_cast<char const*>(low);
+#else
+		void* addr = nullptr;
+		size_t size = 0;
+		pthread_attr_t attr;
+		if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+			pthread_attr_getstack(&attr, &addr, &size);
+			pthread_attr_destroy(&attr);
+		}
+		return static_cast<char const*>(addr);
+#endif
+	}
+
+	struct StackRun {
+		function<void()> const* Run;
+		exception_ptr Error;
+#ifdef _WIN32
+		void* Caller;
+#else
+		ucontext_t Caller, Callee;
+#endif
+
+		void Execute() noexcept {
+			try {
+				(*Run)();
+			}
+			catch (...) {
+				Error = current_exception();
+			}
+		}
+	};
+
+#ifdef _WIN32
+	void CALLBACK FiberEntry(void* param) {
+		auto run = static_cast<StackRun*>(param);
+		run->Execute();
+		::SwitchToFiber(run->Caller);
+	}
+#else
+	// makecontext only passes int arguments, so the entry point finds its work here
+	thread_local StackRun* s_Run;
+
+	void ContextEntry() {
+		s_Run->Execute();
+	}
+#endif
+}
+
+size_t StackGuard::Remaining() noexcept {
+	if (!s_LimitKnown) {
+		s_Limit = ThreadStackLimit();
+		s_LimitKnown = true;
+	}
+	volatile char marker = 0;
+	auto sp = const_cast<char const*>(&marker);
+	if (!s_Limit)
+		return SIZE_MAX;
+	return sp > s_Limit ? size_t(sp - s_Limit) : 0;
+}
+
+void StackGuard::RunOnStack(size_t size, function<void()> const& f) {
+	StackRun run{ &f };
+	auto limit = exchange(s_Limit, nullptr);
+	auto known = exchange(s_LimitKnown, false);
+
+#ifdef _WIN32
+	auto converted = !::IsThreadAFiber();
+	run.Caller = converted ? ::ConvertThreadToFiber(nullptr) : ::GetCurrentFiber();
+	// the size is reserved, not committed, so a large stack costs only what is used of it
+	auto fiber = ::CreateFiberEx(0, size, FIBER_FLAG_FLOAT_SWITCH, FiberEntry, &run);
+	if (fiber) {
+		// the fiber's own bounds are looked up on its first probe
+		::SwitchToFiber(fiber);
+		::DeleteFiber(fiber);
+	}
+	if (converted)
+		::ConvertFiberToThread();
+	s_Limit = limit;
+	s_LimitKnown = known;
+	if (!fiber)
+		throw RuntimeError(RuntimeErrorType::StackOverflow, "Cannot allocate a stack to run on");
+#else
+	auto stack = make_unique_for_overwrite<char[]>(size);
+	getcontext(&run.Callee);
+	run.Callee.uc_stack.ss_sp = stack.get();
+	run.Callee.uc_stack.ss_size = size;
+	run.Callee.uc_link = &run.Caller;
+	makecontext(&run.Callee, ContextEntry, 0);
+
+	s_Limit = stack.get();
+	s_LimitKnown = true;
+	auto outer = exchange(s_Run, &run);
+	swapcontext(&run.Caller, &run.Callee);
+	s_Run = outer;
+	s_Limit = limit;
+	s_LimitKnown = known;
+#endif
+
+	if (run.Error)
+		rethrow_exception(run.Error);
+}
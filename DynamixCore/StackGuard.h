@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+namespace Dynamix {
+	//
+	// the native stack of the running thread: how much of it is left below the caller,
+	// and a way to run code on a larger stack than the thread was created with
+	//
+	class StackGuard final {
+	public:
+		// stack kept free for the work done between two probes
+		static constexpr size_t DefaultReserve = 128 << 10;
+
+		// bytes between the caller's frame and the end of the stack; SIZE_MAX if the bounds are unknown
+		static size_t Remaining() noexcept;
+		// runs f on a fresh stack of the given size; an exception thrown by f propagates to the caller
+		static void RunOnStack(size_t size, std::function<void()> const& f);
+	};
+}
@@ -9,11 +9,11 @@ StructType::StructType(std::string name, StructDesc desc) noexcept : ObjectType(
 	m_Desc.TotalSize = size;
 }
 
-bool StructType::HasField(std::string const& name) const noexcept {
+bool StructType::HasField(Atom name) const noexcept {
 	return std::find_if(m_Desc.Fields.begin(), m_Desc.Fields.end(), [&](auto& f) { return f.Name == name; }) != m_Desc.Fields.end();
 }
 
-StructField const* StructType::GetStructField(std::string const& name) const noexcept {
+StructField const* StructType::GetStructField(Atom name) const noexcept {
 	if (auto const it = std::find_if(m_Desc.Fields.begin(), m_Desc.Fields.end(), [&](auto& f) { return f.Name == name; }); it != m_Desc.Fields.end())
 		return &(*it);
 
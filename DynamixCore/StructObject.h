@@ -9,7 +9,7 @@
 
 namespace Dynamix {
 	struct StructField {
-		std::string Name;
+		Atom Name;
 		ValueType Type;
 		uint16_t Size;
 		uint16_t Offset;
@@ -30,8 +30,8 @@ namespace Dynamix {
 			return m_Desc;
 		}
 
-		bool HasField(std::string const& name) const noexcept;
-		StructField const* GetStructField(std::string const& name) const noexcept;
+		bool HasField(Atom name) const noexcept;
+		StructField const* GetStructField(Atom name) const noexcept;
 
 	private:
 		StructDesc m_Desc;
@@ -63,7 +63,7 @@ namespace Dynamix {
 			return static_cast<T*>(&m_Data);
 		}
 
-		bool HasField(std::string const& name) const noexcept override {
+		bool HasField(Atom name) const noexcept override {
 			return Type()->HasField(name);
 		}
 		//void AssignField(std::string const& name, Value value, TokenType assignType = TokenType::Assign) override;
@@ -79,20 +79,20 @@ namespace Dynamix {
 		StructObjectT(StructType* type) noexcept: RuntimeObject(type) {}
 		StructObjectT(StructType* type, T value) noexcept : RuntimeObject(type), m_Data(std::move(value)) {}
 
-		template<typename T>
+		template<typename U = T>
 		T& Object() noexcept {
 			return m_Data;
 		}
 
-		template<typename T>
+		template<typename U = T>
 		T const& Object() const noexcept {
 			return m_Data;
 		}
 
-		bool HasField(std::string const& name) const noexcept override {
+		bool HasField(Atom name) const noexcept override {
 			return Type()->HasField(name);
 		}
-		Value GetFieldValue(std::string const& name) const override {
+		Value GetFieldValue(Atom name) const override {
 			auto field = reinterpret_cast<StructType const*>(Type())->GetStructField(name);
 			assert(field);
 			return ValueFromField(&m_Data, field);
@@ -7,10 +7,10 @@ SymbolTable::SymbolTable(SymbolTable* parent) : m_Parent(parent) {
 }
 
 bool SymbolTable::AddSymbol(Symbol sym) {
-	return m_Symbols.insert({ sym.Name, move(sym) }).second;
+	return m_Symbols.insert({ Atom(sym.Name), move(sym) }).second;
 }
 
-Symbol const* SymbolTable::FindSymbol(string const& name, bool localOnly) const {
+Symbol const* SymbolTable::FindSymbol(Atom name, bool localOnly) const {
 	if (auto it = m_Symbols.find(name); it != m_Symbols.end())
 		return &(it->second);
 
@@ -36,6 +36,19 @@ namespace Dynamix {
 
 	class Interpreter;
 
+	//
+	// location of a variable in the runtime scopes, as bound by the Resolver
+	// Depth counts scopes up from the current one; an Index of -1 means lookup by name
+	//
+	struct SlotRef {
+		int16_t Depth{ 0 };
+		int16_t Index{ -1 };
+
+		bool IsResolved() const noexcept {
+			return Index >= 0;
+		}
+	};
+
 	struct Symbol {
 		std::string Name;
 		SymbolType Type;
@@ -43,24 +56,18 @@ namespace Dynamix {
 	};
 
 	class SymbolTable {
-		friend class AstNode;
 	public:
 		explicit SymbolTable(SymbolTable* parent = nullptr);
 		bool AddSymbol(Symbol sym);
-		Symbol const* FindSymbol(std::string const& name, bool localOnly = false) const;
+		Symbol const* FindSymbol(Atom name, bool localOnly = false) const;
 		SymbolTable const* Parent() const {
 			return m_Parent;
 		}
 		std::vector<Symbol const*> EnumSymbols() const;
 		void Clear();
 
-	protected:
-		void SetParent(SymbolTable* parent) {
-			m_Parent = parent;
-		}
-
 	private:
-		std::unordered_map<std::string, Symbol> m_Symbols;
+		std::unordered_map<Atom, Symbol> m_Symbols;
 		SymbolTable* m_Parent;
 	};
 }
@@ -0,0 +1,132 @@
+#include <algorithm>
+
+#include "TieredCompiler.h"
+#include "Compiler.h"
+#include "Jit.h"
+#include "AstNode.h"
+
+using namespace Dynamix;
+using namespace std;
+
+namespace {
+	//
+	// the live compilers, so a body going away can be taken off all of them;
+	// the count spares destroying trees the lock while there are none
+	//
+	atomic<int> s_Count;
+	mutex s_Lock;
+	vector<TieredCompiler*> s_Compilers;
+}
+
+TieredCompiler::TieredCompiler() : m_Thread([this] { Run(); }) {
+	lock_guard lock(s_Lock);
+	s_Compilers.push_back(this);
+	s_Count++;
+}
+
+TieredCompiler::~TieredCompiler() {
+	{
+		lock_guard lock(s_Lock);
+		erase(s_Compilers, this);
+		s_Count--;
+	}
+	{
+		lock_guard lock(m_Lock);
+		m_Stop = true;
+	}
+	m_Wake.notify_one();
+	m_Thread.join();
+}
+
+void TieredCompiler::Enqueue(AstNode const* body) {
+	auto& calls = m_Calls[body];
+	if (calls < 0)
+		return;
+	calls = -1;
+	{
+		lock_guard lock(m_Lock);
+		m_Queue.push_back(body);
+	}
+	m_Wake.notify_one();
+}
+
+void TieredCompiler::InstallFinished() {
+	vector<pair<AstNode const*, shared_ptr<CodeChunk>>> done;
+	vector<AstNode const*> forgotten;
+	{
+		lock_guard lock(m_Lock);
+		done.swap(m_Done);
+		forgotten.swap(m_Forgotten);
+		m_Finished.store(false, memory_order_relaxed);
+	}
+	// a new body may have come to live at the same address, and starts counting again
+	for (auto body : forgotten)
+		m_Calls.erase(body);
+	for (auto& [body, code] : done)
+		body->SetCompiledCode(move(code));
+}
+
+void TieredCompiler::Drain() {
+	unique_lock lock(m_Lock);
+	m_Idle.wait(lock, [this] { return m_Queue.empty() && !m_Compiling; });
+}
+
+void TieredCompiler::Forget(AstNode const* body) noexcept {
+	if (s_Count.load(memory_order_acquire) == 0)
+		return;
+
+	lock_guard lock(s_Lock);
+	for (auto compiler : s_Compilers)
+		compiler->Cancel(body);
+}
+
+void TieredCompiler::Cancel(AstNode const* body) noexcept {
+	unique_lock lock(m_Lock);
+	erase(m_Queue, body);
+	m_Idle.wait(lock, [=, this] { return m_Compiling != body; });
+	erase_if(m_Done, [=](auto& done) { return done.first == body; });
+	m_Forgotten.push_back(body);
+	m_Finished.store(true, memory_order_release);
+}
+
+void TieredCompiler::Run() {
+	//
+	// the thread's own compilers; nothing it builds is seen by the script's thread until installed
+	//
+	Compiler compiler;
+	unique_ptr<Jit> jit;
+	if (Jit::IsSupported())
+		jit = make_unique<Jit>();
+
+	unique_lock lock(m_Lock);
+	for (;;) {
+		m_Wake.wait(lock, [this] { return m_Stop || !m_Queue.empty(); });
+		if (m_Stop)
+			return;
+
+		auto body = m_Queue.front();
+		m_Queue.pop_front();
+		m_Compiling = body;
+		lock.unlock();
+
+		shared_ptr<CodeChunk> code;
+		try {
+			code = compiler.Compile(body, true);
+			if (jit && jit->Compile(*code, body))
+				m_Native++;
+			m_Compiled++;
+		}
+		catch (...) {
+			// left to the tree-walker
+			code.reset();
+		}
+
+		lock.lock();
+		m_Compiling = nullptr;
+		if (code) {
+			m_Done.emplace_back(body, move(code));
+			m_Finished.store(true, memory_order_release);
+		}
+		m_Idle.notify_all();
+	}
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Bytecode.h"
+#include "NoCopyMove.h"
+
+namespace Dynamix {
+	class AstNode;
+
+	//
+	// the compiler thread behind tiered execution. function bodies start on the tree-walker, which
+	// counts their calls and their loops' iterations; a body that gets hot is compiled to bytecode
+	// on the thread, and to machine code where the JIT is supported, while the interpreter keeps walking it.
+	// finished code is installed on its body by the thread running the script, at a call boundary,
+	// so a body is never switched while it runs
+	//
+	class TieredCompiler final : NoCopy {
+	public:
+		// calls of a function body before it is compiled
+		static constexpr int HotCalls = 100;
+		// iterations of one loop before the function running it is compiled
+		static constexpr int HotIterations = 1000;
+
+		TieredCompiler();
+		~TieredCompiler();
+
+		void CountCall(AstNode const* body) {
+			if (auto& calls = m_Calls[body]; calls >= 0 && ++calls >= HotCalls)
+				Enqueue(body);
+		}
+
+		// hands a body to the compiler thread; each body is compiled once, whether or not that succeeds
+		void Enqueue(AstNode const* body);
+
+		// installs the code finished since the last call, and drops the counts of bodies since destroyed
+		void Install() {
+			if (m_Finished.load(std::memory_order_acquire))
+				InstallFinished();
+		}
+
+		// waits until the thread has compiled every body handed to it
+		void Drain();
+
+		//
+		// drops every trace of a body about to be destroyed from all compilers, waiting out its compilation
+		// if it is under way; called by the node owning the body, on whatever thread destroys it.
+		// each compiler's call counts belong to its script's thread, so they are dropped at its next call
+		//
+		static void Forget(AstNode const* body) noexcept;
+
+		// bodies compiled, and how many of them to machine code
+		int CompiledCount() const noexcept {
+			return m_Compiled.load(std::memory_order_relaxed);
+		}
+		int NativeCount() const noexcept {
+			return m_Native.load(std::memory_order_relaxed);
+		}
+
+	private:
+		void Run();
+		void InstallFinished();
+		void Cancel(AstNode const* body) noexcept;
+
+		// calls counted per body, or -1 once it is queued; only the script's thread touches them
+		std::unordered_map<AstNode const*, int> m_Calls;
+
+		std::mutex m_Lock;
+		std::condition_variable m_Wake, m_Idle;
+		std::deque<AstNode const*> m_Queue;
+		std::vector<std::pair<AstNode const*, std::shared_ptr<CodeChunk>>> m_Done;
+		// bodies destroyed since the last call, whose counts are still in m_Calls
+		std::vector<AstNode const*> m_Forgotten;
+		// set when there is code to install or bodies to forget
+		std::atomic<bool> m_Finished{ false };
+		std::atomic<int> m_Compiled{ 0 }, m_Native{ 0 };
+		// the body on the thread's hands, if any
+		AstNode const* m_Compiling{ nullptr };
+		bool m_Stop{ false };
+		std::thread m_Thread;
+	};
+}
@@ -3,6 +3,8 @@
 #include <string>
 #include <string_view>
 
+#include "Atom.h"
+
 namespace Dynamix {
 	enum class TokenType : uint16_t {
 		Invalid,	
@@ -117,10 +119,18 @@ namespace Dynamix {
 		MetaDefault,
 	};
 
+	//
+	// the source file is interned in the atom table, so a location is a few integers
+	// that tokens and nodes copy freely; the empty atom stands for code not read from a file
+	//
 	struct CodeLocation {
 		int Line;
 		int Col;
-		std::string FileName;
+		Atom File;
+
+		std::string const& FileName() const noexcept {
+			return File.ToString();
+		}
 	};
 
 	struct Token final {
@@ -1,7 +1,6 @@
 #include "Tokenizer.h"
 #include <assert.h>
-#include <filesystem>
-#include <fstream>
+#include <cstring>
 
 using namespace std;
 using namespace Dynamix;
@@ -9,6 +8,7 @@ using namespace Dynamix;
 bool Tokenizer::Tokenize(string_view text, int line) {
 	m_Line = line;
 	m_Col = 1;
+	m_Source = text;
 	m_Current = text.data();
 	m_Next.Clear();
 	m_MultiLineCommentNesting = 0;
@@ -16,18 +16,23 @@ bool Tokenizer::Tokenize(string_view text, int line) {
 }
 
 bool Tokenizer::TokenizeFile(std::string_view filename) {
-	error_code ec;
-	auto len = filesystem::file_size(filename, ec);
-	if (ec.value())
-		return false;
-	ifstream stm(filename.data());
-	if (!stm.good())
+	m_Text.reset();
+	if (!m_Mapping.Open(filename))
 		return false;
 
-	m_Text = std::make_unique<char[]>(len);
-	stm.read(m_Text.get(), len);
-	m_FileName = filename;
-	return Tokenize(m_Text.get(), 1);
+	m_File = Atom(filename);
+	if (m_Mapping.IsTerminated())
+		return Tokenize(m_Mapping.View(), 1);
+
+	//
+	// the file fills its last page, so there is nothing to read as the terminator; copy it
+	//
+	auto len = m_Mapping.Size();
+	m_Text = std::make_unique<char[]>(len + 1);
+	memcpy(m_Text.get(), m_Mapping.Data(), len);
+	m_Text[len] = 0;
+	m_Mapping.Close();
+	return Tokenize({ m_Text.get(), len }, 1);
 }
 
 void Tokenizer::SetCommentToEndOfLine(std::string_view chars) {
@@ -132,7 +137,8 @@ bool Tokenizer::ProcessSingleLineComment() noexcept {
 		m_Current = current;
 		while (*m_Current && *m_Current != '\n')
 			m_Current++;
-		m_Current++;
+		if (*m_Current)
+			m_Current++;
 		m_Line++;
 		m_Col = 1;
 		return true;
@@ -159,20 +165,21 @@ void Tokenizer::EatWhitespace() noexcept {
 }
 
 Token Tokenizer::ParseIdentifier() {
-	std::string lexeme;
+	auto start = m_Current, end = m_Current;
 	char ch = *m_Current;
 	while (ch && !isspace(ch) && (ch == '_' || !ispunct(ch))) {
 		if (ProcessSingleLineComment())
 			break;
-		lexeme += ch;
 		ch = *++m_Current;
+		end = m_Current;
 		m_Col++;
 	}
+	string_view lexeme(start, end - start);
 	assert(!lexeme.empty());
 	auto type = TokenType::Identifier;
 	if (auto it = m_TokenTypes.find(lexeme); it != m_TokenTypes.end())
 		type = it->second;
-	return Token{ .Type = type, .Lexeme = AddLiteralString(lexeme), .Location { m_Line, m_Col - (int)lexeme.length(), m_FileName } };
+	return Token{ .Type = type, .Lexeme = AddLiteralString(lexeme), .Location { m_Line, m_Col - (int)lexeme.length(), m_File } };
 }
 
 Token Tokenizer::ParseNumber() noexcept {
@@ -200,7 +207,7 @@ Token Tokenizer::ParseNumber() noexcept {
 	auto len = int(type == TokenType::Real ? pd - m_Current : pi - m_Current);
 	m_Col += (int)len + startLen;
 	m_Current += len;
-	auto token = Token{ .Type = type, .Location { m_Line, (int)m_Col - len, m_FileName } };
+	auto token = Token{ .Type = type, .Location { m_Line, (int)m_Col - len, m_File } };
 	if (type == TokenType::Integer)
 		token.Integer = ivalue;
 	else
@@ -215,43 +222,48 @@ Token Tokenizer::ParseNumber() noexcept {
 }
 
 Token Tokenizer::ParseOperator() noexcept {
-	string lexeme;
+	auto start = m_Current;
 	while (*m_Current && ispunct(*m_Current)) {
 		//
 		// treat parenthesis as special so they are not combined with other operators
 		//
+		string_view lexeme(start, m_Current - start);
 		if (lexeme == "(" || lexeme == ")" || (!lexeme.empty() && (*m_Current == '(' || *m_Current == ')')))
 			break;
 
-		lexeme += *m_Current++;
+		m_Current++;
 		m_Col++;
 	}
-	auto temp = lexeme;
+	string_view temp(start, m_Current - start);
 	if (temp.empty())
 		return Token();
 
+	auto lexeme = temp;
 	auto type = TokenType::Invalid;
 	do {
 		if (auto it = m_TokenTypes.find(lexeme); it != m_TokenTypes.end()) {
 			type = it->second;
 			break;
 		}
-		lexeme = lexeme.substr(0, lexeme.length() - 1);
+		lexeme.remove_suffix(1);
 	} while (!lexeme.empty());
 
 	if (type == TokenType::Invalid)
-		return Token{ .Type = TokenType::Invalid, .Lexeme = AddLiteralString(std::move(temp)), .Location { m_Line, m_Col - (int)temp.length(), m_FileName } };
+		return Token{ .Type = TokenType::Invalid, .Lexeme = AddLiteralString(temp), .Location { m_Line, m_Col - (int)temp.length(), m_File } };
 
 	m_Current -= (temp.length() - lexeme.length());
-	if (lexeme.empty()) {
-		lexeme = temp;
-		return Token{ .Type = TokenType::Operator, .Lexeme = AddLiteralString(std::move(lexeme)), .Location { m_Line, m_Col - (int)temp.length(), m_FileName} };
-	}
-	return Token{ .Type = type, .Lexeme = AddLiteralString(std::move(lexeme)), .Location{ m_Line, m_Col - (int)lexeme.length(), m_FileName} };
+	if (lexeme.empty())
+		return Token{ .Type = TokenType::Operator, .Lexeme = AddLiteralString(temp), .Location { m_Line, m_Col - (int)temp.length(), m_File } };
+	return Token{ .Type = type, .Lexeme = AddLiteralString(lexeme), .Location{ m_Line, m_Col - (int)lexeme.length(), m_File } };
 }
 
 Token Tokenizer::ParseString(bool raw) {
-	string lexeme;
+	//
+	// the lexeme is a view of the source unless an escape sequence needs it rewritten
+	//
+	auto start = m_Current + 1;
+	string escaped;
+	bool escapes = false;
 	while (*++m_Current && *m_Current != '\"') {
 		if (!raw && *m_Current == '\\') {
 			//
@@ -260,32 +272,38 @@ Token Tokenizer::ParseString(bool raw) {
 			static const string escape("tnrba\\\""), actual("\t\n\r\b\a\\\"");
 			assert(escape.length() == actual.length());
 			if (auto index = escape.find(m_Current[1]); index != escape.npos) {
+				if (!escapes) {
+					escaped.assign(start, m_Current);
+					escapes = true;
+				}
 				m_Current++;
-				lexeme += actual[index];
+				escaped += actual[index];
 			}
 			else {
 				//
 				// unknown escape sequence
 				//
-				Token token{ .Type = TokenType::Error, .Lexeme = "Unknown escape character", .Location {m_Line, m_Col, m_FileName} };
+				Token token{ .Type = TokenType::Error, .Lexeme = "Unknown escape character", .Location {m_Line, m_Col, m_File } };
 				return token;
 			}
 			continue;
 		}
-		lexeme += *m_Current;
+		if (escapes)
+			escaped += *m_Current;
 		m_Col++;
 		if (*m_Current == '\n') {
 			m_Col = 1;
 			m_Line++;
 			if (!raw) {
-				Token token{ .Type = TokenType::Error, .Lexeme = "Missing closing quote", .Location {m_Line, m_Col, m_FileName} };
+				Token token{ .Type = TokenType::Error, .Lexeme = "Missing closing quote", .Location {m_Line, m_Col, m_File } };
 				return token;
 			}
 		}
 	}
 	if(*m_Current == 0)
-		return Token{ .Type = TokenType::Error, .Lexeme = "Unterminated string", .Location {m_Line, m_Col, m_FileName} };
+		return Token{ .Type = TokenType::Error, .Lexeme = "Unterminated string", .Location {m_Line, m_Col, m_File } };
 
+	auto lexeme = escapes ? string_view(escaped) : string_view(start, m_Current - start);
 	m_Current++;
-	return Token{ .Type = TokenType::String, .Lexeme = AddLiteralString(std::move(lexeme)), .Location{ m_Line, m_Col - (int)lexeme.length(), m_FileName} };
+	return Token{ .Type = TokenType::String, .Lexeme = AddLiteralString(lexeme), .Location{ m_Line, m_Col - (int)lexeme.length(), m_File } };
 }
@@ -5,6 +5,8 @@
 #include <set>
 #include <memory>
 #include "Token.h"
+#include "Atom.h"
+#include "MappedFile.h"
 #include <unordered_map>
 
 namespace Dynamix {
@@ -30,15 +32,19 @@ namespace Dynamix {
 		}
 
 		std::string const& FileName() const noexcept {
-			return m_FileName;
+			return m_File.ToString();
+		}
+
+		// the text being tokenized
+		std::string_view Source() const noexcept {
+			return m_Source;
 		}
 
 		std::string_view TokenTypeToString(TokenType type) const;
 
-		const char* AddLiteralString(std::string str) {
-			if (auto it = m_LiteralStrings.find(str); it != m_LiteralStrings.end())
-				return it->c_str();
-			return m_LiteralStrings.emplace(str).first->c_str();
+		// lexemes are interned in the runtime-wide atom table and stay valid for the life of the process
+		const char* AddLiteralString(std::string_view str) {
+			return Atom(str).ToString().c_str();
 		}
 
 	private:
@@ -50,11 +56,14 @@ namespace Dynamix {
 		Token ParseOperator() noexcept;
 		Token ParseString(bool raw);
 
+		// files are tokenized in place; m_Text holds a terminated copy of one that fills its last page
+		MappedFile m_Mapping;
 		std::unique_ptr<char[]> m_Text;
+		std::string_view m_Source;
 		Token m_Next;
 		int m_Col{ 1 };
 		int m_Line{ 1 };
-		std::string m_FileName;
+		Atom m_File;
 		std::unordered_map<std::string_view, TokenType> m_TokenTypes;
 		std::unordered_map<TokenType, std::string_view> m_TokenTypesRev;
 		const char* m_Current{ nullptr };
@@ -62,7 +71,6 @@ namespace Dynamix {
 		std::string m_MultiLineCommentStart{ "/*" };
 		std::string m_MultiLineCommentEnd{ "*/" };
 		int m_MultiLineCommentNesting;
-		std::set<std::string> m_LiteralStrings;
 	};
 }
 
@@ -47,14 +47,14 @@ MethodDef methods[] {
 #define END_FIELDS	\
     };	\
 	for (auto& f : fields) {	\
-		auto fi = std::make_unique<FieldInfo>(f.Name);	\
+		auto fi = std::make_unique<FieldInfo>(Atom(f.Name));	\
 		fi->Flags = f.Flags;	\
 		AddField(std::move(fi), f.TheValue);	\
 	}
 
 #define END_METHODS()	};	\
 	for (auto& m : methods) {	\
-		auto mi = std::make_unique<MethodInfo>(m.Name);	\
+		auto mi = std::make_unique<MethodInfo>(Atom(m.Name));	\
 		mi->Arity = m.Arity;	\
 		mi->Code.Native = m.Code;	\
 		mi->Flags = m.Flags;	\
@@ -1,9 +1,10 @@
 #include <format>
 #include <cassert>
+#include <atomic>
+#include <cstddef>
 
 #include "Value.h"
 #include "RuntimeObject.h"
-#include <stacktrace>
 #include "Runtime.h"
 #include "ObjectType.h"
 #include "StringType.h"
@@ -13,31 +14,105 @@
 
 using namespace Dynamix;
 
+namespace Dynamix {
+	struct SharedString {
+		std::atomic<uint32_t> RefCount;
+		uint32_t Length;
+		size_t Hash;
+		char Chars[1];
+	};
+}
+
+namespace {
+	size_t HashString(std::string_view s) noexcept {
+		// FNV-1a
+		uint64_t hash = 14695981039346656037ull;
+		for (auto ch : s)
+			hash = (hash ^ (uint8_t)ch) * 1099511628211ull;
+		return (size_t)hash;
+	}
+}
+
+namespace {
+	//
+	// released callables are chained through their own storage and reused by the next Create
+	//
+	struct CallablePool {
+		~CallablePool() {
+			while (Head) {
+				auto next = *reinterpret_cast<void**>(Head);
+				::operator delete(Head);
+				Head = next;
+			}
+		}
+		void* Head{ nullptr };
+	};
+
+	thread_local CallablePool s_Callables;
+}
+
+Callable::Callable(RuntimeObject const* instance, Atom name, SymbolFlags flags) noexcept : Instance(instance), Name(name), Flags(flags) {
+}
+
+Callable* Callable::Create(RuntimeObject const* instance, Atom name, SymbolFlags flags) {
+	static_assert(sizeof(Callable) >= sizeof(void*));
+	void* p = s_Callables.Head;
+	if (p)
+		s_Callables.Head = *reinterpret_cast<void**>(p);
+	else
+		p = ::operator new(sizeof(Callable));
+	return new (p) Callable(instance, name, flags);
+}
+
+void Callable::Release() noexcept {
+	if (--m_RefCount == 0) {
+		this->~Callable();
+		*reinterpret_cast<void**>(this) = s_Callables.Head;
+		s_Callables.Head = this;
+	}
+}
+
+bool Callable::IsStatic() const noexcept {
+	return (Flags & SymbolFlags::Static) == SymbolFlags::Static;
+}
+
+MethodInfo const* Callable::Resolve(int8_t count, ObjectType const*& owner) noexcept {
+	if (!m_Method || m_Count != count) {
+		auto type = Instance->Type();
+		if (type->HasDynamicMembers())
+			return nullptr;
+		m_Method = type->ResolveMethod(Name, count, m_Owner);
+		m_Count = count;
+	}
+	owner = m_Owner;
+	return m_Method;
+}
+
 Int Value::ToInteger() const {
-	switch (m_Type) {
-		case ValueType::Integer: return iValue;
-		case ValueType::Real: return static_cast<Int>(dValue);
-		case ValueType::Boolean: return bValue ? 1 : 0;
+	switch (Type()) {
+		case ValueType::Integer: return AsInteger();
+		case ValueType::Real: return static_cast<Int>(AsReal());
+		case ValueType::Boolean: return AsBoolean() ? 1 : 0;
 	}
 	throw RuntimeError(RuntimeErrorType::CannotConvertToInteger, std::format("Cannot convert {} to Integer", ToString()));
 }
 
 Bool Value::ToBoolean() const {
-	switch (m_Type) {
-		case ValueType::Integer: return iValue ? true : false;
-		case ValueType::Real: return dValue ? true : false;
-		case ValueType::Boolean: return bValue;
+	switch (Type()) {
+		case ValueType::Integer: return AsInteger() ? true : false;
+		case ValueType::Real: return AsReal() ? true : false;
+		case ValueType::Boolean: return AsBoolean();
 		case ValueType::Empty: return false;
-		case ValueType::String: return m_StrLen > 0;
+		case ValueType::String: return StringLength() > 0;
 	}
 	throw RuntimeError(RuntimeErrorType::CannotConvertToBoolean, std::format("Cannot convert {} to Boolean", ToString()));
 }
 
 Real Value::ToReal() const {
-	switch (m_Type) {
-		case ValueType::Integer: return static_cast<Real>(iValue);
-		case ValueType::Real: return dValue;
-		case ValueType::Boolean: return dValue ? 1 : 0;
+	switch (Type()) {
+		case ValueType::Integer: return static_cast<Real>(AsInteger());
+		case ValueType::Real: return AsReal();
+		case ValueType::Boolean: return AsBoolean() ? 1 : 0;
 	}
 	throw RuntimeError(RuntimeErrorType::CannotConvertToReal, std::format("Cannot convert {} to Real", ToString()));
 }
@@ -45,13 +120,13 @@ Real Value::ToReal() const {
 RuntimeObject const* Value::ToObject() const {
 	if (!IsObject())
 		throw RuntimeError(RuntimeErrorType::TypeMismatch, "Object expected");
-	return oValue;
+	return AsObject();
 }
 
 ObjectType const* Value::ToTypeObject() const {
-	if (m_Type != ValueType::Object || !oValue->IsObjectType())
+	if (!IsObject() || !AsObject()->IsObjectType())
 		throw RuntimeError(RuntimeErrorType::TypeMismatch, "Type Object expected");
-	return reinterpret_cast<ObjectType const*>(oValue);
+	return reinterpret_cast<ObjectType const*>(AsObject());
 }
 
 Value Value::BinaryOperator(TokenType op, Value const& rhs) const {
@@ -108,9 +183,9 @@ Value& Value::Assign(Value const& right, TokenType assign) {
 }
 
 Value& Value::AssignArrayIndex(Value const& index, Value const& right, TokenType assign) {
-	switch (m_Type) {
+	switch (Type()) {
 		case ValueType::Object:
-			const_cast<RuntimeObject*>(oValue)->InvokeSetIndexer(index, right, assign);
+			const_cast<RuntimeObject*>(AsObject())->InvokeSetIndexer(index, right, assign);
 			break;
 
 		case ValueType::String:
@@ -121,22 +196,32 @@ Value& Value::AssignArrayIndex(Value const& index, Value const& right, TokenType
 }
 
 std::string Value::ToString(const char* fmt) const {
-	switch (m_Type) {
+	switch (Type()) {
 		case ValueType::Empty:
 			return "<empty>";
 		case ValueType::Integer:
+		{
+			auto i = AsInteger();
+			return std::vformat(fmt, std::make_format_args(i));
+		}
 		case ValueType::Pointer:
-			return std::vformat(fmt, std::make_format_args(iValue));
+		{
+			auto p = reinterpret_cast<Int>(AsPointer());
+			return std::vformat(fmt, std::make_format_args(p));
+		}
 		case ValueType::Real:
-			return std::vformat(fmt, std::make_format_args(dValue));
+		{
+			auto d = AsReal();
+			return std::vformat(fmt, std::make_format_args(d));
+		}
 		case ValueType::Boolean:
-			return bValue ? "true" : "false";
+			return AsBoolean() ? "true" : "false";
 		case ValueType::Object:
-			return oValue->ToString();
+			return AsObject()->ToString();
 		case ValueType::Error:
 			return "<Error>";
 		case ValueType::String:
-			return strValue;
+			return std::string(StringChars(), StringLength());
 	}
 	return "";
 }
@@ -144,16 +229,21 @@ std::string Value::ToString(const char* fmt) const {
 Value Value::Add(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
 		case ValueType::Integer:
-			return iValue + rhs.iValue;
+			return AsInteger() + rhs.AsInteger();
 		case ValueType::Real:
-			return dValue + rhs.dValue;
+			return AsReal() + rhs.AsReal();
 		case ValueType::Integer | ValueType::Real:
 		case ValueType::Real | ValueType::Boolean:
 			return ToReal() + rhs.ToReal();
 		case ValueType::Integer | ValueType::Boolean:
 			return ToInteger() + rhs.ToInteger();
 		case ValueType::String:
-			return Value((std::string(strValue) + rhs.strValue).c_str());
+		{
+			std::string text;
+			text.reserve(StringLength() + rhs.StringLength());
+			text.append(StringChars(), StringLength()).append(rhs.StringChars(), rhs.StringLength());
+			return Value(std::string_view(text));
+		}
 	}
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot add {} and {}", ToString(), rhs.ToString()));
 }
@@ -161,11 +251,11 @@ Value Value::Add(Value const& rhs) const {
 Value Value::Sub(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
 		case ValueType::Integer:
-			return iValue - rhs.iValue;
+			return AsInteger() - rhs.AsInteger();
 		case ValueType::Integer | ValueType::Real:
 			return ToReal() - rhs.ToReal();
 		case ValueType::Real:
-			return dValue - rhs.dValue;
+			return AsReal() - rhs.AsReal();
 	}
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot subtract {} from {}", rhs.ToString(), ToString()));
 }
@@ -173,9 +263,9 @@ Value Value::Sub(Value const& rhs) const {
 Value Value::Mul(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
 		case ValueType::Integer:
-			return iValue * rhs.iValue;
+			return AsInteger() * rhs.AsInteger();
 		case ValueType::Real:
-			return dValue * rhs.dValue;
+			return AsReal() * rhs.AsReal();
 		case ValueType::Integer | ValueType::Real:
 		case ValueType::Real | ValueType::Boolean:
 			return ToReal() * rhs.ToReal();
@@ -188,13 +278,13 @@ Value Value::Mul(Value const& rhs) const {
 Value Value::Div(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
 		case ValueType::Real:
-			if (rhs.dValue == 0)
+			if (rhs.AsReal() == 0)
 				return Value::Error();
-			return dValue / rhs.dValue;
+			return AsReal() / rhs.AsReal();
 		case ValueType::Integer:
-			if (rhs.iValue == 0)
+			if (rhs.AsInteger() == 0)
 				throw RuntimeError(RuntimeErrorType::DivisionByZero, "Cannot divide by zero");
-			return iValue / rhs.iValue;
+			return AsInteger() / rhs.AsInteger();
 		case ValueType::Integer | ValueType::Real:
 			auto r = rhs.ToReal();
 			if (r == 0)
@@ -207,7 +297,7 @@ Value Value::Div(Value const& rhs) const {
 Value Value::Mod(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
 		case ValueType::Integer:
-			return rhs.iValue == 0 ? Value::Error(ValueErrorType::DivideByZero) : iValue % rhs.iValue;
+			return rhs.AsInteger() == 0 ? Value::Error(ValueErrorType::DivideByZero) : AsInteger() % rhs.AsInteger();
 	}
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot modulo {} by {}", ToString(), rhs.ToString()));
 }
@@ -222,21 +312,21 @@ Value Value::Or(Value const& rhs) const {
 
 Value Value::BitwiseAnd(Value const& rhs) const {
 	if (IsInteger() && rhs.IsInteger())
-		return Value(iValue & rhs.iValue);
+		return Value(AsInteger() & rhs.AsInteger());
 
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot bitwise AND {} by {}", ToString(), rhs.ToString()));
 }
 
 Value Value::BitwiseOr(Value const& rhs) const {
 	if (IsInteger() && rhs.IsInteger())
-		return Value(iValue | rhs.iValue);
+		return Value(AsInteger() | rhs.AsInteger());
 
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot bitwise OR {} by {}", ToString(), rhs.ToString()));
 }
 
 Value Value::BitwiseXor(Value const& rhs) const {
 	if (IsInteger() && rhs.IsInteger())
-		return Value(iValue ^ rhs.iValue);
+		return Value(AsInteger() ^ rhs.AsInteger());
 
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot bitwise XOR {} by {}", ToString(), rhs.ToString()));
 }
@@ -250,21 +340,209 @@ Value Value::ShiftRight(Value const& rhs) const {
 }
 
 Value Value::InvokeIndexer(Value const& index) const {
-	switch (m_Type) {
+	switch (Type()) {
 		case ValueType::String:
 		{
 			auto i = index.ToInteger();
-			if (i < 0 || i >= m_StrLen)
+			if (i < 0 || i >= StringLength())
 				throw RuntimeError(RuntimeErrorType::IndexOutOfRange, std::format("Index {} is out of range", i));
-			return Int(strValue[i]);
+			return Int(StringChars()[i]);
 		}
 
 		case ValueType::Object:
-			return const_cast<RuntimeObject*>(oValue)->InvokeGetIndexer(index);
+			return const_cast<RuntimeObject*>(AsObject())->InvokeGetIndexer(index);
 	}
 	throw RuntimeError(RuntimeErrorType::IndexerNotSupported, std::format("Indexer not supported on type {}", GetObjectType()->Name()));
 }
 
+#ifdef DYNAMIX_NAN_BOXING
+namespace {
+	struct ErrorDescription {
+		ValueErrorType Type;
+		uint32_t Length;
+		char Text[1];
+	};
+
+	ErrorDescription* DescribeError(ValueErrorType type, std::string_view desc) noexcept {
+		auto err = (ErrorDescription*)::malloc(offsetof(ErrorDescription, Text) + desc.length() + 1);
+		if (err) {
+			err->Type = type;
+			err->Length = (uint32_t)desc.length();
+			memcpy(err->Text, desc.data(), desc.length());
+			err->Text[desc.length()] = 0;
+		}
+		return err;
+	}
+}
+
+void Value::Free() noexcept {
+	switch (GetTag()) {
+		case Tag::BigInteger:
+			delete PayloadAs<Int>();
+			break;
+
+		case Tag::Object:
+		case Tag::ObjectError:
+			PayloadAs<RuntimeObject const>()->Release();
+			break;
+
+		case Tag::String:
+			if (--PayloadAs<SharedString>()->RefCount == 0)
+				free(PayloadAs<SharedString>());
+			break;
+
+		case Tag::Callable:
+			PayloadAs<Callable>()->Release();
+			break;
+
+		case Tag::DescribedError:
+			free(PayloadAs<ErrorDescription>());
+			break;
+	}
+	m_Bits = Box(Tag::Empty);
+}
+
+bool Value::OwnsStorage() const noexcept {
+	switch (GetTag()) {
+		case Tag::BigInteger:
+		case Tag::Object:
+		case Tag::ObjectError:
+		case Tag::String:
+		case Tag::Callable:
+		case Tag::DescribedError:
+			return true;
+	}
+	return false;
+}
+
+void Value::SetBigInteger(Int v) noexcept {
+	auto box = new (std::nothrow) Int(v);
+	m_Bits = box ? Box(Tag::BigInteger, reinterpret_cast<uint64_t>(box)) : Box(Tag::Error, uint64_t(ValueErrorType::OutOfMemory));
+}
+
+Value::Value(RuntimeObject const* o) noexcept : m_Bits(Box(Tag::Object, reinterpret_cast<uint64_t>(o))) {
+	o->AddRef();
+}
+
+Value::Value(Callable* c) noexcept : m_Bits(Box(Tag::Callable, reinterpret_cast<uint64_t>(c))) {
+}
+
+void Value::SetString(std::string_view s) noexcept {
+	if (s.length() <= ShortStringMax) {
+		// the characters fill the payload from its low byte; the byte after them is 5 - length,
+		// so a 5 character string is still terminated
+		uint64_t chars = 0;
+		memcpy(&chars, s.data(), s.length());
+		m_Bits = Box(Tag::ShortString, chars | (uint64_t(ShortStringMax - s.length()) << 40));
+		return;
+	}
+
+	auto str = (SharedString*)::malloc(offsetof(SharedString, Chars) + s.length() + 1);
+	if (str == nullptr) {
+		m_Bits = Box(Tag::Error, uint64_t(ValueErrorType::OutOfMemory));
+		return;
+	}
+	new (&str->RefCount) std::atomic<uint32_t>(1);
+	str->Length = (uint32_t)s.length();
+	str->Hash = HashString(s);
+	memcpy(str->Chars, s.data(), s.length());
+	str->Chars[s.length()] = 0;
+	m_Bits = Box(Tag::String, reinterpret_cast<uint64_t>(str));
+}
+
+const char* Value::StringChars() const noexcept {
+	assert(IsString());
+	return GetTag() == Tag::String ? PayloadAs<SharedString>()->Chars : reinterpret_cast<const char*>(&m_Bits);
+}
+
+uint32_t Value::StringLength() const noexcept {
+	assert(IsString());
+	return GetTag() == Tag::String ? PayloadAs<SharedString>()->Length : ShortStringMax - uint32_t((m_Bits >> 40) & 0xff);
+}
+
+bool Value::StringEquals(Value const& rhs) const noexcept {
+	if (m_Bits == rhs.m_Bits)
+		return true;
+	// short strings are equal only if their bits are
+	if (GetTag() != Tag::String || rhs.GetTag() != Tag::String)
+		return false;
+	auto str = PayloadAs<SharedString>(), other = rhs.PayloadAs<SharedString>();
+	return str->Length == other->Length && str->Hash == other->Hash && memcmp(str->Chars, other->Chars, str->Length) == 0;
+}
+
+Value::Value(Value const& other) noexcept : m_Bits(other.m_Bits) {
+	switch (GetTag()) {
+		case Tag::BigInteger:
+			SetBigInteger(*other.PayloadAs<Int>());
+			break;
+		case Tag::Object:
+		case Tag::ObjectError:
+			PayloadAs<RuntimeObject const>()->AddRef();
+			break;
+		case Tag::String:
+			++PayloadAs<SharedString>()->RefCount;
+			break;
+		case Tag::Callable:
+			PayloadAs<Callable>()->AddRef();
+			break;
+		case Tag::DescribedError:
+		{
+			auto desc = other.PayloadAs<ErrorDescription>();
+			auto copy = DescribeError(desc->Type, std::string_view(desc->Text, desc->Length));
+			m_Bits = copy ? Box(Tag::DescribedError, reinterpret_cast<uint64_t>(copy)) : Box(Tag::Error, uint64_t(ValueErrorType::OutOfMemory));
+			break;
+		}
+	}
+}
+
+Value& Value::operator=(Value const& other) noexcept {
+	if (this != &other) {
+		Free();
+		new (this) Value(other);
+	}
+	return *this;
+}
+
+Value::Value(Value&& other) noexcept : m_Bits(other.m_Bits) {
+	other.m_Bits = Box(Tag::Empty);
+}
+
+Value& Value::operator=(Value&& other) noexcept {
+	if (this != &other) {
+		Free();
+		m_Bits = other.m_Bits;
+		other.m_Bits = Box(Tag::Empty);
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+Value Value::HResult(int hr) {
+	Value err(ValueType::Error);
+	err.m_Bits = Box(Tag::Error, uint64_t(uint32_t(hr)) << 8);
+	return err;
+}
+#endif
+Value Value::Error(ValueErrorType type, const char* desc) {
+	Value err(ValueType::Error);
+	if (desc) {
+		auto info = DescribeError(type, desc);
+		err.m_Bits = info ? Box(Tag::DescribedError, reinterpret_cast<uint64_t>(info)) : Box(Tag::Error, uint64_t(ValueErrorType::OutOfMemory));
+	}
+	else {
+		err.m_Bits = Box(Tag::Error, uint64_t(type));
+	}
+	return err;
+}
+
+Value Value::Error(RuntimeObject const* obj) noexcept {
+	Value err(ValueType::Error);
+	err.m_Bits = Box(Tag::ObjectError, reinterpret_cast<uint64_t>(obj));
+	obj->AddRef();
+	return err;
+}
+
+#else
 void Value::Free() noexcept {
 	switch (m_Type) {
 		case ValueType::Error:
@@ -279,16 +557,32 @@ void Value::Free() noexcept {
 			break;
 
 		case ValueType::String:
-			free(strValue);
+			if (m_StrTag == LongString && --shValue->RefCount == 0)
+				free(shValue);
 			break;
 
 		case ValueType::Callable:
-			delete cValue;
+			cValue->Release();
 			break;
 	}
 	m_Type = ValueType::Empty;
 }
 
+bool Value::OwnsStorage() const noexcept {
+	switch (m_Type) {
+		case ValueType::Error:
+			return m_Error == ValueErrorType::CustomObject || strValue;
+
+		case ValueType::Object:
+		case ValueType::Callable:
+			return true;
+
+		case ValueType::String:
+			return m_StrTag == LongString;
+	}
+	return false;
+}
+
 Value::Value(RuntimeObject const* o) noexcept : oValue(o), m_Type(ValueType::Object) {
 	o->AddRef();
 }
@@ -296,33 +590,78 @@ Value::Value(RuntimeObject const* o) noexcept : oValue(o), m_Type(ValueType::Obj
 Value::Value(Callable* c) noexcept : cValue(c), m_Type(ValueType::Callable) {
 }
 
-Value::Value(const char* s) noexcept : m_Type(ValueType::String) {
-	strValue = (char*)::malloc((m_StrLen = (unsigned)strlen(s)) + 1);
-	if (strValue == nullptr) {
+void Value::SetString(std::string_view s) noexcept {
+	m_Type = ValueType::String;
+	if (s.length() <= ShortStringMax) {
+		memcpy(m_Chars, s.data(), s.length());
+		memset(m_Chars + s.length(), 0, ShortStringMax - s.length());
+		m_StrTag = uint8_t(ShortStringMax - s.length());
+		return;
+	}
+
+	auto str = (SharedString*)::malloc(offsetof(SharedString, Chars) + s.length() + 1);
+	if (str == nullptr) {
 		m_Type = ValueType::Error;
 		m_Error = ValueErrorType::OutOfMemory;
+		strValue = nullptr;
+		return;
 	}
-	else {
-		memcpy(strValue, s, m_StrLen + 1);
+	new (&str->RefCount) std::atomic<uint32_t>(1);
+	str->Length = (uint32_t)s.length();
+	str->Hash = HashString(s);
+	memcpy(str->Chars, s.data(), s.length());
+	str->Chars[s.length()] = 0;
+	shValue = str;
+	m_StrLen = str->Length;
+	m_StrTag = LongString;
+}
+
+const char* Value::StringChars() const noexcept {
+	assert(IsString());
+	return m_StrTag == LongString ? shValue->Chars : m_Chars;
+}
+
+uint32_t Value::StringLength() const noexcept {
+	assert(IsString());
+	return m_StrTag == LongString ? m_StrLen : ShortStringMax - m_StrTag;
+}
+
+bool Value::StringEquals(Value const& rhs) const noexcept {
+	// a length decides the representation, so equal lengths mean both are short or both are shared
+	auto len = StringLength();
+	if (len != rhs.StringLength())
+		return false;
+	if (m_StrTag == LongString) {
+		if (shValue == rhs.shValue)
+			return true;
+		if (shValue->Hash != rhs.shValue->Hash)
+			return false;
 	}
+	return memcmp(StringChars(), rhs.StringChars(), len) == 0;
 }
 
-Value::Value(Value const& other) noexcept : oValue(other.oValue), m_Type(other.m_Type) {
+Value::Value(Value const& other) noexcept {
+	m_Raw[0] = other.m_Raw[0];
+	m_Raw[1] = other.m_Raw[1];
 	switch (m_Type) {
 		case ValueType::Object:
 			oValue->AddRef();
 			break;
 		case ValueType::String:
-			m_StrLen = other.m_StrLen;
-			strValue = (char*)malloc(m_StrLen + 1);
-			if (strValue == nullptr) {
-				*this = Value::Error(ValueErrorType::OutOfMemory);
-				return;
-			}
-			memcpy(strValue, other.strValue, m_StrLen + 1);
+			if (m_StrTag == LongString)
+				++shValue->RefCount;
 			break;
 		case ValueType::Callable:
-			cValue = new Callable(*other.cValue);
+			cValue->AddRef();
+			break;
+		case ValueType::Error:
+			if (m_Error == ValueErrorType::CustomObject)
+				oValue->AddRef();
+			else if (strValue) {
+				strValue = (char*)malloc(m_StrLen + 1);
+				if (strValue)
+					memcpy(strValue, other.strValue, m_StrLen + 1);
+			}
 			break;
 	}
 }
@@ -330,54 +669,27 @@ Value::Value(Value const& other) noexcept : oValue(other.oValue), m_Type(other.m
 Value& Value::operator=(Value const& other) noexcept {
 	if (this != &other) {
 		Free();
-		m_Type = other.m_Type;
-		m_StrLen = other.m_StrLen;
-		oValue = other.oValue;
-		switch (m_Type) {
-			case ValueType::String:
-				strValue = (char*)malloc(m_StrLen + 1);
-				memcpy(strValue, other.strValue, m_StrLen + 1);
-				break;
-			case ValueType::Object:
-				oValue->AddRef();
-				break;
-			case ValueType::Callable:
-				cValue = new Callable(*other.cValue);
-				break;
-		}
+		new (this) Value(other);
 	}
 	return *this;
 }
 
-Value::Value(Value&& other) noexcept : m_Type(other.m_Type), oValue(other.oValue), m_StrLen(other.m_StrLen) {
+Value::Value(Value&& other) noexcept {
+	m_Raw[0] = other.m_Raw[0];
+	m_Raw[1] = other.m_Raw[1];
 	other.m_Type = ValueType::Empty;
-
 }
 
 Value& Value::operator=(Value&& other) noexcept {
 	if (this != &other) {
 		Free();
-		m_Type = other.m_Type;
-		oValue = other.oValue;
-		m_StrLen = other.m_StrLen;
+		m_Raw[0] = other.m_Raw[0];
+		m_Raw[1] = other.m_Raw[1];
 		other.m_Type = ValueType::Empty;
 	}
 	return *this;
 }
 
-Value Value::FromToken(Token const& token) noexcept {
-	switch (token.Type) {
-		case TokenType::Integer: return token.Integer;
-		case TokenType::Real: return token.Real;
-		case TokenType::True: return Value(true);
-		case TokenType::False: return Value(false);
-		case TokenType::String: return Value(token.Lexeme);
-		case TokenType::Empty: return Value();
-	}
-	assert(false);
-	return Value();
-}
-
 #ifdef _WIN32
 Value Value::HResult(int hr) {
 	Value err(ValueType::Error);
@@ -410,13 +722,36 @@ Value Value::Error(RuntimeObject const* obj) noexcept {
 	return err;
 }
 
+#endif
+
+Value::Value(const char* s) noexcept {
+	SetString(s);
+}
+
+Value::Value(std::string_view s) noexcept {
+	SetString(s);
+}
+
+Value Value::FromToken(Token const& token) noexcept {
+	switch (token.Type) {
+		case TokenType::Integer: return token.Integer;
+		case TokenType::Real: return token.Real;
+		case TokenType::True: return Value(true);
+		case TokenType::False: return Value(false);
+		case TokenType::String: return Value(token.Lexeme);
+		case TokenType::Empty: return Value();
+	}
+	assert(false);
+	return Value();
+}
+
 Value::~Value() {
 	Free();
 }
 
 ObjectType const* Value::GetObjectType() const {
-	switch (m_Type) {
-		case ValueType::Object: return oValue->Type();
+	switch (Type()) {
+		case ValueType::Object: return AsObject()->Type();
 		case ValueType::String: return StringTypeA::Get();
 		case ValueType::Integer: return IntegerType::Get();
 		case ValueType::Real: return RealType::Get();
@@ -431,15 +766,15 @@ bool Value::IsObjectType() const noexcept {
 
 Value Value::Equal(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
-		case ValueType::Integer: return iValue == rhs.iValue;
-		case ValueType::Real: return dValue == rhs.dValue;
-		case ValueType::Boolean: return bValue == rhs.bValue;
+		case ValueType::Integer: return AsInteger() == rhs.AsInteger();
+		case ValueType::Real: return AsReal() == rhs.AsReal();
+		case ValueType::Boolean: return AsBoolean() == rhs.AsBoolean();
 		case ValueType::Empty: return true;
 		case ValueType::Integer | ValueType::Real: return ToReal() == rhs.ToReal();
 		case ValueType::Integer | ValueType::Boolean: return ToBoolean() == rhs.ToBoolean();
-		case ValueType::String: return ::strcmp(strValue, rhs.strValue) == 0;
+		case ValueType::String: return StringEquals(rhs);
 		case ValueType::Empty | ValueType::Pointer: return false;
-		case ValueType::Pointer: return pValue == rhs.pValue;
+		case ValueType::Pointer: return AsPointer() == rhs.AsPointer();
 	}
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot compare {} and {}", ToString(), rhs.ToString()));
 }
@@ -450,33 +785,33 @@ Value Value::NotEqual(Value const& rhs) const {
 
 Value Value::LessThan(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
-		case ValueType::Integer: return iValue < rhs.iValue;
-		case ValueType::Real: return dValue < rhs.dValue;
-		case ValueType::Boolean: return bValue < rhs.bValue;
+		case ValueType::Integer: return AsInteger() < rhs.AsInteger();
+		case ValueType::Real: return AsReal() < rhs.AsReal();
+		case ValueType::Boolean: return AsBoolean() < rhs.AsBoolean();
 		case ValueType::Integer | ValueType::Real: return ToReal() < rhs.ToReal();
 		case ValueType::Integer | ValueType::Boolean: return ToBoolean() < rhs.ToBoolean();
-		case ValueType::String: return ::strcmp(strValue, rhs.strValue) < 0;
+		case ValueType::String: return ::strcmp(StringChars(), rhs.StringChars()) < 0;
 	}
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot compare {} and {}", ToString(), rhs.ToString()));
 }
 
 Value Value::LessThanOrEqual(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
-		case ValueType::Integer: return iValue <= rhs.iValue;
-		case ValueType::Real: return dValue <= rhs.dValue;
-		case ValueType::Boolean: return bValue <= rhs.bValue;
+		case ValueType::Integer: return AsInteger() <= rhs.AsInteger();
+		case ValueType::Real: return AsReal() <= rhs.AsReal();
+		case ValueType::Boolean: return AsBoolean() <= rhs.AsBoolean();
 		case ValueType::Integer | ValueType::Real: return ToReal() <= rhs.ToReal();
 		case ValueType::Integer | ValueType::Boolean: return ToBoolean() <= rhs.ToBoolean();
-		case ValueType::String: return ::strcmp(strValue, rhs.strValue) <= 0;
+		case ValueType::String: return ::strcmp(StringChars(), rhs.StringChars()) <= 0;
 		case ValueType::Empty: return true;
 	}
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot compare '{}' and '{}'", ToString(), rhs.ToString()));
 }
 
 Value Value::Negate() const {
-	switch (m_Type) {
-		case ValueType::Integer: return -iValue;
-		case ValueType::Real: return -dValue;
+	switch (Type()) {
+		case ValueType::Integer: return -AsInteger();
+		case ValueType::Real: return -AsReal();
 	}
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot negate '{}'", ToString()));
 }
@@ -487,30 +822,30 @@ Value Value::Not() const {
 
 Value Value::BitwiseNot() const {
 	if (IsInteger())
-		return ~iValue;
+		return ~AsInteger();
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot bitwise not '{}'", ToString()));
 }
 
 Value Value::GreaterThan(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
-		case ValueType::Integer: return iValue > rhs.iValue;
-		case ValueType::Real: return dValue > rhs.dValue;
-		case ValueType::Boolean: return bValue > rhs.bValue;
+		case ValueType::Integer: return AsInteger() > rhs.AsInteger();
+		case ValueType::Real: return AsReal() > rhs.AsReal();
+		case ValueType::Boolean: return AsBoolean() > rhs.AsBoolean();
 		case ValueType::Integer | ValueType::Real: return ToReal() > rhs.ToReal();
 		case ValueType::Integer | ValueType::Boolean: return ToBoolean() > rhs.ToBoolean();
-		case ValueType::String: return ::strcmp(strValue, rhs.strValue) > 0;
+		case ValueType::String: return ::strcmp(StringChars(), rhs.StringChars()) > 0;
 	}
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot compare {} and {}", ToString(), rhs.ToString()));
 }
 
 Value Value::GreaterThanOrEqual(Value const& rhs) const {
 	switch (Type() | rhs.Type()) {
-		case ValueType::Integer: return iValue >= rhs.iValue;
-		case ValueType::Real: return dValue >= rhs.dValue;
-		case ValueType::Boolean: return bValue >= rhs.bValue;
+		case ValueType::Integer: return AsInteger() >= rhs.AsInteger();
+		case ValueType::Real: return AsReal() >= rhs.AsReal();
+		case ValueType::Boolean: return AsBoolean() >= rhs.AsBoolean();
 		case ValueType::Integer | ValueType::Real: return ToReal() >= rhs.ToReal();
 		case ValueType::Integer | ValueType::Boolean: return ToBoolean() >= rhs.ToBoolean();
-		case ValueType::String: return ::strcmp(strValue, rhs.strValue) >= 0;
+		case ValueType::String: return ::strcmp(StringChars(), rhs.StringChars()) >= 0;
 		case ValueType::Empty: return true;
 	}
 	throw RuntimeError(RuntimeErrorType::TypeMismatch, std::format("Cannot compare {} and {}", ToString(), rhs.ToString()));
@@ -5,8 +5,11 @@
 #include <sstream>
 #include <vector>
 #include <cassert>
+#include <bit>
+#include <atomic>
 
 #include "Token.h"
+#include "Atom.h"
 #include "EnumClassBitwise.h"
 #include "ObjectPtr.h"
 
@@ -54,30 +57,77 @@ namespace Dynamix {
 
 	class Value;
 	struct MethodInfo;
+	struct SharedString;
 	enum class SymbolFlags : uint16_t;
 
 	using NativeFunction = Value(*)(Interpreter&, std::vector<Value>&);
 
-	struct Callable {
+	//
+	// a method bound to its instance, created when "obj.Method" is used as a value rather than called.
+	// pooled and reference counted, so copying a Value holding one does not allocate.
+	// the method is resolved on the first call and reused while the argument count stays the same
+	//
+	struct Callable final {
 		ObjectPtr<const RuntimeObject> Instance;
-		std::string Name;
-		NativeFunction Native{ nullptr };
+		Atom Name;
 		SymbolFlags Flags;
+
+		static Callable* Create(RuntimeObject const* instance, Atom name, SymbolFlags flags);
+
+		bool IsStatic() const noexcept;
+		MethodInfo const* Resolve(int8_t count, ObjectType const*& owner) noexcept;
+
+		void AddRef() noexcept {
+			++m_RefCount;
+		}
+		void Release() noexcept;
+
+	private:
+		Callable(RuntimeObject const* instance, Atom name, SymbolFlags flags) noexcept;
+
+		MethodInfo const* m_Method{ nullptr };
+		ObjectType const* m_Owner{ nullptr };
+		int8_t m_Count{ -1 };
+		std::atomic<int> m_RefCount{ 1 };
 	};
 
+	//
+	// a Value is 16 bytes by default: an 8 byte payload followed by the type, error and string tags.
+	// building with DYNAMIX_NAN_BOXING packs it into 8 bytes instead: doubles are stored as themselves,
+	// everything else lives in the payload bits of negative quiet NaNs (see Tag below).
+	// the public API is the same for both layouts
+	//
 	class Value final {
 	public:
+#ifdef DYNAMIX_NAN_BOXING
+		constexpr Value() noexcept : m_Bits(Box(Tag::Empty)) {}
+		constexpr Value(Int v) noexcept : m_Bits(Box(Tag::Integer, uint64_t(v))) {
+			if (v < MinInlineInteger || v > MaxInlineInteger)
+				SetBigInteger(v);
+		}
+		constexpr Value(int v) noexcept : m_Bits(Box(Tag::Integer, uint64_t(Int(v)))) {}
+		constexpr Value(long v) noexcept : Value(Int(v)) {}
+		constexpr Value(Real d) noexcept : m_Bits(d != d ? CanonicalNaN : std::bit_cast<uint64_t>(d)) {}
+		constexpr Value(Bool b) noexcept : m_Bits(Box(Tag::Boolean, b ? 1 : 0)) {}
+		constexpr Value(ValueType t) noexcept : m_Bits(Box(TagOf(t))) {}
+		Value(AstNode const* node) noexcept : m_Bits(Box(Tag::AstNode, reinterpret_cast<uint64_t>(node))) {}
+		Value(NativeFunction f) noexcept : m_Bits(Box(Tag::NativeFunction, reinterpret_cast<uint64_t>(f))) {}
+		Value(Value* p) noexcept : m_Bits(Box(Tag::Pointer, reinterpret_cast<uint64_t>(p))) {}
+#else
 		constexpr Value() noexcept : m_Type(ValueType::Empty) {}
 		constexpr Value(Int v) noexcept : iValue(v), m_Type(ValueType::Integer) {}
 		constexpr Value(int v) noexcept : iValue(v), m_Type(ValueType::Integer) {}
+		constexpr Value(long v) noexcept : iValue(v), m_Type(ValueType::Integer) {}
 		constexpr Value(Real d) noexcept : dValue(d), m_Type(ValueType::Real) {}
 		constexpr Value(Bool b) noexcept : bValue(b), m_Type(ValueType::Boolean) {}
 		constexpr Value(ValueType t) noexcept : m_Type(t) {}
 		constexpr Value(AstNode const* node) noexcept : nValue(node), m_Type(ValueType::AstNode) {}
 		constexpr Value(NativeFunction f) noexcept : fValue(f), m_Type(ValueType::NativeFunction) {}
 		constexpr Value(Value* p) noexcept : pValue(p), m_Type(ValueType::Pointer) {}
+#endif
 
 		Value(const char* s) noexcept;
+		explicit Value(std::string_view s) noexcept;
 		Value(RuntimeObject const* o) noexcept;
 		Value(Callable* c) noexcept;
 
@@ -99,48 +149,67 @@ namespace Dynamix {
 		ObjectType const* GetObjectType() const;
 
 		ValueType Type() const noexcept {
+#ifdef DYNAMIX_NAN_BOXING
+			return IsBoxed() ? TagTypes[size_t(GetTag())] : ValueType::Real;
+#else
 			return m_Type;
+#endif
 		}
 
 		bool IsEmpty() const noexcept {
-			return m_Type == ValueType::Empty;
+			return Type() == ValueType::Empty;
 		}
 
 		bool IsInteger() const noexcept {
-			return m_Type == ValueType::Integer;
+			return Type() == ValueType::Integer;
 		}
 
 		bool IsReal() const noexcept {
+#ifdef DYNAMIX_NAN_BOXING
+			return !IsBoxed();
+#else
 			return m_Type == ValueType::Real;
+#endif
 		}
 		bool IsBoolean() const noexcept {
-			return m_Type == ValueType::Boolean;
+			return Type() == ValueType::Boolean;
 		}
 		bool IsObject() const noexcept {
-			return m_Type == ValueType::Object;
+			return Type() == ValueType::Object;
 		}
 		bool IsObjectType() const noexcept;
 
 		bool IsAstNode() const noexcept {
-			return m_Type == ValueType::AstNode;
+			return Type() == ValueType::AstNode;
 		}
 		bool IsStruct() const noexcept {
-			return m_Type == ValueType::Struct;
+			return Type() == ValueType::Struct;
 		}
 		bool IsString() const noexcept {
-			return m_Type == ValueType::String;
+			return Type() == ValueType::String;
 		}
 		bool IsError() const noexcept {
-			return m_Type == ValueType::Error;
+			return Type() == ValueType::Error;
 		}
 		bool IsNativeFunction() const noexcept {
-			return m_Type == ValueType::NativeFunction;
+			return Type() == ValueType::NativeFunction;
 		}
 
 		bool IsCallable() const noexcept {
-			return m_Type == ValueType::Callable;
+			return Type() == ValueType::Callable;
 		}
 
+#ifdef DYNAMIX_NAN_BOXING
+		Int AsInteger() const noexcept {
+			assert(IsInteger());
+			return GetTag() == Tag::Integer ? Int(m_Bits << 16) >> 16 : *PayloadAs<Int>();
+		}
+
+		Real AsReal() const noexcept {
+			assert(IsReal());
+			return std::bit_cast<Real>(m_Bits);
+		}
+#else
 		Int AsInteger() const noexcept {
 			assert(IsInteger());
 			return iValue;
@@ -150,6 +219,7 @@ namespace Dynamix {
 			assert(IsReal());
 			return dValue;
 		}
+#endif
 
 		Int ToInteger() const;
 		Bool ToBoolean() const;
@@ -157,6 +227,32 @@ namespace Dynamix {
 		RuntimeObject const* ToObject() const;
 		ObjectType const* ToTypeObject() const;
 
+#ifdef DYNAMIX_NAN_BOXING
+		AstNode const* AsAstNode() const noexcept {
+			assert(IsAstNode());
+			return PayloadAs<AstNode const>();
+		}
+
+		RuntimeObject* AsObject() noexcept {
+			assert(IsObject());
+			return PayloadAs<RuntimeObject>();
+		}
+
+		RuntimeObject const* AsObject() const noexcept {
+			assert(IsObject());
+			return PayloadAs<RuntimeObject const>();
+		}
+
+		NativeFunction AsNativeCode() const noexcept {
+			assert(IsNativeFunction());
+			return reinterpret_cast<NativeFunction>(Payload());
+		}
+
+		Callable* AsCallable() const noexcept {
+			assert(IsCallable());
+			return PayloadAs<Callable>();
+		}
+#else
 		AstNode const* AsAstNode() const noexcept {
 			assert(IsAstNode());
 			return nValue;
@@ -181,6 +277,7 @@ namespace Dynamix {
 			assert(IsCallable());
 			return cValue;
 		}
+#endif
 
 		Value BinaryOperator(TokenType op, Value const& rhs) const;
 		Value UnaryOperator(TokenType op) const;
@@ -217,30 +314,167 @@ namespace Dynamix {
 		Value InvokeIndexer(Value const& index) const;
 
 		void Free() noexcept;
+		// whether Free has anything to let go of: an object, a long string or anything else on the heap
+		bool OwnsStorage() const noexcept;
+
+		//
+		// strings of up to ShortStringMax characters are stored inline;
+		// longer ones share an immutable, reference counted buffer, so copying a string never copies its text
+		//
+#ifdef DYNAMIX_NAN_BOXING
+		static constexpr uint32_t ShortStringMax = 5;
+
+		bool IsShortString() const noexcept {
+			return IsBoxed() && GetTag() == Tag::ShortString;
+		}
+#else
+		static constexpr uint32_t ShortStringMax = 13;
+
+		bool IsShortString() const noexcept {
+			return IsString() && m_StrTag != LongString;
+		}
+#endif
 
 	private:
-		union {
-			Int iValue;
-			Real dValue;
-			Bool bValue;
-			RuntimeObject const* oValue;
-			AstNode const* nValue;
-			NativeStruct* sValue;
-			Callable* cValue;
-			char* strValue;
-			NativeFunction fValue;
-			Value* pValue;
+		// generated code reads and writes the payload and the type in place
+		friend class Jit;
+
+		void SetString(std::string_view s) noexcept;
+		const char* StringChars() const noexcept;
+		uint32_t StringLength() const noexcept;
+		bool StringEquals(Value const& rhs) const noexcept;
+
+#ifdef DYNAMIX_NAN_BOXING
+		Bool AsBoolean() const noexcept {
+			assert(IsBoolean());
+			return Payload() != 0;
+		}
+		Value* AsPointer() const noexcept {
+			assert(Type() == ValueType::Pointer);
+			return PayloadAs<Value>();
+		}
+
+		//
+		// boxed values are negative quiet NaNs: the top 12 bits are set, the next 4 hold the tag
+		// and the low 48 the payload. Tag::Real (0) is never boxed, which leaves -infinity alone;
+		// any other NaN a double may hold is canonicalized to a positive one.
+		// pointers fit in 48 bits on the 64-bit platforms we support, as do most integers -
+		// those that do not are boxed on the heap (BigInteger)
+		//
+		enum class Tag : uint8_t {
+			Real,
+			Empty,
+			Integer,
+			BigInteger,
+			Boolean,
+			Object,
+			AstNode,
+			Struct,
+			ShortString,	// up to 5 characters in the payload, the 6th byte is 5 - length
+			String,			// SharedString*
+			NativeFunction,
+			Callable,
+			Pointer,
+			Error,			// payload is the ValueErrorType
+			DescribedError,	// payload is an ErrorDescription*
+			ObjectError,	// payload is the RuntimeObject*
 		};
+
+		static constexpr uint64_t BoxBase = 0xfff0'0000'0000'0000ull;
+		static constexpr uint64_t PayloadMask = 0x0000'ffff'ffff'ffffull;
+		static constexpr uint64_t CanonicalNaN = 0x7ff8'0000'0000'0000ull;
+		static constexpr Int MinInlineInteger = -(1ll << 47);
+		static constexpr Int MaxInlineInteger = (1ll << 47) - 1;
+
+		static constexpr ValueType TagTypes[] {
+			ValueType::Real, ValueType::Empty, ValueType::Integer, ValueType::Integer, ValueType::Boolean,
+			ValueType::Object, ValueType::AstNode, ValueType::Struct, ValueType::String, ValueType::String,
+			ValueType::NativeFunction, ValueType::Callable, ValueType::Pointer,
+			ValueType::Error, ValueType::Error, ValueType::Error,
+		};
+
+		static constexpr uint64_t Box(Tag tag, uint64_t payload = 0) noexcept {
+			return BoxBase | (uint64_t(tag) << 48) | (payload & PayloadMask);
+		}
+
+		static constexpr Tag TagOf(ValueType type) noexcept {
+			switch (type) {
+				case ValueType::Empty: return Tag::Empty;
+				case ValueType::Integer: return Tag::Integer;
+				case ValueType::Real: return Tag::Real;
+				case ValueType::Boolean: return Tag::Boolean;
+				case ValueType::Object: return Tag::Object;
+				case ValueType::AstNode: return Tag::AstNode;
+				case ValueType::Struct: return Tag::Struct;
+				case ValueType::String: return Tag::ShortString;
+				case ValueType::NativeFunction: return Tag::NativeFunction;
+				case ValueType::Callable: return Tag::Callable;
+				case ValueType::Pointer: return Tag::Pointer;
+			}
+			return Tag::Error;
+		}
+
+		bool IsBoxed() const noexcept {
+			return m_Bits > BoxBase;
+		}
+		Tag GetTag() const noexcept {
+			return IsBoxed() ? Tag((m_Bits >> 48) & 15) : Tag::Real;
+		}
+		uint64_t Payload() const noexcept {
+			return m_Bits & PayloadMask;
+		}
+		template<typename T>
+		T* PayloadAs() const noexcept {
+			return reinterpret_cast<T*>(Payload());
+		}
+
+		void SetBigInteger(Int v) noexcept;
+
+		uint64_t m_Bits;
+	};
+
+	static_assert(sizeof(Value) == 8);
+	static_assert(sizeof(void*) == 8 && std::endian::native == std::endian::little, "NaN boxing requires a 64-bit little endian target");
+#else
+		Bool AsBoolean() const noexcept {
+			assert(IsBoolean());
+			return bValue;
+		}
+		Value* AsPointer() const noexcept {
+			assert(Type() == ValueType::Pointer);
+			return pValue;
+		}
+
+		static constexpr uint8_t LongString = 0xff;
+
 		union {
 			struct {
-				ValueType m_Type;
-				ValueErrorType m_Error;
+				union {
+					Int iValue;
+					Real dValue;
+					Bool bValue;
+					RuntimeObject const* oValue;
+					AstNode const* nValue;
+					NativeStruct* sValue;
+					Callable* cValue;
+					SharedString* shValue;
+					char* strValue;			// error description
+					NativeFunction fValue;
+					Value* pValue;
+				};
 				uint32_t m_StrLen;
+				ValueErrorType m_Error;
+				// 13 - length for short strings (the terminator of a 13 character one), LongString otherwise
+				uint8_t m_StrTag;
+				ValueType m_Type;
 			};
+			char m_Chars[ShortStringMax + 1];
+			uint64_t m_Raw[2];
 		};
 	};
 
 	static_assert(sizeof(Value) == 16);
+#endif
 }
 
 
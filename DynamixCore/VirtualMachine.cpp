@@ -0,0 +1,572 @@
+#include <cassert>
+#include <format>
+
+#include "VirtualMachine.h"
+#include "Interpreter.h"
+#include "AstNode.h"
+#include "Runtime.h"
+#include "RuntimeObject.h"
+#include "ArrayType.h"
+#include "CoreInterfaces.h"
+#include "Jit.h"
+
+using namespace Dynamix;
+using namespace std;
+
+#if defined(__GNUC__) || defined(__clang__)
+#define DYNAMIX_COMPUTED_GOTO
+#endif
+
+VirtualMachine::VirtualMachine(Interpreter& intr) : m_Interpreter(intr), m_Registers(make_unique<Value[]>(MaxRegisters)) {
+}
+
+VirtualMachine::~VirtualMachine() = default;
+
+void VirtualMachine::EnableJit(bool enable) {
+	if (!enable)
+		m_Jit.reset();
+	else if (!m_Jit && Jit::IsSupported())
+		m_Jit = make_unique<Jit>();
+}
+
+Value VirtualMachine::Execute(AstNode const* root) {
+	auto chunk = m_Compiler.Compile(root);
+	return Execute(*chunk);
+}
+
+Value VirtualMachine::ExecuteBody(AstNode const* body) {
+	auto code = body->CompiledCode();
+	if (!code) {
+		code = m_Compiler.Compile(body, true);
+		body->SetCompiledCode(code);
+	}
+	if (m_Jit && !code->Native && ++code->Hotness >= Jit::HotThreshold)
+		m_Jit->Compile(*code, body);
+	TreeWalking walking(this, false);
+	return Execute(*code);
+}
+
+Value VirtualMachine::Execute(CodeChunk const& chunk) {
+	auto base = m_Top;
+	if (base + chunk.RegisterCount > MaxRegisters)
+		throw RuntimeError(RuntimeErrorType::StackOverflow, "Call stack is too deep");
+
+	m_Top += chunk.RegisterCount;
+	auto scopes = m_Interpreter.m_Scopes.Depth();
+	auto iterations = m_Iterations.size();
+	auto R = m_Registers.get() + base;
+
+	//
+	// leave the interpreter the way the tree-walker's RAII would, whether by return or by exception
+	//
+	auto unwind = [&]() {
+		while (m_Iterations.size() > iterations)
+			m_Iterations.pop_back();
+		while (m_Interpreter.m_Scopes.Depth() > scopes)
+			m_Interpreter.PopScope();
+		for (int i = 0; i < chunk.RegisterCount; i++)
+			R[i] = Value();
+		m_Top = base;
+	};
+
+	try {
+		auto result = chunk.Native ? RunNative(chunk, R) : Run(chunk, R);
+		unwind();
+		return result;
+	}
+	catch (...) {
+		unwind();
+		throw;
+	}
+}
+
+Value VirtualMachine::RunNative(CodeChunk const& chunk, Value* R) {
+	JitContext ctx{ this, &chunk, m_Interpreter.m_Scopes.TopAddress() };
+	switch (chunk.Native->Run(R, ctx)) {
+		case JitCode::Exit:
+			return move(ctx.Result);
+		case JitCode::Failed:
+			rethrow_exception(ctx.Error);
+	}
+	// the machine code handed the rest of this call back
+	return Run(chunk, R, ctx.ResumePc);
+}
+
+Value VirtualMachine::Run(CodeChunk const& chunk, Value* R, int start) {
+	auto& intr = m_Interpreter;
+	auto code = chunk.Code.data();
+	auto K = chunk.Constants.data();
+	auto pc = code + start;
+	Instruction inst;
+
+#define ORIGIN(T) static_cast<T const*>(chunk.Origins[pc - code - 1])
+
+#ifdef DYNAMIX_COMPUTED_GOTO
+	// must follow the order of OpCode
+	static void* const labels[] = {
+		&&op_Nop, &&op_LoadConst, &&op_LoadEmpty, &&op_LoadTrue, &&op_LoadFalse, &&op_Move, &&op_ClearRegs,
+		&&op_LoadName, &&op_Assign, &&op_TestVar, &&op_DeclareVar,
+		&&op_Add, &&op_Sub, &&op_Mul, &&op_Div, &&op_Mod, &&op_Equal, &&op_NotEqual,
+		&&op_Less, &&op_LessEqual, &&op_Greater, &&op_GreaterEqual,
+		&&op_Binary, &&op_Unary, &&op_Jump, &&op_JumpIfFalse, &&op_JumpIfTrue, &&op_JumpIfError,
+		&&op_Call, &&op_CallMember, &&op_GetMember, &&op_GetIndex, &&op_SetIndex, &&op_NewArray, &&op_PushScope, &&op_PopScope,
+		&&op_RepeatInit, &&op_RepeatNext, &&op_IterInit, &&op_IterNext, &&op_IterEnd,
+		&&op_Return, &&op_ReturnEmpty, &&op_EvalNode,
+	};
+	static_assert(size(labels) == (size_t)OpCode::Count_);
+
+#define CASE(op) op_##op:
+#define NEXT inst = *pc++; goto *labels[(size_t)inst.Op]
+	NEXT;
+#else
+#define CASE(op) case OpCode::op:
+#define NEXT continue
+	for (;;) {
+		inst = *pc++;
+		switch (inst.Op) {
+#endif
+
+#define INT_BINARY(op, expr)														\
+	CASE(op) {																		\
+		auto& l = R[inst.B];														\
+		auto& r = R[inst.C];														\
+		if (l.IsInteger() && r.IsInteger())											\
+			R[inst.A] = Value(l.AsInteger() expr r.AsInteger());					\
+		else																		\
+			R[inst.A] = intr.BinaryOperation(l, ORIGIN(BinaryExpression)->Operator(), r);	\
+	}																				\
+	NEXT;
+
+	CASE(Nop)
+		NEXT;
+
+	CASE(LoadConst)
+		R[inst.A] = K[inst.Bx];
+		NEXT;
+
+	CASE(LoadEmpty)
+		R[inst.A] = Value();
+		NEXT;
+
+	CASE(LoadTrue)
+		R[inst.A] = true;
+		NEXT;
+
+	CASE(LoadFalse)
+		R[inst.A] = false;
+		NEXT;
+
+	CASE(Move)
+		R[inst.A] = R[inst.B];
+		NEXT;
+
+	CASE(ClearRegs)
+		for (int i = 0; i < inst.B; i++)
+			R[inst.A + i] = Value();
+		NEXT;
+
+	CASE(LoadName)
+		R[inst.A] = intr.VisitName(ORIGIN(NameExpression));
+		NEXT;
+
+	CASE(Assign) {
+		auto expr = ORIGIN(AssignExpression);
+		auto lhs = intr.FindVariable(expr->LhsAtom(), expr->Slot());
+		if (!lhs)
+			throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Unknown identifier: {}", expr->Lhs()), expr->Location());
+		R[inst.A] = lhs->VarValue.Assign(R[inst.A], expr->AssignType());
+	}
+	NEXT;
+
+	CASE(TestVar)
+		if (intr.IsDeclared(ORIGIN(VarValStatement))) {
+			R[inst.A] = Value::Error(ValueErrorType::DuplicateName);
+			pc += inst.sBx;
+		}
+		NEXT;
+
+	CASE(DeclareVar)
+		intr.DeclareVariable(ORIGIN(VarValStatement), move(R[inst.A]));
+		R[inst.A] = Value();
+		NEXT;
+
+	INT_BINARY(Add, +)
+	INT_BINARY(Sub, -)
+	INT_BINARY(Mul, *)
+	INT_BINARY(Equal, ==)
+	INT_BINARY(NotEqual, !=)
+	INT_BINARY(Less, <)
+	INT_BINARY(LessEqual, <=)
+	INT_BINARY(Greater, >)
+	INT_BINARY(GreaterEqual, >=)
+
+	CASE(Div)
+	CASE(Mod)
+	CASE(Binary)
+		R[inst.A] = intr.BinaryOperation(R[inst.B], ORIGIN(BinaryExpression)->Operator(), R[inst.C]);
+		NEXT;
+
+	CASE(Unary)
+		R[inst.A] = R[inst.B].UnaryOperator(ORIGIN(UnaryExpression)->Operator());
+		NEXT;
+
+	CASE(Jump)
+		// a loop's back edge counts toward its function body getting compiled
+		if (inst.sBx < 0 && chunk.Hotness < Jit::HotThreshold)
+			chunk.Hotness++;
+		pc += inst.sBx;
+		NEXT;
+
+	CASE(JumpIfFalse)
+		if (!R[inst.A].ToBoolean())
+			pc += inst.sBx;
+		NEXT;
+
+	CASE(JumpIfTrue)
+		if (R[inst.A].ToBoolean())
+			pc += inst.sBx;
+		NEXT;
+
+	CASE(JumpIfError)
+		if (R[inst.A].IsError())
+			pc += inst.sBx;
+		NEXT;
+
+	CASE(Call)
+		if (Call(inst, ORIGIN(InvokeFunctionExpression), R, false))
+			return move(R[inst.A]);
+		NEXT;
+
+	CASE(CallMember)
+		if (Call(inst, ORIGIN(InvokeFunctionExpression), R, true))
+			return move(R[inst.A]);
+		NEXT;
+
+	CASE(GetMember)
+		R[inst.A] = intr.GetMemberValue(R[inst.A], ORIGIN(GetMemberExpression));
+		NEXT;
+
+	CASE(GetIndex)
+		R[inst.A] = R[inst.B].InvokeIndexer(R[inst.C]);
+		NEXT;
+
+	CASE(SetIndex)
+		R[inst.A].AssignArrayIndex(R[inst.A + 1], R[inst.A + 2], ORIGIN(AssignArrayIndexExpression)->AssignType());
+		NEXT;
+
+	CASE(NewArray) {
+		vector<Value> values;
+		values.reserve(inst.C);
+		for (int i = 0; i < inst.C; i++)
+			values.push_back(move(R[inst.B + i]));
+		R[inst.A] = ArrayType::Get()->CreateArrayValue(move(values));
+	}
+	NEXT;
+
+	CASE(PushScope)
+		intr.PushScope(inst.Bx);
+		NEXT;
+
+	CASE(PopScope)
+		intr.PopScope();
+		NEXT;
+
+	CASE(RepeatInit)
+		R[inst.A] = R[inst.A].ToInteger();
+		NEXT;
+
+	CASE(RepeatNext)
+		if (R[inst.A].AsInteger() <= 0)
+			pc += inst.sBx;
+		else
+			R[inst.A] = R[inst.A].AsInteger() - 1;
+		NEXT;
+
+	CASE(IterInit)
+		BeginIteration(ORIGIN(ForEachStatement), R[inst.A]);
+		NEXT;
+
+	CASE(IterNext)
+		if (!NextIteration())
+			pc += inst.sBx;
+		NEXT;
+
+	CASE(IterEnd)
+		EndIteration();
+		NEXT;
+
+	CASE(Return)
+		return move(R[inst.A]);
+
+	CASE(ReturnEmpty)
+		return Value();
+
+	CASE(EvalNode) {
+		auto next = EvalNode(chunk, inst, int(pc - code - 1), R);
+		if (next < 0)
+			return move(R[inst.A]);
+		pc = code + next;
+	}
+	NEXT;
+
+#ifndef DYNAMIX_COMPUTED_GOTO
+			case OpCode::Count_:
+				break;
+		}
+		assert(false);
+	}
+#endif
+
+#undef INT_BINARY
+#undef NEXT
+#undef CASE
+#undef ORIGIN
+	return Value();
+}
+
+bool VirtualMachine::Call(Instruction inst, InvokeFunctionExpression const* site, Value* R, bool member) {
+	auto& intr = m_Interpreter;
+	Arguments arguments(&intr);
+	auto& args = arguments.Get();
+	for (int i = 1; i <= inst.C; i++)
+		args.push_back(move(R[inst.B + i]));
+	intr.m_CurrentNode = site;
+	R[inst.A] = member ? intr.InvokeMember(R[inst.B], args, site) : intr.CallFunction(move(R[inst.B]), args, site);
+	// a break or continue escaping the callee unwinds this chunk too
+	return intr.m_Completion != Completion::Normal;
+}
+
+void VirtualMachine::BeginIteration(ForEachStatement const* stmt, Value const& collection) {
+	// String to be dealt with later
+	if (!collection.IsObject())
+		throw RuntimeError(RuntimeErrorType::TypeMismatch, "Expected collection in 'foreach' statement",
+			stmt->Collection()->Location());
+
+	auto enumerable = static_cast<IEnumerable*>(const_cast<RuntimeObject*>(collection.AsObject())->QueryService(ServiceId::Enumerable));
+	if (!enumerable)
+		throw RuntimeError(RuntimeErrorType::TypeMismatch, "Object does not implement the Enumerable interface", stmt->Collection()->Location());
+
+	m_Interpreter.PushScope(stmt->SlotCount());
+	auto variable = m_Interpreter.CurrentScope().DefineSlot(stmt->Slot().Index, stmt->NameAtom(), Element{});
+	assert(variable);
+	m_Iterations.push_back(Iteration{ enumerable->GetEnumerator(), variable });
+}
+
+bool VirtualMachine::NextIteration() {
+	auto& iteration = m_Iterations.back();
+	auto next = iteration.Enumerator->GetNextValue();
+	if (next.IsError())
+		return false;
+	iteration.Variable->VarValue = move(next);
+	return true;
+}
+
+void VirtualMachine::EndIteration() {
+	m_Iterations.pop_back();
+	m_Interpreter.PopScope();
+}
+
+int VirtualMachine::EvalNode(CodeChunk const& chunk, Instruction inst, int pc, Value* R) {
+	auto& intr = m_Interpreter;
+	{
+		TreeWalking walking(this, true);
+		R[inst.A] = intr.Eval(chunk.Origins[pc]);
+	}
+	if (intr.m_Completion == Completion::Normal)
+		return pc + 1;
+
+	//
+	// break/continue left by the tree-walker inside a compiled loop jump to its exits;
+	// anything else completes outside this chunk
+	//
+	if (inst.Bx == 0)
+		return -1;
+
+	auto& handler = chunk.Handlers[inst.Bx - 1];
+	int next;
+	switch (intr.m_Completion) {
+		case Completion::Break:
+			next = handler.Break;
+			break;
+		case Completion::Continue:
+			next = handler.Continue;
+			break;
+		default:
+			return -1;
+	}
+	intr.m_Completion = Completion::Normal;
+	return next;
+}
+
+//
+// the JIT's slow path: one instruction, run the way Run would. the status tells the machine code
+// to go on, to take the instruction's jump, or to leave with the call's result or exception
+//
+int64_t VirtualMachine::Step(JitContext& ctx, Value* R, int pc) noexcept {
+	auto& intr = m_Interpreter;
+	auto& chunk = *ctx.Chunk;
+	auto inst = chunk.Code[pc];
+	auto origin = chunk.Origins[pc];
+
+	try {
+		switch (inst.Op) {
+			case OpCode::Nop:
+				break;
+
+			case OpCode::LoadConst:
+				R[inst.A] = chunk.Constants[inst.Bx];
+				break;
+
+			case OpCode::LoadEmpty:
+				R[inst.A] = Value();
+				break;
+
+			case OpCode::LoadTrue:
+				R[inst.A] = true;
+				break;
+
+			case OpCode::LoadFalse:
+				R[inst.A] = false;
+				break;
+
+			case OpCode::Move:
+				R[inst.A] = R[inst.B];
+				break;
+
+			case OpCode::ClearRegs:
+				for (int i = 0; i < inst.B; i++)
+					R[inst.A + i] = Value();
+				break;
+
+			case OpCode::LoadName:
+				R[inst.A] = intr.VisitName(static_cast<NameExpression const*>(origin));
+				break;
+
+			case OpCode::Assign: {
+				auto expr = static_cast<AssignExpression const*>(origin);
+				auto lhs = intr.FindVariable(expr->LhsAtom(), expr->Slot());
+				if (!lhs)
+					throw RuntimeError(RuntimeErrorType::UnknownIdentifier, format("Unknown identifier: {}", expr->Lhs()), expr->Location());
+				R[inst.A] = lhs->VarValue.Assign(R[inst.A], expr->AssignType());
+				break;
+			}
+
+			case OpCode::TestVar:
+				if (intr.IsDeclared(static_cast<VarValStatement const*>(origin))) {
+					R[inst.A] = Value::Error(ValueErrorType::DuplicateName);
+					return JitCode::Jump;
+				}
+				break;
+
+			case OpCode::DeclareVar:
+				intr.DeclareVariable(static_cast<VarValStatement const*>(origin), move(R[inst.A]));
+				R[inst.A] = Value();
+				break;
+
+			case OpCode::Add: case OpCode::Sub: case OpCode::Mul: case OpCode::Div: case OpCode::Mod:
+			case OpCode::Equal: case OpCode::NotEqual: case OpCode::Less: case OpCode::LessEqual:
+			case OpCode::Greater: case OpCode::GreaterEqual: case OpCode::Binary:
+				R[inst.A] = intr.BinaryOperation(R[inst.B], static_cast<BinaryExpression const*>(origin)->Operator(), R[inst.C]);
+				break;
+
+			case OpCode::Unary:
+				R[inst.A] = R[inst.B].UnaryOperator(static_cast<UnaryExpression const*>(origin)->Operator());
+				break;
+
+			case OpCode::Jump:
+				return JitCode::Jump;
+
+			case OpCode::JumpIfFalse:
+				return R[inst.A].ToBoolean() ? JitCode::Continue : JitCode::Jump;
+
+			case OpCode::JumpIfTrue:
+				return R[inst.A].ToBoolean() ? JitCode::Jump : JitCode::Continue;
+
+			case OpCode::JumpIfError:
+				return R[inst.A].IsError() ? JitCode::Jump : JitCode::Continue;
+
+			case OpCode::Call:
+			case OpCode::CallMember:
+				if (Call(inst, static_cast<InvokeFunctionExpression const*>(origin), R, inst.Op == OpCode::CallMember)) {
+					ctx.Result = move(R[inst.A]);
+					return JitCode::Exit;
+				}
+				break;
+
+			case OpCode::GetMember:
+				R[inst.A] = intr.GetMemberValue(R[inst.A], static_cast<GetMemberExpression const*>(origin));
+				break;
+
+			case OpCode::GetIndex:
+				R[inst.A] = R[inst.B].InvokeIndexer(R[inst.C]);
+				break;
+
+			case OpCode::SetIndex:
+				R[inst.A].AssignArrayIndex(R[inst.A + 1], R[inst.A + 2], static_cast<AssignArrayIndexExpression const*>(origin)->AssignType());
+				break;
+
+			case OpCode::NewArray: {
+				vector<Value> values;
+				values.reserve(inst.C);
+				for (int i = 0; i < inst.C; i++)
+					values.push_back(move(R[inst.B + i]));
+				R[inst.A] = ArrayType::Get()->CreateArrayValue(move(values));
+				break;
+			}
+
+			case OpCode::PushScope:
+				intr.PushScope(inst.Bx);
+				break;
+
+			case OpCode::PopScope:
+				intr.PopScope();
+				break;
+
+			case OpCode::RepeatInit:
+				R[inst.A] = R[inst.A].ToInteger();
+				break;
+
+			case OpCode::RepeatNext:
+				if (R[inst.A].AsInteger() <= 0)
+					return JitCode::Jump;
+				R[inst.A] = R[inst.A].AsInteger() - 1;
+				break;
+
+			case OpCode::IterInit:
+				BeginIteration(static_cast<ForEachStatement const*>(origin), R[inst.A]);
+				break;
+
+			case OpCode::IterNext:
+				return NextIteration() ? JitCode::Continue : JitCode::Jump;
+
+			case OpCode::IterEnd:
+				EndIteration();
+				break;
+
+			case OpCode::Return:
+				ctx.Result = move(R[inst.A]);
+				return JitCode::Exit;
+
+			case OpCode::ReturnEmpty:
+				return JitCode::Exit;
+
+			case OpCode::EvalNode: {
+				auto next = EvalNode(chunk, inst, pc, R);
+				if (next < 0) {
+					ctx.Result = move(R[inst.A]);
+					return JitCode::Exit;
+				}
+				if (next != pc + 1) {
+					ctx.ResumePc = next;
+					return JitCode::Resume;
+				}
+				break;
+			}
+		}
+	}
+	catch (...) {
+		ctx.Error = current_exception();
+		return JitCode::Failed;
+	}
+	return JitCode::Continue;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "Bytecode.h"
+#include "Compiler.h"
+#include "NoCopyMove.h"
+
+namespace Dynamix {
+	class Interpreter;
+	class Jit;
+	class InvokeFunctionExpression;
+	class ForEachStatement;
+	struct Element;
+	struct IEnumerator;
+	struct JitContext;
+
+	class VirtualMachine final : NoCopy {
+	public:
+		explicit VirtualMachine(Interpreter& intr);
+		~VirtualMachine();
+
+		Value Execute(AstNode const* root);
+		Value ExecuteBody(AstNode const* body);
+		Value Execute(CodeChunk const& chunk);
+
+		bool IsTreeWalking() const noexcept {
+			return m_TreeWalking;
+		}
+
+		// compiles hot function bodies to machine code where the JIT is supported
+		void EnableJit(bool enable);
+		Jit* GetJit() const noexcept {
+			return m_Jit.get();
+		}
+
+		static constexpr int MaxRegisters = 1 << 16;
+
+	private:
+		friend class Jit;
+
+		Value Run(CodeChunk const& chunk, Value* R, int start = 0);
+		Value RunNative(CodeChunk const& chunk, Value* R);
+		// runs the instruction at pc on behalf of JIT code; returns one of JitCode's status codes
+		int64_t Step(JitContext& ctx, Value* R, int pc) noexcept;
+
+		// returns true if the call left a completion this chunk must return with
+		bool Call(Instruction inst, InvokeFunctionExpression const* site, Value* R, bool member);
+		void BeginIteration(ForEachStatement const* stmt, Value const& collection);
+		bool NextIteration();
+		void EndIteration();
+		// returns the pc to go on at, or -1 if the chunk must return R[A]
+		int EvalNode(CodeChunk const& chunk, Instruction inst, int pc, Value* R);
+
+		struct TreeWalking {
+			TreeWalking(VirtualMachine* vm, bool walking) : m_VM(vm), m_Saved(vm->m_TreeWalking) {
+				vm->m_TreeWalking = walking;
+			}
+			~TreeWalking() {
+				m_VM->m_TreeWalking = m_Saved;
+			}
+
+		private:
+			VirtualMachine* m_VM;
+			bool m_Saved;
+		};
+
+		struct Iteration {
+			std::unique_ptr<IEnumerator> Enumerator;
+			Element* Variable;
+		};
+
+		Interpreter& m_Interpreter;
+		Compiler m_Compiler;
+		std::unique_ptr<Value[]> m_Registers;
+		int m_Top{ 0 };
+		std::vector<Iteration> m_Iterations;
+		std::unique_ptr<Jit> m_Jit;
+		bool m_TreeWalking{ false };
+	};
+}
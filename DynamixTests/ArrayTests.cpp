@@ -3,6 +3,10 @@
 #include <Value.h>
 #include <RuntimeObject.h>
 #include <Runtime.h>
+#include <Parser.h>
+#include <Tokenizer.h>
+#include <Interpreter.h>
+#include <chrono>
 
 using namespace Dynamix;
 
@@ -51,4 +55,43 @@ TEST_CASE("ArrayType::CreateArray", "[array]") {
     REQUIRE(arr->Items()[1].ToInteger() == 200);
 
     arr->Release();
-}
\ No newline at end of file
+}
+
+//
+// array-heavy workload for comparing Value layouts (build with and without DYNAMIX_NAN_BOXING).
+// hidden; run with: DynamixTests "[benchmark]"
+//
+TEST_CASE("Array workload", "[.][benchmark]") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+
+    auto code = parser.Parse(R"(
+        var items = [];
+        var i = 0;
+        while i < 1000000 {
+            items.Add(i * 0.5);
+            items.Add(i);
+            i += 1;
+        }
+        var sum = 0.0;
+        repeat 5 {
+            foreach item in items {
+                sum += item;
+            }
+        }
+        items.Reverse();
+        items
+    )", true);
+    REQUIRE(code != nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    auto result = interpreter.Eval(code.get());
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+    REQUIRE(result.IsObject());
+
+    auto& items = static_cast<ArrayObject*>(result.AsObject())->Items();
+    CHECK(items.size() == 2000000);
+    WARN(std::format("sizeof(Value) = {}, {} items use {} KB, {} ms", sizeof(Value), items.size(), items.capacity() * sizeof(Value) / 1024, elapsed.count()));
+}
@@ -0,0 +1,73 @@
+#include <catch.hpp>
+#include <Atom.h>
+#include <Tokenizer.h>
+#include <Parser.h>
+#include <AstNode.h>
+#include <Interpreter.h>
+#include <Runtime.h>
+
+using namespace Dynamix;
+
+TEST_CASE("Atoms intern names once", "[atom]") {
+    Atom a("someIdentifier"), b(std::string("some") + "Identifier"), c("otherIdentifier");
+    CHECK(a == b);
+    CHECK(a != c);
+    CHECK(a.Id() == b.Id());
+    CHECK(a.ToString() == "someIdentifier");
+    CHECK(&a.ToString() == &b.ToString());
+    CHECK(Atom().IsEmpty());
+    CHECK(Atom("").IsEmpty());
+    CHECK(std::format("<{}>", c) == "<otherIdentifier>");
+}
+
+TEST_CASE("Tokenizer and AST share atoms", "[atom]") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+
+    auto count = Atom::Count();
+    auto stmts = parser.Parse("var atomTestValue = 5; atomTestValue * 2", true);
+    REQUIRE(stmts != nullptr);
+    CHECK(Atom::Count() > count);
+
+    auto decl = dynamic_cast<VarValStatement const*>(stmts->Get()[0].get());
+    REQUIRE(decl != nullptr);
+    CHECK(decl->NameAtom() == Atom("atomTestValue"));
+    CHECK(decl->Name().c_str() == tokenizer.AddLiteralString("atomTestValue"));
+    CHECK(interpreter.Eval(stmts.get()).ToInteger() == 10);
+
+    // parsing the same names again adds no atoms
+    count = Atom::Count();
+    Tokenizer tokenizer2;
+    Parser parser2(tokenizer2);
+    REQUIRE(parser2.Parse("var atomTestValue = 5; atomTestValue * 2", true) != nullptr);
+    CHECK(Atom::Count() == count);
+}
+
+TEST_CASE("Run-time strings are looked up, not interned", "[atom]") {
+    STATIC_REQUIRE(!std::is_convertible_v<const char*, Atom>);
+    STATIC_REQUIRE(!std::is_convertible_v<std::string, Atom>);
+    CHECK(Atom::This == Atom("this"));
+    CHECK(Atom::This.ToString() == "this");
+
+    auto count = Atom::Count();
+    CHECK(Atom::Find("neverInternedAtomName").IsEmpty());
+    CHECK(Atom::Find("this") == Atom::This);
+    CHECK(Atom::Count() == count);
+
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+    auto stmts = parser.Parse(R"(fn twice(x) { return x * 2; } var f = "tw" + "ice"; f(21))", true);
+    REQUIRE(stmts != nullptr);
+    CHECK(interpreter.Eval(stmts.get()).ToInteger() == 42);
+
+    stmts = parser.Parse(R"(var g = "no" + "SuchFunctionAtAll"; g(1))", true);
+    REQUIRE(stmts != nullptr);
+    count = Atom::Count();
+    CHECK_THROWS_AS(interpreter.Eval(stmts.get()), RuntimeError);
+    CHECK(Atom::Find("noSuchFunctionAtAll").IsEmpty());
+    CHECK(Atom::Count() == count);
+}
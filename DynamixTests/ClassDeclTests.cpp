@@ -120,4 +120,52 @@ TEST_CASE("Interpreter supports inheritance", "[class][inheritance]") {
     auto val = interpreter.Eval(stmts.get());
     REQUIRE(val.IsInteger());
     REQUIRE(val.ToInteger() == 123);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Member call sites cache methods per receiver type", "[class][inlinecache]") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+
+    const char* code = R"(
+        class Shape {
+            var k = 1;
+            fn area() { return this.k; }
+            fn twice() { return this.area() * 2; }
+            class fn unit() { return 1000; }
+        }
+        class Square : Shape { fn area() { return 2; } }
+        class Circle : Shape { fn area() { return 3; } }
+        class Tri : Shape { fn area() { return 4; } }
+        class Hex : Shape { fn area() { return 5; } }
+        fn total(items) {
+            var sum = 0;
+            foreach s in items {
+                sum += s.area();
+            }
+            return sum;
+        }
+        var shapes = [new Shape(), new Square(), new Circle(), new Square()];
+        var all = [new Shape(), new Square(), new Circle(), new Tri(), new Hex()];
+        var sq = new Square();
+        total(shapes) * 100 + total(all) + Shape::unit();
+        sq.twice()
+    )";
+    auto stmts = parser.Parse(code, true);
+    REQUIRE(stmts != nullptr);
+    auto& stmtsVec = stmts->Get();
+    REQUIRE(stmtsVec.size() == 11);
+
+    REQUIRE(interpreter.Eval(stmts.get()).ToInteger() == 4);
+    // polymorphic through four types, then megamorphic with five
+    auto sum = dynamic_cast<ExpressionStatement*>(stmtsVec[9].get());
+    REQUIRE(sum != nullptr);
+    CHECK(interpreter.Eval(sum->Expr()).ToInteger() == 800 + 15 + 1000);
+    CHECK(interpreter.Eval(sum->Expr()).ToInteger() == 800 + 15 + 1000);
+
+    auto call = dynamic_cast<InvokeFunctionExpression const*>(dynamic_cast<ExpressionStatement*>(stmtsVec[10].get())->Expr());
+    REQUIRE(call != nullptr);
+    CHECK(call->Cache().Count() == 1);
+    CHECK_FALSE(call->Cache().IsMegamorphic());
+}
@@ -28,7 +28,7 @@ TEST_CASE("Parser parses a recursive function and checks AST") {
     REQUIRE(fnDecl->NodeType() == AstNodeType::FunctionDeclaration);
     REQUIRE(fnDecl->Name() == "fact");
     REQUIRE(fnDecl->Parameters().size() == 1);
-    REQUIRE(fnDecl->Parameters()[0].Name == "n");
+    REQUIRE(fnDecl->Parameters()[0].Name == Atom("n"));
 
     // Check function body is a block with two statements (if and return)
     auto body = fnDecl->Body();
@@ -0,0 +1,121 @@
+#include <catch.hpp>
+#include <Parser.h>
+#include <Tokenizer.h>
+#include <AstNode.h>
+#include <Interpreter.h>
+#include <CppTranslator.h>
+#include <Value.h>
+#include <Runtime.h>
+
+#include <algorithm>
+
+using namespace Dynamix;
+
+namespace {
+    struct Translation {
+        std::string Code;
+        std::vector<std::string> Translated;
+        std::vector<std::string> Interpreted;
+    };
+
+    Translation Translate(const char* code) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        parser.SetOptimizations(OptimizerPasses::All);
+        auto stmts = parser.Parse(code);
+        REQUIRE(stmts != nullptr);
+
+        CppTranslator translator;
+        auto text = translator.Translate({ { "test.dx", code, OptimizerPasses::All, stmts.get() } });
+        return { text, translator.Translated(), translator.Interpreted() };
+    }
+
+    bool Contains(std::vector<std::string> const& names, const char* name) {
+        return std::find(names.begin(), names.end(), name) != names.end();
+    }
+}
+
+TEST_CASE("C++ translation types locals and calls functions directly", "[compile]") {
+    auto result = Translate(R"(
+        fn fib(n) {
+            if n < 2 { return n; }
+            return fib(n - 1) + fib(n - 2);
+        }
+        fn work(n) {
+            var t = 0;
+            var x = 0.5;
+            var i = 0;
+            while i < n {
+                t += i * 2 - 1;
+                x = x * 2.0;
+                i += 1;
+            }
+            return t;
+        }
+        fn sum(n, acc) {
+            if n == 0 { return acc; }
+            return sum(n - 1, acc + n);
+        }
+        fn Main(args) { fib(10) + work(5) + sum(10, 0) }
+    )");
+    CHECK(result.Interpreted.empty());
+    CHECK(result.Translated.size() == 4);
+    CHECK(result.Code.find("Int l1_t{};") != std::string::npos);
+    CHECK(result.Code.find("Real l2_x{};") != std::string::npos);
+    CHECK(result.Code.find("f0_fib(intr, ") != std::string::npos);
+    // a call of the function itself in tail position becomes a jump
+    CHECK(result.Code.find("goto tail;") != std::string::npos);
+    CHECK(result.Code.find("int main(") != std::string::npos);
+}
+
+TEST_CASE("C++ translation leaves dynamically scoped functions to the interpreter", "[compile]") {
+    SECTION("A variable another function looks up by name") {
+        auto result = Translate(R"(
+            fn helper() { k * 2 }
+            fn caller() { var k = 21; helper() }
+        )");
+        CHECK(Contains(result.Interpreted, "caller"));
+        CHECK(Contains(result.Translated, "helper"));
+    }
+
+    SECTION("A variable read before its declaration") {
+        auto result = Translate(R"(
+            fn early() { var r = y; var y = 3; r }
+            fn outer() { var y = 100; early() }
+            fn other(a) { a + 1 }
+        )");
+        CHECK(Contains(result.Interpreted, "early"));
+        CHECK(Contains(result.Interpreted, "outer"));
+        CHECK(Contains(result.Translated, "other"));
+    }
+
+    SECTION("Nested declarations") {
+        auto result = Translate(R"(
+            fn nested() { fn inner() { 1 } inner() }
+            fn lambda(n) { var f = |a| => a * 3; f(n) }
+        )");
+        CHECK(Contains(result.Interpreted, "nested"));
+        CHECK(Contains(result.Translated, "lambda"));
+    }
+}
+
+TEST_CASE("Interpreter runs native code bound to a function", "[compile]") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+
+    auto stmts = parser.Parse(R"(
+        fn twice(x) { x * 2 }
+        twice(21)
+    )", true);
+    REQUIRE(stmts != nullptr);
+    auto decl = reinterpret_cast<FunctionDeclaration const*>(stmts->Get()[0].get());
+    REQUIRE(decl->NodeType() == AstNodeType::FunctionDeclaration);
+
+    interpreter.BindNative(decl, [](Interpreter&, std::vector<Value>& args) -> Value {
+        return args[0].ToInteger() * 3;
+    });
+    CHECK(interpreter.BoundNative(decl) != nullptr);
+    CHECK(interpreter.Eval(stmts.get()).ToString() == "63");
+}
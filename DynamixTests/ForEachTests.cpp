@@ -76,4 +76,42 @@ TEST_CASE("Interpreter throws on foreach with non-array", "[foreach]") {
     REQUIRE(foreachStmt != nullptr);
 
     REQUIRE_THROWS_AS(foreachStmt->Accept(&interpreter), RuntimeError);
-}
\ No newline at end of file
+}
+
+TEST_CASE("Break and continue apply to repeat and foreach bodies", "[foreach]") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+
+    const char* code = R"(
+        var sum = 0;
+        foreach item in [1, 2, 3, 4, 5, 6] {
+            if item == 2 { continue; }
+            if item == 5 { break; }
+            sum += item;
+        }
+        var n = 0;
+        repeat 10 {
+            n += 1;
+            if n % 2 == 0 { continue; }
+            if n > 6 { break; }
+            sum += n * 100;
+        }
+        sum
+    )";
+    auto stmts = parser.Parse(code, true);
+    REQUIRE(stmts != nullptr);
+    CHECK(!parser.HasErrors());
+
+    for (auto engine : { ExecutionEngine::TreeWalker, ExecutionEngine::Bytecode }) {
+        Runtime rt;
+        Interpreter interpreter(rt);
+        interpreter.SetEngine(engine);
+        CHECK(interpreter.Eval(stmts.get()).ToInteger() == 908);
+    }
+
+    SECTION("Outside a loop they are still errors") {
+        CHECK(parser.Parse("var x = 1; break;", true) == nullptr);
+        REQUIRE(parser.HasErrors());
+        CHECK(parser.Errors()[0].Type() == ParseErrorType::BreakContinueNoLoop);
+    }
+}
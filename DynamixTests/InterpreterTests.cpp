@@ -105,3 +105,235 @@ TEST_CASE("Interpreter evaluates a recursive function (factorial)") {
     REQUIRE(val.ToInteger() == 120);
 }
 
+
+TEST_CASE("Interpreter completes return, break and continue without unwinding") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+
+    auto run = [&](const char* code) {
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        auto result = interpreter.Eval(stmts.get()).ToString();
+        rt.AddCode(std::move(stmts));
+        return result;
+    };
+
+    SECTION("Return from nested loops") {
+        CHECK(run(R"(
+            fn find(n) {
+                var j = 0;
+                for var i = 0; i < 10; i += 1 {
+                    j = 0;
+                    while true {
+                        if i * j == n { return i * 100 + j; }
+                        j += 1;
+                        if j > i { break; }
+                    }
+                }
+                return -1;
+            }
+            find(12) * 10 + find(99)
+        )") == "4029");
+    }
+
+    SECTION("Continue, breakout and match actions") {
+        CHECK(run(R"(
+            var hits = 0;
+            fn odds(n) {
+                var sum = 0;
+                repeat n {
+                    n -= 1;
+                    if n % 2 == 0 { continue; }
+                    sum += n;
+                }
+                return sum;
+            }
+            fn first() {
+                foreach i in [1, 2, 3] {
+                    hits += 1;
+                    match i {
+                        case 2: breakout;
+                    }
+                }
+                hits = 100;
+            }
+            fn sign(x) { match x { case 0: return 0; default: return 1; } }
+            first();
+            odds(10) + sign(0) + sign(7) * 1000 + hits
+        )") == "1027");
+    }
+
+    SECTION("Top level return ends the code it appears in") {
+        CHECK(run("var t = 1; if t { return 7; } t = 2; t") == "7");
+        CHECK(run("var u = 3; u") == "3");
+    }
+}
+
+TEST_CASE("Operator nodes quicken on stable operand types and deoptimize on a miss") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+    interpreter.SetEngine(ExecutionEngine::TreeWalker);
+
+    auto stmts = parser.Parse(R"(
+        fn add(a, b) { var s = a + b; return s; }
+        var items = [10, 20, 30];
+        fn at(i) { var v = items[i]; return v; }
+        fn total(n) { var t = 0; for var i = 0; i < n; i += 1 { t += i; } return t; }
+    )", true);
+    REQUIRE(stmts != nullptr);
+    interpreter.Eval(stmts.get());
+
+    auto first = [&](int index) {
+        auto f = dynamic_cast<FunctionDeclaration const*>(stmts->Get()[index].get());
+        REQUIRE(f != nullptr);
+        auto decl = dynamic_cast<VarValStatement const*>(dynamic_cast<Statements const*>(f->Body())->Get()[0].get());
+        REQUIRE(decl != nullptr);
+        return decl->Init();
+    };
+    auto add = dynamic_cast<BinaryExpression const*>(first(0));
+    auto at = dynamic_cast<AccessArrayExpression const*>(first(2));
+    REQUIRE(add != nullptr);
+    REQUIRE(at != nullptr);
+    CHECK(add->Quick() == QuickOp::Unobserved);
+
+    auto call = [&](const char* code) {
+        auto expr = parser.Parse(code, true);
+        REQUIRE(expr != nullptr);
+        return interpreter.Eval(expr.get());
+    };
+    CHECK(call("add(2, 3)").AsInteger() == 5);
+    CHECK(add->Quick() == QuickOp::AddInt);
+    CHECK(call("add(2.5, 0.5)").AsReal() == 3.0);
+    CHECK(add->Quick() == QuickOp::Generic);
+    CHECK(call("add(2, 3)").AsInteger() == 5);
+
+    CHECK(call("at(1)").AsInteger() == 20);
+    CHECK(at->Quick() == QuickOp::IndexArrayInt);
+    CHECK_THROWS_AS(call("at(3)"), RuntimeError);
+    CHECK(at->Quick() == QuickOp::IndexArrayInt);
+
+    CHECK(call("total(10)").AsInteger() == 45);
+}
+
+TEST_CASE("Calls in tail position run in constant stack") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+    interpreter.SetEngine(ExecutionEngine::TreeWalker);
+
+    auto run = [&](const char* code) {
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        auto result = interpreter.Eval(stmts.get()).ToString();
+        rt.AddCode(std::move(stmts));
+        return result;
+    };
+
+    run(R"(
+        fn count(n, total) { if n == 0 { return total; } return count(n - 1, total + 1); }
+        fn even(n) { if n == 0 { true } else { odd(n - 1) } }
+        fn odd(n) { match n { case 0: return false; default: return even(n - 1); } }
+        fn depth(n) { if n == 0 { return 0; } return 1 + depth(n - 1); }
+        fn twice(f, x) { f(f(x)) }
+    )");
+
+    CHECK(run("count(10000, 0)") == "10000");
+    CHECK(run("even(5001)") == "false");
+    CHECK(run("twice(|x| => x * 3, 2)") == "18");
+    CHECK(run("depth(50)") == "50");
+    // only tail calls are flattened
+    interpreter.SetMaxCallDepth(1000);
+    CHECK_THROWS_AS(run("depth(1000)"), RuntimeError);
+    CHECK(run("count(3, 0) + count(4, 1)") == "8");
+
+    // a call statement ending in a semicolon is not in tail position
+    run("fn last() { count(3, 0); }");
+    auto call = parser.Parse("last()", true);
+    REQUIRE(call != nullptr);
+    CHECK(interpreter.Eval(call.get()).IsEmpty());
+}
+
+TEST_CASE("Tail calls keep scopes a callee can see") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+    interpreter.SetEngine(ExecutionEngine::TreeWalker);
+
+    auto run = [&](const char* code) {
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        auto result = interpreter.Eval(stmts.get()).ToString();
+        rt.AddCode(std::move(stmts));
+        return result;
+    };
+
+    run(R"(
+        fn g() { y }
+        fn f() { var y = 1; g() }
+        fn h(k) { var z = 5; return k(1); }
+        fn count(n, total) { if n == 0 { return total; } return count(n - 1, total + 1); }
+        fn enter(k) { return k(); }
+        fn outer() { var w = 2; return middle(); }
+        fn middle() { return inner(); }
+        fn inner() { w * 10 }
+        fn caller() { var v = 3; return declares(); }
+        fn declares() { fn nested() { return v; } return nested(); }
+    )");
+
+    CHECK(run("f()") == "1");
+    CHECK(run("h(|a| => z + a)") == "6");
+    // entered by a tail call, so nothing keeps the scope but the names read from it:
+    // a local read two calls down, and one read by a function not declared until the callee runs
+    for (int i = 0; i < 2; i++) {
+        CHECK(run("enter(outer)") == "20");
+        CHECK(run("enter(caller)") == "3");
+    }
+    // callers whose names nothing looks up still run in constant stack
+    interpreter.SetMaxCallDepth(1000);
+    CHECK(run("count(10000, 0)") == "10000");
+}
+
+TEST_CASE("Call depth is limited by calls rather than scopes") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+    interpreter.SetEngine(ExecutionEngine::TreeWalker);
+
+    auto run = [&](const char* code) {
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        auto result = interpreter.Eval(stmts.get()).ToString();
+        rt.AddCode(std::move(stmts));
+        return result;
+    };
+
+    run(R"(
+        fn sum(n) {
+            if n > 0 { for var i = 0; i < 1; i += 1 { while true { return n + sum(n - 1); } } }
+            return 0;
+        }
+    )");
+
+    // blocks and loops no longer count toward the limit
+    CHECK(run("sum(200)") == "20100");
+
+    interpreter.SetMaxCallDepth(50);
+    CHECK_THROWS_AS(run("sum(50)"), RuntimeError);
+    CHECK(interpreter.CallDepth() == 0);
+    CHECK(run("sum(49)") == "1225");
+
+    // a dedicated stack takes recursion past what the thread's stack holds; the native guard fails cleanly otherwise
+    interpreter.SetMaxCallDepth(1 << 30);
+    interpreter.SetStackSize(size_t(256) << 20);
+    CHECK(run("sum(12000)") == "72006000");
+    interpreter.SetStackSize(0);
+    CHECK_THROWS_AS(run("sum(10000000)"), RuntimeError);
+    CHECK(interpreter.CallDepth() == 0);
+}
@@ -0,0 +1,193 @@
+#include <catch.hpp>
+#include <Parser.h>
+#include <Tokenizer.h>
+#include <AstNode.h>
+#include <Interpreter.h>
+#include <Jit.h>
+#include <Value.h>
+#include <Runtime.h>
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+using namespace Dynamix;
+
+namespace {
+    struct JitRun {
+        std::string Result;
+        int Compiled;
+    };
+
+    JitRun RunJit(const char* code) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        Runtime rt;
+        rt.SetDefaultEngine(ExecutionEngine::Jit);
+        Interpreter interpreter(rt);
+
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        auto result = interpreter.Eval(stmts.get()).ToString();
+        return { result, interpreter.GetJit()->CompiledCount() };
+    }
+
+    std::string RunWalker(const char* code) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        Runtime rt;
+        Interpreter interpreter(rt);
+
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        return interpreter.Eval(stmts.get()).ToString();
+    }
+
+    // runs the code compiled and checks it against the tree-walker
+    JitRun RunBoth(const char* code) {
+        auto run = RunJit(code);
+        CHECK(run.Result == RunWalker(code));
+        return run;
+    }
+}
+
+TEST_CASE("JIT compiles hot functions and matches the tree-walker", "[jit]") {
+    if (!Jit::IsSupported())
+        return;
+
+    SECTION("Integer and real loops") {
+        auto run = RunBoth(R"(
+            fn work(n) {
+                var t = 0;
+                var i = 0;
+                while i < n {
+                    t += i * 2 - 1;
+                    i += 1;
+                }
+                return t;
+            }
+            var s = 0;
+            repeat 5 { s += work(2000); }
+            s
+        )");
+        CHECK(run.Result == "19980000");
+        CHECK(run.Compiled == 1);
+
+        run = RunBoth(R"(
+            fn mean(n) {
+                var t = 0.0;
+                var i = 0;
+                while i < n {
+                    t = t + 0.5;
+                    if t / 2.0 >= 1000.0 { t = 0.0; }
+                    i += 1;
+                }
+                return t;
+            }
+            mean(5000) + mean(5000)
+        )");
+        CHECK(run.Result == "1000");
+        CHECK(run.Compiled == 1);
+    }
+
+    SECTION("Loops with break and continue, foreach and recursion") {
+        auto run = RunBoth(R"(
+            fn odd(n) {
+                var sum = 0;
+                var i = 0;
+                while i < n {
+                    i += 1;
+                    if i % 2 == 0 { continue; }
+                    if i > 50 { break; }
+                    sum += i;
+                }
+                foreach item in [1, 2, 3] { sum += item; }
+                return sum;
+            }
+            var total = 0;
+            repeat 1200 { total += odd(100); }
+            total
+        )");
+        CHECK(run.Result == "757200");
+        CHECK(run.Compiled > 0);
+
+        run = RunBoth(R"(
+            fn fib(n) {
+                if n < 2 { return n; }
+                return fib(n - 1) + fib(n - 2);
+            }
+            fib(18)
+        )");
+        CHECK(run.Result == "2584");
+        CHECK(run.Compiled == 1);
+    }
+
+    SECTION("Guards fall back when the types change") {
+        auto run = RunBoth(R"(
+            fn twice(x) {
+                var y = x;
+                y += x;
+                return y;
+            }
+            var i = 0;
+            while i < 1500 { twice(i); i += 1; }
+            twice(2.5) * 100 + twice(21)
+        )");
+        CHECK(run.Result == "542");
+        CHECK(run.Compiled == 1);
+
+        run = RunBoth(R"(
+            fn twice(x) {
+                var y = x;
+                y += x;
+                return y;
+            }
+            var i = 0;
+            while i < 1500 { twice(i); i += 1; }
+            twice("ab") + twice("c")
+        )");
+        CHECK(run.Result == "ababcc");
+        CHECK(run.Compiled == 1);
+    }
+
+    SECTION("Errors in compiled code propagate") {
+        CHECK_THROWS_AS(RunJit(R"(
+            fn divide(x) { return 100 / x; }
+            var i = 1;
+            while i < 1500 { divide(i); i += 1; }
+            divide(0)
+        )"), RuntimeError);
+    }
+}
+
+TEST_CASE("JIT records compiled code in a perf map", "[jit]") {
+    if (!Jit::IsSupported())
+        return;
+
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    rt.SetDefaultEngine(ExecutionEngine::Jit);
+    Interpreter interpreter(rt);
+    auto jit = interpreter.GetJit();
+    REQUIRE(jit != nullptr);
+
+    auto path = jit->PerfMapPath();
+    std::remove(path.c_str());
+    jit->EnablePerfMap(true);
+
+    auto stmts = parser.Parse(R"(
+        fn square(x) { return x * x; }
+        var i = 0;
+        while i < 1500 { square(i); i += 1; }
+    )", true);
+    REQUIRE(stmts != nullptr);
+    interpreter.Eval(stmts.get());
+    jit->EnablePerfMap(false);
+
+    std::ifstream map(path);
+    std::stringstream text;
+    text << map.rdbuf();
+    CHECK(text.str().find("dynamix::") != std::string::npos);
+    std::remove(path.c_str());
+}
@@ -4,9 +4,41 @@
 #include <Interpreter.h>
 #include <Value.h>
 #include <ArrayType.h>
+#include <AstNode.h>
+#include <CycleCollector.h>
+#include <SlabAllocator.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <format>
+#include <new>
+#include <thread>
 
 using namespace Dynamix;
 
+namespace {
+    std::atomic<size_t> s_Allocations;
+}
+
+//
+// counts every heap allocation in the test process
+//
+void* operator new(size_t size) {
+    ++s_Allocations;
+    if (auto p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
 TEST_CASE("Memory") {
     Tokenizer tokenizer;
     Parser parser(tokenizer);
@@ -29,6 +61,89 @@ TEST_CASE("Memory") {
         CHECK(interpreter.Eval(code.get()).ToInteger() == 1);
     }
 
+    SECTION("Lots of objects in the nursery") {
+        rt.SetHeapMode(HeapMode::Nursery);
+        auto code = parser.Parse(R"(
+        class Foo {
+            var x = 1;
+        }
+        repeat 10000 {
+            new Foo();
+        }
+        var kept = [];
+        var foo;
+        var i = 0;
+        while i < 10000 {
+            foo = new Foo();
+            if i % 1000 == 0 {
+                kept.Add(foo);
+            }
+            i += 1;
+        }
+        [ typeof(Foo).ObjectCount(), kept.Count() ]
+    )", true);
+
+        REQUIRE(code != nullptr);
+        CHECK(interpreter.Eval(code.get()).ToString() == "[ 11, 10 ]");
+
+        // temporaries are reclaimed in place; only chunks holding survivors stay in the old space
+        auto stats = rt.GetHeap()->GetStats();
+        CHECK(stats.Allocated >= 20000);
+        CHECK(stats.Reclaimed >= 9000);
+        CHECK(stats.OldChunks <= 11);
+
+        rt.SetHeapMode(HeapMode::Default);
+        CHECK(rt.GetHeap() == nullptr);
+    }
+
+    SECTION("Objects are aligned in either heap mode") {
+        auto decl = parser.Parse("class Foo { var x = 1; }", true);
+        auto make = parser.Parse("new Foo()", true);
+        REQUIRE(make != nullptr);
+        interpreter.Eval(decl.get());
+        auto aligned = [&] {
+            // kept alive together, so each comes from a new place
+            std::vector<Value> objects;
+            for (int i = 0; i < 5; i++)
+                objects.push_back(interpreter.Eval(make.get()));
+            return std::ranges::all_of(objects, [](auto& v) {
+                return reinterpret_cast<uintptr_t>(v.AsObject()) % __STDCPP_DEFAULT_NEW_ALIGNMENT__ == 0;
+            });
+        };
+        CHECK(aligned());
+        rt.SetHeapMode(HeapMode::Nursery);
+        CHECK(aligned());
+        CHECK(rt.GetHeap()->GetStats().Allocated >= 5);
+    }
+
+    SECTION("Nursery objects released on another thread") {
+        rt.SetHeapMode(HeapMode::Nursery);
+        auto code = parser.Parse(R"(
+        class Foo {
+            var x = 1;
+        }
+        fn Fill(n) {
+            var items = [];
+            repeat n { items.Add(new Foo()); }
+            items
+        }
+        Fill(20000)
+    )", true);
+        REQUIRE(code != nullptr);
+        auto items = interpreter.Eval(code.get());
+        REQUIRE(items.IsObject());
+        rt.GetCollector().Collect();
+
+        // their chunks empty on the other thread while this one keeps filling the nursery
+        auto churn = parser.Parse("repeat 20000 { new Foo(); } typeof(Foo).ObjectCount()", true);
+        REQUIRE(churn != nullptr);
+        std::thread other([items = std::move(items)]() mutable { items = Value(); });
+        interpreter.Eval(churn.get());
+        other.join();
+        CHECK(interpreter.Eval(churn.get()).ToInteger() == 0);
+        CHECK(rt.GetHeap()->GetStats().Reclaimed > 0);
+    }
+
     SECTION("Simple Cycle") {
         auto code = parser.Parse(R"(
         class A {
@@ -48,11 +163,342 @@ TEST_CASE("Memory") {
     )", true);
 
         REQUIRE(code != nullptr);
-        auto arr = interpreter.Eval(code.get()).ToObject();
+        auto value = interpreter.Eval(code.get());
+        auto arr = value.ToObject();
         REQUIRE(arr->Type() == ArrayType::Get());
         auto result = reinterpret_cast<ArrayObject const*>(arr);
         REQUIRE(result->Count() == 2);
         CHECK(result->Items()[0].ToInteger() == 1);
         CHECK(result->Items()[1].ToInteger() == 1);
+
+        // the pair outlives the function until the cycle collector runs
+        CHECK(rt.GetCollector().Collect() == 2);
+        auto counts = parser.Parse("typeof(A).ObjectCount() + typeof(B).ObjectCount()", true);
+        REQUIRE(counts != nullptr);
+        CHECK(interpreter.Eval(counts.get()).ToInteger() == 0);
+    }
+}
+
+TEST_CASE("Cycle collector frees unreachable cycles only") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+    auto& gc = rt.GetCollector();
+
+    auto code = parser.Parse(R"(
+        class Node {
+            var next;
+            var items;
+        }
+        fn Ring(n) {
+            var first = new Node();
+            var last = first;
+            var node;
+            var i = 1;
+            while i < n {
+                node = new Node();
+                last.next = node;
+                last = node;
+                i += 1;
+            }
+            last.next = first;
+            first.items = [first, last, [last]];
+            first
+        }
+        var kept = Ring(3);
+        repeat 10 { Ring(5); }
+        typeof(Node).ObjectCount()
+    )", true);
+    REQUIRE(code != nullptr);
+    gc.SetThreshold(0);
+    CHECK(interpreter.Eval(code.get()).ToInteger() == 53);
+
+    SECTION("Collecting on demand") {
+        // ten rings of five nodes and two arrays
+        CHECK(gc.Collect() == 70);
+        CHECK(gc.RootCount() == 0);
+
+        auto check = parser.Parse(R"(
+            [ typeof(Node).ObjectCount(), kept.next.next.next == kept, kept.items[2][0] == kept.next.next ]
+        )", true);
+        REQUIRE(check != nullptr);
+        CHECK(interpreter.Eval(check.get()).ToString() == "[ 3, true, true ]");
+        CHECK(gc.GetStats().Collections == 1);
+        CHECK(gc.GetStats().LastFreed == 70);
+    }
+
+    SECTION("Collecting on the allocation threshold") {
+        gc.SetThreshold(100);
+        auto more = parser.Parse("repeat 100 { Ring(4); } typeof(Node).ObjectCount()", true);
+        REQUIRE(more != nullptr);
+        CHECK(interpreter.Eval(more.get()).ToInteger() < 100);
+        CHECK(gc.GetStats().Collections >= 4);
+        CHECK(gc.GetStats().Freed >= 400);
+        CHECK(gc.GetStats().MaxPause >= gc.GetStats().LastPause);
+    }
+}
+
+TEST_CASE("Objects leave the collector that buffered them") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    auto outer = CycleCollector::Current();
+    std::unique_ptr<Statements> code;
+    auto first = std::make_unique<Runtime>();
+    Value kept;
+    {
+        Interpreter interpreter(*first);
+        code = parser.Parse("class Box { var item; } new Box()", true);
+        REQUIRE(code != nullptr);
+        kept = interpreter.Eval(code.get());
+    }
+    REQUIRE(kept.IsObject());
+    kept.AsObject()->AddRef();
+    kept.AsObject()->Release();
+    auto roots = first->GetCollector().RootCount();
+    REQUIRE(roots > 0);
+
+    // freed while another runtime's collector is the thread's
+    auto second = std::make_unique<Runtime>();
+    CHECK(CycleCollector::Current() == &second->GetCollector());
+    kept = Value();
+    CHECK(first->GetCollector().RootCount() == roots - 1);
+    CHECK(second->GetCollector().RootCount() == 0);
+
+    // and runtimes go in the order they came
+    first.reset();
+    CHECK(CycleCollector::Current() == &second->GetCollector());
+    second.reset();
+    CHECK(CycleCollector::Current() == outer);
+}
+
+TEST_CASE("Confined runtimes count references without atomics") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    rt.SetThreadingMode(ThreadingMode::Confined);
+    Interpreter interpreter(rt);
+
+    auto code = parser.Parse(R"(
+        class Box {
+            var item;
+            var items;
+        }
+        var box = new Box();
+        box.item = new Box();
+        box.items = [new Box(), 3];
+        box
+    )", true);
+    REQUIRE(code != nullptr);
+    auto box = interpreter.Eval(code.get());
+    REQUIRE(box.IsObject());
+    auto boxed = parser.Parse("box.item", true);
+    REQUIRE(boxed != nullptr);
+    auto item = interpreter.Eval(boxed.get());
+    CHECK(!box.AsObject()->IsShared());
+    CHECK(!item.AsObject()->IsShared());
+
+    // sharing reaches everything the object references, and what is stored in it later
+    box.AsObject()->Share();
+    CHECK(item.AsObject()->IsShared());
+    auto later = parser.Parse("box.items.Add(new Box()); box.item = new Box(); [ box.item, box.items[0], box.items[2] ]", true);
+    REQUIRE(later != nullptr);
+    auto items = interpreter.Eval(later.get());
+    for (auto& shared : static_cast<ArrayObject const*>(items.AsObject())->Items())
+        CHECK(shared.AsObject()->IsShared());
+    CHECK(!items.AsObject()->IsShared());
+
+    auto count = parser.Parse("typeof(Box).ObjectCount()", true);
+    REQUIRE(count != nullptr);
+    auto before = interpreter.Eval(count.get()).ToInteger();
+    {
+        std::vector<Value> copies(1000, box);
+        std::thread other([&] {
+            for (int i = 0; i < 100; i++)
+                std::vector<Value>(copies.size(), item);
+        });
+        for (int i = 0; i < 100; i++)
+            std::vector<Value>(copies.size(), item);
+        other.join();
     }
+    CHECK(interpreter.Eval(count.get()).ToInteger() == before);
+
+    rt.SetThreadingMode(ThreadingMode::Shared);
+    auto fresh = parser.Parse("new Box()", true);
+    REQUIRE(fresh != nullptr);
+    CHECK(interpreter.Eval(fresh.get()).AsObject()->IsShared());
+}
+
+TEST_CASE("Slab allocator recycles blocks by size class") {
+    auto live = [](size_t size) {
+        for (auto& c : SlabAllocator::GetStats().Classes)
+            if (c.Size >= size)
+                return c.LiveBlocks;
+        return size_t(0);
+    };
+    auto before = live(100);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 1000; i++)
+        blocks.push_back(SlabAllocator::Allocate(100));
+    CHECK(live(100) == before + 1000);
+    auto slabs = SlabAllocator::GetStats().Slabs;
+
+    // freed on another thread, then reused here without new slabs
+    std::thread([&] {
+        for (auto p : blocks)
+            SlabAllocator::Free(p, 100);
+    }).join();
+    CHECK(live(100) == before);
+    blocks.clear();
+    for (int i = 0; i < 1000; i++)
+        blocks.push_back(SlabAllocator::Allocate(97));
+    CHECK(SlabAllocator::GetStats().Slabs == slabs);
+    for (auto p : blocks)
+        SlabAllocator::Free(p, 97);
+    CHECK(live(100) == before);
+
+    // too large for a class
+    auto large = SlabAllocator::Allocate(SlabAllocator::MaxSize + 1);
+    SlabAllocator::Free(large, SlabAllocator::MaxSize + 1);
+    CHECK(SlabAllocator::GetStats().Slabs == slabs);
+}
+
+//
+// object-heavy workload, run with atomic and with plain reference counts.
+// hidden; run with: DynamixTests "[benchmark]"
+//
+TEST_CASE("Slab allocator returns emptied slabs") {
+    auto slabs = SlabAllocator::GetStats().Slabs;
+    std::vector<void*> blocks;
+    for (int i = 0; i < 20000; i++)
+        blocks.push_back(SlabAllocator::Allocate(200));
+    CHECK(SlabAllocator::GetStats().Slabs >= slabs + 50);
+
+    // all but the spares, and slabs with blocks left in this thread's list
+    for (auto p : blocks)
+        SlabAllocator::Free(p, 200);
+    CHECK(SlabAllocator::GetStats().Slabs <= slabs + SlabAllocator::SpareSlabs + 2);
+
+    blocks.clear();
+    for (int i = 0; i < 1000; i++)
+        blocks.push_back(SlabAllocator::Allocate(200));
+    for (auto p : blocks)
+        SlabAllocator::Free(p, 200);
+    CHECK(SlabAllocator::GetStats().Slabs <= slabs + SlabAllocator::SpareSlabs + 2);
+}
+
+TEST_CASE("Object workload", "[.][benchmark]") {
+    for (auto mode : { ThreadingMode::Shared, ThreadingMode::Confined }) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        Runtime rt;
+        rt.SetThreadingMode(mode);
+        Interpreter interpreter(rt);
+
+        auto code = parser.Parse(R"(
+            class Point {
+                var x;
+                var y;
+            }
+            fn Next(p) {
+                var q = new Point();
+                q.x = p.y;
+                q.y = p.x + 1;
+                return q;
+            }
+            var items = [];
+            var p = new Point();
+            p.x = 0;
+            p.y = 0;
+            var i = 0;
+            while i < 300000 {
+                p = Next(p);
+                if i % 10 == 0 {
+                    items.Add(p);
+                }
+                i += 1;
+            }
+            var sum = 0;
+            foreach item in items {
+                sum += item.x + item.y;
+            }
+            sum
+        )", true);
+        REQUIRE(code != nullptr);
+
+        auto start = std::chrono::steady_clock::now();
+        auto result = interpreter.Eval(code.get());
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+        CHECK(result.IsInteger());
+        WARN(std::format("{} counts: {} ms", mode == ThreadingMode::Confined ? "plain" : "atomic", elapsed.count()));
+    }
+}
+
+TEST_CASE("Calling a small function does not allocate") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+    // the bytecode engine compiles each top level evaluation
+    interpreter.SetEngine(ExecutionEngine::TreeWalker);
+
+    auto code = parser.Parse(R"(
+        fn add(a, b) {
+            var sum = a + b;
+            while sum > 100 { sum -= 100; }
+            return sum;
+        }
+        add(40, 2)
+    )", true);
+    REQUIRE(code != nullptr);
+    REQUIRE(code->Count() == 2);
+    CHECK(interpreter.Eval(code.get()).ToInteger() == 42);
+
+    // the pooled argument vector and lookup buffer are warm now
+    auto call = code->GetAt(1);
+    auto before = s_Allocations.load();
+    for (int i = 0; i < 100; i++)
+        interpreter.Eval(call);
+    CHECK(s_Allocations.load() - before == 0);
+}
+
+
+TEST_CASE("Binding a method does not allocate") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    Interpreter interpreter(rt);
+    interpreter.SetEngine(ExecutionEngine::TreeWalker);
+
+    auto code = parser.Parse(R"(
+        class Counter {
+            var n = 0;
+            fn Next() {
+                this.n += 1;
+                return this.n;
+            }
+        }
+        var c = new Counter();
+        fn bind() {
+            var f = c.Next;
+            var g = f;
+            return g;
+        }
+        bind()
+    )", true);
+    REQUIRE(code != nullptr);
+    auto f = interpreter.Eval(code.get());
+    REQUIRE(f.IsCallable());
+    std::vector<Value> args;
+    CHECK(interpreter.CallFunction(f, args, nullptr).ToInteger() == 1);
+    CHECK(interpreter.CallFunction(f, args, nullptr).ToInteger() == 2);
+    f = Value();
+
+    // the released bound methods are pooled now
+    auto bind = code->GetAt(code->Count() - 1);
+    auto before = s_Allocations.load();
+    for (int i = 0; i < 100; i++)
+        interpreter.Eval(bind);
+    CHECK(s_Allocations.load() - before == 0);
 }
@@ -0,0 +1,101 @@
+#include <catch.hpp>
+#include <Parser.h>
+#include <Tokenizer.h>
+#include <AstNode.h>
+#include <Optimizer.h>
+#include <Interpreter.h>
+#include <Value.h>
+#include <Runtime.h>
+
+using namespace Dynamix;
+
+namespace {
+    std::string Run(const char* code, OptimizerPasses passes) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        parser.SetOptimizations(passes);
+        Runtime rt;
+        Interpreter interpreter(rt);
+
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        return interpreter.Eval(stmts.get()).ToString();
+    }
+
+    std::unique_ptr<Statements> Optimize(Optimizer& optimizer, const char* code) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        optimizer.Optimize(stmts.get());
+        return stmts;
+    }
+
+    Value const* LiteralInit(Statement const* stmt) {
+        auto decl = dynamic_cast<VarValStatement const*>(stmt);
+        REQUIRE(decl != nullptr);
+        auto literal = dynamic_cast<LiteralExpression const*>(decl->Init());
+        return literal ? &literal->Literal() : nullptr;
+    }
+}
+
+TEST_CASE("Optimizer passes rewrite constant code", "[optimizer]") {
+    Optimizer optimizer;
+
+    SECTION("Constant folding") {
+        auto stmts = Optimize(optimizer, "var a = 2 * 3 + 4; var b = -(1 + 1.5); var c = \"ab\" + \"cd\"; var d = false and f(); var e = 1 / 0; var g = a + 1;");
+        auto& s = stmts->Get();
+        CHECK(LiteralInit(s[0].get())->AsInteger() == 10);
+        CHECK(LiteralInit(s[1].get())->AsReal() == -2.5);
+        CHECK(LiteralInit(s[2].get())->ToString() == "abcd");
+        CHECK(LiteralInit(s[3].get())->ToBoolean() == false);
+        // failing and non constant operations are left for run time
+        CHECK(LiteralInit(s[4].get()) == nullptr);
+        CHECK(LiteralInit(s[5].get()) == nullptr);
+    }
+
+    SECTION("Val and enum propagation") {
+        auto stmts = Optimize(optimizer, "val size = 4; enum Color { Red, Green = 5 } var a = size * 2; var b = Color.Green + Color::Red; var v = 1; var c = v;");
+        auto& s = stmts->Get();
+        CHECK(LiteralInit(s[2].get())->AsInteger() == 8);
+        CHECK(LiteralInit(s[3].get())->AsInteger() == 5);
+        // only vals are propagated
+        CHECK(LiteralInit(s[5].get()) == nullptr);
+        CHECK(optimizer.GetPass(OptimizerPasses::ConstantPropagation)->Rewrites() == 3);
+    }
+
+    SECTION("Dead branches and unreachable code") {
+        auto stmts = Optimize(optimizer, "val debug = false; fn f(x) { if debug { x = 1; } else { x = 2; } return x; x = 3; }");
+        auto f = dynamic_cast<FunctionDeclaration const*>(stmts->Get()[1].get());
+        REQUIRE(f != nullptr);
+        auto& body = dynamic_cast<Statements const*>(f->Body())->Get();
+        REQUIRE(body.size() == 2);
+        // the else branch is all that is left of the if
+        CHECK(body[0]->NodeType() == AstNodeType::Assign);
+        CHECK(dynamic_cast<ReturnStatement const*>(body[1].get()) != nullptr);
+    }
+
+    SECTION("Disabled passes leave the tree alone") {
+        optimizer.Enable(OptimizerPasses::All, false);
+        optimizer.Enable(OptimizerPasses::UnreachableCode);
+        CHECK(optimizer.IsEnabled(OptimizerPasses::UnreachableCode));
+        CHECK_FALSE(optimizer.IsEnabled(OptimizerPasses::ConstantFolding));
+        auto stmts = Optimize(optimizer, "val n = 2; var a = n + 1; if true { a } return a; a");
+        auto& s = stmts->Get();
+        REQUIRE(s.size() == 4);
+        CHECK(LiteralInit(s[1].get()) == nullptr);
+        CHECK(s[2]->NodeType() == AstNodeType::IfThenElse);
+    }
+}
+
+TEST_CASE("Optimized code evaluates like the original", "[optimizer]") {
+    auto code = GENERATE(
+        "val n = 10; fn sum(k) { var total = 0; for var i = 1; i <= k; i += 1 { total += i * n; } return total; } sum(4)",
+        "val limit = 3; var count = 0; while true { count += 1; if count >= limit { break; count = 100; } } count",
+        "enum Level { Low, High = 10 } fn level(x) { if x > Level.High { return \"high\"; } return \"low\"; } level(11) + level(1)",
+        "fn f(n) { val n2 = n * 2; return n2 + 1; } val n2 = 1; f(3) + n2",
+        "val s = \"a\" + \"b\"; var r = if s == \"ab\" { 1 } else { 2 }; r * (2 + 3)",
+        "var x = 5; if 1 > 2 { x = 0; } x"
+    );
+    CHECK(Run(code, OptimizerPasses::All) == Run(code, OptimizerPasses::None));
+}
@@ -3,6 +3,16 @@
 #include <Value.h>
 #include <RuntimeObject.h>
 #include <Tokenizer.h>
+#include <AstTables.h>
+#include <Bytecode.h>
+#include <ModuleCache.h>
+#include <Interpreter.h>
+#include <Runtime.h>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <format>
+#include <string>
 
 using namespace Dynamix;
 
@@ -15,3 +25,286 @@ TEST_CASE("Parse members", "[parser]") {
 	REQUIRE(node);
 }
 
+TEST_CASE("Parsed trees are laid out in their arena", "[parser]") {
+	Tokenizer t;
+	Parser parser(t);
+	auto tree = parser.Parse("fn add(a, b) { a + b } var s = \"a string too long to be short\"; add(1, 2)", true);
+	REQUIRE(tree);
+	auto arena = tree->Arena();
+	REQUIRE(arena != nullptr);
+	CHECK(AstArena::Current() == nullptr);
+	CHECK(AstArena::Of(tree.get()) == nullptr);
+	for (auto& stmt : tree->Get())
+		CHECK(AstArena::Of(stmt.get()) == arena);
+
+	auto& stats = arena->GetStats();
+	CHECK(stats.Nodes > 8);
+	CHECK(stats.Chunks == 1);
+	// the function and the long string hold something outside the arena; the other nodes just go with it
+	CHECK(stats.Released == 2);
+}
+
+TEST_CASE("Tearing a tree down releases what its nodes hold", "[parser]") {
+	Tokenizer t;
+	Parser parser(t);
+	auto tree = parser.Parse("var s = \"a string too long to be short\"; s; s", true);
+	REQUIRE(tree);
+	auto var = dynamic_cast<VarValStatement const*>(tree->GetAt(0));
+	REQUIRE(var != nullptr);
+	auto text = dynamic_cast<LiteralExpression const*>(var->Init())->Literal();
+
+	auto kept = std::make_shared<CodeChunk>(), removed = std::make_shared<CodeChunk>();
+	std::weak_ptr<CodeChunk> keptCode = kept, removedCode = removed;
+	tree->GetAt(1)->SetCompiledCode(std::move(kept));
+	tree->GetAt(2)->SetCompiledCode(std::move(removed));
+	// a node deleted before its tree is destroyed there, and not released again with the arena
+	tree->RemoveAt(2);
+	CHECK(removedCode.expired());
+	CHECK(!keptCode.expired());
+
+	tree.reset();
+	CHECK(keptCode.expired());
+	CHECK(text.ToString() == "a string too long to be short");
+}
+
+TEST_CASE("Appended trees keep their arena and tables", "[parser]") {
+	Tokenizer t;
+	Parser parser(t);
+	auto tree = parser.Parse("var x = 7;", true);
+	REQUIRE(tree);
+	REQUIRE(tree->Tables() != nullptr);
+	CHECK(AstTables::Current() == nullptr);
+
+	auto more = parser.Parse("fn twice(a) { var b = a * 2; return b; } twice(x)", true);
+	REQUIRE(more);
+	auto moved = tree->Append(std::move(more));
+	CHECK(tree->Count() == 3);
+	CHECK(moved == tree->GetAt(1));
+	auto decl = dynamic_cast<FunctionDeclaration const*>(moved);
+	REQUIRE(decl != nullptr);
+	CHECK(AstArena::Of(decl) != tree->Arena());
+	CHECK(tree->Tables()->Symbols(decl->Body()) != nullptr);
+
+	Runtime rt;
+	Interpreter interpreter(rt);
+	CHECK(interpreter.Eval(tree.get()).ToInteger() == 14);
+}
+
+TEST_CASE("Only scopes have symbol tables", "[parser]") {
+	Tokenizer t;
+	Parser parser(t);
+	auto tree = parser.Parse("fn f(a) { var b = a * 2; return b; }");
+	REQUIRE(tree);
+	auto tables = tree->Tables();
+	auto decl = dynamic_cast<FunctionDeclaration const*>(tree->GetAt(0));
+	REQUIRE(decl != nullptr);
+	auto body = dynamic_cast<Statements const*>(decl->Body());
+	REQUIRE(body != nullptr);
+
+	auto symbols = tables->Symbols(body);
+	REQUIRE(symbols != nullptr);
+	auto a = symbols->FindSymbol(Atom("a"), true);
+	REQUIRE(a != nullptr);
+	CHECK(a->Type == SymbolType::Argument);
+	CHECK(symbols->Parent() != nullptr);
+	CHECK(tables->Symbols(decl) == nullptr);
+	CHECK(tables->Symbols(body->GetAt(0)) == nullptr);
+
+	CHECK(tables->Attributes(decl).empty());
+	tables->Attributes(decl).push_back(Attribute{ "Inline" });
+	CHECK(tables->Attributes(decl).size() == 1);
+	CHECK(tables->Attributes(body).empty());
+}
+
+TEST_CASE("Locations are plain values", "[parser]") {
+	STATIC_REQUIRE(std::is_trivially_copyable_v<CodeLocation>);
+	STATIC_REQUIRE(std::is_trivially_copyable_v<Token>);
+
+	Tokenizer t;
+	Parser parser(t);
+	auto tree = parser.Parse("var x = 1;\nx = );", true);
+	CHECK(tree == nullptr);
+	REQUIRE(parser.HasErrors());
+	auto loc = parser.Errors()[0].Location();
+	CHECK(loc.Line == 2);
+	CHECK(loc.File.IsEmpty());
+	CHECK(loc.FileName().empty());
+
+	CodeLocation named{ 3, 7, Atom("script.dx") };
+	RuntimeError err(RuntimeErrorType::Unexpected, "oops", named);
+	CHECK(err.Location().File == Atom("script.dx"));
+	CHECK(err.Location().FileName() == "script.dx");
+	CHECK(err.Location().Col == 7);
+}
+
+TEST_CASE("Parsed modules load from the cache", "[parser]") {
+	auto dir = std::filesystem::temp_directory_path() / "dynamix-module-tests";
+	std::filesystem::create_directories(dir);
+	auto source = (dir / "module.dx").string();
+	std::string text = R"(
+		var hits = 0;
+		fn odds(n) {
+			var sum = 0;
+			repeat n {
+				n -= 1;
+				if n % 2 == 0 { continue; }
+				sum += n;
+			}
+			return sum;
+		}
+		fn first() {
+			foreach i in [1, 2, 3] {
+				hits += 1;
+				match i {
+					case 2: breakout;
+				}
+			}
+		}
+		fn sign(x) { match x { case 0: return 0; default: return 1; } }
+		class Point {
+			var x = 3;
+			fn twice() { return this.x * 2; }
+		}
+		var p = new Point();
+		var label = "sum";
+		first();
+		odds(10) + sign(0) + sign(7) * 1000 + hits + p.twice() * 100000
+	)";
+	std::ofstream(source, std::ios::binary) << text;
+
+	Tokenizer t;
+	Parser parser(t);
+	parser.SetOptimizations(OptimizerPasses::All);
+	auto tree = parser.Parse(text, true);
+	REQUIRE(tree);
+
+	ModuleCache cache(dir.string());
+	auto run = [](Statements const* code) {
+		Runtime rt;
+		Interpreter interpreter(rt);
+		return interpreter.Eval(code).ToString();
+	};
+	CHECK(cache.Load(source, OptimizerPasses::All) == nullptr);
+	REQUIRE(cache.Store(source, text, tree.get(), OptimizerPasses::All));
+	CHECK(std::filesystem::exists(cache.ModulePath(source)));
+
+	auto loaded = cache.Load(source, OptimizerPasses::All);
+	REQUIRE(loaded);
+	CHECK(loaded->Count() == tree->Count());
+	CHECK(loaded->GetAt(1)->Location().Line == tree->GetAt(1)->Location().Line);
+	CHECK(run(loaded.get()) == run(tree.get()));
+	CHECK(run(loaded.get()) == "601027");
+	CHECK(cache.GetStats().Hits == 1);
+
+	SECTION("Other passes or changed source miss") {
+		CHECK(cache.Load(source, OptimizerPasses::None) == nullptr);
+		std::ofstream(source, std::ios::binary) << text << "+ 1";
+		CHECK(cache.Load(source, OptimizerPasses::All) == nullptr);
+		CHECK(cache.GetStats().Misses == 3);
+	}
+	SECTION("Cached modules declare their globals") {
+		auto other = (dir / "other.dx").string();
+		std::ofstream(other, std::ios::binary) << "fn odds(n) { n }";
+		auto duplicate = [&](Parser& p) {
+			return p.ParseFile(other) == nullptr && p.HasErrors() && p.Errors()[0].Type() == ParseErrorType::DuplicateDefinition;
+		};
+
+		Tokenizer t1;
+		Parser parsed(t1);
+		REQUIRE(parsed.Parse(text, true));
+		CHECK(duplicate(parsed));
+
+		Tokenizer t2;
+		Parser loaded(t2);
+		loaded.SetOptimizations(OptimizerPasses::All);
+		loaded.SetModuleCache(&cache);
+		REQUIRE(loaded.ParseFile(source));
+		CHECK(cache.GetStats().Hits == 2);
+		CHECK(duplicate(loaded));
+		CHECK(loaded.Parse("var label = 1;", true) == nullptr);
+		CHECK(loaded.Parse("var other = 1;", true) != nullptr);
+	}
+	SECTION("Damaged modules miss") {
+		auto path = cache.ModulePath(source);
+		auto size = std::filesystem::file_size(path);
+		std::filesystem::resize_file(path, size - 3);
+		CHECK(cache.Load(source, OptimizerPasses::All) == nullptr);
+	}
+	std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("Files tokenize from their mapping", "[parser]") {
+	auto dir = std::filesystem::temp_directory_path() / "dynamix-mapping-tests";
+	std::filesystem::create_directories(dir);
+	auto source = (dir / "mapped.dx").string();
+	std::string text = "fn twice(a) { return a * 2; }\nvar s = \"a\\tb\"; var r = \"plain\";\n// last line";
+
+	// a file that ends on a page boundary has no zero after it in the mapping
+	for (size_t size : { text.size(), size_t(4096), size_t(8192), MappedFile::CopyLimit + 4096 }) {
+		Tokenizer t;
+		Parser parser(t);
+		auto write = [&] { std::ofstream(source, std::ios::binary) << text << std::string(size - text.size(), ' '); };
+		write();
+		REQUIRE(std::filesystem::file_size(source) == size);
+
+		REQUIRE(t.TokenizeFile(source));
+		// small files are copied, so cutting one short while it is read can't fault
+		if (size <= MappedFile::CopyLimit)
+			std::filesystem::resize_file(source, 0);
+		std::vector<std::string> strings;
+		int count = 0;
+		for (auto token = t.Next(); token.Type != TokenType::End; token = t.Next()) {
+			REQUIRE(token.Type != TokenType::Invalid);
+			REQUIRE(token.Type != TokenType::Error);
+			if (token.Type == TokenType::String)
+				strings.push_back(token.Lexeme);
+			count++;
+		}
+		CHECK(count == 22);
+		CHECK(strings == std::vector<std::string>{ "a\tb", "plain" });
+
+		write();
+		auto tree = parser.ParseFile(source);
+		REQUIRE(tree);
+		CHECK(tree->Count() == 3);
+		CHECK(tree->GetAt(1)->Location().FileName() == source);
+		CHECK(tree->GetAt(1)->Location().Line == 2);
+	}
+	std::filesystem::remove_all(dir);
+}
+
+//
+// hidden; run with: DynamixTests "[benchmark]"
+//
+TEST_CASE("Large script", "[.][benchmark]") {
+	std::string code = "var x = 0;\nvar y = 1;\nvar s = \"\";\n";
+	for (int i = 0; code.size() < (4 << 20); i++) {
+		code += std::format("x = (x + {} * 3 - y) % 1000;\n", i);
+		code += std::format("if x > {} {{ y = y + 1; }} else {{ y = y - {} / 7; }}\n", i % 1000, i);
+		code += std::format("s = \"item{}\";\n", i);
+	}
+	code += "x + y\n";
+
+	Tokenizer tokenizer;
+	Parser parser(tokenizer);
+	Runtime rt;
+	Interpreter interpreter(rt);
+	interpreter.SetEngine(ExecutionEngine::TreeWalker);
+
+	using namespace std::chrono;
+	auto start = steady_clock::now();
+	auto ast = parser.Parse(code, true);
+	auto parsed = steady_clock::now();
+	REQUIRE(ast != nullptr);
+	auto result = interpreter.Eval(ast.get());
+	auto walked = steady_clock::now();
+	CHECK(result.IsInteger());
+	auto stats = ast->Arena()->GetStats();
+	ast.reset();
+	auto done = steady_clock::now();
+
+	auto ms = [](auto d) { return duration_cast<microseconds>(d).count() / 1000.0; };
+	WARN(std::format("{} KB: parse {:.1f} ms, walk {:.1f} ms, teardown {:.1f} ms; {} nodes, {} MB in {} chunks, {} released",
+		code.size() >> 10, ms(parsed - start), ms(walked - parsed), ms(done - walked),
+		stats.Nodes, stats.Bytes >> 20, stats.Chunks, stats.Released));
+}
@@ -0,0 +1,87 @@
+#include <catch.hpp>
+#include <Parser.h>
+#include <Tokenizer.h>
+#include <AstNode.h>
+#include <Interpreter.h>
+#include <Value.h>
+#include <Runtime.h>
+
+using namespace Dynamix;
+
+namespace {
+    std::string Run(const char* code) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        Runtime rt;
+        Interpreter interpreter(rt);
+
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        return interpreter.Eval(stmts.get()).ToString();
+    }
+}
+
+TEST_CASE("Resolver binds function locals to slots", "[resolver]") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+
+    auto stmts = parser.Parse("fn f(a, b) { var c = a + b; while c > 0 { var d = c; c -= 1; } return c; }", true);
+    REQUIRE(stmts != nullptr);
+    REQUIRE(stmts->Get().size() == 1);
+    auto f = dynamic_cast<FunctionDeclaration const*>(stmts->Get()[0].get());
+    REQUIRE(f != nullptr);
+    CHECK(f->SlotCount() == 3);
+
+    auto& body = dynamic_cast<Statements const*>(f->Body())->Get();
+    auto c = dynamic_cast<VarValStatement const*>(body[0].get());
+    REQUIRE(c != nullptr);
+    CHECK(c->Slot().Depth == 0);
+    CHECK(c->Slot().Index == 2);
+
+    auto loop = dynamic_cast<WhileStatement const*>(body[1].get());
+    REQUIRE(loop != nullptr);
+    CHECK(loop->SlotCount() == 1);
+
+    SECTION("Top level names stay dynamic") {
+        auto top = parser.Parse("var x = 1; x", true);
+        REQUIRE(top != nullptr);
+        auto x = dynamic_cast<VarValStatement const*>(top->Get()[0].get());
+        REQUIRE(x != nullptr);
+        CHECK_FALSE(x->Slot().IsResolved());
+    }
+}
+
+TEST_CASE("Resolved code keeps name lookup semantics", "[resolver]") {
+    SECTION("Locals, loop scopes and recursion") {
+        CHECK(Run(R"(
+            fn sum(n) {
+                var total = 0;
+                for var i = 1; i <= n; i += 1 {
+                    total += i * i;
+                }
+                return total;
+            }
+            fn fact(n) { if n < 2 { return 1; } return n * fact(n - 1); }
+            sum(4) + fact(5)
+        )") == "150");
+    }
+
+    SECTION("Callees still see caller variables by name") {
+        CHECK(Run(R"(
+            fn inner() { return depth * 2; }
+            fn outer(depth) { return inner(); }
+            outer(21)
+        )") == "42");
+    }
+
+    SECTION("Lambdas and nested functions") {
+        CHECK(Run(R"(
+            fn apply(f, x) { return f(x); }
+            fn wrap(v) {
+                fn helper(y) { return y + v; }
+                return apply(|z| => helper(z) * 10, v);
+            }
+            wrap(3)
+        )") == "60");
+    }
+}
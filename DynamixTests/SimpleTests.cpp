@@ -53,8 +53,8 @@ TEST_CASE("Parser and Tokenizer integration with AST validation") {
         REQUIRE(fnDecl != nullptr);
         REQUIRE(fnDecl->Name() == "foo");
         REQUIRE(fnDecl->Parameters().size() == 2);
-        REQUIRE(fnDecl->Parameters()[0].Name == "a");
-        REQUIRE(fnDecl->Parameters()[1].Name == "b");
+        REQUIRE(fnDecl->Parameters()[0].Name == Atom("a"));
+        REQUIRE(fnDecl->Parameters()[1].Name == Atom("b"));
         auto* body = fnDecl->Body();
         REQUIRE(body != nullptr);
         auto* bodyStmts = dynamic_cast<const Statement*>(body);
@@ -93,9 +93,9 @@ TEST_CASE("Parser and Tokenizer integration with AST validation") {
         REQUIRE(enumDecl->Name() == "Color");
         auto values = enumDecl->Values();
         REQUIRE(values.size() == 3);
-        REQUIRE(values.at("Red") == 0);
-        REQUIRE(values.at("Green") == 2);
-        REQUIRE(values.at("Blue") == 3);
+        REQUIRE(values.at(Atom("Red")) == 0);
+        REQUIRE(values.at(Atom("Green")) == 2);
+        REQUIRE(values.at(Atom("Blue")) == 3);
     }
 
     SECTION("Parse return statement and check AST") {
@@ -0,0 +1,216 @@
+#include <catch.hpp>
+#include <Parser.h>
+#include <Tokenizer.h>
+#include <AstNode.h>
+#include <Interpreter.h>
+#include <TieredCompiler.h>
+#include <Value.h>
+#include <Runtime.h>
+#include <atomic>
+#include <format>
+#include <thread>
+
+using namespace Dynamix;
+
+namespace {
+    std::string RunWalker(const char* code, const char* call) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        Runtime rt;
+        Interpreter interpreter(rt);
+
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        interpreter.Eval(stmts.get());
+        return interpreter.Eval(parser.Parse(call, true).get()).ToString();
+    }
+}
+
+TEST_CASE("Tiered execution compiles hot functions in the background", "[tiered]") {
+    const char* code = R"(
+        fn work(n) {
+            var t = 0;
+            var i = 0;
+            while i < n {
+                t += i * 2 - 1;
+                i += 1;
+            }
+            return t;
+        }
+        var s = 0;
+        repeat 150 { s += work(10); }
+        s
+    )";
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    rt.SetDefaultEngine(ExecutionEngine::Tiered);
+    Interpreter interpreter(rt);
+
+    auto stmts = parser.Parse(code, true);
+    REQUIRE(stmts != nullptr);
+    auto decl = reinterpret_cast<FunctionDeclaration const*>(stmts->Get()[0].get());
+    REQUIRE(decl->NodeType() == AstNodeType::FunctionDeclaration);
+
+    auto tiers = interpreter.GetTieredCompiler();
+    REQUIRE(tiers != nullptr);
+    CHECK(interpreter.Eval(stmts.get()).ToString() == "12000");
+
+    // the body is queued once hot, and installed by the first call after it is compiled
+    tiers->Drain();
+    CHECK(tiers->CompiledCount() == 1);
+
+    auto call = parser.Parse("work(1000) + work(7)", true);
+    REQUIRE(call != nullptr);
+    CHECK(interpreter.Eval(call.get()).ToString() == RunWalker(code, "work(1000) + work(7)"));
+    CHECK(decl->Body()->CompiledCode() != nullptr);
+    CHECK(tiers->CompiledCount() == 1);
+}
+
+TEST_CASE("Tiered execution keeps tail calls flat in compiled code", "[tiered]") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    rt.SetDefaultEngine(ExecutionEngine::Tiered);
+    Interpreter interpreter(rt);
+
+    auto stmts = parser.Parse(R"(
+        fn loop(n, acc) {
+            if n == 0 { return acc; }
+            return loop(n - 1, acc + n);
+        }
+        repeat 10 { loop(10, 0); }
+    )", true);
+    REQUIRE(stmts != nullptr);
+    interpreter.Eval(stmts.get());
+    interpreter.GetTieredCompiler()->Drain();
+    CHECK(interpreter.GetTieredCompiler()->CompiledCount() == 1);
+
+    auto call = parser.Parse("loop(50000, 0)", true);
+    REQUIRE(call != nullptr);
+    CHECK(interpreter.Eval(call.get()).ToString() == "1250025000");
+}
+
+TEST_CASE("Tiered execution compiles functions with hot loops", "[tiered]") {
+    const char* code = R"(
+        class Point {
+            var x;
+            var y;
+            new(x, y) {
+                var i = 0;
+                while i < 2000 { i += 1; }
+                this.x = x;
+                this.y = y + i;
+            }
+        }
+        fn build(n) {
+            var items = [];
+            var count = 0;
+            for var i = 0; i < n; i += 1 {
+                if i % 3 == 0 { continue; }
+                count += 1;
+            }
+            foreach k in 0..n {
+                if k > 2500 { break; }
+                count += k % 7;
+            }
+            var p = new Point(count, n);
+            p.x + p.y
+        }
+        build(3000)
+    )";
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    rt.SetDefaultEngine(ExecutionEngine::Tiered);
+    Interpreter interpreter(rt);
+
+    auto stmts = parser.Parse(code, true);
+    REQUIRE(stmts != nullptr);
+    auto expected = RunWalker(code, "build(3000) + build(10)");
+    CHECK(interpreter.Eval(stmts.get()).ToString() == RunWalker(code, "build(3000)"));
+
+    // one long running call is enough
+    auto tiers = interpreter.GetTieredCompiler();
+    tiers->Drain();
+    CHECK(tiers->CompiledCount() == 1);
+
+    auto call = parser.Parse("build(3000) + build(10)", true);
+    REQUIRE(call != nullptr);
+    CHECK(interpreter.Eval(call.get()).ToString() == expected);
+
+    // back on the tree-walker, the compiler thread is gone
+    interpreter.SetEngine(ExecutionEngine::TreeWalker);
+    CHECK(interpreter.GetTieredCompiler() == nullptr);
+    CHECK(interpreter.Eval(call.get()).ToString() == expected);
+}
+
+TEST_CASE("Tiered execution forgets the bodies of freed trees", "[tiered]") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    rt.SetDefaultEngine(ExecutionEngine::Tiered);
+    Interpreter interpreter(rt);
+    auto tiers = interpreter.GetTieredCompiler();
+
+    // freed while its hot body is queued or compiling
+    auto stmts = parser.Parse(R"(
+        fn work(n) { var t = 0; repeat n { t += 2; } t }
+        var s = 0;
+        repeat 150 { s += work(3); }
+        s
+    )", true);
+    REQUIRE(stmts != nullptr);
+    CHECK(interpreter.Eval(stmts.get()).ToString() == "900");
+    stmts.reset();
+    tiers->Drain();
+
+    // a body parsed next, maybe at the same address, gets hot and compiled on its own
+    stmts = parser.Parse(R"(
+        fn more(n) { var t = 0; repeat n { t += 3; } t }
+        var m = 0;
+        repeat 150 { m += more(3); }
+        m
+    )", true);
+    REQUIRE(stmts != nullptr);
+    auto decl = reinterpret_cast<FunctionDeclaration const*>(stmts->Get()[0].get());
+    CHECK(interpreter.Eval(stmts.get()).ToString() == "1350");
+    tiers->Drain();
+    auto call = parser.Parse("more(5)", true);
+    CHECK(interpreter.Eval(call.get()).ToString() == "15");
+    CHECK(decl->Body()->CompiledCode() != nullptr);
+}
+
+TEST_CASE("Tiered execution leaves other threads' counts to them", "[tiered]") {
+    std::atomic<bool> done{ false };
+    std::string results;
+
+    // a script thread counting new bodies while trees are freed on this one
+    std::thread script([&] {
+        Runtime rt;
+        rt.SetDefaultEngine(ExecutionEngine::Tiered);
+        Interpreter interpreter(rt);
+        for (int i = 0; i < 100; i++) {
+            Tokenizer tokenizer;
+            Parser parser(tokenizer);
+            auto stmts = parser.Parse(std::format("fn s{0}(n) {{ n + {0} }} var r{0} = 0; repeat 20 {{ r{0} = s{0}(r{0}); }} r{0}", i), true);
+            if (!stmts)
+                break;
+            results += interpreter.Eval(stmts.get()).ToString() + " ";
+        }
+        done = true;
+    });
+
+    for (int i = 0; !done; i++) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        auto stmts = parser.Parse(std::format("fn a{0}() {{ 1 }} fn b{0}() {{ 2 }} fn c{0}() {{ 3 }}", i % 1000), true);
+        CHECK(stmts != nullptr);
+    }
+    script.join();
+
+    std::string expected;
+    for (int i = 0; i < 100; i++)
+        expected += std::to_string(20 * i) + " ";
+    CHECK(results == expected);
+}
@@ -0,0 +1,59 @@
+#include <catch.hpp>
+#include <Value.h>
+#include <limits>
+
+using namespace Dynamix;
+
+TEST_CASE("Strings are inline when short and shared when long", "[value]") {
+    std::string inlineText(Value::ShortStringMax, 'x'), sharedText = "more than thirteen characters";
+    Value empty(""), shortest("a"), longest(inlineText.c_str()), shared(sharedText.c_str());
+    CHECK(empty.IsShortString());
+    CHECK(shortest.IsShortString());
+    CHECK(longest.IsShortString());
+    CHECK(!shared.IsShortString());
+    CHECK(!Value((inlineText + "x").c_str()).IsShortString());
+    CHECK(empty.ToString().empty());
+    CHECK(longest.ToString() == inlineText);
+    CHECK(shared.ToString() == sharedText);
+    CHECK(!empty.ToBoolean());
+    CHECK(shortest.ToBoolean());
+
+    // copies of a long string share the same characters
+    Value copy(shared);
+    CHECK(copy.ToString() == shared.ToString());
+    CHECK(copy.Equal(shared).ToBoolean());
+    Value moved(std::move(copy));
+    CHECK(moved.ToString() == sharedText);
+
+    // equal contents compare equal regardless of how they were built
+    CHECK(Value(std::string_view(sharedText)).Equal(shared).ToBoolean());
+    CHECK(!Value("more than thirteen characterz").Equal(shared).ToBoolean());
+    CHECK(Value("x").Add(Value(inlineText.substr(1).c_str())).Equal(longest).ToBoolean());
+    CHECK(Value("more than ").Add(Value("thirteen characters")).Equal(shared).ToBoolean());
+    CHECK(Value("abc").LessThan(Value("abd")).ToBoolean());
+    CHECK(shared.InvokeIndexer(Value(5)).ToInteger() == 't');
+}
+
+TEST_CASE("Values round trip through either layout", "[value]") {
+    for (Int i : { 0LL, -1LL, 42LL, 1LL << 40, -(1LL << 47), (1LL << 47) - 1, 1LL << 47, -(1LL << 47) - 1, std::numeric_limits<Int>::max(), std::numeric_limits<Int>::min() }) {
+        Value v(i), copy(v);
+        CHECK(v.IsInteger());
+        CHECK(v.AsInteger() == i);
+        CHECK(copy.AsInteger() == i);
+        CHECK(v.Equal(copy).ToBoolean());
+    }
+    CHECK(Value(Int(1) << 50).Add(Value(Int(1) << 50)).AsInteger() == Int(1) << 51);
+
+    auto nan = std::numeric_limits<Real>::quiet_NaN(), inf = std::numeric_limits<Real>::infinity();
+    CHECK(Value(nan).IsReal());
+    CHECK(Value(-nan).IsReal());
+    CHECK(Value(inf - inf).IsReal());
+    CHECK(Value(-inf).IsReal());
+    CHECK(Value(-inf).AsReal() == -inf);
+    CHECK(Value(-0.5).AsReal() == -0.5);
+
+    CHECK(Value(true).IsBoolean());
+    CHECK(Value(false).ToBoolean() == false);
+    CHECK(Value().IsEmpty());
+    CHECK(Value::Error(ValueErrorType::TypeMismatch, "description").IsError());
+}
@@ -0,0 +1,173 @@
+#include <catch.hpp>
+#include <Parser.h>
+#include <Tokenizer.h>
+#include <AstNode.h>
+#include <Interpreter.h>
+#include <Value.h>
+#include <Runtime.h>
+
+using namespace Dynamix;
+
+namespace {
+    std::string RunWith(ExecutionEngine engine, const char* code) {
+        Tokenizer tokenizer;
+        Parser parser(tokenizer);
+        Runtime rt;
+        rt.SetDefaultEngine(engine);
+        Interpreter interpreter(rt);
+
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        return interpreter.Eval(stmts.get()).ToString();
+    }
+
+    std::string RunBoth(const char* code) {
+        auto walked = RunWith(ExecutionEngine::TreeWalker, code);
+        auto compiled = RunWith(ExecutionEngine::Bytecode, code);
+        CHECK(walked == compiled);
+        return compiled;
+    }
+}
+
+TEST_CASE("Bytecode engine matches the tree-walker", "[vm]") {
+    SECTION("Arithmetic and variables") {
+        CHECK(RunBoth("var x = 10; var y = x * 3 - 4; x += y; x % 7 + (y / 2)") == "14");
+        CHECK(RunBoth("var a = 2.5; a * 4 < 10 or a > 2 and not false") == "true");
+        CHECK(RunBoth(R"(var s = "abc"; s + "def")") == "abcdef");
+    }
+
+    SECTION("Loops with break and continue") {
+        CHECK(RunBoth(R"(
+            var sum = 0;
+            var i = 0;
+            while i < 100 {
+                i += 1;
+                if i % 2 == 0 { continue; }
+                if i > 50 { break; }
+                sum += i;
+            }
+            sum
+        )") == "625");
+
+        CHECK(RunBoth(R"(
+            var total = 0;
+            for var i = 0; i < 10; i += 1 {
+                if i == 3 { continue; }
+                total += i;
+            }
+            repeat 5 { total += 100; }
+            total
+        )") == "542");
+
+        CHECK(RunBoth(R"(
+            var sum = 0;
+            foreach item in [1, 2, 3, 4, 5, 6] {
+                if item == 5 { break; }
+                sum += item;
+            }
+            sum
+        )") == "10");
+    }
+
+    SECTION("Functions and recursion") {
+        CHECK(RunBoth(R"(
+            fn fib(n) {
+                if n < 2 { return n; }
+                return fib(n - 1) + fib(n - 2);
+            }
+            fib(15)
+        )") == "610");
+
+        CHECK(RunBoth(R"(
+            fn find(n) {
+                var i = 0;
+                while true {
+                    foreach x in [10, 20, 30] {
+                        if x == n { return i; }
+                        i += 1;
+                    }
+                    return -1;
+                }
+            }
+            find(30) * 10 + find(5)
+        )") == "19");
+    }
+
+    SECTION("Arrays, classes and tree-walked nodes") {
+        CHECK(RunBoth(R"(
+            var arr = [1, 2, 3];
+            arr[1] = 20;
+            arr[2] += 5;
+            arr[0] + arr[1] + arr[2]
+        )") == "29");
+
+        CHECK(RunBoth(R"(
+            class Counter {
+                var count = 0;
+                fn Inc(n) { this.count = this.count + n; return this.count; }
+            }
+            var c = new Counter();
+            repeat 10 { c.Inc(2); }
+            c.Inc(1)
+        )") == "21");
+
+        CHECK(RunBoth(R"(
+            var hits = 0;
+            var i = 0;
+            while true {
+                i += 1;
+                match i {
+                    case 3: continue;
+                    case 6: break;
+                    default: hits += i;
+                }
+            }
+            hits
+        )") == "12");
+    }
+}
+
+TEST_CASE("Bytecode engine releases temporaries like the tree-walker", "[vm]") {
+    const char* code = R"(
+        class Foo {
+            var x = 1;
+        }
+        repeat 1000 {
+            new Foo();
+        }
+        var x = new Foo();
+        typeof(Foo).ObjectCount()
+    )";
+    CHECK(RunBoth(code) == "1");
+}
+
+TEST_CASE("Bytecode engine runs tail calls in constant stack", "[vm]") {
+    Tokenizer tokenizer;
+    Parser parser(tokenizer);
+    Runtime rt;
+    rt.SetDefaultEngine(ExecutionEngine::Bytecode);
+    Interpreter interpreter(rt);
+    interpreter.SetMaxCallDepth(1000);
+
+    auto run = [&](const char* code) {
+        auto stmts = parser.Parse(code, true);
+        REQUIRE(stmts != nullptr);
+        auto result = interpreter.Eval(stmts.get()).ToString();
+        rt.AddCode(std::move(stmts));
+        return result;
+    };
+
+    run(R"(
+        fn count(n, total) { if n == 0 { return total; } return count(n - 1, total + 1); }
+        fn even(n) { if n == 0 { true } else { odd(n - 1) } }
+        fn odd(n) { match n { case 0: return false; default: return even(n - 1); } }
+        fn depth(n) { if n == 0 { return 0; } return 1 + depth(n - 1); }
+        fn g() { y }
+        fn f() { var y = 1; g() }
+    )");
+
+    CHECK(run("count(10000, 0)") == "10000");
+    CHECK(run("even(5001)") == "false");
+    CHECK(run("f()") == "1");
+    CHECK_THROWS_AS(run("depth(1000)"), RuntimeError);
+}
@@ -178,7 +178,7 @@ Value TreeViewVisitor::VisitAnonymousFunction(AnonymousFunctionExpression const*
     if (!func->Parameters().empty()) {
         CString params;
         for (auto& param : func->Parameters()) {
-            params += CString(param.Name.c_str()) + L", ";
+            params += CString(param.Name.ToString().c_str()) + L", ";
         }
         m_Tree.InsertItem(L"Parameters: " + params.Left(params.GetLength() - 2), m_hCurrent, TVI_LAST);
     }
@@ -281,7 +281,7 @@ Value TreeViewVisitor::VisitNewObjectExpression(NewObjectExpression const* expr)
     if (!expr->FieldInitializers().empty()) {
         hRoot = m_Tree.InsertItem(L"Field initializers", hRoot, TVI_LAST);
         for (auto& fi : expr->FieldInitializers()) {
-            m_hCurrent = m_Tree.InsertItem(CString(fi.Name.c_str()), hRoot, TVI_LAST);
+            m_hCurrent = m_Tree.InsertItem(CString(fi.Name.ToString().c_str()), hRoot, TVI_LAST);
             fi.Init->Accept(this);
         }
     }